@@ -30,6 +30,7 @@
 #include "basic-block.h"
 #include "function.h"
 #include "phi.h"
+#include "reg-alloc.h"
 #include "symbol.h"
 #include "symbol-table.h"
 
@@ -333,6 +334,8 @@ void Llvm2siFunctionCreate(Llvm2siFunction *self, LLVMValueRef llfunction)
 	self->name = str_set(self->name, (char *) LLVMGetValueName(llfunction));
 	self->arg_list = list_create();
 	self->uav_list = list_create();
+	self->sreg_range_list = list_create();
+	self->vreg_range_list = list_create();
 	self->symbol_table = new(Llvm2siSymbolTable);
 	self->ctree = ctree = new(CTree, self->name);
 	self->phi_list = new(List);
@@ -370,6 +373,14 @@ void Llvm2siFunctionDestroy(Llvm2siFunction *self)
 		delete(asLlvm2siFunctionUAV(list_get(self->uav_list, index)));
 	list_free(self->uav_list);
 
+	/* Free register ranges */
+	LIST_FOR_EACH(self->sreg_range_list, index)
+		llvm2si_reg_range_free(list_get(self->sreg_range_list, index));
+	LIST_FOR_EACH(self->vreg_range_list, index)
+		llvm2si_reg_range_free(list_get(self->vreg_range_list, index));
+	list_free(self->sreg_range_list);
+	list_free(self->vreg_range_list);
+
 	/* Free control tree */
 	if (self->ctree)
 		delete(self->ctree);
@@ -1221,6 +1232,8 @@ int Llvm2siFunctionAllocSReg(Llvm2siFunction *self, int count, int align)
 	self->num_sregs = (self->num_sregs + align - 1)
 			/ align * align;
 	self->num_sregs += count;
+	list_add(self->sreg_range_list, llvm2si_reg_range_create(
+			self->num_sregs - count, count, align));
 	return self->num_sregs - count;
 }
 
@@ -1230,5 +1243,7 @@ int Llvm2siFunctionAllocVReg(Llvm2siFunction *self, int count, int align)
 	self->num_vregs = (self->num_vregs + align - 1)
 			/ align * align;
 	self->num_vregs += count;
+	list_add(self->vreg_range_list, llvm2si_reg_range_create(
+			self->num_vregs - count, count, align));
 	return self->num_vregs - count;
 }
@@ -111,6 +111,12 @@ CLASS_BEGIN(Llvm2siFunction, Object)
 	int num_sregs;  /* Scalar */
 	int num_vregs;  /* Vector */
 
+	/* Ranges of virtual registers allocated during code emission, used
+	 * later by the register allocator. Elements of type
+	 * 'struct llvm2si_reg_range_t'. */
+	struct list_t *sreg_range_list;
+	struct list_t *vreg_range_list;
+
 	int sreg_uav_table;  /* UAV table (2 registers) */
 	int sreg_cb0;  /* CB0 (4 registers) */
 	int sreg_cb1;  /* CB1 (4 registers) */
@@ -218,8 +224,9 @@ struct si2bin_arg_t *Llvm2siFunctionConstToVReg(
 		Llvm2siBasicBlock *basic_block,
 		struct si2bin_arg_t *arg);
 
-/* Allocate 'count' scalar/vector registers where the first register
- * identifier is a multiple of 'align'. */
+/* Allocate 'count' scalar/vector virtual registers where the first register
+ * identifier is a multiple of 'align'. Virtual registers are replaced with
+ * physical registers by 'Llvm2siFunctionAllocRegisters'. */
 int Llvm2siFunctionAllocSReg(Llvm2siFunction *function,
 		int count, int align);
 int Llvm2siFunctionAllocVReg(Llvm2siFunction *function,
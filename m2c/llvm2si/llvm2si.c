@@ -28,6 +28,7 @@
 #include "function.h"
 #include "llvm2si.h"
 #include "phi.h"
+#include "reg-alloc.h"
 #include "symbol.h"
 #include "symbol-table.h"
 
@@ -86,6 +87,9 @@ static void llvm2si_compile_file(char *source_file, char *output_file)
 		Llvm2siFunctionEmitPhi(function);
 		Llvm2siFunctionEmitControlFlow(function);
 
+		/* Assign physical registers */
+		Llvm2siFunctionAllocRegisters(function);
+
 		/* Dump code */
 		Llvm2siFunctionDump(asObject(function), f);
 
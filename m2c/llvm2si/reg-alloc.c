@@ -0,0 +1,829 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2013  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <assert.h>
+#include <limits.h>
+#include <string.h>
+
+#include <m2c/common/ctree.h>
+#include <m2c/si2bin/arg.h>
+#include <m2c/si2bin/inst.h>
+#include <lib/class/list.h>
+#include <lib/mhandle/mhandle.h>
+#include <lib/util/bit-map.h>
+#include <lib/util/debug.h>
+#include <lib/util/linked-list.h>
+#include <lib/util/list.h>
+#include <lib/util/misc.h>
+
+#include "basic-block.h"
+#include "function.h"
+#include "reg-alloc.h"
+
+
+/*
+ * Register range
+ */
+
+struct llvm2si_reg_range_t *llvm2si_reg_range_create(int base, int count,
+		int align)
+{
+	struct llvm2si_reg_range_t *range;
+
+	/* Initialize */
+	range = xcalloc(1, sizeof(struct llvm2si_reg_range_t));
+	range->base = base;
+	range->count = count;
+	range->align = align;
+
+	/* Return */
+	return range;
+}
+
+
+void llvm2si_reg_range_free(struct llvm2si_reg_range_t *range)
+{
+	free(range);
+}
+
+
+
+
+/*
+ * Private Functions
+ */
+
+/* Group of virtual registers allocated together. Each group comes from one
+ * register range of the function and is assigned as a unit. */
+struct llvm2si_reg_group_t
+{
+	int vector;  /* Vector (1) or scalar (0) registers */
+	int base;  /* First virtual register */
+	int count;  /* Number of registers */
+	int align;  /* Alignment of the physical register */
+
+	/* Group stays in its original registers. This is the case for the
+	 * registers initialized by the runtime or the hardware, whose position
+	 * is part of the kernel interface. */
+	int fixed;
+
+	/* Live interval, as the positions of the first and last instructions
+	 * where the group is live. Field 'start' is INT_MAX if the group is
+	 * never used. */
+	int start;
+	int end;
+
+	/* Physical register assigned */
+	int new_base;
+};
+
+/* Basic block in code layout order, with its liveness information. Bit maps
+ * have one entry per virtual register, scalar registers first, so that a
+ * write to some registers of a group does not kill the others. */
+struct llvm2si_reg_block_t
+{
+	Llvm2siBasicBlock *basic_block;
+
+	/* Position of first and last instruction */
+	int first;
+	int last;
+
+	/* Successor blocks, elements of type 'struct llvm2si_reg_block_t' */
+	struct list_t *succ_list;
+
+	struct bit_map_t *use;  /* Read before written in the block */
+	struct bit_map_t *def;  /* Written in the block */
+	struct bit_map_t *live_in;
+	struct bit_map_t *live_out;
+};
+
+struct llvm2si_reg_alloc_t
+{
+	Llvm2siFunction *function;
+
+	/* Blocks, elements of type 'struct llvm2si_reg_block_t' */
+	struct list_t *block_list;
+
+	/* Register groups */
+	int num_groups;
+	struct llvm2si_reg_group_t *groups;
+
+	/* Group index of each virtual scalar and vector register, or -1 if
+	 * the register was left unused to satisfy an alignment. */
+	int *sreg_group;
+	int *vreg_group;
+
+	/* Number of entries in the liveness bit maps */
+	int num_regs;
+};
+
+
+static void llvm2si_reg_alloc_add_groups(struct llvm2si_reg_alloc_t *alloc,
+		struct list_t *range_list, int vector, int *reg_group)
+{
+	struct llvm2si_reg_range_t *range;
+	struct llvm2si_reg_group_t *group;
+
+	int index;
+	int reg;
+
+	LIST_FOR_EACH(range_list, index)
+	{
+		range = list_get(range_list, index);
+		group = &alloc->groups[alloc->num_groups];
+		group->vector = vector;
+		group->base = range->base;
+		group->count = range->count;
+		group->align = MAX(range->align, 1);
+		group->start = INT_MAX;
+		group->end = -1;
+		group->new_base = -1;
+
+		/* 64-bit scalar operands must start at an even register, and
+		 * 128-bit resource descriptors at a multiple of 4. */
+		if (!vector && range->count == 2)
+			group->align = MAX(group->align, 2);
+		if (!vector && range->count >= 4)
+			group->align = MAX(group->align, 4);
+
+		for (reg = range->base; reg < range->base + range->count; reg++)
+			reg_group[reg] = alloc->num_groups;
+		alloc->num_groups++;
+	}
+}
+
+
+static void llvm2si_reg_alloc_fix_group(struct llvm2si_reg_alloc_t *alloc,
+		int *reg_group, int reg)
+{
+	int group_index;
+
+	group_index = reg_group[reg];
+	assert(group_index >= 0);
+	alloc->groups[group_index].fixed = 1;
+}
+
+
+static struct llvm2si_reg_alloc_t *llvm2si_reg_alloc_create(
+		Llvm2siFunction *function)
+{
+	struct llvm2si_reg_alloc_t *alloc;
+	struct llvm2si_reg_block_t *block;
+	Llvm2siBasicBlock *basic_block;
+
+	List *node_list;
+	Node *node;
+
+	int num_ranges;
+	int num_regs;
+	int index;
+
+	/* Initialize */
+	alloc = xcalloc(1, sizeof(struct llvm2si_reg_alloc_t));
+	alloc->function = function;
+	alloc->block_list = list_create();
+
+	/* Register groups */
+	num_ranges = list_count(function->sreg_range_list) +
+			list_count(function->vreg_range_list);
+	alloc->groups = xcalloc(MAX(num_ranges, 1),
+			sizeof(struct llvm2si_reg_group_t));
+	alloc->sreg_group = xcalloc(MAX(function->num_sregs, 1), sizeof(int));
+	alloc->vreg_group = xcalloc(MAX(function->num_vregs, 1), sizeof(int));
+	for (index = 0; index < function->num_sregs; index++)
+		alloc->sreg_group[index] = -1;
+	for (index = 0; index < function->num_vregs; index++)
+		alloc->vreg_group[index] = -1;
+	llvm2si_reg_alloc_add_groups(alloc, function->sreg_range_list,
+			0, alloc->sreg_group);
+	llvm2si_reg_alloc_add_groups(alloc, function->vreg_range_list,
+			1, alloc->vreg_group);
+
+	/* Registers populated by the runtime and the hardware */
+	llvm2si_reg_alloc_fix_group(alloc, alloc->sreg_group,
+			function->sreg_uav_table);
+	llvm2si_reg_alloc_fix_group(alloc, alloc->sreg_group,
+			function->sreg_cb0);
+	llvm2si_reg_alloc_fix_group(alloc, alloc->sreg_group,
+			function->sreg_cb1);
+	llvm2si_reg_alloc_fix_group(alloc, alloc->sreg_group,
+			function->sreg_wgid);
+	llvm2si_reg_alloc_fix_group(alloc, alloc->vreg_group,
+			function->vreg_lid);
+
+	/* Blocks in the same order as they are dumped */
+	alloc->num_regs = function->num_sregs + function->num_vregs;
+	num_regs = MAX(alloc->num_regs, 1);
+	node_list = new(List);
+	CTreeTraverse(function->ctree, node_list, NULL);
+	ListForEach(node_list, node, Node)
+	{
+		/* Skip abstract nodes and empty blocks */
+		if (!isLeafNode(node))
+			continue;
+		basic_block = asLlvm2siBasicBlock(asLeafNode(node)->basic_block);
+		if (!basic_block || !basic_block->inst_list->count)
+			continue;
+
+		/* Create block */
+		block = xcalloc(1, sizeof(struct llvm2si_reg_block_t));
+		block->basic_block = basic_block;
+		block->succ_list = list_create();
+		block->use = bit_map_create(num_regs);
+		block->def = bit_map_create(num_regs);
+		block->live_in = bit_map_create(num_regs);
+		block->live_out = bit_map_create(num_regs);
+		list_add(alloc->block_list, block);
+	}
+	delete(node_list);
+
+	/* Return */
+	return alloc;
+}
+
+
+static void llvm2si_reg_alloc_free(struct llvm2si_reg_alloc_t *alloc)
+{
+	struct llvm2si_reg_block_t *block;
+	int index;
+
+	LIST_FOR_EACH(alloc->block_list, index)
+	{
+		block = list_get(alloc->block_list, index);
+		list_free(block->succ_list);
+		bit_map_free(block->use);
+		bit_map_free(block->def);
+		bit_map_free(block->live_in);
+		bit_map_free(block->live_out);
+		free(block);
+	}
+	list_free(alloc->block_list);
+	free(alloc->groups);
+	free(alloc->sreg_group);
+	free(alloc->vreg_group);
+	free(alloc);
+}
+
+
+/* Return the group of the register at position 'index' of the liveness bit
+ * maps, or -1 if the register is not part of any group. */
+static int llvm2si_reg_alloc_get_group(struct llvm2si_reg_alloc_t *alloc,
+		int index)
+{
+	if (index < alloc->function->num_sregs)
+		return alloc->sreg_group[index];
+	return alloc->vreg_group[index - alloc->function->num_sregs];
+}
+
+
+/* Return the block whose leaf node is named 'name', or NULL if the block
+ * does not exist or contains no code. */
+static struct llvm2si_reg_block_t *llvm2si_reg_alloc_get_block(
+		struct llvm2si_reg_alloc_t *alloc, char *name)
+{
+	struct llvm2si_reg_block_t *block;
+	LeafNode *node;
+	int index;
+
+	LIST_FOR_EACH(alloc->block_list, index)
+	{
+		block = list_get(alloc->block_list, index);
+		node = asBasicBlock(block->basic_block)->node;
+		if (!strcmp(asNode(node)->name, name))
+			return block;
+	}
+	return NULL;
+}
+
+
+/* Populate the successor list of each block. Code for structured control flow
+ * runs the blocks in layout order under an active mask, so every block falls
+ * through into the next one, unless it ends with an unconditional branch. The
+ * only other edges are those created by branch instructions, such as the
+ * backward branch closing a loop, or the branch skipping a loop body when no
+ * work-item is active. */
+static void llvm2si_reg_alloc_build_cfg(struct llvm2si_reg_alloc_t *alloc)
+{
+	struct llvm2si_reg_block_t *block;
+	struct llvm2si_reg_block_t *succ;
+	struct si2bin_inst_t *inst;
+	struct si2bin_arg_t *arg;
+	struct linked_list_t *inst_list;
+
+	int index;
+	int arg_index;
+
+	LIST_FOR_EACH(alloc->block_list, index)
+	{
+		block = list_get(alloc->block_list, index);
+		inst_list = block->basic_block->inst_list;
+
+		/* Branch targets */
+		LINKED_LIST_FOR_EACH(inst_list)
+		{
+			inst = linked_list_get(inst_list);
+			LIST_FOR_EACH(inst->arg_list, arg_index)
+			{
+				arg = list_get(inst->arg_list, arg_index);
+				if (arg->type != si2bin_arg_label)
+					continue;
+				succ = llvm2si_reg_alloc_get_block(alloc,
+						arg->value.label.name);
+				if (!succ)
+					fatal("%s: label '%s' not found",
+						__FUNCTION__, arg->value.label.name);
+				if (list_index_of(block->succ_list, succ) < 0)
+					list_add(block->succ_list, succ);
+			}
+		}
+
+		/* Fall-through */
+		linked_list_tail(inst_list);
+		inst = linked_list_get(inst_list);
+		if (inst->opcode == SI_INST_S_BRANCH ||
+				inst->opcode == SI_INST_S_ENDPGM)
+			continue;
+		succ = list_get(alloc->block_list, index + 1);
+		if (succ && list_index_of(block->succ_list, succ) < 0)
+			list_add(block->succ_list, succ);
+	}
+}
+
+
+/* Record an occurrence of virtual register 'reg' at instruction position
+ * 'pos' within 'block'. */
+static void llvm2si_reg_alloc_access(struct llvm2si_reg_alloc_t *alloc,
+		struct llvm2si_reg_block_t *block, int vector, int reg,
+		int pos, int is_def)
+{
+	struct llvm2si_reg_group_t *group;
+
+	int group_index;
+	int index;
+
+	/* Unknown register */
+	group_index = vector ? alloc->vreg_group[reg] : alloc->sreg_group[reg];
+	if (group_index < 0)
+		panic("%s: register not allocated", __FUNCTION__);
+
+	/* Live interval */
+	group = &alloc->groups[group_index];
+	group->start = MIN(group->start, pos);
+	group->end = MAX(group->end, pos);
+
+	/* Local liveness sets */
+	index = vector ? alloc->function->num_sregs + reg : reg;
+	if (is_def)
+		bit_map_set(block->def, index, 1, 1);
+	else if (!bit_map_get(block->def, index, 1))
+		bit_map_set(block->use, index, 1, 1);
+}
+
+
+/* Record the registers accessed by argument 'arg' */
+static void llvm2si_reg_alloc_access_arg(struct llvm2si_reg_alloc_t *alloc,
+		struct llvm2si_reg_block_t *block, struct si2bin_arg_t *arg,
+		int pos, int is_def)
+{
+	int *reg_group;
+	int vector;
+	int low;
+	int high;
+	int reg;
+
+	switch (arg->type)
+	{
+
+	case si2bin_arg_scalar_register:
+
+		llvm2si_reg_alloc_access(alloc, block, 0,
+				arg->value.scalar_register.id, pos, is_def);
+		return;
+
+	case si2bin_arg_vector_register:
+
+		llvm2si_reg_alloc_access(alloc, block, 1,
+				arg->value.vector_register.id, pos, is_def);
+		return;
+
+	case si2bin_arg_scalar_register_series:
+
+		reg_group = alloc->sreg_group;
+		vector = 0;
+		low = arg->value.scalar_register_series.low;
+		high = arg->value.scalar_register_series.high;
+		break;
+
+	case si2bin_arg_vector_register_series:
+
+		reg_group = alloc->vreg_group;
+		vector = 1;
+		low = arg->value.vector_register_series.low;
+		high = arg->value.vector_register_series.high;
+		break;
+
+	case si2bin_arg_maddr:
+
+		if (arg->value.maddr.soffset)
+			llvm2si_reg_alloc_access_arg(alloc, block,
+					arg->value.maddr.soffset, pos, 0);
+		return;
+
+	default:
+		return;
+	}
+
+	/* A series spanning more than one group can only be encoded if all
+	 * groups keep their relative position, so leave them in place. */
+	for (reg = low; reg <= high; reg++)
+	{
+		if (reg_group[reg] != reg_group[low])
+		{
+			for (reg = low; reg <= high; reg++)
+				llvm2si_reg_alloc_fix_group(alloc, reg_group, reg);
+			break;
+		}
+	}
+
+	/* Access every register in the series */
+	for (reg = low; reg <= high; reg++)
+		llvm2si_reg_alloc_access(alloc, block, vector, reg, pos, is_def);
+}
+
+
+/* Number the instructions in layout order, and compute for each block the set
+ * of registers read before being written, and the set of registers written.
+ * Whether the first argument of an instruction is written, read, or both is
+ * given by the flags of the instruction in the disassembler table. */
+static void llvm2si_reg_alloc_scan(struct llvm2si_reg_alloc_t *alloc)
+{
+	struct llvm2si_reg_block_t *block;
+	struct si2bin_inst_t *inst;
+	struct si2bin_arg_t *arg;
+	struct linked_list_t *inst_list;
+	struct si_inst_info_t *info;
+
+	int has_def;
+	int has_use;
+	int index;
+	int arg_index;
+	int pos;
+
+	pos = 0;
+	LIST_FOR_EACH(alloc->block_list, index)
+	{
+		block = list_get(alloc->block_list, index);
+		inst_list = block->basic_block->inst_list;
+		block->first = pos;
+		LINKED_LIST_FOR_EACH(inst_list)
+		{
+			/* Source operands are read before the destination is
+			 * written. */
+			inst = linked_list_get(inst_list);
+			info = &si_inst_info[inst->opcode];
+			has_def = !(info->flags & SI_INST_FLAG_DST_NONE);
+			has_use = info->flags & SI_INST_FLAG_DST_READ;
+			LIST_FOR_EACH(inst->arg_list, arg_index)
+			{
+				if (has_def && !has_use && !arg_index)
+					continue;
+				arg = list_get(inst->arg_list, arg_index);
+				llvm2si_reg_alloc_access_arg(alloc, block,
+						arg, pos, 0);
+			}
+			if (has_def && list_count(inst->arg_list))
+				llvm2si_reg_alloc_access_arg(alloc, block,
+						list_get(inst->arg_list, 0), pos, 1);
+			pos++;
+		}
+		block->last = pos - 1;
+	}
+}
+
+
+/* Iterative backward data-flow analysis computing the registers live at the
+ * entry and exit of each block. */
+static void llvm2si_reg_alloc_liveness(struct llvm2si_reg_alloc_t *alloc)
+{
+	struct llvm2si_reg_block_t *block;
+	struct llvm2si_reg_block_t *succ;
+
+	int changed;
+	int live;
+	int index;
+	int succ_index;
+	int reg;
+
+	do
+	{
+		changed = 0;
+		for (index = list_count(alloc->block_list) - 1; index >= 0; index--)
+		{
+			block = list_get(alloc->block_list, index);
+			for (reg = 0; reg < alloc->num_regs; reg++)
+			{
+				/* Live out if live into any successor */
+				live = 0;
+				LIST_FOR_EACH(block->succ_list, succ_index)
+				{
+					succ = list_get(block->succ_list, succ_index);
+					if (bit_map_get(succ->live_in, reg, 1))
+					{
+						live = 1;
+						break;
+					}
+				}
+				bit_map_set(block->live_out, reg, 1, live);
+
+				/* Live in if read in the block, or live out and
+				 * not written in the block. */
+				live = bit_map_get(block->use, reg, 1) ||
+					(live && !bit_map_get(block->def, reg, 1));
+				if (live && !bit_map_get(block->live_in, reg, 1))
+				{
+					bit_map_set(block->live_in, reg, 1, 1);
+					changed = 1;
+				}
+			}
+		}
+	} while (changed);
+}
+
+
+/* Extend the live interval of each group to cover all blocks where any of its
+ * registers is live in or out. Together with the first and last occurrences
+ * in layout order, this gives one interval per group. Intervals are contiguous
+ * on purpose: a vector register written under a partial active mask does not
+ * overwrite the values of inactive work-items, so no hole can be assumed in
+ * them. */
+static void llvm2si_reg_alloc_intervals(struct llvm2si_reg_alloc_t *alloc)
+{
+	struct llvm2si_reg_block_t *block;
+	struct llvm2si_reg_group_t *group;
+
+	int index;
+	int group_index;
+	int reg;
+
+	LIST_FOR_EACH(alloc->block_list, index)
+	{
+		block = list_get(alloc->block_list, index);
+		for (reg = 0; reg < alloc->num_regs; reg++)
+		{
+			group_index = llvm2si_reg_alloc_get_group(alloc, reg);
+			if (group_index < 0)
+				continue;
+			group = &alloc->groups[group_index];
+			if (bit_map_get(block->live_in, reg, 1))
+			{
+				group->start = MIN(group->start, block->first);
+				group->end = MAX(group->end, block->first);
+			}
+			if (bit_map_get(block->live_out, reg, 1))
+			{
+				group->start = MIN(group->start, block->last);
+				group->end = MAX(group->end, block->last);
+			}
+		}
+	}
+
+	/* Registers populated before the kernel starts are live since its
+	 * first instruction. */
+	for (group_index = 0; group_index < alloc->num_groups; group_index++)
+	{
+		group = &alloc->groups[group_index];
+		if (group->fixed)
+		{
+			group->start = 0;
+			group->end = MAX(group->end, 0);
+		}
+	}
+}
+
+
+static int llvm2si_reg_group_compare(const void *ptr1, const void *ptr2)
+{
+	const struct llvm2si_reg_group_t *group1 = ptr1;
+	const struct llvm2si_reg_group_t *group2 = ptr2;
+
+	if (group1->start != group2->start)
+		return group1->start < group2->start ? -1 :  1;
+	if (group1->fixed != group2->fixed)
+		return group1->fixed ? -1 : 1;
+	return group1->base < group2->base ? -1 : group1->base > group2->base;
+}
+
+
+/* Linear-scan allocation of the groups of one register file. Groups are
+ * visited in increasing order of interval start, and each is assigned the
+ * lowest aligned set of physical registers that are free, that is, whose last
+ * assigned interval ended before this one starts. Registers are only released
+ * after the instruction where they were last live, so that a destination never
+ * overlaps a source of the same instruction. Return the number of physical
+ * registers used. */
+static int llvm2si_reg_alloc_scan_file(struct llvm2si_reg_alloc_t *alloc,
+		int vector)
+{
+	struct llvm2si_reg_group_t *group;
+	struct list_t *group_list;
+
+	int *busy;
+	int busy_size;
+	int num_regs;
+
+	int base;
+	int reg;
+	int index;
+
+	/* Groups with live intervals, in increasing order of start */
+	group_list = list_create();
+	for (index = 0; index < alloc->num_groups; index++)
+	{
+		group = &alloc->groups[index];
+		if (group->vector == vector && group->start != INT_MAX)
+			list_add(group_list, group);
+	}
+	list_sort(group_list, llvm2si_reg_group_compare);
+
+	/* Last position where each physical register is busy */
+	busy_size = 64;
+	busy = xmalloc(busy_size * sizeof(int));
+	for (reg = 0; reg < busy_size; reg++)
+		busy[reg] = -1;
+
+	/* Assign registers */
+	num_regs = 0;
+	LIST_FOR_EACH(group_list, index)
+	{
+		group = list_get(group_list, index);
+		if (group->fixed)
+		{
+			base = group->base;
+		}
+		else
+		{
+			for (base = 0; ; base += group->align)
+			{
+				for (reg = base; reg < base + group->count &&
+						reg < busy_size; reg++)
+					if (busy[reg] >= group->start)
+						break;
+				if (reg == base + group->count || reg == busy_size)
+					break;
+			}
+		}
+
+		/* Grow table */
+		while (base + group->count > busy_size)
+		{
+			busy = xrealloc(busy, busy_size * 2 * sizeof(int));
+			for (reg = busy_size; reg < busy_size * 2; reg++)
+				busy[reg] = -1;
+			busy_size *= 2;
+		}
+
+		/* Reserve registers */
+		for (reg = base; reg < base + group->count; reg++)
+			busy[reg] = group->end;
+		group->new_base = base;
+		num_regs = MAX(num_regs, base + group->count);
+	}
+
+	/* Free */
+	free(busy);
+	list_free(group_list);
+	return num_regs;
+}
+
+
+/* Return the physical register assigned to virtual register 'reg' */
+static int llvm2si_reg_alloc_map(struct llvm2si_reg_alloc_t *alloc,
+		int *reg_group, int reg)
+{
+	struct llvm2si_reg_group_t *group;
+
+	assert(reg_group[reg] >= 0);
+	group = &alloc->groups[reg_group[reg]];
+	assert(group->new_base >= 0);
+	return group->new_base + reg - group->base;
+}
+
+
+static void llvm2si_reg_alloc_rewrite_arg(struct llvm2si_reg_alloc_t *alloc,
+		struct si2bin_arg_t *arg)
+{
+	switch (arg->type)
+	{
+
+	case si2bin_arg_scalar_register:
+
+		arg->value.scalar_register.id = llvm2si_reg_alloc_map(alloc,
+				alloc->sreg_group, arg->value.scalar_register.id);
+		break;
+
+	case si2bin_arg_vector_register:
+
+		arg->value.vector_register.id = llvm2si_reg_alloc_map(alloc,
+				alloc->vreg_group, arg->value.vector_register.id);
+		break;
+
+	case si2bin_arg_scalar_register_series:
+
+		arg->value.scalar_register_series.low = llvm2si_reg_alloc_map(
+				alloc, alloc->sreg_group,
+				arg->value.scalar_register_series.low);
+		arg->value.scalar_register_series.high = llvm2si_reg_alloc_map(
+				alloc, alloc->sreg_group,
+				arg->value.scalar_register_series.high);
+		break;
+
+	case si2bin_arg_vector_register_series:
+
+		arg->value.vector_register_series.low = llvm2si_reg_alloc_map(
+				alloc, alloc->vreg_group,
+				arg->value.vector_register_series.low);
+		arg->value.vector_register_series.high = llvm2si_reg_alloc_map(
+				alloc, alloc->vreg_group,
+				arg->value.vector_register_series.high);
+		break;
+
+	case si2bin_arg_maddr:
+
+		if (arg->value.maddr.soffset)
+			llvm2si_reg_alloc_rewrite_arg(alloc,
+					arg->value.maddr.soffset);
+		break;
+
+	default:
+		break;
+	}
+}
+
+
+static void llvm2si_reg_alloc_rewrite(struct llvm2si_reg_alloc_t *alloc)
+{
+	struct llvm2si_reg_block_t *block;
+	struct si2bin_inst_t *inst;
+	struct linked_list_t *inst_list;
+
+	int index;
+	int arg_index;
+
+	LIST_FOR_EACH(alloc->block_list, index)
+	{
+		block = list_get(alloc->block_list, index);
+		inst_list = block->basic_block->inst_list;
+		LINKED_LIST_FOR_EACH(inst_list)
+		{
+			inst = linked_list_get(inst_list);
+			LIST_FOR_EACH(inst->arg_list, arg_index)
+				llvm2si_reg_alloc_rewrite_arg(alloc,
+					list_get(inst->arg_list, arg_index));
+		}
+	}
+}
+
+
+
+
+/*
+ * Public Functions
+ */
+
+void Llvm2siFunctionAllocRegisters(Llvm2siFunction *self)
+{
+	struct llvm2si_reg_alloc_t *alloc;
+
+	/* Liveness analysis */
+	alloc = llvm2si_reg_alloc_create(self);
+	llvm2si_reg_alloc_build_cfg(alloc);
+	llvm2si_reg_alloc_scan(alloc);
+	llvm2si_reg_alloc_liveness(alloc);
+	llvm2si_reg_alloc_intervals(alloc);
+
+	/* Assign physical registers and rename operands. The register counts
+	 * reported in the kernel metadata are derived from the highest
+	 * register used in the code. */
+	self->num_sregs = llvm2si_reg_alloc_scan_file(alloc, 0);
+	self->num_vregs = llvm2si_reg_alloc_scan_file(alloc, 1);
+	llvm2si_reg_alloc_rewrite(alloc);
+
+	/* Free */
+	llvm2si_reg_alloc_free(alloc);
+}
@@ -0,0 +1,52 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2013  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef M2C_LLVM2SI_REG_ALLOC_H
+#define M2C_LLVM2SI_REG_ALLOC_H
+
+#include <lib/class/class.h>
+
+
+/* Range of consecutive virtual registers returned by one call to
+ * 'Llvm2siFunctionAllocSReg' or 'Llvm2siFunctionAllocVReg'. The register
+ * allocator keeps all registers of a range together, and places them at a
+ * physical register that is a multiple of 'align'. */
+struct llvm2si_reg_range_t
+{
+	int base;
+	int count;
+	int align;
+};
+
+struct llvm2si_reg_range_t *llvm2si_reg_range_create(int base, int count,
+		int align);
+void llvm2si_reg_range_free(struct llvm2si_reg_range_t *range);
+
+
+/* Replace the virtual registers used in the code of 'function' with physical
+ * registers. Registers are assigned with a linear-scan allocator driven by a
+ * liveness analysis of the basic blocks in the control tree, so that values
+ * with disjoint live ranges share registers. Fields 'num_sregs' and
+ * 'num_vregs' of the function are updated with the number of physical
+ * registers actually used. This function must be called after all code has
+ * been emitted. */
+void Llvm2siFunctionAllocRegisters(Llvm2siFunction *function);
+
+
+#endif
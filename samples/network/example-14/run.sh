@@ -0,0 +1,35 @@
+#!/bin/sh
+#
+# Run the traces in this directory and check the results. Variable M2S can
+# point to the simulator binary (default is '../../../bin/m2s').
+#
+
+M2S=${M2S:-../../../bin/m2s}
+OPTIONS="--net-sim net0 --net-config net-trace --net-traffic-pattern trace
+	--net-msg-size 16 --net-max-cycles 100"
+
+cd `dirname $0`
+status=0
+
+# Trace 'trace' must produce the reference report
+$M2S $OPTIONS --net-traffic-trace trace --net-report net-report > /dev/null 2>&1
+if diff net-report.ref net0_net-report
+then
+	echo "trace: ok"
+else
+	echo "trace: report differs from 'net-report.ref'"
+	status=1
+fi
+rm -f net0_net-report
+
+# Trace 'trace-self' must be rejected
+if $M2S $OPTIONS --net-traffic-trace trace-self 2>&1 | \
+	grep -q "trace-self: line 3: source and destination are the same node"
+then
+	echo "trace-self: ok"
+else
+	echo "trace-self: self-sent message not rejected"
+	status=1
+fi
+
+exit $status
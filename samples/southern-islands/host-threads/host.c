@@ -0,0 +1,179 @@
+/*
+ * Host program running the kernels in 'vector-add.bin' and 'loop.bin' on the
+ * Southern Islands GPU. Instead of linking with the OpenCL runtime, it issues
+ * the OpenCL ABI calls (system call 329) directly, following the same sequence
+ * as the runtime. This way it needs no 32-bit C library and can be built with:
+ *
+ *   gcc -m32 -march=i386 -O1 -ffreestanding -fno-pic -fno-stack-protector \
+ *       -nostdlib -static host.c -o host
+ *
+ * The kernel binaries are embedded in the executable. The program prints
+ * PASSED if both kernels compute the expected results.
+ */
+
+#define N  1024
+#define WG 64
+
+/* ABI call codes, as listed in src/driver/opencl/opencl.dat */
+enum opencl_abi_call_t
+{
+	opencl_abi_init = 1,
+	opencl_abi_si_mem_alloc = 2,
+	opencl_abi_si_mem_read = 3,
+	opencl_abi_si_mem_write = 4,
+	opencl_abi_si_program_create = 7,
+	opencl_abi_si_program_set_binary = 8,
+	opencl_abi_si_kernel_create = 9,
+	opencl_abi_si_kernel_set_arg_pointer = 11,
+	opencl_abi_si_ndrange_initialize = 14,
+	opencl_abi_si_ndrange_get_num_buffer_entries = 15,
+	opencl_abi_si_ndrange_send_work_groups = 16,
+	opencl_abi_si_ndrange_finish = 17,
+	opencl_abi_si_ndrange_pass_mem_objs = 18,
+	opencl_abi_si_ndrange_set_fused = 19
+};
+
+int opencl_call(int code, ...);
+
+__asm__(
+	".text\n"
+	".globl _start\n"
+	"_start:\n"
+	"	call main\n"
+	"	movl %eax, %ebx\n"
+	"	movl $1, %eax\n"
+	"	int $0x80\n"
+
+	/* opencl_call(code, a1, a2, a3, a4, a5). The ABI call code goes in
+	 * ebx and the arguments in ecx, edx, esi, edi and ebp. */
+	".globl opencl_call\n"
+	"opencl_call:\n"
+	"	pushl %ebp\n"
+	"	pushl %ebx\n"
+	"	pushl %esi\n"
+	"	pushl %edi\n"
+	"	movl $329, %eax\n"
+	"	movl 20(%esp), %ebx\n"
+	"	movl 24(%esp), %ecx\n"
+	"	movl 28(%esp), %edx\n"
+	"	movl 32(%esp), %esi\n"
+	"	movl 36(%esp), %edi\n"
+	"	movl 40(%esp), %ebp\n"
+	"	int $0x80\n"
+	"	popl %edi\n"
+	"	popl %esi\n"
+	"	popl %ebx\n"
+	"	popl %ebp\n"
+	"	ret\n"
+
+	".section .rodata\n"
+	".globl vector_add_bin\n"
+	"vector_add_bin:\n"
+	"	.incbin \"vector-add.bin\"\n"
+	".globl vector_add_bin_end\n"
+	"vector_add_bin_end:\n"
+	".globl loop_bin\n"
+	"loop_bin:\n"
+	"	.incbin \"loop.bin\"\n"
+	".globl loop_bin_end\n"
+	"loop_bin_end:\n"
+	".text\n");
+
+extern const char vector_add_bin[], vector_add_bin_end[];
+extern const char loop_bin[], loop_bin_end[];
+
+static int a[N], b[N], c[N];
+
+static void print(const char *s)
+{
+	int len = 0;
+
+	while (s[len])
+		len++;
+	__asm__ volatile("int $0x80" : : "a" (4), "b" (1), "c" (s), "d" (len)
+		: "memory");
+}
+
+/* Load a kernel binary and run it over N work-items with pointer
+ * arguments 'args[0..num_args-1]' (device pointers). */
+static void run_kernel(const char *bin, const char *bin_end, char *name,
+	unsigned int *args, int num_args)
+{
+	unsigned int offset[3] = { 0, 0, 0 };
+	unsigned int global[3] = { N, 1, 1 };
+	unsigned int local[3] = { WG, 1, 1 };
+	unsigned int start[3] = { 0, 0, 0 };
+	unsigned int count[3] = { N / WG, 1, 1 };
+	int program_id;
+	int kernel_id;
+	int entries;
+	int i;
+
+	program_id = opencl_call(opencl_abi_si_program_create, 0, 0, 0, 0, 0);
+	opencl_call(opencl_abi_si_program_set_binary, program_id,
+		(int) bin, bin_end - bin, 0, 0);
+	kernel_id = opencl_call(opencl_abi_si_kernel_create, program_id,
+		(int) name, 0, 0, 0);
+	for (i = 0; i < num_args; i++)
+		opencl_call(opencl_abi_si_kernel_set_arg_pointer, kernel_id,
+			i, args[i], N * 4, 0);
+
+	opencl_call(opencl_abi_si_ndrange_set_fused, 0, 0, 0, 0, 0);
+	opencl_call(opencl_abi_si_ndrange_initialize, kernel_id, 1,
+		(int) offset, (int) global, (int) local);
+	opencl_call(opencl_abi_si_ndrange_pass_mem_objs, 0, 0, 0, 0, 0);
+	opencl_call(opencl_abi_si_ndrange_get_num_buffer_entries,
+		(int) &entries, 0, 0, 0, 0);
+	opencl_call(opencl_abi_si_ndrange_send_work_groups, (int) start,
+		(int) count, (int) count, 0, 0);
+	opencl_call(opencl_abi_si_ndrange_finish, 0, 0, 0, 0, 0);
+}
+
+int main(void)
+{
+	unsigned int args[3];
+	int version[2];
+	int errors = 0;
+	int sum;
+	int i;
+	int j;
+
+	opencl_call(opencl_abi_init, (int) version, 0, 0, 0, 0);
+
+	/* Device buffers */
+	for (i = 0; i < 3; i++)
+		args[i] = opencl_call(opencl_abi_si_mem_alloc, N * 4, 0, 0, 0, 0);
+
+	/* c = a + b */
+	for (i = 0; i < N; i++)
+	{
+		a[i] = i;
+		b[i] = 3 * i + 7;
+	}
+	opencl_call(opencl_abi_si_mem_write, args[0], (int) a, N * 4, 0, 0);
+	opencl_call(opencl_abi_si_mem_write, args[1], (int) b, N * 4, 0, 0);
+	run_kernel(vector_add_bin, vector_add_bin_end, "vector_add", args, 3);
+	opencl_call(opencl_abi_si_mem_read, (int) c, args[2], N * 4, 0, 0);
+	for (i = 0; i < N; i++)
+		if (c[i] != a[i] + b[i])
+			errors++;
+
+	/* out[i] = sum(j * j, j < in[i]) - i, with divergent trip counts */
+	for (i = 0; i < N; i++)
+		a[i] = (i * 7) % 23;
+	opencl_call(opencl_abi_si_mem_write, args[0], (int) a, N * 4, 0, 0);
+	args[1] = args[2];
+	run_kernel(loop_bin, loop_bin_end, "loop", args, 2);
+	opencl_call(opencl_abi_si_mem_read, (int) c, args[1], N * 4, 0, 0);
+	for (i = 0; i < N; i++)
+	{
+		sum = 0;
+		for (j = 0; j < a[i]; j++)
+			sum += j * j;
+		if (c[i] != sum - i)
+			errors++;
+	}
+
+	print(errors ? "FAILED\n" : "PASSED\n");
+	return errors != 0;
+}
@@ -0,0 +1,41 @@
+#!/bin/sh
+#
+# Run 'host' with the Southern Islands detailed simulation, first on one host
+# thread and then on several ('--si-host-threads'), for the default GPU and for
+# a GPU with 4 compute units. All runs must produce the reference report.
+# Variable M2S can point to the simulator binary (default is '../../../bin/m2s').
+#
+
+M2S=${M2S:-../../../bin/m2s}
+
+cd `dirname $0`
+status=0
+
+for gpu in default 4cu
+do
+	if [ $gpu = 4cu ]
+	then
+		config="--si-config ../4CU-GPU/si-config"
+	else
+		config=""
+	fi
+	for threads in 1 2 4
+	do
+		$M2S --si-sim detailed $config --si-host-threads $threads \
+			--si-report si-report host > host.out 2>&1
+		if ! grep -q PASSED host.out
+		then
+			echo "$gpu, $threads threads: kernels failed"
+			status=1
+		elif ! diff si-report-$gpu.ref si-report > /dev/null
+		then
+			echo "$gpu, $threads threads: report differs from 'si-report-$gpu.ref'"
+			status=1
+		else
+			echo "$gpu, $threads threads: ok"
+		fi
+	done
+done
+
+rm -f host.out si-report
+exit $status
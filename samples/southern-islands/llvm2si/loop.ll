@@ -0,0 +1,37 @@
+; __kernel void loop(__global int *in, __global int *out)
+; {
+; 	int gid = get_global_id(0);
+; 	int n = in[gid];
+; 	int acc = 0;
+; 	for (int i = 0; i < n; i++)
+; 		acc += i * i;
+; 	out[gid] = acc - gid;
+; }
+
+define void @loop(i32 addrspace(1)* %in, i32 addrspace(1)* %out) {
+entry:
+  %gid = call i32 @get_global_id(i32 0)
+  %pin = getelementptr i32, i32 addrspace(1)* %in, i32 %gid
+  %n = load i32, i32 addrspace(1)* %pin
+  br label %cond
+
+cond:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %body ]
+  %acc = phi i32 [ 0, %entry ], [ %acc.next, %body ]
+  %cmp = icmp slt i32 %i, %n
+  br i1 %cmp, label %body, label %end
+
+body:
+  %sq = mul i32 %i, %i
+  %acc.next = add i32 %acc, %sq
+  %i.next = add i32 %i, 1
+  br label %cond
+
+end:
+  %res = sub i32 %acc, %gid
+  %pout = getelementptr i32, i32 addrspace(1)* %out, i32 %gid
+  store i32 %res, i32 addrspace(1)* %pout
+  ret void
+}
+
+declare i32 @get_global_id(i32) nounwind
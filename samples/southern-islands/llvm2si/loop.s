@@ -0,0 +1,102 @@
+.global loop
+
+.args
+	i32* in 0 uav10
+	i32* out 16 uav11
+
+.text
+
+header:
+
+	# Obtain global size
+	s_buffer_load_dword s13, s[2:5], 0x0
+	s_buffer_load_dword s14, s[2:5], 0x1
+	s_buffer_load_dword s15, s[2:5], 0x2
+
+	# Obtain local size
+	s_buffer_load_dword s13, s[2:5], 0x4
+	s_buffer_load_dword s14, s[2:5], 0x5
+	s_buffer_load_dword s15, s[2:5], 0x6
+
+	# Obtain global offset
+	s_buffer_load_dword s16, s[2:5], 0x18
+	s_buffer_load_dword s17, s[2:5], 0x19
+	s_buffer_load_dword s18, s[2:5], 0x1a
+
+	# Calculate global ID in dimension 0
+	v_mov_b32 v3, s13
+	v_mul_i32_i24 v3, s10, v3
+	v_add_i32 v3, vcc, v3, v0
+	v_add_i32 v3, vcc, s16, v3
+
+	# Calculate global ID in dimension 1
+	v_mov_b32 v4, s14
+	v_mul_i32_i24 v4, s11, v4
+	v_add_i32 v4, vcc, v4, v1
+	v_add_i32 v4, vcc, s17, v4
+
+	# Calculate global ID in dimension 2
+	v_mov_b32 v5, s15
+	v_mul_i32_i24 v5, s12, v5
+	v_add_i32 v5, vcc, v5, v2
+	v_add_i32 v5, vcc, s18, v5
+
+uavs:
+	s_load_dwordx4 s[12:15], s[0:1], 0x50
+	s_load_dwordx4 s[16:19], s[0:1], 0x58
+
+args:
+	s_buffer_load_dword s0, s[6:9], 0x0
+	v_mov_b32 v0, s0
+	s_buffer_load_dword s0, s[6:9], 0x4
+	v_mov_b32 v1, s0
+
+entry:
+	v_mul_i32_i24 v2, 0x4, v3
+	v_add_i32 v6, vcc, v2, v0
+	tbuffer_load_format_x v0, v6, s[12:15], 0x0 offen format:[BUF_DATA_FORMAT_32,BUF_NUM_FORMAT_FLOAT]
+	v_mov_b32 v2, 0x0
+	v_mov_b32 v6, 0x0
+
+__while_loop_0_pre:
+	s_mov_b64 s[0:1], exec
+
+cond:
+	v_cmp_lt_i32 vcc, v2, v0
+	s_mov_b64 s[2:3], vcc
+	s_and_b64 exec, exec, s[2:3]
+	s_cbranch_execz  __while_loop_0_exit
+
+body:
+	v_mul_lo_u32 v7, v2, v2
+	v_add_i32 v8, vcc, v6, v7
+	v_mov_b32 v7, 0x1
+	v_add_i32 v9, vcc, v2, v7
+	v_mov_b32 v2, v9
+	v_mov_b32 v6, v8
+	s_branch  cond
+
+__while_loop_0_exit:
+	s_mov_b64 exec, s[0:1]
+
+end:
+	v_sub_i32 v0, vcc, v6, v3
+	v_mul_i32_i24 v2, 0x4, v3
+	v_add_i32 v3, vcc, v2, v1
+	tbuffer_store_format_x v0, v3, s[16:19], 0x0 offen format:[BUF_DATA_FORMAT_32,BUF_NUM_FORMAT_FLOAT]
+	s_endpgm 
+
+.metadata
+	userElements[0] = PTR_UAV_TABLE, 0, s[0:1]
+	userElements[1] = IMM_CONST_BUFFER, 0, s[2:5]
+	userElements[2] = IMM_CONST_BUFFER, 1, s[6:9]
+
+	FloatMode = 192
+	IeeeMode = 0
+
+	COMPUTE_PGM_RSRC2:USER_SGPR = 10
+	COMPUTE_PGM_RSRC2:TGID_X_EN = 1
+	COMPUTE_PGM_RSRC2:TGID_Y_EN = 1
+	COMPUTE_PGM_RSRC2:TGID_Z_EN = 1
+
+
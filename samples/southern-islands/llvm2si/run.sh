@@ -0,0 +1,57 @@
+#!/bin/sh
+#
+# Compile the kernels in this directory with the LLVM-to-SI back-end and check
+# the output against the reference assembly files and register counts.
+# Variable M2C points to the compiler (default is '../../../bin/m2c'), and
+# LLVM_AS to the LLVM assembler of the LLVM version m2c was built with
+# (default is 'llvm-as').
+#
+
+M2C=${M2C:-../../../bin/m2c}
+LLVM_AS=${LLVM_AS:-llvm-as}
+
+cd `dirname $0`
+status=0
+
+# Print the number of scalar and vector registers used in section '.text' of
+# an SI assembly file, as the highest register index plus one.
+reg_count()
+{
+	awk '
+	/^\./ { text = ($1 == ".text"); next }
+	!text || /^[ \t]*#/ { next }
+	{
+		line = $0
+		while (match(line, /[sv]\[[0-9]+:[0-9]+\]|[sv][0-9]+/)) {
+			tok = substr(line, RSTART, RLENGTH)
+			line = substr(line, RSTART + RLENGTH)
+			kind = substr(tok, 1, 1)
+			gsub(/[sv\[\]]/, "", tok)
+			n = split(tok, r, ":")
+			if (kind == "s" && r[n] + 1 > ns) ns = r[n] + 1
+			if (kind == "v" && r[n] + 1 > nv) nv = r[n] + 1
+		}
+	}
+	END { print ns + 0, nv + 0 }' $1
+}
+
+grep -v "^#" reg-counts | while read kernel sregs vregs
+do
+	$LLVM_AS $kernel.ll -o $kernel.llvm &&
+	$M2C --llvm2si $kernel.llvm -o $kernel.out.s > /dev/null 2>&1
+	if ! diff $kernel.s $kernel.out.s > /dev/null 2>&1
+	then
+		echo "$kernel: assembly differs from '$kernel.s'"
+		status=1
+	fi
+	count=`reg_count $kernel.out.s`
+	if [ "$count" = "$sregs $vregs" ]
+	then
+		echo "$kernel: $sregs scalar and $vregs vector registers: ok"
+	else
+		echo "$kernel: $count registers used, $sregs $vregs expected"
+		status=1
+	fi
+	rm -f $kernel.llvm $kernel.out.s
+	[ $status = 0 ]
+done
@@ -0,0 +1,20 @@
+; __kernel void vector_add(__global int *a, __global int *b, __global int *c)
+; {
+; 	int gid = get_global_id(0);
+; 	c[gid] = a[gid] + b[gid];
+; }
+
+define void @vector_add(i32 addrspace(1)* %a, i32 addrspace(1)* %b, i32 addrspace(1)* %c) {
+entry:
+  %gid = call i32 @get_global_id(i32 0)
+  %pa = getelementptr i32, i32 addrspace(1)* %a, i32 %gid
+  %pb = getelementptr i32, i32 addrspace(1)* %b, i32 %gid
+  %pc = getelementptr i32, i32 addrspace(1)* %c, i32 %gid
+  %va = load i32, i32 addrspace(1)* %pa
+  %vb = load i32, i32 addrspace(1)* %pb
+  %sum = add i32 %va, %vb
+  store i32 %sum, i32 addrspace(1)* %pc
+  ret void
+}
+
+declare i32 @get_global_id(i32) nounwind
@@ -29,6 +29,7 @@
 #include <lib/util/misc.h>
 #include <lib/util/string.h>
 #include <lib/util/timer.h>
+#include <mem-system/cache-sweep.h>
 #include <mem-system/memory.h>
 
 #include "context.h"
@@ -544,6 +545,7 @@ struct arm_ctx_t *arm_ctx_create(void)
 
 	/* Memory */
 	ctx->mem = mem_create();
+	cache_sweep_register_mem(ctx->mem, "arm.ctx%d", ctx->pid);
 
 	/* Initialize Loader Sections*/
 	ctx->args = linked_list_create();
@@ -19,6 +19,7 @@
 
 
 #include <lib/esim/esim.h>
+#include <lib/esim/profile.h>
 #include <lib/mhandle/mhandle.h>
 #include <lib/util/debug.h>
 #include <lib/util/linked-list.h>
@@ -300,6 +301,20 @@ void arch_for_each(arch_callback_func_t callback_func, void *user_data)
 }
 
 
+void arch_reset_timers(void)
+{
+	struct arch_t *arch;
+	int i;
+
+	for (i = 0; i < arch_list_count; i++)
+	{
+		arch = arch_list[i];
+		if (arch->emu)
+			m2s_timer_reset(arch->emu->timer);
+	}
+}
+
+
 struct arch_t *arch_get(char *name)
 {
 	int i;
@@ -371,7 +386,9 @@ void arch_run(int *num_emu_active_ptr, int *num_timing_active_ptr)
 			/* Emulation iteration */
 			emu = arch->emu;
 			assert(emu && emu->Run);
-			arch->active = emu->Run(emu);
+			ESIM_PROFILE_CALL(arch->emu_probe,
+					arch->active = emu->Run(emu),
+					"arch_run %s emu", arch->name);
 
 			/* Increase number of active emulations if the architecture
 			 * actually performed a useful emulation iteration. */
@@ -392,7 +409,9 @@ void arch_run(int *num_emu_active_ptr, int *num_timing_active_ptr)
 			if (run)
 			{
 				/* Do it... */
-				arch->active = timing->Run(timing);
+				ESIM_PROFILE_CALL(arch->timing_probe,
+						arch->active = timing->Run(timing),
+						"arch_run %s timing", arch->name);
 
 				/* ... but only update the last timing
 				 * simulation cycle if there was an effective
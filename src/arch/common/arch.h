@@ -31,6 +31,7 @@
 
 
 struct config_t;
+struct esim_profile_probe_t;
 struct arch_t;
 
 extern struct str_map_t arch_sim_kind_map;
@@ -93,6 +94,11 @@ struct arch_t
 	/* Timing simulator */
 	Timing *timing;
 
+	/* Host-throughput profiling probes for emulation and timing
+	 * simulation iterations */
+	struct esim_profile_probe_t *emu_probe;
+	struct esim_profile_probe_t *timing_probe;
+
 	/* List of entry modules to the memory hierarchy. Each element of this list
 	 * is of type 'mod_t'. */
 	struct linked_list_t *mem_entry_mod_list;
@@ -142,6 +148,11 @@ struct arch_t *arch_register(char *name, char *prefix,
 
 void arch_for_each(arch_callback_func_t callback_func, void *user_data);
 
+/* Reset the timers measuring the execution time of each emulator. These are
+ * used to compute the instructions and cycles per second in the statistics
+ * summary. */
+void arch_reset_timers(void);
+
 struct arch_t *arch_get(char *name);
 void arch_get_names(char *str, int size);
 
@@ -29,6 +29,7 @@
 #include <lib/util/list.h>
 #include <lib/util/misc.h>
 #include <lib/util/string.h>
+#include <mem-system/cache-sweep.h>
 #include <mem-system/memory.h>
 
 #include "emu.h"
@@ -52,6 +53,7 @@ void EvgEmuCreate(EvgEmu *self)
 	self->const_mem->safe = 0;
 	self->global_mem = mem_create();
 	self->global_mem->safe = 0;
+	cache_sweep_register_mem(self->global_mem, "evg.global");
 
 	/* Initialize OpenCL objects */
 	self->opencl_repo = evg_opencl_repo_create();
@@ -21,10 +21,8 @@
 #include <lib/mhandle/mhandle.h>
 #include <lib/util/bit-map.h>
 #include <lib/util/debug.h>
-#include <lib/util/linked-list.h>
 #include <lib/util/list.h>
 #include <lib/util/misc.h>
-#include <lib/util/repos.h>
 #include <lib/util/string.h>
 #include <mem-system/memory.h>
 
@@ -39,9 +37,6 @@
  * Global Variables
  */
 
-/* Repository of deferred tasks */
-struct repos_t *evg_isa_write_task_repos;
-
 /* Instruction execution table */
 evg_isa_inst_func_t *evg_isa_inst_func;
 
@@ -65,10 +60,6 @@ void evg_isa_init()
 	evg_isa_inst_func[EVG_INST_##_name] = evg_isa_##_name##_impl;
 #include <arch/evergreen/asm/asm.dat>
 #undef DEFINST
-
-	/* Repository of deferred tasks */
-	evg_isa_write_task_repos = repos_create(sizeof(struct evg_isa_write_task_t),
-		"gpu_isa_write_task_repos");
 }
 
 
@@ -76,9 +67,6 @@ void evg_isa_done()
 {
 	/* Instruction execution table */
 	free(evg_isa_inst_func);
-
-	/* Repository of deferred tasks */
-	repos_free(evg_isa_write_task_repos);
 }
 
 
@@ -491,27 +479,74 @@ struct evg_inst_t *evg_isa_get_alu_inst(struct evg_alu_group_t *alu_group,
  * Deferred tasks for ALU group
  */
 
+struct evg_isa_write_buffer_t *evg_isa_write_buffer_create(int lane_count)
+{
+	struct evg_isa_write_buffer_t *buffer;
+	int size;
+
+	/* Initialize */
+	buffer = xcalloc(1, sizeof(struct evg_isa_write_buffer_t));
+	buffer->lane_count = lane_count;
+	size = EVG_ALU_COUNT * lane_count;
+
+	/* Destination register writes */
+	buffer->dest_mask = xcalloc(size, sizeof(unsigned char));
+	buffer->dest_value = xcalloc(size, sizeof(unsigned int));
+
+	/* LDS writes */
+	buffer->lds_count = xcalloc(size, sizeof(unsigned char));
+	buffer->lds_addr = xcalloc(size * EVG_ISA_MAX_LDS_WRITES_PER_INST,
+		sizeof(unsigned int));
+	buffer->lds_value = xcalloc(size * EVG_ISA_MAX_LDS_WRITES_PER_INST,
+		sizeof(unsigned int));
+	buffer->lds_value_size = xcalloc(size * EVG_ISA_MAX_LDS_WRITES_PER_INST,
+		sizeof(int));
+
+	/* Predicate updates */
+	buffer->pred_mask = xcalloc(size, sizeof(unsigned char));
+	buffer->pred_cond = xcalloc(size, sizeof(unsigned char));
+
+	/* Return */
+	return buffer;
+}
+
+
+void evg_isa_write_buffer_free(struct evg_isa_write_buffer_t *buffer)
+{
+	free(buffer->dest_mask);
+	free(buffer->dest_value);
+	free(buffer->lds_count);
+	free(buffer->lds_addr);
+	free(buffer->lds_value);
+	free(buffer->lds_value_size);
+	free(buffer->pred_mask);
+	free(buffer->pred_cond);
+	free(buffer);
+}
+
+
 void evg_isa_enqueue_write_lds(struct evg_work_item_t *work_item,
 	struct evg_inst_t *inst, unsigned int addr, unsigned int value,
 	int value_size)
 {
-	struct evg_isa_write_task_t *wt;
+	struct evg_isa_write_buffer_t *buffer = work_item->wavefront->write_buffer;
+	int entry;
+	int index;
 
 	/* Inactive pixel not enqueued */
 	if (!evg_work_item_get_pred(work_item))
 		return;
-	
-	/* Create task */
-	wt = repos_create_object(evg_isa_write_task_repos);
-	wt->work_item = work_item;
-	wt->kind = EVG_ISA_WRITE_TASK_WRITE_LDS;
-	wt->inst = inst;
-	wt->lds_addr = addr;
-	wt->lds_value = value;
-	wt->lds_value_size = value_size;
-
-	/* Enqueue task */
-	linked_list_add(work_item->write_task_list, wt);
+
+	/* Record task */
+	assert(!buffer->lds_inst[inst->alu] || buffer->lds_inst[inst->alu] == inst);
+	buffer->lds_inst[inst->alu] = inst;
+	entry = inst->alu * buffer->lane_count + work_item->id_in_wavefront;
+	assert(buffer->lds_count[entry] < EVG_ISA_MAX_LDS_WRITES_PER_INST);
+	index = entry * EVG_ISA_MAX_LDS_WRITES_PER_INST + buffer->lds_count[entry];
+	buffer->lds_addr[index] = addr;
+	buffer->lds_value[index] = value;
+	buffer->lds_value_size[index] = value_size;
+	buffer->lds_count[entry]++;
 }
 
 
@@ -519,32 +554,21 @@ void evg_isa_enqueue_write_lds(struct evg_work_item_t *work_item,
 void evg_isa_enqueue_write_dest(struct evg_work_item_t *work_item,
 	struct evg_inst_t *inst, unsigned int value)
 {
-	struct evg_isa_write_task_t *wt;
+	struct evg_isa_write_buffer_t *buffer = work_item->wavefront->write_buffer;
+	int entry;
 
 	/* If pixel is inactive, do not enqueue the task */
 	assert(inst->info->fmt[0] == EVG_FMT_ALU_WORD0);
 	if (!evg_work_item_get_pred(work_item))
 		return;
 
-	/* Fields 'dst_gpr', 'dst_rel', and 'dst_chan' are at the same bit positions in both
-	 * EVG_ALU_WORD1_OP2 and EVG_ALU_WORD1_OP3 formats. */
-	wt = repos_create_object(evg_isa_write_task_repos);
-	wt->work_item = work_item;
-	wt->kind = EVG_ISA_WRITE_TASK_WRITE_DEST;
-	wt->inst = inst;
-	wt->gpr = EVG_ALU_WORD1_OP2.dst_gpr;
-	wt->rel = EVG_ALU_WORD1_OP2.dst_rel;
-	wt->chan = EVG_ALU_WORD1_OP2.dst_chan;
-	wt->index_mode = EVG_ALU_WORD0.index_mode;
-	wt->value = value;
-
-	/* For EVG_ALU_WORD1_OP2, check 'write_mask' field */
-	wt->write_mask = 1;
-	if (inst->info->fmt[1] == EVG_FMT_ALU_WORD1_OP2 && !EVG_ALU_WORD1_OP2.write_mask)
-		wt->write_mask = 0;
-
-	/* Enqueue task */
-	linked_list_add(work_item->write_task_list, wt);
+	/* Record task. The destination operand is decoded from the
+	 * instruction at commit time. */
+	assert(!buffer->dest_inst[inst->alu] || buffer->dest_inst[inst->alu] == inst);
+	buffer->dest_inst[inst->alu] = inst;
+	entry = inst->alu * buffer->lane_count + work_item->id_in_wavefront;
+	buffer->dest_mask[entry] = 1;
+	buffer->dest_value[entry] = value;
 }
 
 
@@ -562,25 +586,21 @@ void evg_isa_enqueue_push_before(struct evg_work_item_t *work_item,
 	struct evg_inst_t *inst)
 {
 	struct evg_wavefront_t *wavefront = work_item->wavefront;
-	struct evg_isa_write_task_t *wt;
 
 	/* Do only if instruction initiating ALU clause is ALU_PUSH_BEFORE */
 	if (wavefront->cf_inst.info->inst != EVG_INST_ALU_PUSH_BEFORE)
 		return;
 
-	/* Create and enqueue task */
-	wt = repos_create_object(evg_isa_write_task_repos);
-	wt->work_item = work_item;
-	wt->kind = EVG_ISA_WRITE_TASK_PUSH_BEFORE;
-	wt->inst = inst;
-	linked_list_add(work_item->write_task_list, wt);
+	/* Record task */
+	wavefront->write_buffer->push_before = 1;
 }
 
 
 void evg_isa_enqueue_pred_set(struct evg_work_item_t *work_item,
 	struct evg_inst_t *inst, int cond)
 {
-	struct evg_isa_write_task_t *wt;
+	struct evg_isa_write_buffer_t *buffer = work_item->wavefront->write_buffer;
+	int entry;
 
 	/* If pixel is inactive, predicate is not changed */
 	assert(inst->info->fmt[0] == EVG_FMT_ALU_WORD0);
@@ -588,145 +608,203 @@ void evg_isa_enqueue_pred_set(struct evg_work_item_t *work_item,
 	if (!evg_work_item_get_pred(work_item))
 		return;
 	
-	/* Create and enqueue task */
-	wt = repos_create_object(evg_isa_write_task_repos);
-	wt->work_item = work_item;
-	wt->kind = EVG_ISA_WRITE_TASK_SET_PRED;
-	wt->inst = inst;
-	wt->cond = cond;
-	linked_list_add(work_item->write_task_list, wt);
+	/* Record task */
+	assert(!buffer->pred_inst[inst->alu] || buffer->pred_inst[inst->alu] == inst);
+	buffer->pred_inst[inst->alu] = inst;
+	entry = inst->alu * buffer->lane_count + work_item->id_in_wavefront;
+	buffer->pred_mask[entry] = 1;
+	buffer->pred_cond[entry] = cond;
 }
 
 
-void evg_isa_write_task_commit(struct evg_work_item_t *work_item)
+/* Commit destination register writes of one VLIW slot for all lanes */
+static void evg_isa_write_dest_commit(struct evg_wavefront_t *wavefront,
+	int slot)
 {
-	struct linked_list_t *task_list = work_item->write_task_list;
-	struct evg_wavefront_t *wavefront = work_item->wavefront;
-	struct evg_work_group_t *work_group = work_item->work_group;
+	struct evg_isa_write_buffer_t *buffer = wavefront->write_buffer;
+	struct evg_work_item_t **work_items = wavefront->work_items;
+	struct evg_work_item_t *work_item;
+	struct evg_inst_t *inst = buffer->dest_inst[slot];
+
+	unsigned char *mask = buffer->dest_mask + slot * buffer->lane_count;
+	unsigned int *value = buffer->dest_value + slot * buffer->lane_count;
 
-	struct evg_isa_write_task_t *wt;
-	struct evg_inst_t *inst;
+	int gpr;
+	int rel;
+	int chan;
+	int write_mask;
+	int lane;
+
+	/* Fields 'dst_gpr', 'dst_rel', and 'dst_chan' are at the same bit positions in both
+	 * EVG_ALU_WORD1_OP2 and EVG_ALU_WORD1_OP3 formats. */
+	gpr = EVG_ALU_WORD1_OP2.dst_gpr;
+	rel = EVG_ALU_WORD1_OP2.dst_rel;
+	chan = EVG_ALU_WORD1_OP2.dst_chan;
 
-	/* Process first tasks of type:
-	 *  - EVG_ISA_WRITE_TASK_WRITE_DEST
-	 *  - EVG_ISA_WRITE_TASK_WRITE_LDS
-	 */
-	for (linked_list_head(task_list); !linked_list_is_end(task_list); )
+	/* For EVG_ALU_WORD1_OP2, check 'write_mask' field */
+	write_mask = 1;
+	if (inst->info->fmt[1] == EVG_FMT_ALU_WORD1_OP2 && !EVG_ALU_WORD1_OP2.write_mask)
+		write_mask = 0;
+
+	/* Check destination once for the whole wavefront */
+	if (write_mask && (!IN_RANGE(chan, 0, 4) || !IN_RANGE(gpr, 0, 127)))
+		fatal("%s: invalid destination register", __FUNCTION__);
+	if (write_mask && rel)
+		fatal("%s: not supported for 'rel' != 0", __FUNCTION__);
+
+	/* Write all lanes */
+	for (lane = 0; lane < wavefront->work_item_count; lane++)
 	{
+		if (!mask[lane])
+			continue;
 
-		/* Get task */
-		wt = linked_list_get(task_list);
-		assert(wt->work_item == work_item);
-		inst = wt->inst;
+		work_item = work_items[lane];
+		if (write_mask)
+			work_item->gpr[gpr].elem[chan] = value[lane];
+		work_item->pv.elem[slot] = value[lane];
 
-		switch (wt->kind)
-		{
-		
-		case EVG_ISA_WRITE_TASK_WRITE_DEST:
+		/* Debug */
+		if (evg_isa_debugging())
 		{
-			if (wt->write_mask)
-				evg_isa_write_gpr(work_item, wt->gpr, wt->rel, wt->chan, wt->value);
-			work_item->pv.elem[wt->inst->alu] = wt->value;
-
-			/* Debug */
-			if (evg_isa_debugging())
+			evg_isa_debug("  i%d:%s", work_item->id,
+				str_map_value(&evg_pv_map, slot));
+			if (write_mask)
 			{
-				evg_isa_debug("  i%d:%s", work_item->id,
-					str_map_value(&evg_pv_map, wt->inst->alu));
-				if (wt->write_mask)
-				{
-					evg_isa_debug(",");
-					evg_inst_dump_gpr(wt->gpr, wt->rel, wt->chan, 0,
-						debug_file(evg_isa_debug_category));
-				}
-				evg_isa_debug("<=");
-				gpu_isa_dest_value_dump(inst, &wt->value,
+				evg_isa_debug(",");
+				evg_inst_dump_gpr(gpr, rel, chan, 0,
 					debug_file(evg_isa_debug_category));
 			}
-
-			break;
+			evg_isa_debug("<=");
+			gpu_isa_dest_value_dump(inst, &value[lane],
+				debug_file(evg_isa_debug_category));
 		}
+	}
 
-		case EVG_ISA_WRITE_TASK_WRITE_LDS:
-		{
-			struct mem_t *local_mem;
-			union evg_reg_t lds_value;
+	/* Reset slot */
+	memset(mask, 0, buffer->lane_count);
+	buffer->dest_inst[slot] = NULL;
+}
 
-			local_mem = work_group->local_mem;
-			assert(local_mem);
-			assert(wt->lds_value_size);
-			mem_write(local_mem, wt->lds_addr, wt->lds_value_size, &wt->lds_value);
 
-			/* Debug */
-			lds_value.as_uint = wt->lds_value;
-			evg_isa_debug("  i%d:LDS[0x%x]<=(%u,%gf) (%d bytes)", work_item->id, wt->lds_addr,
-				lds_value.as_uint, lds_value.as_float, (int) wt->lds_value_size);
-			break;
-		}
+/* Commit the LDS writes of a work-item for all VLIW slots. This is done right
+ * after the work-item executes the ALU group, so that the following
+ * work-items in the wavefront observe them, as when writes were committed
+ * one work-item at a time. */
+void evg_isa_write_lds_commit(struct evg_work_item_t *work_item)
+{
+	struct evg_wavefront_t *wavefront = work_item->wavefront;
+	struct evg_isa_write_buffer_t *buffer = wavefront->write_buffer;
+	struct mem_t *local_mem;
+
+	union evg_reg_t lds_value;
+
+	int entry;
+	int index;
+	int slot;
+	int i;
 
-		default:
-			linked_list_next(task_list);
+	local_mem = wavefront->work_group->local_mem;
+	for (slot = 0; slot < EVG_ALU_COUNT; slot++)
+	{
+		if (!buffer->lds_inst[slot])
 			continue;
-		}
 
-		/* Done with this task */
-		repos_free_object(evg_isa_write_task_repos, wt);
-		linked_list_remove(task_list);
+		assert(local_mem);
+		entry = slot * buffer->lane_count + work_item->id_in_wavefront;
+		for (i = 0; i < buffer->lds_count[entry]; i++)
+		{
+			index = entry * EVG_ISA_MAX_LDS_WRITES_PER_INST + i;
+			assert(buffer->lds_value_size[index]);
+			mem_write(local_mem, buffer->lds_addr[index],
+				buffer->lds_value_size[index],
+				&buffer->lds_value[index]);
+
+			/* Debug */
+			lds_value.as_uint = buffer->lds_value[index];
+			evg_isa_debug("  i%d:LDS[0x%x]<=(%u,%gf) (%d bytes)", work_item->id,
+				buffer->lds_addr[index], lds_value.as_uint,
+				lds_value.as_float, buffer->lds_value_size[index]);
+		}
+		buffer->lds_count[entry] = 0;
 	}
+}
 
-	/* Process PUSH_BEFORE, PRED_SET */
-	for (linked_list_head(task_list); !linked_list_is_end(task_list); )
+
+/* Commit predicate updates of one VLIW slot for all lanes */
+static void evg_isa_pred_set_commit(struct evg_wavefront_t *wavefront,
+	int slot)
+{
+	struct evg_isa_write_buffer_t *buffer = wavefront->write_buffer;
+	struct evg_work_item_t *work_item;
+	struct evg_inst_t *inst = buffer->pred_inst[slot];
+
+	unsigned char *mask = buffer->pred_mask + slot * buffer->lane_count;
+	unsigned char *cond = buffer->pred_cond + slot * buffer->lane_count;
+
+	int update_pred = EVG_ALU_WORD1_OP2.update_pred;
+	int update_exec_mask = EVG_ALU_WORD1_OP2.update_exec_mask;
+	int lane;
+
+	assert(inst->info->fmt[1] == EVG_FMT_ALU_WORD1_OP2);
+	for (lane = 0; lane < wavefront->work_item_count; lane++)
 	{
-		/* Get task */
-		wt = linked_list_get(task_list);
-		inst = wt->inst;
+		if (!mask[lane])
+			continue;
 
-		/* Process */
-		switch (wt->kind)
-		{
+		work_item = wavefront->work_items[lane];
+		if (update_pred)
+			evg_work_item_set_pred(work_item, cond[lane]);
+		if (update_exec_mask)
+			evg_work_item_set_active(work_item, cond[lane]);
 
-		case EVG_ISA_WRITE_TASK_PUSH_BEFORE:
+		/* Debug */
+		if (debug_status(evg_isa_debug_category))
 		{
-			if (!wavefront->push_before_done)
-				evg_wavefront_stack_push(wavefront);
-			wavefront->push_before_done = 1;
-			break;
+			if (update_pred && update_exec_mask)
+				evg_isa_debug("  i%d:act/pred<=%d", work_item->id, cond[lane]);
+			else if (update_pred)
+				evg_isa_debug("  i%d:pred=%d", work_item->id, cond[lane]);
+			else if (update_exec_mask)
+				evg_isa_debug("  i%d:pred=%d", work_item->id, cond[lane]);
 		}
+	}
 
-		case EVG_ISA_WRITE_TASK_SET_PRED:
-		{
-			int update_pred = EVG_ALU_WORD1_OP2.update_pred;
-			int update_exec_mask = EVG_ALU_WORD1_OP2.update_exec_mask;
+	/* Reset slot */
+	memset(mask, 0, buffer->lane_count);
+	buffer->pred_inst[slot] = NULL;
+}
 
-			assert(inst->info->fmt[1] == EVG_FMT_ALU_WORD1_OP2);
-			if (update_pred)
-				evg_work_item_set_pred(work_item, wt->cond);
-			if (update_exec_mask)
-				evg_work_item_set_active(work_item, wt->cond);
 
-			/* Debug */
-			if (debug_status(evg_isa_debug_category))
-			{
-				if (update_pred && update_exec_mask)
-					evg_isa_debug("  i%d:act/pred<=%d", work_item->id, wt->cond);
-				else if (update_pred)
-					evg_isa_debug("  i%d:pred=%d", work_item->id, wt->cond);
-				else if (update_exec_mask)
-					evg_isa_debug("  i%d:pred=%d", work_item->id, wt->cond);
-			}
-			break;
-		}
+/* Apply the writes staged by the work-items of the wavefront during the
+ * execution of an ALU group. LDS writes were already committed by
+ * 'evg_isa_write_lds_commit' after each work-item. Register writes go first,
+ * followed by the stack push for ALU_PUSH_BEFORE, and finally predicate
+ * updates, so that the pushed active mask is the one before the group. */
+void evg_isa_write_task_commit(struct evg_wavefront_t *wavefront)
+{
+	struct evg_isa_write_buffer_t *buffer = wavefront->write_buffer;
+	int slot;
 
-		default:
-			abort();
-		}
-		
-		/* Done with task */
-		repos_free_object(evg_isa_write_task_repos, wt);
-		linked_list_remove(task_list);
+	/* Register writes */
+	for (slot = 0; slot < EVG_ALU_COUNT; slot++)
+	{
+		if (buffer->dest_inst[slot])
+			evg_isa_write_dest_commit(wavefront, slot);
+		buffer->lds_inst[slot] = NULL;
+	}
+
+	/* Process PUSH_BEFORE */
+	if (buffer->push_before)
+	{
+		if (!wavefront->push_before_done)
+			evg_wavefront_stack_push(wavefront);
+		wavefront->push_before_done = 1;
+		buffer->push_before = 0;
 	}
 
-	/* List should be empty */
-	assert(!linked_list_count(task_list));
+	/* Process PRED_SET */
+	for (slot = 0; slot < EVG_ALU_COUNT; slot++)
+		if (buffer->pred_inst[slot])
+			evg_isa_pred_set_commit(wavefront, slot);
 }
 
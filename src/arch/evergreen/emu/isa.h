@@ -23,41 +23,43 @@
 #include "wavefront.h"
 
 
-enum evg_isa_write_task_kind_t
+/* Maximum number of LDS writes enqueued by one ALU instruction */
+#define EVG_ISA_MAX_LDS_WRITES_PER_INST  2
+
+/* Staging buffer for the writes deferred to the end of an ALU group. LDS
+ * writes are committed after each work-item executes the group, and the rest
+ * once all work-items of the wavefront have executed it.
+ * Per-work-item entries are indexed by VLIW slot ('inst->alu') and by lane
+ * ('work_item->id_in_wavefront'), as 'slot * lane_count + lane'. An entry is
+ * valid only if its mask is set. */
+struct evg_isa_write_buffer_t
 {
-	EVG_ISA_WRITE_TASK_NONE = 0,
-	EVG_ISA_WRITE_TASK_WRITE_LDS,
-	EVG_ISA_WRITE_TASK_WRITE_DEST,
-	EVG_ISA_WRITE_TASK_PUSH_BEFORE,
-	EVG_ISA_WRITE_TASK_SET_PRED
+	int lane_count;
+
+	/* Destination register writes. The destination operand is common for
+	 * all lanes, so only the instruction is recorded per slot. */
+	struct evg_inst_t *dest_inst[EVG_ALU_COUNT];
+	unsigned char *dest_mask;
+	unsigned int *dest_value;
+
+	/* LDS writes, with up to EVG_ISA_MAX_LDS_WRITES_PER_INST per entry */
+	struct evg_inst_t *lds_inst[EVG_ALU_COUNT];
+	unsigned char *lds_count;
+	unsigned int *lds_addr;
+	unsigned int *lds_value;
+	int *lds_value_size;
+
+	/* Predicate updates */
+	struct evg_inst_t *pred_inst[EVG_ALU_COUNT];
+	unsigned char *pred_mask;
+	unsigned char *pred_cond;
+
+	/* Stack push requested by an ALU_PUSH_BEFORE clause */
+	int push_before;
 };
 
-
-struct evg_isa_write_task_t
-{
-	/* Work-item affected */
-	struct evg_work_item_t *work_item;
-
-	/* All */
-	enum evg_isa_write_task_kind_t kind;
-	struct evg_inst_t *inst;
-	
-	/* When 'kind' == EVG_ISA_WRITE_TASK_WRITE_DEST */
-	int gpr, rel, chan, index_mode, write_mask;
-	unsigned int value;
-
-	/* When 'kind' == EVG_ISA_WRITE_TASK_WRITE_LDS */
-	unsigned int lds_addr;
-	unsigned int lds_value;
-        int lds_value_size;
-
-	/* When 'kind' == GPU_ISA_WRITE_TASK_PRED_SET */
-	int cond;
-};
-
-
-/* Repository for 'struct evg_isa_write_task_t' objects */
-extern struct repos_t *evg_isa_write_task_repos;
+struct evg_isa_write_buffer_t *evg_isa_write_buffer_create(int lane_count);
+void evg_isa_write_buffer_free(struct evg_isa_write_buffer_t *buffer);
 
 
 /* Functions to handle deferred tasks */
@@ -73,7 +75,8 @@ void evg_isa_enqueue_push_before(struct evg_work_item_t *work_item,
 void evg_isa_enqueue_pred_set(struct evg_work_item_t *work_item,
 	struct evg_inst_t *inst, int cond);
 
-void evg_isa_write_task_commit(struct evg_work_item_t *work_item);
+void evg_isa_write_lds_commit(struct evg_work_item_t *work_item);
+void evg_isa_write_task_commit(struct evg_wavefront_t *wavefront);
 
 
 
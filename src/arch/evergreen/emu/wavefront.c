@@ -148,6 +148,7 @@ struct evg_wavefront_t *evg_wavefront_create()
 	wavefront = xcalloc(1, sizeof(struct evg_wavefront_t));
 	wavefront->active_stack = bit_map_create(EVG_MAX_STACK_SIZE * evg_emu_wavefront_size);
 	wavefront->pred = bit_map_create(evg_emu_wavefront_size);
+	wavefront->write_buffer = evg_isa_write_buffer_create(evg_emu_wavefront_size);
 	/* FIXME: Remove once loop state is part of stack */
 	wavefront->loop_depth = 0;
 
@@ -161,6 +162,7 @@ void evg_wavefront_free(struct evg_wavefront_t *wavefront)
 	/* Free wavefront */
 	bit_map_free(wavefront->active_stack);
 	bit_map_free(wavefront->pred);
+	evg_isa_write_buffer_free(wavefront->write_buffer);
 	str_free(wavefront->name);
 	free(wavefront);
 }
@@ -352,7 +354,9 @@ void evg_wavefront_execute(struct evg_wavefront_t *wavefront)
 			evg_alu_group_dump(alu_group, 0, debug_file(evg_isa_debug_category));
 		}
 
-		/* Execute group for each work_item in wavefront */
+		/* Execute group for each work_item in wavefront. LDS writes are
+		 * committed after each work-item, and the rest of the writes for
+		 * all work-items at once. */
 		EVG_FOREACH_WORK_ITEM_IN_WAVEFRONT(wavefront, work_item_id)
 		{
 			work_item = ndrange->work_items[work_item_id];
@@ -361,8 +365,9 @@ void evg_wavefront_execute(struct evg_wavefront_t *wavefront)
 				inst = &alu_group->inst[i];
 				(*evg_isa_inst_func[inst->info->inst])(work_item, inst);
 			}
-			evg_isa_write_task_commit(work_item);
+			evg_isa_write_lds_commit(work_item);
 		}
+		evg_isa_write_task_commit(wavefront);
 		
 		/* Statistics */
 		asEmu(evg_emu)->instructions++;
@@ -80,6 +80,9 @@ struct evg_wavefront_t
 	/* Predicate mask */
 	struct bit_map_t *pred;  /* work_item_count elements */
 
+	/* Writes deferred to the end of the current ALU group */
+	struct evg_isa_write_buffer_t *write_buffer;
+
 	/* Loop counters */
 	/* FIXME: Include this as part of the stack to handle nested loops */
 	int loop_depth;
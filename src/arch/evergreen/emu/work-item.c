@@ -21,7 +21,6 @@
 
 #include <lib/mhandle/mhandle.h>
 #include <lib/util/bit-map.h>
-#include <lib/util/linked-list.h>
 #include <lib/util/list.h>
 
 #include "wavefront.h"
@@ -39,7 +38,6 @@ struct evg_work_item_t *evg_work_item_create()
 
 	/* Initialize */
 	work_item = xcalloc(1, sizeof(struct evg_work_item_t));
-	work_item->write_task_list = linked_list_create();
 	work_item->lds_oqa = list_create();
 	work_item->lds_oqb = list_create();
 
@@ -57,7 +55,6 @@ void evg_work_item_free(struct evg_work_item_t *work_item)
 		free(list_dequeue(work_item->lds_oqb));
 	list_free(work_item->lds_oqa);
 	list_free(work_item->lds_oqb);
-	linked_list_free(work_item->write_task_list);
 
 	/* Free work_item */
 	free(work_item);
@@ -57,10 +57,6 @@ struct evg_work_item_t
 	struct evg_gpr_t gpr[128];  /* General purpose registers */
 	struct evg_gpr_t pv;  /* Result of last computations */
 
-	/* Linked list of write tasks. They are enqueued by machine instructions
-	 * and executed as a burst at the end of an ALU group. */
-	struct linked_list_t *write_task_list;
-
 	/* LDS (Local Data Share) OQs (Output Queues) */
 	struct list_t *lds_oqa;
 	struct list_t *lds_oqb;
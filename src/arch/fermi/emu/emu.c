@@ -23,6 +23,7 @@
 #include <lib/util/file.h>
 #include <lib/util/list.h>
 #include <lib/util/misc.h>
+#include <mem-system/cache-sweep.h>
 #include <mem-system/memory.h>
 
 #include "emu.h"
@@ -48,6 +49,7 @@ void FrmEmuCreate(FrmEmu *self)
 	self->finished_grids = list_create();
         self->global_mem = mem_create();
         self->global_mem->safe = 0;
+	cache_sweep_register_mem(self->global_mem, "frm.global");
         self->global_mem_top = 0;
         self->total_global_mem_size = 1 << 31; /* 2GB */
         self->free_global_mem_size = 1 << 31; /* 2GB */
@@ -35,6 +35,8 @@
 struct frm_grid_t *frm_grid_create(struct cuda_function_t *function)
 {
 	struct frm_grid_t *grid;
+	struct frm_inst_t *inst;
+	int i;
 
 	/* Create new grid */
 	grid = xcalloc(1, sizeof(struct frm_grid_t));
@@ -46,6 +48,17 @@ struct frm_grid_t *frm_grid_create(struct cuda_function_t *function)
 	grid->function = function;
 	grid->num_gpr_used = function->num_gpr_used;
 
+	/* Decode kernel instructions */
+	grid->inst_count = function->inst_buffer_size / 8;
+	grid->inst_table = xcalloc(grid->inst_count, sizeof(struct frm_inst_t));
+	for (i = 0; i < grid->inst_count; i++)
+	{
+		inst = &grid->inst_table[i];
+		inst->dword.word[0] = function->inst_buffer[i] >> 32;
+		inst->dword.word[1] = function->inst_buffer[i];
+		frm_inst_decode(inst);
+	}
+
 	/* Add to list */
 	list_add(frm_emu->grids, grid);
 
@@ -77,6 +90,7 @@ void frm_grid_free(struct frm_grid_t *grid)
 	list_free(grid->finished_thread_blocks);
 
         /* Free grid */
+        free(grid->inst_table);
         free(grid);
 }
 
@@ -235,6 +249,7 @@ static void frm_grid_setup_arrays(struct frm_grid_t *grid)
 			warp->inst_buffer = grid->function->inst_buffer;
 			warp->inst_buffer_size =
 				grid->function->inst_buffer_size;
+			warp->inst_table = grid->inst_table;
 			if (wid < thread_block->warp_count - 1)
 				warp->thread_count = frm_emu_warp_size;
 			else
@@ -87,6 +87,11 @@ struct frm_grid_t
 	void *inst_buffer;
 	unsigned int inst_buffer_size;
 
+	/* Kernel instructions, decoded once when the grid is created and
+	 * shared by all warps. Indexed by PC / 8. */
+	struct frm_inst_t *inst_table;
+	int inst_count;
+
 	/* Local memory top to assign to local arguments.
 	 * Initially it is equal to the size of local variables in 
 	 * kernel function. */
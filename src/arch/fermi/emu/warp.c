@@ -255,17 +255,14 @@ void frm_warp_execute(struct frm_warp_t *warp)
 	warp->inst_size = 8;
 	warp->at_barrier = 0;
 
-	/* Get instruction */
+	/* Get instruction, already decoded when the grid was created */
+	assert(warp->pc / warp->inst_size < warp->inst_buffer_size / 8);
 	inst = &warp->inst;
-	((inst->dword).word)[0] = 
-		((warp->inst_buffer)[warp->pc / warp->inst_size]) >> 32;
-	((inst->dword).word)[1] = 
-		(warp->inst_buffer)[warp->pc / warp->inst_size];
+	*inst = warp->inst_table[warp->pc / warp->inst_size];
 	frm_isa_debug("%s:%d: warp[%d] executes instruction 0x%0llx\n", 
 			__FUNCTION__, __LINE__, warp->id, inst->dword.dword);
 
-	/* Decode instruction */
-	frm_inst_decode(inst);
+	/* Check instruction */
 	if (!inst->info)
 		fatal("%s: unrecognized instruction (%08x %08x)",
 			__FUNCTION__, inst->dword.word[0], inst->dword.word[1]);
@@ -56,6 +56,9 @@ struct frm_warp_t
 	unsigned int inst_buffer_index;
 	unsigned int inst_buffer_size;
 
+	/* Decoded instructions of the grid, indexed by PC / 8 */
+	struct frm_inst_t *inst_table;
+
 	/* Active mask stack */
 	struct bit_map_t *active_stack;  /* FRM_MAX_STACK_SIZE * thread_count elements */
 	int stack_top;
@@ -29,6 +29,7 @@
 #include <lib/util/misc.h>
 #include <lib/util/string.h>
 #include <lib/util/timer.h>
+#include <mem-system/cache-sweep.h>
 #include <mem-system/memory.h>
 
 #include "context.h"
@@ -506,6 +507,7 @@ struct mips_ctx_t *mips_ctx_create(void)
 
 	/* Memory */
 	ctx->mem = mem_create();
+	cache_sweep_register_mem(ctx->mem, "mips.ctx%d", ctx->pid);
 
 	/* Initialize Loader Sections*/
 	ctx->args = linked_list_create();
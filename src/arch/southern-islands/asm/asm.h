@@ -395,7 +395,9 @@ enum si_inst_flag_t
 {
 	SI_INST_FLAG_NONE = 0x0000,
 	SI_INST_FLAG_OP8 = 0x0001,  /* Opcode represents 8 comparison instructions */
-	SI_INST_FLAG_OP16 = 0x0002  /* Opcode represents 16 comparison instructions */
+	SI_INST_FLAG_OP16 = 0x0002,  /* Opcode represents 16 comparison instructions */
+	SI_INST_FLAG_DST_NONE = 0x0004,  /* First operand is a source, not a destination */
+	SI_INST_FLAG_DST_READ = 0x0008  /* First operand is read before it is written */
 };
 
 
@@ -26,6 +26,7 @@
 #include <lib/util/list.h>
 #include <lib/util/misc.h>
 #include <lib/util/string.h>
+#include <mem-system/cache-sweep.h>
 #include <mem-system/memory.h>
 
 #include "emu.h"
@@ -48,6 +49,7 @@ void SIEmuCreate(SIEmu *self)
 	/* Initialize */
 	self->video_mem = mem_create();
 	self->video_mem->safe = 0;
+	cache_sweep_register_mem(self->video_mem, "si.global");
 	self->video_mem_top = 0;
 	self->waiting_work_groups = list_create();
 	self->running_work_groups = list_create();
@@ -105,10 +107,8 @@ int SIEmuRun(Emu *self)
 	OpenclDriver *opencl_driver;
 
 	struct si_ndrange_t *ndrange;
-	struct si_wavefront_t *wavefront;
 	struct si_work_group_t *work_group;
 
-	int wavefront_id;
 	long work_group_id;
 
 	if (!list_count(emu->running_work_groups) &&
@@ -132,19 +132,7 @@ int SIEmuRun(Emu *self)
 	work_group = si_work_group_create(work_group_id, ndrange);
 
 	/* Execute the work-group to completion */
-	while (!work_group->finished_emu)
-	{
-		SI_FOREACH_WAVEFRONT_IN_WORK_GROUP(work_group, wavefront_id)
-		{
-			wavefront = work_group->wavefronts[wavefront_id];
-
-			if (wavefront->finished || wavefront->at_barrier)
-				continue;
-
-			/* Execute instruction in wavefront */
-			si_wavefront_execute(wavefront);
-		}
-	}
+	si_work_group_execute(work_group);
 
 	/* Remove work group from running list */
 	list_dequeue(emu->running_work_groups);
@@ -59,6 +59,10 @@ void si_ndrange_free(struct si_ndrange_t *ndrange)
 	if (ndrange->inst_buffer)
 		free(ndrange->inst_buffer);
 
+	/* Free decoded instruction table */
+	if (ndrange->inst_table)
+		free(ndrange->inst_table);
+
 	/* Free ndrange */
 	memset(ndrange, 0, sizeof(struct si_ndrange_t));
 	free(ndrange);
@@ -140,6 +144,10 @@ void si_ndrange_setup_inst_mem(struct si_ndrange_t *ndrange, void *buf,
 	ndrange->inst_buffer = xmalloc(size);
 	ndrange->inst_buffer_size = size;
 	memcpy(ndrange->inst_buffer, buf, size);
+
+	/* Decoded instruction table, one entry per 32-bit word */
+	ndrange->inst_table = xcalloc((size + 3) / 4,
+		sizeof(struct si_ndrange_inst_t));
 }
 
 void si_ndrange_setup_fs_mem(struct si_ndrange_t *ndrange, void *buf, 
@@ -166,6 +174,40 @@ void si_ndrange_setup_fs_mem(struct si_ndrange_t *ndrange, void *buf,
 	ndrange->fs_buffer_initialized = 1;
 	ndrange->inst_buffer = buffer;
 	ndrange->inst_buffer_size +=  size;
+
+	/* Resize decoded instruction table. This happens before any
+	 * wavefront runs, so no entry has been decoded yet. */
+	if (ndrange->inst_table)
+		free(ndrange->inst_table);
+	ndrange->inst_table = xcalloc((ndrange->inst_buffer_size + 3) / 4,
+		sizeof(struct si_ndrange_inst_t));
+}
+
+struct si_ndrange_inst_t *si_ndrange_get_inst(struct si_ndrange_t *ndrange,
+	unsigned int pc)
+{
+	struct si_ndrange_inst_t *entry;
+	int size;
+
+	/* Sanity */
+	if (pc >= ndrange->inst_buffer_size || pc % 4)
+		panic("%s: invalid PC (0x%x)", __FUNCTION__, pc);
+
+	/* Decode on first fetch. Wavefronts running in parallel host threads
+	 * can get here at the same time, so the first one claims the entry by
+	 * setting its size to -1, and the others wait until it is filled. */
+	entry = &ndrange->inst_table[pc / 4];
+	while (*(volatile int *) &entry->size <= 0)
+	{
+		if (!__sync_bool_compare_and_swap(&entry->size, 0, -1))
+			continue;
+		size = si_inst_decode(ndrange->inst_buffer + pc, &entry->inst, 0);
+		__sync_synchronize();
+		entry->size = size;
+	}
+
+	/* Return */
+	return entry;
 }
 
 void si_ndrange_insert_buffer_into_uav_table(struct si_ndrange_t *ndrange,
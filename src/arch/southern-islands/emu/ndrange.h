@@ -22,6 +22,7 @@
 
 #include <stdio.h>
 
+#include <arch/southern-islands/asm/asm.h>
 #include <arch/southern-islands/asm/bin-file.h>
 
 #include "emu.h"
@@ -40,6 +41,14 @@ struct si_ndrange_table_entry_t
         unsigned int size;
 };
 
+/* Entry of the decoded instruction table, indexed by PC / 4 */
+struct si_ndrange_inst_t
+{
+	struct si_inst_t inst;
+	int size;  /* Instruction size in bytes, 0 if not decoded yet, or -1 while
+		    * being decoded */
+};
+
 struct si_ndrange_t
 {
 	/* ID */
@@ -70,6 +79,11 @@ struct si_ndrange_t
 	void *inst_buffer;
 	unsigned int inst_buffer_size;
 
+	/* Decoded instructions, shared by all wavefronts of the ND-Range.
+	 * Each entry is decoded the first time any wavefront fetches it, so
+	 * that data or padding that is never executed is never decoded. */
+	struct si_ndrange_inst_t *inst_table;
+
 	/* Fetch shader memory containing Fetch shader instructions */
 	int fs_buffer_initialized;
 	unsigned int fs_buffer_ptr; /* Relative offset */
@@ -125,6 +139,10 @@ void si_ndrange_setup_fs_mem(struct si_ndrange_t *ndrange, void *buf,
 void si_ndrange_setup_inst_mem(struct si_ndrange_t *ndrange, void *buf, 
 	int size, unsigned int pc);
 
+/* Return the decoded instruction at the given PC */
+struct si_ndrange_inst_t *si_ndrange_get_inst(struct si_ndrange_t *ndrange,
+	unsigned int pc);
+
 /* Access constant buffers */
 void si_ndrange_const_buf_write(struct si_ndrange_t *ndrange, 
 	int const_buf_num, int offset, void *pvalue, unsigned int size);
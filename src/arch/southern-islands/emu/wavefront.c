@@ -115,6 +115,7 @@ void si_wavefront_execute(struct si_wavefront_t *wavefront)
 	struct si_work_group_t *work_group;
 	struct si_work_item_t *work_item;
 	struct si_inst_t *inst;
+	struct si_ndrange_inst_t *decoded_inst;
 
 	char inst_dump[MAX_INST_STR_SIZE];
 
@@ -141,13 +142,16 @@ void si_wavefront_execute(struct si_wavefront_t *wavefront)
 
 	assert(!wavefront->finished);
 	
-	/* Grab the instruction at PC and update the pointer */
-	wavefront->inst_size = si_inst_decode(
-		ndrange->inst_buffer + wavefront->pc,
-		&wavefront->inst, 0);
-
-	/* Stats */
-	asEmu(si_emu)->instructions++;
+	/* Grab the instruction at PC from the ND-Range's decoded
+	 * instruction table */
+	decoded_inst = si_ndrange_get_inst(ndrange, wavefront->pc);
+	wavefront->inst = decoded_inst->inst;
+	wavefront->inst_size = decoded_inst->size;
+
+	/* Stats. Counters of the emulator are updated atomically, since compute
+	 * units simulated in parallel host threads execute wavefronts at the
+	 * same time. */
+	__sync_fetch_and_add(&asEmu(si_emu)->instructions, 1);
 	wavefront->emu_inst_count++;
 	wavefront->inst_count++;
 
@@ -171,7 +175,7 @@ void si_wavefront_execute(struct si_wavefront_t *wavefront)
 		}
 
 		/* Stats */
-		si_emu->scalar_alu_inst_count++;
+		__sync_fetch_and_add(&si_emu->scalar_alu_inst_count, 1);
 		wavefront->scalar_alu_inst_count++;
 
 		/* Only one work item executes the instruction */
@@ -198,7 +202,7 @@ void si_wavefront_execute(struct si_wavefront_t *wavefront)
 		}
 
 		/* Stats */
-		si_emu->scalar_alu_inst_count++;
+		__sync_fetch_and_add(&si_emu->scalar_alu_inst_count, 1);
 		wavefront->scalar_alu_inst_count++;
 
 		/* Only one work item executes the instruction */
@@ -228,11 +232,11 @@ void si_wavefront_execute(struct si_wavefront_t *wavefront)
 		if (wavefront->inst.micro_inst.sopp.op > 1 &&
 			wavefront->inst.micro_inst.sopp.op < 10)
 		{
-			si_emu->branch_inst_count++;
+			__sync_fetch_and_add(&si_emu->branch_inst_count, 1);
 			wavefront->branch_inst_count++;
 		} else
 		{
-			si_emu->scalar_alu_inst_count++;
+			__sync_fetch_and_add(&si_emu->scalar_alu_inst_count, 1);
 			wavefront->scalar_alu_inst_count++;
 		}
 
@@ -260,7 +264,7 @@ void si_wavefront_execute(struct si_wavefront_t *wavefront)
 		}
 
 		/* Stats */
-		si_emu->scalar_alu_inst_count++;
+		__sync_fetch_and_add(&si_emu->scalar_alu_inst_count, 1);
 		wavefront->scalar_alu_inst_count++;
 
 		/* Only one work item executes the instruction */
@@ -287,7 +291,7 @@ void si_wavefront_execute(struct si_wavefront_t *wavefront)
 		}
 
 		/* Stats */
-		si_emu->scalar_alu_inst_count++;
+		__sync_fetch_and_add(&si_emu->scalar_alu_inst_count, 1);
 		wavefront->scalar_alu_inst_count++;
 
 		/* Only one work item executes the instruction */
@@ -315,7 +319,7 @@ void si_wavefront_execute(struct si_wavefront_t *wavefront)
 		}
 
 		/* Stats */
-		si_emu->scalar_mem_inst_count++;
+		__sync_fetch_and_add(&si_emu->scalar_mem_inst_count, 1);
 		wavefront->scalar_mem_inst_count++;
 
 		/* Only one work item executes the instruction */
@@ -343,7 +347,7 @@ void si_wavefront_execute(struct si_wavefront_t *wavefront)
 		}
 
 		/* Stats */
-		si_emu->vector_alu_inst_count++;
+		__sync_fetch_and_add(&si_emu->vector_alu_inst_count, 1);
 		wavefront->vector_alu_inst_count++;
 	
 		/* Execute the instruction */
@@ -378,7 +382,7 @@ void si_wavefront_execute(struct si_wavefront_t *wavefront)
 		}
 
 		/* Stats */
-		si_emu->vector_alu_inst_count++;
+		__sync_fetch_and_add(&si_emu->vector_alu_inst_count, 1);
 		wavefront->vector_alu_inst_count++;
 
 		/* Special case: V_READFIRSTLANE_B32 */
@@ -449,7 +453,7 @@ void si_wavefront_execute(struct si_wavefront_t *wavefront)
 		}
 
 		/* Stats */
-		si_emu->vector_alu_inst_count++;
+		__sync_fetch_and_add(&si_emu->vector_alu_inst_count, 1);
 		wavefront->vector_alu_inst_count++;
 	
 		/* Execute the instruction */
@@ -484,7 +488,7 @@ void si_wavefront_execute(struct si_wavefront_t *wavefront)
 		}
 
 		/* Stats */
-		si_emu->vector_alu_inst_count++;
+		__sync_fetch_and_add(&si_emu->vector_alu_inst_count, 1);
 		wavefront->vector_alu_inst_count++;
 	
 		/* Execute the instruction */
@@ -519,7 +523,7 @@ void si_wavefront_execute(struct si_wavefront_t *wavefront)
 		}
 
 		/* Stats */
-		si_emu->vector_alu_inst_count++;
+		__sync_fetch_and_add(&si_emu->vector_alu_inst_count, 1);
 		wavefront->vector_alu_inst_count++;
 	
 		/* Execute the instruction */
@@ -554,7 +558,7 @@ void si_wavefront_execute(struct si_wavefront_t *wavefront)
 		}
 
 		/* Stats */
-		si_emu->lds_inst_count++;
+		__sync_fetch_and_add(&si_emu->lds_inst_count, 1);
 		wavefront->lds_inst_count++;
 
 		/* Record access type */
@@ -608,7 +612,7 @@ void si_wavefront_execute(struct si_wavefront_t *wavefront)
 		}
 
 		/* Stats */
-		si_emu->vector_mem_inst_count++;
+		__sync_fetch_and_add(&si_emu->vector_mem_inst_count, 1);
 		wavefront->vector_mem_inst_count++;
 
 		/* Record access type */
@@ -651,7 +655,7 @@ void si_wavefront_execute(struct si_wavefront_t *wavefront)
 		}
 
 		/* Stats */
-		si_emu->vector_mem_inst_count++;
+		__sync_fetch_and_add(&si_emu->vector_mem_inst_count, 1);
 		wavefront->vector_mem_inst_count++;
 
 		/* Record access type */
@@ -702,7 +706,7 @@ void si_wavefront_execute(struct si_wavefront_t *wavefront)
 		}
 
 		/* Stats */
-		si_emu->export_inst_count++;
+		__sync_fetch_and_add(&si_emu->export_inst_count, 1);
 		wavefront->export_inst_count++;
 
 		/* Record access type */
@@ -331,3 +331,25 @@ void si_work_group_free(struct si_work_group_t *work_group)
 	free(work_group);
 	work_group = NULL;
 }
+
+
+void si_work_group_execute(struct si_work_group_t *work_group)
+{
+	struct si_wavefront_t *wavefront;
+	int wavefront_id;
+
+	/* Execute the work-group to completion */
+	while (!work_group->finished_emu)
+	{
+		SI_FOREACH_WAVEFRONT_IN_WORK_GROUP(work_group, wavefront_id)
+		{
+			wavefront = work_group->wavefronts[wavefront_id];
+
+			if (wavefront->finished || wavefront->at_barrier)
+				continue;
+
+			/* Execute instruction in wavefront */
+			si_wavefront_execute(wavefront);
+		}
+	}
+}
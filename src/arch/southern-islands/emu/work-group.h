@@ -47,6 +47,7 @@ struct si_work_group_t
 
 	/* Fields introduced for architectural simulation */
 	int id_in_compute_unit;
+	long long map_cycle;  /* Cycle when mapped to a compute unit */
 
 	/* LDS */
 	struct mem_t *lds_module;
@@ -56,6 +57,7 @@ struct si_work_group_t
 	long long int sreg_write_count;
 	long long int vreg_read_count;
 	long long int vreg_write_count;
+	long long int vector_mem_block_accesses;
 };
 
 struct si_work_group_t *si_work_group_create(unsigned int work_group_id, 
@@ -63,4 +65,7 @@ struct si_work_group_t *si_work_group_create(unsigned int work_group_id,
 void si_work_group_free(struct si_work_group_t *work_group);
 void si_work_group_dump(struct si_work_group_t *work_group, FILE *f);
 
+/* Run all wavefronts of the work-group functionally until they finish */
+void si_work_group_execute(struct si_work_group_t *work_group);
+
 #endif
@@ -18,25 +18,115 @@
  */
 
 
+#include <arch/southern-islands/emu/emu.h>
 #include <arch/southern-islands/emu/ndrange.h>
 #include <arch/southern-islands/emu/wavefront.h>
 #include <arch/southern-islands/emu/work-group.h>
 #include <arch/x86/emu/emu.h>
 #include <driver/opencl/opencl.h>
+#include <lib/esim/profile.h>
 #include <lib/esim/trace.h>
 #include <lib/mhandle/mhandle.h>
 #include <lib/util/debug.h>
 #include <lib/util/list.h>
+#include <lib/util/misc.h>
+#include <lib/util/repos.h>
 #include <lib/util/string.h>
 
 #include "compute-unit.h"
 #include "gpu.h"
+#include "sampling.h"
 #include "simd-unit.h"
 #include "uop.h"
 #include "wavefront-pool.h"
 
 #include "cycle-interval-report.h"
 
+
+/* Action of a compute unit with effects outside of it, deferred while compute
+ * units run in parallel host threads. It is a release of a work-group if
+ * 'work_group' is set, or an access to module 'mod' otherwise. */
+struct si_compute_unit_action_t
+{
+	struct mod_t *mod;
+	enum mod_access_kind_t access_kind;
+	unsigned int addr;
+	int *witness_ptr;
+
+	struct si_work_group_t *work_group;
+};
+
+
+static struct si_compute_unit_action_t *si_compute_unit_defer(
+	struct si_compute_unit_t *compute_unit)
+{
+	struct si_compute_unit_action_t *action;
+
+	/* Grow buffer */
+	if (compute_unit->deferred_action_count ==
+			compute_unit->deferred_action_size)
+	{
+		compute_unit->deferred_action_size =
+			MAX(16, compute_unit->deferred_action_size * 2);
+		compute_unit->deferred_actions = xrealloc(
+			compute_unit->deferred_actions,
+			compute_unit->deferred_action_size *
+			sizeof(struct si_compute_unit_action_t));
+	}
+
+	/* New action */
+	action = &compute_unit->deferred_actions[
+		compute_unit->deferred_action_count++];
+	memset(action, 0, sizeof(struct si_compute_unit_action_t));
+	return action;
+}
+
+
+/* Part of the unmapping of a work-group that updates the GPU and emulator
+ * state, and frees the work-group */
+static void si_compute_unit_release_work_group(
+	struct si_compute_unit_t *compute_unit,
+	struct si_work_group_t *work_group)
+{
+	struct si_ndrange_t *ndrange = work_group->ndrange;
+	OpenclDriver *driver = ndrange->opencl_driver;
+
+	long work_group_id;
+
+	work_group_id = work_group->id;
+	assert(list_index_of(si_emu->running_work_groups, 
+		(void*) work_group_id) >= 0);
+	list_remove(si_emu->running_work_groups, (void*)work_group_id);
+
+	if (driver && !si_emu->running_work_groups->count &&
+			!si_emu->waiting_work_groups->count)
+		OpenclDriverRequestWork(driver);
+
+	/* If compute unit is not already in the available list, place
+	 * it there */
+	assert(compute_unit->work_group_count <
+		si_gpu->work_groups_per_compute_unit);
+	if (list_index_of(si_gpu->available_compute_units, compute_unit) < 0)
+	{
+		list_enqueue(si_gpu->available_compute_units, compute_unit);
+	}
+
+	/* Trace */
+	si_trace("si.unmap_wg cu=%d wg=%d\n", compute_unit->id,
+		work_group->id);
+
+	if(si_spatial_report_active)
+		si_report_unmapped_work_group(compute_unit);
+
+	/* Work-group sampling */
+	if (si_sampling_active)
+		si_sampling_unmap_work_group(work_group);
+
+	si_work_group_free(work_group);
+}
+
+
+
 /*
  * Compute Unit
  */
@@ -87,6 +177,8 @@ struct si_compute_unit_t *si_compute_unit_create()
 	compute_unit->vector_mem_unit.mem_buffer = list_create();
 	compute_unit->vector_mem_unit.write_buffer = list_create();
 	compute_unit->vector_mem_unit.compute_unit = compute_unit;
+	compute_unit->vector_mem_unit.coalesce_block_addr = xcalloc(
+		si_emu_wavefront_size, sizeof(unsigned int));
 
 	compute_unit->lds_unit.issue_buffer = list_create();
 	compute_unit->lds_unit.decode_buffer = list_create();
@@ -136,6 +228,7 @@ struct si_compute_unit_t *si_compute_unit_create()
 	compute_unit->work_groups = 
 		xcalloc(si_gpu_max_work_groups_per_wavefront_pool * 
 		si_gpu_num_wavefront_pools, sizeof(void *));
+	compute_unit->uop_repos = si_uop_repos_create();
 
 	/* Return */
 	return compute_unit;
@@ -183,6 +276,7 @@ void si_compute_unit_free(struct si_compute_unit_t *compute_unit)
 	list_free(compute_unit->vector_mem_unit.read_buffer);
 	list_free(compute_unit->vector_mem_unit.mem_buffer);
 	list_free(compute_unit->vector_mem_unit.write_buffer);
+	free(compute_unit->vector_mem_unit.coalesce_block_addr);
 
 	/* Local Data Share */
 	si_uop_list_free(compute_unit->lds_unit.issue_buffer);
@@ -229,6 +323,8 @@ void si_compute_unit_free(struct si_compute_unit_t *compute_unit)
 	free(compute_unit->fetch_buffers);
 	free(compute_unit->work_groups);  /* List of mapped work-groups */
 	mod_free(compute_unit->lds_module);
+	free(compute_unit->deferred_actions);
+	repos_free(compute_unit->uop_repos);
 	free(compute_unit);
 }
 
@@ -254,6 +350,7 @@ void si_compute_unit_map_work_group(struct si_compute_unit_t *compute_unit,
 		si_gpu->work_groups_per_compute_unit);
 	compute_unit->work_groups[work_group->id_in_compute_unit] = work_group;
 	compute_unit->work_group_count++;
+	work_group->map_cycle = asTiming(si_gpu)->cycle;
 
 	/* If compute unit is not full, add it back to the available list */
 	assert(compute_unit->work_group_count <= 
@@ -295,11 +392,6 @@ void si_compute_unit_map_work_group(struct si_compute_unit_t *compute_unit,
 void si_compute_unit_unmap_work_group(struct si_compute_unit_t *compute_unit,
 	struct si_work_group_t *work_group)
 {
-	struct si_ndrange_t *ndrange = work_group->ndrange;
-	OpenclDriver *driver = ndrange->opencl_driver;
-
-	long work_group_id;
-
 	/* Add work group register access statistics to compute unit */
 	compute_unit->sreg_read_count += work_group->sreg_read_count;
 	compute_unit->sreg_write_count += work_group->sreg_write_count;
@@ -316,32 +408,57 @@ void si_compute_unit_unmap_work_group(struct si_compute_unit_t *compute_unit,
 	si_wavefront_pool_unmap_wavefronts(work_group->wavefront_pool,
 		work_group);
 
-	work_group_id = work_group->id;
-	assert(list_index_of(si_emu->running_work_groups, 
-		(void*) work_group_id) >= 0);
-	list_remove(si_emu->running_work_groups, (void*)work_group_id);
+	/* Release work-group */
+	if (si_gpu->parallel_running)
+		si_compute_unit_defer(compute_unit)->work_group = work_group;
+	else
+		si_compute_unit_release_work_group(compute_unit, work_group);
+}
 
-	if (driver && !si_emu->running_work_groups->count &&
-			!si_emu->waiting_work_groups->count)
-		OpenclDriverRequestWork(driver);
 
-	/* If compute unit is not already in the available list, place
-	 * it there */
-	assert(compute_unit->work_group_count <
-		si_gpu->work_groups_per_compute_unit);
-	if (list_index_of(si_gpu->available_compute_units, compute_unit) < 0)
+/* Access a memory module on behalf of a uop. The access is deferred while
+ * compute units run in parallel host threads. */
+void si_compute_unit_mod_access(struct si_compute_unit_t *compute_unit,
+	struct mod_t *mod, enum mod_access_kind_t access_kind,
+	unsigned int addr, int *witness_ptr)
+{
+	struct si_compute_unit_action_t *action;
+
+	/* Access now */
+	if (!si_gpu->parallel_running)
 	{
-		list_enqueue(si_gpu->available_compute_units, compute_unit);
+		mod_access(mod, access_kind, addr, witness_ptr,
+			NULL, NULL, NULL);
+		return;
 	}
 
-	/* Trace */
-	si_trace("si.unmap_wg cu=%d wg=%d\n", compute_unit->id,
-		work_group->id);
+	/* Defer */
+	action = si_compute_unit_defer(compute_unit);
+	action->mod = mod;
+	action->access_kind = access_kind;
+	action->addr = addr;
+	action->witness_ptr = witness_ptr;
+}
 
-	if(si_spatial_report_active)
-		si_report_unmapped_work_group(compute_unit);
 
-	si_work_group_free(work_group);
+/* Run the actions deferred in the last cycle, in the order they were issued */
+void si_compute_unit_run_deferred(struct si_compute_unit_t *compute_unit)
+{
+	struct si_compute_unit_action_t *action;
+	int i;
+
+	for (i = 0; i < compute_unit->deferred_action_count; i++)
+	{
+		action = &compute_unit->deferred_actions[i];
+		if (action->work_group)
+			si_compute_unit_release_work_group(compute_unit,
+				action->work_group);
+		else
+			mod_access(action->mod, action->access_kind,
+				action->addr, action->witness_ptr,
+				NULL, NULL, NULL);
+	}
+	compute_unit->deferred_action_count = 0;
 }
 
 void si_compute_unit_fetch(struct si_compute_unit_t *compute_unit, 
@@ -451,10 +568,9 @@ void si_compute_unit_fetch(struct si_compute_unit_t *compute_unit,
 		wavefront_pool_entry->ready = 0;
 
 		/* Create uop */
-		uop = si_uop_create();
+		uop = si_uop_create(compute_unit);
 		uop->wavefront = wavefront;
 		uop->work_group = wavefront->work_group;
-		uop->compute_unit = compute_unit;
 		uop->id_in_compute_unit = compute_unit->uop_id_counter++;
 		uop->id_in_wavefront = wavefront->uop_id_counter++;
 		uop->wavefront_pool_id = active_fb;
@@ -1352,6 +1468,14 @@ void si_compute_unit_issue_first(struct si_compute_unit_t *compute_unit,
  * last to first */
 void si_compute_unit_run(struct si_compute_unit_t *compute_unit)
 {
+	/* Host-throughput profiling probes */
+	static struct esim_profile_probe_t *simd_probe;
+	static struct esim_profile_probe_t *vector_mem_probe;
+	static struct esim_profile_probe_t *lds_probe;
+	static struct esim_profile_probe_t *scalar_unit_probe;
+	static struct esim_profile_probe_t *branch_unit_probe;
+	static struct esim_profile_probe_t *issue_probe;
+
 	int i;
 	int num_simd_units;
 	int active_fetch_buffer;  
@@ -1370,23 +1494,36 @@ void si_compute_unit_run(struct si_compute_unit_t *compute_unit)
 	/* SIMDs */
 	num_simd_units = compute_unit->num_wavefront_pools;
 	for (i = 0; i < num_simd_units; i++)
-		si_simd_run(compute_unit->simd_units[i]);
+		ESIM_PROFILE_CALL(simd_probe,
+				si_simd_run(compute_unit->simd_units[i]),
+				"si_simd_run");
 
 	/* Vector memory */
-	si_vector_mem_run(&compute_unit->vector_mem_unit);
+	ESIM_PROFILE_CALL(vector_mem_probe,
+			si_vector_mem_run(&compute_unit->vector_mem_unit),
+			"si_vector_mem_run");
 
 	/* LDS */
-	si_lds_run(&compute_unit->lds_unit);
+	ESIM_PROFILE_CALL(lds_probe,
+			si_lds_run(&compute_unit->lds_unit),
+			"si_lds_run");
 
 	/* Scalar unit */
-	si_scalar_unit_run(&compute_unit->scalar_unit);
+	ESIM_PROFILE_CALL(scalar_unit_probe,
+			si_scalar_unit_run(&compute_unit->scalar_unit),
+			"si_scalar_unit_run");
 
 	/* Branch unit */
-	si_branch_unit_run(&compute_unit->branch_unit);
+	ESIM_PROFILE_CALL(branch_unit_probe,
+			si_branch_unit_run(&compute_unit->branch_unit),
+			"si_branch_unit_run");
 
 	/* Issue from the active fetch buffer */
 	//si_compute_unit_issue_first(compute_unit, active_fetch_buffer);
-	si_compute_unit_issue_oldest(compute_unit, active_fetch_buffer);
+	ESIM_PROFILE_CALL(issue_probe,
+			si_compute_unit_issue_oldest(compute_unit,
+				active_fetch_buffer),
+			"si_compute_unit_issue_oldest");
 
 	/* Update visualization in non-active fetch buffers */
 	for (i = 0; i < num_simd_units; i++)
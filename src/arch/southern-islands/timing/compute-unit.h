@@ -20,6 +20,8 @@
 #ifndef ARCH_SOUTHERN_ISLANDS_TIMING_COMPUTE_UNIT_H
 #define ARCH_SOUTHERN_ISLANDS_TIMING_COMPUTE_UNIT_H
 
+#include <mem-system/module.h>
+
 #include "branch-unit.h"
 #include "lds-unit.h"
 #include "scalar-unit.h"
@@ -97,6 +99,15 @@ struct si_compute_unit_t
 	long long interval_alu_issued;
 	long long interval_lds_issued ;
 	FILE * spatial_report_file;
+
+	/* Repository of uops */
+	struct repos_t *uop_repos;
+
+	/* Actions with effects outside of the compute unit, deferred while
+	 * compute units run in parallel host threads */
+	struct si_compute_unit_action_t *deferred_actions;
+	int deferred_action_count;
+	int deferred_action_size;  /* Allocated entries */
 };
 
 struct si_compute_unit_t *si_compute_unit_create(void);
@@ -105,6 +116,10 @@ void si_compute_unit_map_work_group(struct si_compute_unit_t *compute_unit,
 	struct si_work_group_t *work_group);
 void si_compute_unit_unmap_work_group(struct si_compute_unit_t *compute_unit, 
 	struct si_work_group_t *work_group);
+void si_compute_unit_mod_access(struct si_compute_unit_t *compute_unit,
+	struct mod_t *mod, enum mod_access_kind_t access_kind,
+	unsigned int addr, int *witness_ptr);
+void si_compute_unit_run_deferred(struct si_compute_unit_t *compute_unit);
 struct si_wavefront_t *si_compute_unit_schedule(struct si_compute_unit_t *compute_unit);
 void si_compute_unit_run(struct si_compute_unit_t *compute_unit);
 
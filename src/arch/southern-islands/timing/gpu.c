@@ -18,11 +18,15 @@
  */
 
 
+#include <arch/southern-islands/emu/emu.h>
+#include <arch/southern-islands/emu/isa.h>
 #include <arch/southern-islands/emu/ndrange.h>
 #include <arch/southern-islands/emu/work-group.h>
 #include <arch/x86/emu/emu.h>
 #include <driver/opencl/opencl.h>
 #include <lib/esim/esim.h>
+#include <lib/esim/interval.h>
+#include <lib/esim/profile.h>
 #include <lib/esim/trace.h>
 #include <lib/mhandle/mhandle.h>
 #include <lib/util/config.h>
@@ -31,11 +35,14 @@
 #include <lib/util/list.h>
 #include <lib/util/misc.h>
 #include <lib/util/string.h>
+#include <mem-system/cache-sweep.h>
+#include <mem-system/memory.h>
 
 #include "calc.h"
 #include "compute-unit.h"
 #include "gpu.h"
 #include "mem-config.h"
+#include "sampling.h"
 #include "uop.h"
 
 #include "cycle-interval-report.h"
@@ -216,6 +223,10 @@ char *si_gpu_config_help =
 	"      Latency of register file writes in number of cycles.\n"
 	"  WriteBufferSize = <num> (Default = 1)\n"
 	"      Size of the buffer holding register write instructions.\n"
+	"  Coalesce = {t|f} (Default = t)\n"
+	"      Merge the accesses of all work-items in a wavefront that fall\n"
+	"      into the same vector cache block into one memory access. If\n"
+	"      false, one access per work-item is issued.\n"
 	"\n"
 	"Section '[ LDS ]': defines the parameters of the Local Data Share\n"
 	"on each compute unit.\n"
@@ -233,6 +244,18 @@ char *si_gpu_config_help =
 	"      Latency for an access in number of cycles.\n"
 	"  Ports = <num> (Default = 4)\n"
 	"      Number of ports.\n"
+	"\n"
+	"Section '[ Sampling ]': when present, only a sample of the work-groups\n"
+	"of each ND-Range is simulated in detail. The rest are emulated when they\n"
+	"are dispatched, and their timing is extrapolated from the sample in the\n"
+	"GPU pipeline report, with a 95% confidence interval.\n"
+	"\n"
+	"  WarmupWorkGroups = <num> (Default = 4)\n"
+	"      Number of work-groups simulated in detail on each compute unit\n"
+	"      at the beginning of each ND-Range.\n"
+	"  Period = <num> (Default = 10)\n"
+	"      After the warm-up, one out of every 'Period' work-groups\n"
+	"      dispatched to each compute unit is simulated in detail.\n"
 	"\n";
 
 char *si_gpu_config_file_name = "";
@@ -330,6 +353,9 @@ enum si_gpu_register_alloc_granularity_t si_gpu_register_alloc_granularity;
 int si_gpu_frequency = 925;
 int si_gpu_num_compute_units = 32;
 
+/* Host threads simulating compute units in parallel */
+int si_gpu_host_threads = 1;
+
 /* Compute unit parameters */
 int si_gpu_num_wavefront_pools = 4; /* Per CU */
 int si_gpu_max_work_groups_per_wavefront_pool = 10;
@@ -400,6 +426,7 @@ int si_gpu_vector_mem_read_buffer_size = 1;
 int si_gpu_vector_mem_max_inflight_mem_accesses = 32;
 int si_gpu_vector_mem_write_latency = 1;
 int si_gpu_vector_mem_write_buffer_size = 1;
+int si_gpu_vector_mem_coalesce = 1;
 
 /* LDS memory parameters */
 int si_gpu_lds_size = 65536; /* 64KB */
@@ -454,6 +481,9 @@ void si_gpu_map_ndrange(struct si_ndrange_t *ndrange)
 
 	/* Optional plotting */
 	si_calc_plot();
+
+	/* Work-group sampling */
+	si_sampling_map_ndrange(ndrange);
 }
 
 
@@ -573,6 +603,8 @@ void si_config_dump(FILE *f)
 	fprintf(f, "WriteLatency = %d\n", si_gpu_vector_mem_write_latency);
 	fprintf(f, "WriteBufferSize = %d\n",
 		si_gpu_vector_mem_write_buffer_size);
+	fprintf(f, "Coalesce = %s\n", si_gpu_vector_mem_coalesce ?
+		"True" : "False");
 	fprintf(f, "\n");
 
 	/* LDS */
@@ -584,6 +616,9 @@ void si_config_dump(FILE *f)
 	fprintf(f, "Ports = %d\n", si_gpu_lds_num_ports);
 	fprintf(f, "\n");
 
+	/* Work-group sampling */
+	si_sampling_config_dump(f);
+
 	/* End of configuration */
 	fprintf(f, "\n");
 }
@@ -1026,6 +1061,10 @@ void si_gpu_read_config(void)
 		fatal("%s: invalid value for 'WriteBufferSize'.\n%s",
 			si_gpu_config_file_name, err_note);
 
+	si_gpu_vector_mem_coalesce = config_read_bool(
+		gpu_config, section, "Coalesce",
+		si_gpu_vector_mem_coalesce);
+
 	/* Local Data Share Unit */
 	section = "LocalDataShare";
 
@@ -1069,6 +1108,9 @@ void si_gpu_read_config(void)
 	/* Cycle Interval report */
 	si_spatial_report_config_read(gpu_config);
 
+	/* Work-group sampling */
+	si_sampling_config_read(gpu_config);
+
 	/* Close GPU configuration file */
 	config_check(gpu_config);
 	config_free(gpu_config);
@@ -1092,9 +1134,6 @@ void si_gpu_init(void)
 	/* Create GPU */
 	si_gpu = new(SIGpu);
 
-	/* Initializations */
-	si_uop_init();
-
 	/* Trace */
 	si_trace_header("si.init version=\"%d.%d\" num_compute_units=%d\n",
 		SI_TRACE_VERSION_MAJOR, SI_TRACE_VERSION_MINOR,
@@ -1114,8 +1153,8 @@ void si_gpu_done(void)
 	if (si_spatial_report_active)
 		si_cu_spatial_report_done();
 
-	/* Finalizations */
-	si_uop_done();
+	/* Work-group sampling */
+	si_sampling_done();
 }
 
 
@@ -1178,6 +1217,9 @@ void si_gpu_dump_report(void)
 	fprintf(f, "InstructionsPerCycle = %.4g\n", inst_per_cycle);
 	fprintf(f, "\n\n");
 
+	/* Estimates for work-group sampling */
+	si_sampling_dump_report(f);
+
 	/* Report for compute units */
 	SI_GPU_FOREACH_COMPUTE_UNIT(compute_unit_id)
 	{
@@ -1205,6 +1247,10 @@ void si_gpu_dump_report(void)
 			compute_unit->simd_inst_count);
 		fprintf(f, "VectorMemInstructions = %lld\n", 
 			compute_unit->vector_mem_inst_count);
+		fprintf(f, "VectorMemWorkItemAccesses = %lld\n", 
+			compute_unit->vector_mem_unit.work_item_accesses);
+		fprintf(f, "VectorMemBlockAccesses = %lld\n", 
+			compute_unit->vector_mem_unit.block_accesses);
 		fprintf(f, "LDSInstructions = %lld\n", 
 			compute_unit->lds_inst_count);
 		fprintf(f, "Cycles = %lld\n", compute_unit->cycle);
@@ -1244,6 +1290,146 @@ void si_gpu_dump_report(void)
  * Class 'SIGpu'
  */
 
+/* Take compute units of the current cycle until there are none left, and run
+ * one cycle on each of them. */
+static void SIGpuParallelWork(SIGpu *self)
+{
+	int index;
+
+	while ((index = __sync_fetch_and_add(&self->parallel_compute_unit_next,
+			1)) < si_gpu_num_compute_units)
+		si_compute_unit_run(self->compute_units[index]);
+}
+
+
+/* Worker thread for parallel simulation. It waits for a new cycle to start,
+ * takes part in it, and notifies the main thread when it is done. */
+static void *SIGpuParallelThread(void *arg)
+{
+	SIGpu *self = asSIGpu(arg);
+	long long round = 0;
+
+	pthread_mutex_lock(&self->parallel_mutex);
+	while (1)
+	{
+		/* Wait for next cycle */
+		while (!self->parallel_stop && self->parallel_round == round)
+			pthread_cond_wait(&self->parallel_start_cond, &self->parallel_mutex);
+		if (self->parallel_stop)
+			break;
+		round = self->parallel_round;
+
+		/* Work */
+		pthread_mutex_unlock(&self->parallel_mutex);
+		SIGpuParallelWork(self);
+		pthread_mutex_lock(&self->parallel_mutex);
+
+		/* Last worker done */
+		if (!--self->parallel_pending)
+			pthread_cond_signal(&self->parallel_done_cond);
+	}
+	pthread_mutex_unlock(&self->parallel_mutex);
+	return NULL;
+}
+
+
+/* Launch the worker threads for parallel simulation, if they are not running
+ * yet. */
+static void SIGpuParallelStart(SIGpu *self)
+{
+	int i;
+
+	/* Already running */
+	if (self->parallel_threads)
+		return;
+
+	/* From now on, memory images are accessed by several host threads */
+	mem_thread_safe_mode++;
+
+	/* Launch threads. The main thread works too. */
+	self->parallel_stop = 0;
+	self->parallel_round = 0;
+	self->parallel_thread_count = MIN(si_gpu_host_threads,
+		si_gpu_num_compute_units) - 1;
+	self->parallel_threads = xcalloc(self->parallel_thread_count, sizeof(pthread_t));
+	for (i = 0; i < self->parallel_thread_count; i++)
+		if (pthread_create(&self->parallel_threads[i], NULL,
+				SIGpuParallelThread, self))
+			fatal("%s: could not create host thread", __FUNCTION__);
+}
+
+
+void SIGpuStopHostThreads(SIGpu *self)
+{
+	int i;
+
+	/* Not running */
+	if (!self->parallel_threads)
+		return;
+
+	/* Notify threads and wait for them */
+	pthread_mutex_lock(&self->parallel_mutex);
+	self->parallel_stop = 1;
+	pthread_cond_broadcast(&self->parallel_start_cond);
+	pthread_mutex_unlock(&self->parallel_mutex);
+	for (i = 0; i < self->parallel_thread_count; i++)
+		pthread_join(self->parallel_threads[i], NULL);
+
+	/* Free */
+	free(self->parallel_threads);
+	self->parallel_threads = NULL;
+	mem_thread_safe_mode--;
+}
+
+
+/* Return whether compute units can be simulated in parallel. Features relying
+ * on the serial order of compute units, or on shared state that is not
+ * thread-safe, keep the serial simulation loop. This is the case of the
+ * pipeline trace, the ISA debug output, the spatial report, the
+ * host-throughput profile, and cache sweeps over global memory. */
+static int SIGpuParallelEnabled(SIGpu *self)
+{
+	return si_gpu_host_threads > 1 && si_gpu_num_compute_units > 1 &&
+		!si_tracing() && !si_spatial_report_active &&
+		!esim_profile_active && !cache_sweep_active &&
+		!debug_status(si_isa_debug_category);
+}
+
+
+/* Run one cycle on all compute units in parallel. Compute units only update
+ * their own state meanwhile. Their memory accesses and released work-groups
+ * are then processed by the main thread in the order of compute units, so
+ * that the simulation matches the serial loop. */
+static void SIGpuRunParallel(SIGpu *self)
+{
+	int compute_unit_id;
+
+	/* Launch threads */
+	SIGpuParallelStart(self);
+
+	/* Start cycle */
+	self->parallel_running = 1;
+	self->parallel_compute_unit_next = 0;
+	pthread_mutex_lock(&self->parallel_mutex);
+	self->parallel_round++;
+	self->parallel_pending = self->parallel_thread_count;
+	pthread_cond_broadcast(&self->parallel_start_cond);
+	pthread_mutex_unlock(&self->parallel_mutex);
+
+	/* Work and wait for workers */
+	SIGpuParallelWork(self);
+	pthread_mutex_lock(&self->parallel_mutex);
+	while (self->parallel_pending)
+		pthread_cond_wait(&self->parallel_done_cond, &self->parallel_mutex);
+	pthread_mutex_unlock(&self->parallel_mutex);
+	self->parallel_running = 0;
+
+	/* Deferred actions */
+	SI_GPU_FOREACH_COMPUTE_UNIT(compute_unit_id)
+		si_compute_unit_run_deferred(self->compute_units[compute_unit_id]);
+}
+
+
 void SIGpuCreate(SIGpu *self)
 {
 	struct si_compute_unit_t *compute_unit;
@@ -1270,8 +1456,34 @@ void SIGpuCreate(SIGpu *self)
 		if (compute_unit_id) {
 			list_add(self->available_compute_units, compute_unit);
 		}
+
+		/* Interval statistics */
+		if (esim_interval_active)
+		{
+			esim_interval_register_counter(&compute_unit->inst_count,
+					"si.cu%d.Insts", compute_unit_id);
+			esim_interval_register_counter(&compute_unit->simd_inst_count,
+					"si.cu%d.SimdInsts", compute_unit_id);
+			esim_interval_register_counter(&compute_unit->scalar_alu_inst_count,
+					"si.cu%d.ScalarAluInsts", compute_unit_id);
+			esim_interval_register_counter(&compute_unit->scalar_mem_inst_count,
+					"si.cu%d.ScalarMemInsts", compute_unit_id);
+			esim_interval_register_counter(&compute_unit->vector_mem_inst_count,
+					"si.cu%d.VectorMemInsts", compute_unit_id);
+			esim_interval_register_counter(&compute_unit->lds_inst_count,
+					"si.cu%d.LdsInsts", compute_unit_id);
+			esim_interval_register_counter(&compute_unit->branch_inst_count,
+					"si.cu%d.BranchInsts", compute_unit_id);
+			esim_interval_register_gauge(&compute_unit->work_group_count,
+					"si.cu%d.WorkGroups", compute_unit_id);
+		}
 	}
 
+	/* Parallel simulation */
+	pthread_mutex_init(&self->parallel_mutex, NULL);
+	pthread_cond_init(&self->parallel_start_cond, NULL);
+	pthread_cond_init(&self->parallel_done_cond, NULL);
+
 	/* Virtual functions */
 	asObject(self)->Dump = SIGpuDump;
 	asTiming(self)->DumpSummary = SIGpuDumpSummary;
@@ -1287,6 +1499,12 @@ void SIGpuDestroy(SIGpu *self)
 	struct si_compute_unit_t *compute_unit;
 	int compute_unit_id;
 
+	/* Parallel simulation */
+	SIGpuStopHostThreads(self);
+	pthread_mutex_destroy(&self->parallel_mutex);
+	pthread_cond_destroy(&self->parallel_start_cond);
+	pthread_cond_destroy(&self->parallel_done_cond);
+
 	/* Free stream cores, compute units, and device */
 	SI_GPU_FOREACH_COMPUTE_UNIT(compute_unit_id)
 	{
@@ -1343,6 +1561,12 @@ int SIGpuRun(Timing *self)
 
 		work_group = si_work_group_create(work_group_id, ndrange);
 
+		/* Work-groups left out of the sample run functionally */
+		compute_unit = list_head(gpu->available_compute_units);
+		if (si_sampling_active && si_sampling_skip_work_group(
+				compute_unit, work_group))
+			continue;
+
 		list_enqueue(si_emu->running_work_groups, 
 			(void *)work_group_id);
 
@@ -1382,6 +1606,11 @@ int SIGpuRun(Timing *self)
 		OpenclDriverRequestWork(opencl_driver);
 
 	/* Run one loop iteration on each busy compute unit */
+	if (SIGpuParallelEnabled(gpu))
+	{
+		SIGpuRunParallel(gpu);
+		return TRUE;
+	}
 	SI_GPU_FOREACH_COMPUTE_UNIT(compute_unit_id)
 	{
 		compute_unit = gpu->compute_units[compute_unit_id];
@@ -20,6 +20,8 @@
 #ifndef ARCH_SOUTHERN_ISLANDS_TIMING_GPU_H
 #define ARCH_SOUTHERN_ISLANDS_TIMING_GPU_H
 
+#include <pthread.h>
+
 #include <arch/common/timing.h>
 
 
@@ -116,6 +118,7 @@ extern enum si_gpu_register_alloc_granularity_t
 
 extern int si_gpu_frequency;
 extern int si_gpu_num_compute_units;
+extern int si_gpu_host_threads;
 extern int si_gpu_max_wavefronts_per_workgroup;
 
 extern int si_gpu_num_vector_registers;
@@ -185,6 +188,7 @@ extern int si_gpu_vector_mem_exec_buffer_size;
 extern int si_gpu_vector_mem_write_latency;
 extern int si_gpu_vector_mem_write_buffer_size;
 extern int si_gpu_vector_mem_max_inflight_mem_accesses;
+extern int si_gpu_vector_mem_coalesce;
 
 extern int si_gpu_lds_size;
 extern int si_gpu_lds_alloc_size;
@@ -254,6 +258,25 @@ CLASS_BEGIN(SIGpu, Timing)
 
 	long long int last_complete_cycle;
 
+	/* Host-parallel simulation of compute units (option
+	 * '--si-host-threads'). In each cycle, compute units are distributed
+	 * among the main thread and 'parallel_thread_count' worker threads,
+	 * which take them in order through 'parallel_compute_unit_next'. Actions
+	 * with effects outside of a compute unit are deferred while
+	 * 'parallel_running' is set, and replayed afterwards by the main thread
+	 * in the order of compute units. The workers are launched the first
+	 * time they are needed. */
+	pthread_t *parallel_threads;
+	int parallel_thread_count;
+	int parallel_stop;  /* Workers should finish */
+	int parallel_running;  /* Compute units running in parallel */
+	pthread_mutex_t parallel_mutex;
+	pthread_cond_t parallel_start_cond;  /* Cycle started */
+	pthread_cond_t parallel_done_cond;  /* All workers done with cycle */
+	long long parallel_round;  /* Cycle counter, protected by mutex */
+	int parallel_pending;  /* Workers not done with cycle, protected by mutex */
+	volatile int parallel_compute_unit_next;  /* Accessed atomically */
+
 CLASS_END(SIGpu)
 
 void SIGpuCreate(SIGpu *self);
@@ -264,6 +287,10 @@ void SIGpuDumpSummary(Timing *self, FILE *f);
 
 int SIGpuRun(Timing *self);
 
+/* Stop the host threads simulating compute units in parallel. They are
+ * launched again when needed. */
+void SIGpuStopHostThreads(SIGpu *self);
+
 
 
 /*
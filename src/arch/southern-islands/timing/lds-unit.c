@@ -229,10 +229,11 @@ void si_lds_mem(struct si_lds_t *lds)
 						work_item->lds_access_type[j]);
 				}
 
-				mod_access(lds->compute_unit->lds_module, 
+				si_compute_unit_mod_access(lds->compute_unit,
+					lds->compute_unit->lds_module, 
 					access_type, 
 					work_item_uop->lds_access_addr[j],
-					&uop->lds_witness, NULL, NULL, NULL);
+					&uop->lds_witness);
 				uop->lds_witness--;
 			}
 		}
@@ -0,0 +1,300 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <math.h>
+
+#include <arch/southern-islands/emu/ndrange.h>
+#include <arch/southern-islands/emu/work-group.h>
+#include <lib/mhandle/mhandle.h>
+#include <lib/util/config.h>
+#include <lib/util/debug.h>
+#include <lib/util/list.h>
+#include <lib/util/misc.h>
+
+#include "compute-unit.h"
+#include "gpu.h"
+#include "sampling.h"
+
+
+/* Two-sided 95% confidence level of a normal distribution */
+#define SI_SAMPLING_Z95  1.96
+
+int si_sampling_active;
+
+static char *si_sampling_section_name = "Sampling";
+
+/* Work-groups simulated in detail at the beginning of an ND-Range on each
+ * compute unit, and one out of every 'si_sampling_period' work-groups after
+ * them. */
+static int si_sampling_warmup = 4;
+static int si_sampling_period = 10;
+
+/* Statistics of one ND-Range */
+struct si_sampling_ndrange_t
+{
+	int id;
+
+	/* Number of work-groups that can run at a time in the GPU */
+	int slots;
+
+	/* Cycles spanned by the work-groups simulated in detail */
+	long long start_cycle;
+	long long end_cycle;
+
+	long long detailed_work_groups;
+	long long functional_work_groups;
+
+	/* Sums and sums of squares over the work-groups simulated in detail of
+	 * their cycles in a compute unit and their vector memory accesses */
+	double cycles_sum;
+	double cycles_sq_sum;
+	double mem_sum;
+	double mem_sq_sum;
+};
+
+/* List of ND-Ranges, elements of type 'struct si_sampling_ndrange_t'. The
+ * last element is the ND-Range currently running. */
+static struct list_t *si_sampling_ndrange_list;
+
+/* Work-groups dispatched to each compute unit in the current ND-Range */
+static long long *si_sampling_work_group_count;
+
+
+/* Mean and 95% confidence interval of the sum of 'count' unobserved values,
+ * estimated from a sample of 'n' values with sum 'sum' and sum of squares
+ * 'sq_sum'. */
+static void si_sampling_estimate(long long n, double sum, double sq_sum,
+	long long count, double *estimate_ptr, double *error_ptr)
+{
+	double mean;
+	double var;
+
+	mean = n ? sum / n : 0.0;
+	var = n > 1 ? (sq_sum - sum * mean) / (n - 1) : 0.0;
+	*estimate_ptr = count * mean;
+	*error_ptr = n ? SI_SAMPLING_Z95 * count * sqrt(MAX(var, 0.0) / n) : 0.0;
+}
+
+
+static void si_sampling_ndrange_dump(struct si_sampling_ndrange_t *ndrange,
+	FILE *f, double *cycles_ptr, double *cycles_error_ptr)
+{
+	long long cycles;
+	long long n;
+
+	double cycles_estimate;
+	double cycles_error;
+	double mem_estimate;
+	double mem_error;
+
+	/* Cycles of the skipped work-groups, which run in parallel with up to
+	 * 'slots' other work-groups. */
+	n = ndrange->detailed_work_groups;
+	cycles = ndrange->end_cycle - ndrange->start_cycle;
+	si_sampling_estimate(n, ndrange->cycles_sum, ndrange->cycles_sq_sum,
+		ndrange->functional_work_groups, &cycles_estimate,
+		&cycles_error);
+	cycles_estimate = cycles + cycles_estimate / ndrange->slots;
+	cycles_error /= ndrange->slots;
+
+	/* Memory accesses of all work-groups */
+	si_sampling_estimate(n, ndrange->mem_sum, ndrange->mem_sq_sum,
+		ndrange->functional_work_groups, &mem_estimate, &mem_error);
+	mem_estimate += ndrange->mem_sum;
+
+	fprintf(f, "[ Sampling.NDRange %d ]\n\n", ndrange->id);
+	fprintf(f, "DetailedWorkGroups = %lld\n", n);
+	fprintf(f, "FunctionalWorkGroups = %lld\n",
+		ndrange->functional_work_groups);
+	fprintf(f, "Cycles = %lld\n", cycles);
+	fprintf(f, "WorkGroupCycles = %.2f\n", n ?
+		ndrange->cycles_sum / n : 0.0);
+	fprintf(f, "EstimatedCycles = %.0f\n", cycles_estimate);
+	fprintf(f, "EstimatedCyclesError = %.0f\n", cycles_error);
+	fprintf(f, "WorkGroupVectorMemBlockAccesses = %.2f\n", n ?
+		ndrange->mem_sum / n : 0.0);
+	fprintf(f, "EstimatedVectorMemBlockAccesses = %.0f\n", mem_estimate);
+	fprintf(f, "EstimatedVectorMemBlockAccessesError = %.0f\n", mem_error);
+	fprintf(f, "\n");
+
+	/* Return */
+	*cycles_ptr = cycles_estimate;
+	*cycles_error_ptr = cycles_error;
+}
+
+
+
+
+/*
+ * Public Functions
+ */
+
+void si_sampling_config_read(struct config_t *config)
+{
+	char *section;
+
+	/* Sampling is only active if the section is present */
+	section = si_sampling_section_name;
+	if (!config_section_exists(config, section))
+		return;
+	si_sampling_active = 1;
+
+	/* Parameters */
+	si_sampling_warmup = config_read_int(config, section,
+		"WarmupWorkGroups", si_sampling_warmup);
+	si_sampling_period = config_read_int(config, section,
+		"Period", si_sampling_period);
+	if (si_sampling_warmup < 0)
+		fatal("%s: invalid value for 'WarmupWorkGroups'", section);
+	if (si_sampling_period < 1)
+		fatal("%s: invalid value for 'Period'", section);
+
+	/* Initialize */
+	si_sampling_ndrange_list = list_create();
+	si_sampling_work_group_count = xcalloc(si_gpu_num_compute_units,
+		sizeof(long long));
+}
+
+
+void si_sampling_config_dump(FILE *f)
+{
+	if (!si_sampling_active)
+		return;
+
+	fprintf(f, "[ Config.Sampling ]\n");
+	fprintf(f, "WarmupWorkGroups = %d\n", si_sampling_warmup);
+	fprintf(f, "Period = %d\n", si_sampling_period);
+	fprintf(f, "\n");
+}
+
+
+void si_sampling_done(void)
+{
+	int index;
+
+	if (!si_sampling_active)
+		return;
+
+	LIST_FOR_EACH(si_sampling_ndrange_list, index)
+		free(list_get(si_sampling_ndrange_list, index));
+	list_free(si_sampling_ndrange_list);
+	free(si_sampling_work_group_count);
+}
+
+
+void si_sampling_map_ndrange(struct si_ndrange_t *ndrange)
+{
+	struct si_sampling_ndrange_t *sampling_ndrange;
+	int compute_unit_id;
+
+	if (!si_sampling_active)
+		return;
+
+	/* New statistics */
+	sampling_ndrange = xcalloc(1, sizeof(struct si_sampling_ndrange_t));
+	sampling_ndrange->id = ndrange->id;
+	sampling_ndrange->slots = si_gpu_num_compute_units *
+		si_gpu->work_groups_per_compute_unit;
+	sampling_ndrange->start_cycle = asTiming(si_gpu)->cycle;
+	sampling_ndrange->end_cycle = asTiming(si_gpu)->cycle;
+	list_add(si_sampling_ndrange_list, sampling_ndrange);
+
+	/* Restart warm-up on all compute units */
+	SI_GPU_FOREACH_COMPUTE_UNIT(compute_unit_id)
+		si_sampling_work_group_count[compute_unit_id] = 0;
+}
+
+
+int si_sampling_skip_work_group(struct si_compute_unit_t *compute_unit,
+	struct si_work_group_t *work_group)
+{
+	struct si_sampling_ndrange_t *ndrange;
+	long long count;
+
+	/* Warm-up, or periodic sample */
+	count = si_sampling_work_group_count[compute_unit->id]++;
+	if (count < si_sampling_warmup ||
+			!((count - si_sampling_warmup) % si_sampling_period))
+		return FALSE;
+
+	/* Functional execution */
+	si_work_group_execute(work_group);
+	si_work_group_free(work_group);
+
+	/* Statistics */
+	ndrange = list_tail(si_sampling_ndrange_list);
+	assert(ndrange);
+	ndrange->functional_work_groups++;
+	return TRUE;
+}
+
+
+void si_sampling_unmap_work_group(struct si_work_group_t *work_group)
+{
+	struct si_sampling_ndrange_t *ndrange;
+
+	double cycles;
+	double mem;
+
+	/* Statistics */
+	ndrange = list_tail(si_sampling_ndrange_list);
+	assert(ndrange);
+	cycles = asTiming(si_gpu)->cycle - work_group->map_cycle;
+	mem = work_group->vector_mem_block_accesses;
+	ndrange->detailed_work_groups++;
+	ndrange->cycles_sum += cycles;
+	ndrange->cycles_sq_sum += cycles * cycles;
+	ndrange->mem_sum += mem;
+	ndrange->mem_sq_sum += mem * mem;
+	ndrange->end_cycle = asTiming(si_gpu)->cycle;
+}
+
+
+void si_sampling_dump_report(FILE *f)
+{
+	struct si_sampling_ndrange_t *ndrange;
+
+	double cycles;
+	double cycles_error;
+	double total_cycles;
+	double total_cycles_var;
+
+	int index;
+
+	if (!si_sampling_active)
+		return;
+
+	/* ND-Ranges */
+	total_cycles = 0.0;
+	total_cycles_var = 0.0;
+	LIST_FOR_EACH(si_sampling_ndrange_list, index)
+	{
+		ndrange = list_get(si_sampling_ndrange_list, index);
+		si_sampling_ndrange_dump(ndrange, f, &cycles, &cycles_error);
+		total_cycles += cycles;
+		total_cycles_var += cycles_error * cycles_error;
+	}
+
+	/* Total, with the errors of independent ND-Ranges combined */
+	fprintf(f, "[ Sampling ]\n\n");
+	fprintf(f, "NDRangeCount = %d\n", list_count(si_sampling_ndrange_list));
+	fprintf(f, "EstimatedCycles = %.0f\n", total_cycles);
+	fprintf(f, "EstimatedCyclesError = %.0f\n", sqrt(total_cycles_var));
+	fprintf(f, "\n\n");
+}
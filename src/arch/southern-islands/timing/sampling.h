@@ -0,0 +1,65 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef ARCH_SOUTHERN_ISLANDS_TIMING_SAMPLING_H
+#define ARCH_SOUTHERN_ISLANDS_TIMING_SAMPLING_H
+
+#include <stdio.h>
+
+
+/*
+ * Work-group sampling
+ *
+ * The first work-groups dispatched to each compute unit in an ND-Range, and
+ * then one out of every few, are simulated in detail. The rest run
+ * functionally at the time they are dispatched, without occupying the
+ * compute unit. The kernel execution time and memory traffic are
+ * extrapolated from the work-groups simulated in detail.
+ */
+
+struct config_t;
+struct si_compute_unit_t;
+struct si_ndrange_t;
+struct si_work_group_t;
+
+/* Set when section '[ Sampling ]' is present in the GPU configuration file */
+extern int si_sampling_active;
+
+void si_sampling_config_read(struct config_t *config);
+void si_sampling_config_dump(FILE *f);
+void si_sampling_done(void);
+
+/* Start the statistics of a new ND-Range. Called once the number of
+ * work-groups per compute unit is known. */
+void si_sampling_map_ndrange(struct si_ndrange_t *ndrange);
+
+/* Decide whether a work-group about to be dispatched to 'compute_unit' is
+ * left out of the sample. If so, the work-group is executed functionally and
+ * freed, and the function returns TRUE. */
+int si_sampling_skip_work_group(struct si_compute_unit_t *compute_unit,
+	struct si_work_group_t *work_group);
+
+/* Record the statistics of a work-group simulated in detail, before it is
+ * freed */
+void si_sampling_unmap_work_group(struct si_work_group_t *work_group);
+
+void si_sampling_dump_report(FILE *f);
+
+
+#endif
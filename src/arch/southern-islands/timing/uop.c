@@ -21,6 +21,7 @@
 #include <lib/util/list.h>
 #include <lib/util/repos.h>
 
+#include "compute-unit.h"
 #include "uop.h"
 
 
@@ -39,8 +40,6 @@ int si_stack_debug_category;
 
 static long long gpu_uop_id_counter = 0;
 
-static struct repos_t *gpu_uop_repos;
-
 
 #if 0
 static void si_uop_add_src_idep(struct si_uop_t *uop, struct si_inst_t *inst, int src_idx)
@@ -75,30 +74,27 @@ static void si_uop_add_src_idep(struct si_uop_t *uop, struct si_inst_t *inst, in
  * Public Functions
  */
 
-void si_uop_init()
+struct repos_t *si_uop_repos_create(void)
 {
 	/* GPU uop repository.
 	 * The size assigned for each 'si_uop_t' is equals to the 
 	 * baseline structure size plus the size of a 'si_work_item_uop_t' 
 	 * element for each work-item in the wavefront. */
-	gpu_uop_repos = repos_create(sizeof(struct si_uop_t) + 
+	return repos_create(sizeof(struct si_uop_t) + 
 		sizeof(struct si_work_item_uop_t)
 		* si_emu_wavefront_size, "gpu_uop_repos");
 }
 
 
-void si_uop_done()
-{
-	repos_free(gpu_uop_repos);
-}
-
-
-struct si_uop_t *si_uop_create()
+struct si_uop_t *si_uop_create(struct si_compute_unit_t *compute_unit)
 {
 	struct si_uop_t *uop;
 
-	uop = repos_create_object(gpu_uop_repos);
-	uop->id = gpu_uop_id_counter++;
+	/* Compute units running in different host threads allocate uops from
+	 * their own repository */
+	uop = repos_create_object(compute_unit->uop_repos);
+	uop->id = __sync_fetch_and_add(&gpu_uop_id_counter, 1);
+	uop->compute_unit = compute_unit;
 	return uop;
 }
 
@@ -107,7 +103,7 @@ void si_uop_free(struct si_uop_t *gpu_uop)
 {
 	if (!gpu_uop)
 		return;
-	repos_free_object(gpu_uop_repos, gpu_uop);
+	repos_free_object(gpu_uop->compute_unit->uop_repos, gpu_uop);
 }
 
 
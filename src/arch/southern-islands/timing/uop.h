@@ -105,10 +105,11 @@ struct si_uop_t
 };
 
 
-void si_uop_init(void);
-void si_uop_done(void);
+/* Repository of uops of one compute unit */
+struct repos_t;
+struct repos_t *si_uop_repos_create(void);
 
-struct si_uop_t *si_uop_create(void);
+struct si_uop_t *si_uop_create(struct si_compute_unit_t *compute_unit);
 void si_uop_free(struct si_uop_t *gpu_uop);
 
 void si_uop_list_free(struct list_t *uop_list);
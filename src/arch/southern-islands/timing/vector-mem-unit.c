@@ -20,6 +20,7 @@
 
 #include <arch/southern-islands/emu/emu.h>
 #include <arch/southern-islands/emu/wavefront.h>
+#include <arch/southern-islands/emu/work-group.h>
 #include <lib/esim/trace.h>
 #include <lib/util/debug.h>
 #include <lib/util/list.h>
@@ -31,6 +32,58 @@
 #include "uop.h"
 #include "wavefront-pool.h"
 
+
+/* Group the global memory addresses of all work-items in the uop's wavefront
+ * into unique vector cache blocks. The block addresses are left in
+ * 'vector_mem->coalesce_block_addr', in order of first appearance. */
+static void si_vector_mem_coalesce(struct si_vector_mem_unit_t *vector_mem,
+	struct si_uop_t *uop)
+{
+	struct si_work_item_uop_t *work_item_uop;
+	struct mod_t *mod;
+
+	unsigned int block_addr;
+	unsigned int block_mask;
+
+	int work_item_id;
+	int count;
+	int i;
+
+	/* Without coalescing, every work-item gets its own access */
+	mod = vector_mem->compute_unit->vector_cache;
+	block_mask = si_gpu_vector_mem_coalesce ? ~(mod->block_size - 1) : ~0;
+
+	count = 0;
+	SI_FOREACH_WORK_ITEM_IN_WAVEFRONT(uop->wavefront, work_item_id)
+	{
+		work_item_uop = &uop->work_item_uop[work_item_id];
+		block_addr = work_item_uop->global_mem_access_addr & block_mask;
+
+		/* Unit-stride accesses hit the last block found, so check it
+		 * before searching the whole list. */
+		if (si_gpu_vector_mem_coalesce && count)
+		{
+			if (vector_mem->coalesce_block_addr[count - 1] == block_addr)
+				continue;
+			for (i = count - 2; i >= 0; i--)
+				if (vector_mem->coalesce_block_addr[i] == block_addr)
+					break;
+			if (i >= 0)
+				continue;
+		}
+
+		/* New block */
+		assert(count < si_emu_wavefront_size);
+		vector_mem->coalesce_block_addr[count++] = block_addr;
+	}
+
+	/* Statistics */
+	vector_mem->coalesce_block_count = count;
+	vector_mem->work_item_accesses += si_emu_wavefront_size;
+	vector_mem->block_accesses += count;
+	uop->work_group->vector_mem_block_accesses += count;
+}
+
 void si_vector_mem_complete(struct si_vector_mem_unit_t *vector_mem)
 {
 	struct si_uop_t *uop = NULL;
@@ -166,12 +219,10 @@ void si_vector_mem_write(struct si_vector_mem_unit_t *vector_mem)
 void si_vector_mem_mem(struct si_vector_mem_unit_t *vector_mem)
 {
 	struct si_uop_t *uop;
-	struct si_work_item_uop_t *work_item_uop;
-	struct si_work_item_t *work_item;
-	int work_item_id;
 	int instructions_processed = 0;
 	int list_entries;
 	int i;
+	int j;
 	enum mod_access_kind_t access_kind;
 	int list_index = 0;
 
@@ -231,18 +282,18 @@ void si_vector_mem_mem(struct si_vector_mem_unit_t *vector_mem)
 		else 
 			fatal("%s: invalid access kind", __FUNCTION__);
 
-		/* Access global memory */
+		/* Access global memory. One access is issued per vector
+		 * cache block touched by the wavefront. The witness counts
+		 * blocks, so the uop leaves the memory buffer once every block
+		 * has completed, which covers all work-items mapped to it. */
 		assert(!uop->global_mem_witness);
-		SI_FOREACH_WORK_ITEM_IN_WAVEFRONT(uop->wavefront, work_item_id)
+		si_vector_mem_coalesce(vector_mem, uop);
+		for (j = 0; j < vector_mem->coalesce_block_count; j++)
 		{
-			work_item = uop->wavefront->work_items[work_item_id];
-			work_item_uop = 
-				&uop->work_item_uop[work_item->id_in_wavefront];
-
-			mod_access(vector_mem->compute_unit->vector_cache, 
-				access_kind, 
-				work_item_uop->global_mem_access_addr,
-				&uop->global_mem_witness, NULL, NULL, NULL);
+			si_compute_unit_mod_access(vector_mem->compute_unit,
+				vector_mem->compute_unit->vector_cache, 
+				access_kind, vector_mem->coalesce_block_addr[j],
+				&uop->global_mem_witness);
 			uop->global_mem_witness--;
 		}
 
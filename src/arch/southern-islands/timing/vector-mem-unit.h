@@ -30,8 +30,16 @@ struct si_vector_mem_unit_t
 
 	struct si_compute_unit_t *compute_unit;
 
+	/* Coalescer. Scratch list of the unique vector cache blocks touched
+	 * by the work-items of the uop being sent to memory, with room for
+	 * one block per work-item. */
+	unsigned int *coalesce_block_addr;
+	int coalesce_block_count;
+
 	/* Statistics */
 	long long inst_count;
+	long long work_item_accesses;  /* Accesses requested by work-items */
+	long long block_accesses;  /* Accesses issued to the vector cache */
 
 	/* Spatial profiling statistics*/
 	long long inflight_mem_accesses ;
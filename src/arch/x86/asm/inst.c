@@ -500,6 +500,7 @@ void X86InstClear(X86Inst *self)
 	self->opindex = 0;
 	self->segment = 0;
 	self->prefixes = 0;
+	self->lock = 0;
 
 	self->op_size = 0;
 	self->addr_size = 0;
@@ -556,7 +557,8 @@ void X86InstDecode(X86Inst *self, unsigned int eip, void *buf)
 		{
 
 		case 0xf0:
-			/* lock prefix is ignored */
+			/* lock prefix does not affect decoding */
+			self->lock = 1;
 			break;
 
 		case 0xf2:
@@ -160,6 +160,7 @@ CLASS_BEGIN(X86Inst, Object)
 	/* Prefixes */
 	X86InstReg segment;  /* Reg. used to override segment */
 	int prefixes;  /* Mask of prefixes of type 'X86InstPrefix' */
+	int lock;  /* 'lock' prefix, not in 'prefixes' since it does not select the opcode */
 	int op_size;  /* Operand size: 2 or 4, default 4 */
 	int addr_size;  /* Address size: 2 or 4, default 4 */
 	
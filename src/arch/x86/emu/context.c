@@ -17,7 +17,10 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <errno.h>
 #include <poll.h>
+#include <string.h>
+#include <sys/epoll.h>
 #include <unistd.h>
 
 #include <arch/x86/timing/cpu.h>
@@ -28,6 +31,7 @@
 #include <lib/util/misc.h>
 #include <lib/util/string.h>
 #include <lib/util/timer.h>
+#include <mem-system/cache-sweep.h>
 #include <mem-system/memory.h>
 #include <mem-system/mmu.h>
 #include <mem-system/spec-mem.h>
@@ -54,6 +58,7 @@ static void X86ContextDoCreate(X86Context *self, X86Emu *emu)
 	/* Initialize */
 	self->emu = emu;
 	self->pid = emu->current_pid++;
+	self->host_event_fd = -1;
 
 	/* Update state so that the context is inserted in the
 	 * corresponding lists. The x86_ctx_running parameter has no
@@ -93,6 +98,7 @@ void X86ContextCreate(X86Context *self, X86Emu *emu)
 	self->address_space_index = mmu_address_space_new();
 	self->mem = mem_create();
 	self->spec_mem = spec_mem_create(self->mem);
+	cache_sweep_register_mem(self->mem, "x86.ctx%d", self->pid);
 
 	/* Signal handlers and file descriptor table */
 	self->signal_handler_table = x86_signal_handler_table_create();
@@ -144,6 +150,7 @@ void X86ContextCreateAndFork(X86Context *self, X86Context *forked)
 	self->address_space_index = mmu_address_space_new();
 	self->mem = mem_create();
 	self->spec_mem = spec_mem_create(self->mem);
+	cache_sweep_register_mem(self->mem, "x86.ctx%d", self->pid);
 	mem_clone(self->mem, forked->mem);
 
 	/* Loader */
@@ -234,10 +241,37 @@ void X86ContextDump(Object *self, FILE *f)
 }
 
 
-void X86ContextExecute(X86Context *self)
+/* Read 'size' bytes of the instruction at 'addr' into 'buf' without checking
+ * permissions. Nonexistent pages or pages without data read as zeros. The
+ * memory image is not switched to unsafe mode for this, since it might be
+ * shared with contexts running in other host threads. */
+static void X86ContextFetchUnchecked(X86Context *self, unsigned int addr,
+		int size, unsigned char *buf)
 {
-	X86Emu *emu = self->emu;
+	struct mem_page_t *page;
+	unsigned int offset;
+	int chunksize;
+
+	while (size)
+	{
+		offset = addr & (MEM_PAGE_SIZE - 1);
+		chunksize = MIN(size, MEM_PAGE_SIZE - offset);
+		page = mem_page_get(self->mem, addr);
+		if (page && page->data)
+			memcpy(buf, page->data + offset, chunksize);
+		else
+			memset(buf, 0, chunksize);
 
+		size -= chunksize;
+		buf += chunksize;
+		addr += chunksize;
+	}
+}
+
+
+/* Fetch and decode the instruction at the current 'eip' into 'self->inst' */
+void X86ContextDecode(X86Context *self)
+{
 	struct x86_regs_t *regs = self->regs;
 	struct mem_t *mem = self->mem;
 
@@ -249,21 +283,21 @@ void X86ContextExecute(X86Context *self)
 	/* Memory permissions should not be checked if the context is executing in
 	 * speculative mode. This will prevent guest segmentation faults to occur. */
 	spec_mode = X86ContextGetState(self, X86ContextSpecMode);
-	mem->safe = spec_mode ? 0 : mem_safe_mode;
+	if (spec_mode)
+		mem->safe = 0;
 
-	/* Read instruction from memory. Memory should be accessed here in unsafe mode
-	 * (i.e., allowing segmentation faults) if executing speculatively. */
+	/* Read instruction from memory. If the 20 read bytes cross a page
+	 * boundary, permissions are not checked. If a part of them does not
+	 * belong to the actual instruction, and they lie on a page with no
+	 * permissions, this would generate an undesired protection fault. */
 	buffer_ptr = mem_get_buffer(mem, regs->eip, 20, mem_access_exec);
 	if (!buffer_ptr)
 	{
-		/* Disable safe mode. If a part of the 20 read bytes does not belong to the
-		 * actual instruction, and they lie on a page with no permissions, this would
-		 * generate an undesired protection fault. */
-		mem->safe = 0;
 		buffer_ptr = buffer;
-		mem_access(mem, regs->eip, 20, buffer_ptr, mem_access_exec);
+		X86ContextFetchUnchecked(self, regs->eip, 20, buffer_ptr);
 	}
-	mem->safe = mem_safe_mode;
+	if (spec_mode)
+		mem->safe = mem_safe_mode;
 
 	/* Disassemble */
 	X86InstDecode(&self->inst, regs->eip, buffer_ptr);
@@ -277,6 +311,15 @@ void X86ContextExecute(X86Context *self)
 		x86_emu_last_inst_size == self->inst.size &&
 		!memcmp(x86_emu_last_inst_bytes, buffer_ptr, x86_emu_last_inst_size))
 		esim_finish = esim_finish_x86_last_inst;
+}
+
+
+void X86ContextExecute(X86Context *self)
+{
+	X86Emu *emu = self->emu;
+
+	/* Fetch and decode */
+	X86ContextDecode(self);
 
 	/* Execute instruction */
 	X86ContextExecuteInst(self);
@@ -286,6 +329,38 @@ void X86ContextExecute(X86Context *self)
 }
 
 
+/* Run up to 'max_inst' instructions of the context from a host thread, as part
+ * of a parallel round started by 'X86EmuRun'. Execution stops right before any
+ * instruction that must be executed serially by the main thread, setting flag
+ * 'parallel_serialize'. The function returns the number of executed
+ * instructions, which the caller adds to the emulator statistics. */
+long long X86ContextExecuteParallel(X86Context *self, long long max_inst)
+{
+	long long count;
+
+	self->parallel = 1;
+	self->parallel_serialize = 0;
+	for (count = 0; count < max_inst && !esim_finish; count++)
+	{
+		/* System calls run serially, and they are the only instructions
+		 * that can change the state of any context. */
+		X86ContextDecode(self);
+		if (self->inst.opcode == x86_inst_int_imm8)
+		{
+			self->parallel_serialize = 1;
+			break;
+		}
+
+		/* Execute */
+		X86ContextExecuteInst(self);
+	}
+	self->parallel = 0;
+
+	/* Return executed instructions */
+	return count;
+}
+
+
 /* Force a new 'eip' value for the context. The forced value should be the same as
  * the current 'eip' under normal circumstances. If it is not, speculative execution
  * starts, which will end on the next call to 'x86_ctx_recover'. */
@@ -420,56 +495,61 @@ X86Context *X86ContextGetZombie(X86Context *self, int pid)
 }
 
 
-/* If the context is running a 'x86_emu_host_thread_suspend' thread,
- * cancel it and schedule call to 'x86_emu_process_events' */
-void X86ContextHostThreadSuspendCancelUnsafe(X86Context *self)
-{
-	X86Emu *emu = self->emu;
-
-	if (self->host_thread_suspend_active)
-	{
-		if (pthread_cancel(self->host_thread_suspend))
-			fatal("%s: context %d: error canceling host thread",
-				__FUNCTION__, self->pid);
-		self->host_thread_suspend_active = 0;
-		emu->process_events_force = 1;
-	}
-}
-
-
-void X86ContextHostThreadSuspendCancel(X86Context *self)
+/* Register host file descriptor 'host_fd' in the emulator's host event loop,
+ * so that the context is checked again in 'X86EmuProcessEvents' as soon as
+ * any of the 'poll'-style 'events' (POLLIN, POLLOUT) occur. The registration
+ * is one-shot, and is released by 'X86ContextHostEventUnwatch'. */
+void X86ContextHostEventWatch(X86Context *self, int host_fd, int events)
 {
 	X86Emu *emu = self->emu;
+	struct epoll_event event;
+	int err;
+
+	/* Launch host event loop */
+	assert(self->host_event_fd < 0);
+	X86EmuHostEventStart(emu);
+
+	/* Register a duplicate of the file descriptor. Epoll registrations are
+	 * per descriptor, so this allows several contexts to wait on one file. */
+	self->host_event_fd = dup(host_fd);
+	if (self->host_event_fd < 0)
+		fatal("%s: context %d: cannot duplicate host file descriptor",
+			__FUNCTION__, self->pid);
+	event.events = EPOLLONESHOT;
+	event.events |= (events & POLLIN) ? EPOLLIN : 0;
+	event.events |= (events & POLLOUT) ? EPOLLOUT : 0;
+	event.data.u64 = self->pid;
+	if (!epoll_ctl(emu->host_event_epoll_fd, EPOLL_CTL_ADD,
+			self->host_event_fd, &event))
+		return;
 
-	pthread_mutex_lock(&emu->process_events_mutex);
-	X86ContextHostThreadSuspendCancelUnsafe(self);
-	pthread_mutex_unlock(&emu->process_events_mutex);
+	/* Files not supported by 'epoll' (e.g., regular files) never block,
+	 * so the wake up condition will just be checked again. */
+	err = errno;
+	close(self->host_event_fd);
+	self->host_event_fd = -1;
+	if (err != EPERM)
+		fatal("%s: context %d: cannot watch host file descriptor (%s)",
+			__FUNCTION__, self->pid, strerror(err));
+	X86EmuProcessEventsSchedule(emu);
 }
 
 
-/* If the context is running a 'ke_host_thread_timer' thread,
- * cancel it and schedule call to 'x86_emu_process_events' */
-void X86ContextHostThreadTimerCancelUnsafe(X86Context *self)
+/* Release the host file descriptor registered with 'X86ContextHostEventWatch',
+ * if any. The caller is responsible for scheduling a call to
+ * 'X86EmuProcessEvents' if the wake up condition must be checked again. */
+void X86ContextHostEventUnwatch(X86Context *self)
 {
 	X86Emu *emu = self->emu;
 
-	if (self->host_thread_timer_active)
-	{
-		if (pthread_cancel(self->host_thread_timer))
-			fatal("%s: context %d: error canceling host thread",
-				__FUNCTION__, self->pid);
-		self->host_thread_timer_active = 0;
-		emu->process_events_force = 1;
-	}
-}
-
-void X86ContextHostThreadTimerCancel(X86Context *self)
-{
-	X86Emu *emu = self->emu;
-
-	pthread_mutex_lock(&emu->process_events_mutex);
-	X86ContextHostThreadTimerCancelUnsafe(self);
-	pthread_mutex_unlock(&emu->process_events_mutex);
+	if (self->host_event_fd < 0)
+		return;
+	if (epoll_ctl(emu->host_event_epoll_fd, EPOLL_CTL_DEL,
+			self->host_event_fd, NULL))
+		fatal("%s: context %d: error unwatching host file descriptor",
+			__FUNCTION__, self->pid);
+	close(self->host_event_fd);
+	self->host_event_fd = -1;
 }
 
 
@@ -523,8 +603,7 @@ void X86ContextFinishGroup(X86Context *self, int state)
 			X86ContextSetState(aux, X86ContextFinished);
 		if (X86ContextGetState(aux, X86ContextHandler))
 			X86ContextReturnFromSignalHandler(aux);
-		X86ContextHostThreadSuspendCancel(aux);
-		X86ContextHostThreadTimerCancel(aux);
+		X86ContextHostEventUnwatch(aux);
 
 		/* Child context of 'ctx' goes to state 'finished'.
 		 * Context 'ctx' goes to state 'zombie' or 'finished' if it has a parent */
@@ -554,9 +633,8 @@ void X86ContextFinish(X86Context *self, int state)
 	if (X86ContextGetState(self, X86ContextFinished | X86ContextZombie))
 		return;
 	
-	/* If context is waiting for host events, cancel spawned host threads. */
-	X86ContextHostThreadSuspendCancel(self);
-	X86ContextHostThreadTimerCancel(self);
+	/* If context is waiting for host events, stop watching them. */
+	X86ContextHostEventUnwatch(self);
 
 	/* From now on, all children have lost their parent. If a child is
 	 * already zombie, finish it, since its parent won't be able to waitpid it
@@ -798,133 +876,6 @@ void X86ContextProcCPUInfo(X86Context *self, char *path, int size)
 }
 
 
-void *X86EmuHostThreadSuspend(void *arg)
-{
-	X86Context *self = asX86Context(arg);
-	X86Emu *emu = self->emu;
-
-	long long now = esim_real_time();
-
-	/* Detach this thread - we don't want the parent to have to join it to release
-	 * its resources. The thread termination can be observed by atomically checking
-	 * the 'self->host_thread_suspend_active' flag. */
-	pthread_detach(pthread_self());
-
-	/* Context suspended in 'poll' system call */
-	if (X86ContextGetState(self, X86ContextNanosleep))
-	{
-		long long timeout;
-
-		/* Calculate remaining sleep time in microseconds */
-		timeout = self->wakeup_time > now ? self->wakeup_time - now : 0;
-		usleep(timeout);
-
-	}
-	else if (X86ContextGetState(self, X86ContextPoll))
-	{
-		struct x86_file_desc_t *fd;
-		struct pollfd host_fds;
-		int err, timeout;
-
-		/* Get file descriptor */
-		fd = x86_file_desc_table_entry_get(self->file_desc_table, self->wakeup_fd);
-		if (!fd)
-			fatal("syscall 'poll': invalid 'wakeup_fd'");
-
-		/* Calculate timeout for host call in milliseconds from now */
-		if (!self->wakeup_time)
-			timeout = -1;
-		else if (self->wakeup_time < now)
-			timeout = 0;
-		else
-			timeout = (self->wakeup_time - now) / 1000;
-
-		/* Perform blocking host 'poll' */
-		host_fds.fd = fd->host_fd;
-		host_fds.events = ((self->wakeup_events & 4) ? POLLOUT : 0) | ((self->wakeup_events & 1) ? POLLIN : 0);
-		err = poll(&host_fds, 1, timeout);
-		if (err < 0)
-			fatal("syscall 'poll': unexpected error in host 'poll'");
-	}
-	else if (X86ContextGetState(self, X86ContextRead))
-	{
-		struct x86_file_desc_t *fd;
-		struct pollfd host_fds;
-		int err;
-
-		/* Get file descriptor */
-		fd = x86_file_desc_table_entry_get(self->file_desc_table, self->wakeup_fd);
-		if (!fd)
-			fatal("syscall 'read': invalid 'wakeup_fd'");
-
-		/* Perform blocking host 'poll' */
-		host_fds.fd = fd->host_fd;
-		host_fds.events = POLLIN;
-		err = poll(&host_fds, 1, -1);
-		if (err < 0)
-			fatal("syscall 'read': unexpected error in host 'poll'");
-	}
-	else if (X86ContextGetState(self, X86ContextWrite))
-	{
-		struct x86_file_desc_t *fd;
-		struct pollfd host_fds;
-		int err;
-
-		/* Get file descriptor */
-		fd = x86_file_desc_table_entry_get(self->file_desc_table, self->wakeup_fd);
-		if (!fd)
-			fatal("syscall 'write': invalid 'wakeup_fd'");
-
-		/* Perform blocking host 'poll' */
-		host_fds.fd = fd->host_fd;
-		host_fds.events = POLLOUT;
-		err = poll(&host_fds, 1, -1);
-		if (err < 0)
-			fatal("syscall 'write': unexpected error in host 'write'");
-
-	}
-
-	/* Event occurred - thread finishes */
-	pthread_mutex_lock(&emu->process_events_mutex);
-	emu->process_events_force = 1;
-	self->host_thread_suspend_active = 0;
-	pthread_mutex_unlock(&emu->process_events_mutex);
-	return NULL;
-}
-
-
-void *X86ContextHostThreadTimer(void *arg)
-{
-	X86Context *self = asX86Context(arg);
-	X86Emu *emu = self->emu;
-
-	long long now = esim_real_time();
-	struct timespec ts;
-	long long sleep_time;  /* In usec */
-
-	/* Detach this thread - we don't want the parent to have to join it to release
-	 * its resources. The thread termination can be observed by thread-safely checking
-	 * the 'self->host_thread_timer_active' flag. */
-	pthread_detach(pthread_self());
-
-	/* Calculate sleep time, and sleep only if it is greater than 0 */
-	if (self->host_thread_timer_wakeup > now)
-	{
-		sleep_time = self->host_thread_timer_wakeup - now;
-		ts.tv_sec = sleep_time / 1000000;
-		ts.tv_nsec = (sleep_time % 1000000) * 1000;  /* nsec */
-		nanosleep(&ts, NULL);
-	}
-
-	/* Timer expired, schedule call to 'X86EmuProcessEvents' */
-	pthread_mutex_lock(&emu->process_events_mutex);
-	emu->process_events_force = 1;
-	self->host_thread_timer_active = 0;
-	pthread_mutex_unlock(&emu->process_events_mutex);
-	return NULL;
-}
-
-
 
 
 /*
@@ -126,6 +126,26 @@ CLASS_BEGIN(X86Context, Object)
 
 
 
+	/* Host-parallel execution. Flag 'parallel' is set while the context runs
+	 * in a host thread as part of a parallel round. Flag 'parallel_serialize'
+	 * is set when the context stopped before an instruction that must be
+	 * executed by the main thread, such as a system call. */
+	int parallel;
+	int parallel_serialize;
+
+	/* Atomic emulation of locked instructions in parallel rounds. Accesses to
+	 * the memory operand at 'atomic_addr' are served from 'atomic_value', which
+	 * is initialized from 'atomic_old' and committed into the host buffer
+	 * 'atomic_host' with a compare-and-swap once the instruction finishes. */
+	int atomic_active;
+	int atomic_size;  /* Size of operand, 0 before its first access */
+	int atomic_dirty;  /* Operand was written */
+	int atomic_locked;  /* Serialized with emulator mutex instead */
+	unsigned int atomic_addr;
+	void *atomic_host;
+	unsigned long long atomic_old;
+	unsigned long long atomic_value;
+
 	/* For segmented memory access in glibc */
 	unsigned int glibc_segment_base;
 	unsigned int glibc_segment_limit;
@@ -133,18 +153,11 @@ CLASS_BEGIN(X86Context, Object)
 	/* When debugging function calls with 'x86_isa_debug_call', function call level. */
 	int function_level;
 
-	/* Host thread that suspends and then schedules call to 'x86_emu_process_events'. */
-	/* The 'host_thread_suspend_active' flag is set when a 'host_thread_suspend' thread
-	 * is launched for this context (by caller).
-	 * It is clear when the context finished (by the host thread).
-	 * It should be accessed safely by locking global mutex 'process_events_mutex'. */
-	pthread_t host_thread_suspend;  /* Thread */
-	int host_thread_suspend_active;  /* Thread-spawned flag */
-
-	/* Host thread that lets time elapse and schedules call to 'x86_emu_process_events'. */
-	pthread_t host_thread_timer;  /* Thread */
-	int host_thread_timer_active;  /* Thread-spawned flag */
-	long long host_thread_timer_wakeup;  /* Time when the thread will wake up */
+	/* Host file descriptor registered in the emulator's host event loop while the
+	 * context is suspended in 'read', 'write', or 'poll' and the file is not ready.
+	 * It is a 'dup' of the guest file's host descriptor, so that several contexts
+	 * can wait on the same file. Set to -1 when no file is being watched. */
+	int host_event_fd;
 
 	/* Three timers used by 'setitimer' system call - real, virtual, and prof. */
 	long long itimer_value[3];  /* Time when current occurrence of timer expires (0=inactive) */
@@ -209,11 +222,8 @@ void X86ContextDestroy(X86Context *self);
 
 void X86ContextDump(Object *self, FILE *f);
 
-/* Thread safe/unsafe versions */
-void X86ContextHostThreadSuspendCancelUnsafe(X86Context *self);
-void X86ContextHostThreadSuspendCancel(X86Context *self);
-void X86ContextHostThreadTimerCancelUnsafe(X86Context *self);
-void X86ContextHostThreadTimerCancel(X86Context *self);
+void X86ContextHostEventWatch(X86Context *self, int host_fd, int events);
+void X86ContextHostEventUnwatch(X86Context *self);
 
 void X86ContextSuspend(X86Context *self,
 	X86ContextCanWakeupFunc can_wakeup_callback_func,
@@ -222,7 +232,9 @@ void X86ContextSuspend(X86Context *self,
 
 void X86ContextFinish(X86Context *self, int state);
 void X86ContextFinishGroup(X86Context *self, int state);
+void X86ContextDecode(X86Context *self);
 void X86ContextExecute(X86Context *self);
+long long X86ContextExecuteParallel(X86Context *self, long long max_inst);
 
 void X86ContextSetEip(X86Context *self, unsigned int eip);
 void X86ContextRecover(X86Context *self);
@@ -240,16 +252,6 @@ void X86ContextExitRobustList(X86Context *self);
 void X86ContextProcSelfMaps(X86Context *self, char *path, int size);
 void X86ContextProcCPUInfo(X86Context *self, char *path, int size);
 
-/* Function that suspends the host thread waiting for an event to occur.
- * When the event finally occurs (i.e., before the function finishes, a
- * call to 'X86EmuProcessEvents' is scheduled.
- * The argument 'arg' is the associated guest context. */
-void *X86EmuHostThreadSuspend(void *self);
-
-/* Function that suspends the host thread waiting for a timer to expire,
- * and then schedules a call to 'X86EmuProcessEvents'. */
-void *X86ContextHostThreadTimer(void *self);
-
 
 
 
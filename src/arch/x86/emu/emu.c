@@ -19,6 +19,10 @@
 
 #include <errno.h>
 #include <poll.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
 #include <unistd.h>
 
 #include <arch/x86/timing/cpu.h>
@@ -34,11 +38,13 @@
 #include <lib/util/linked-list.h>
 #include <lib/util/misc.h>
 #include <lib/util/string.h>
+#include <mem-system/cache-sweep.h>
 #include <mem-system/memory.h>
 
 #include "context.h"
 #include "emu.h"
 #include "file-desc.h"
+#include "isa.h"
 #include "loader.h"
 #include "regs.h"
 #include "signal.h"
@@ -55,6 +61,8 @@ long long x86_emu_max_cycles = 0;
 char x86_emu_last_inst_bytes[20];
 int x86_emu_last_inst_size = 0;
 int x86_emu_process_prefetch_hints = 0;
+int x86_emu_host_threads = 1;
+long long x86_emu_host_quantum = 10000;
 
 X86Emu *x86_emu;
 
@@ -65,6 +73,420 @@ X86Emu *x86_emu;
  * Class 'X86Emu'
  */
 
+/* Values of the 'data' field of host epoll events not associated with a
+ * context. Events for contexts carry the context pid. */
+#define X86_EMU_HOST_EVENT_TIMER  ((unsigned long long) -1)
+#define X86_EMU_HOST_EVENT_STOP  ((unsigned long long) -2)
+
+/* Maximum number of events returned by one call to 'epoll_wait' */
+#define X86_EMU_HOST_EVENT_BATCH  64
+
+
+/* Return the earliest of two wakeup times, where 0 means no wakeup. */
+static long long X86EmuMinWakeup(long long wakeup1, long long wakeup2)
+{
+	if (!wakeup1)
+		return wakeup2;
+	if (!wakeup2)
+		return wakeup1;
+	return MIN(wakeup1, wakeup2);
+}
+
+
+/* Post a wakeup for context 'pid' into the host event queue. This function is
+ * only called by the host event loop thread, the only producer in the queue. */
+static void X86EmuHostEventPost(X86Emu *self, int pid)
+{
+	unsigned int tail = self->host_event_queue_tail;
+
+	/* Queue full. The consumer will release all watched files instead. */
+	if (tail - self->host_event_queue_head >= X86_EMU_HOST_EVENT_QUEUE_SIZE)
+	{
+		self->host_event_queue_overflow = 1;
+		return;
+	}
+
+	/* Make the entry visible before publishing it */
+	self->host_event_queue[tail % X86_EMU_HOST_EVENT_QUEUE_SIZE] = pid;
+	__sync_synchronize();
+	self->host_event_queue_tail = tail + 1;
+}
+
+
+/* Drain the host event queue, releasing the host files watched by the posted
+ * contexts, so that their wakeup conditions are checked again. A posted context
+ * might have finished or started waiting on a different file in the meantime,
+ * which only causes a spurious check. */
+static void X86EmuHostEventDrain(X86Emu *self)
+{
+	X86Context *ctx;
+	unsigned int head;
+	unsigned int tail;
+
+	/* Consume published entries */
+	head = self->host_event_queue_head;
+	tail = self->host_event_queue_tail;
+	__sync_synchronize();
+	for (; head != tail; head++)
+	{
+		ctx = X86EmuGetContext(self, self->host_event_queue[head %
+				X86_EMU_HOST_EVENT_QUEUE_SIZE]);
+		if (ctx)
+			X86ContextHostEventUnwatch(ctx);
+	}
+	__sync_synchronize();
+	self->host_event_queue_head = head;
+
+	/* Some entries were lost, so check all contexts */
+	if (__sync_fetch_and_and(&self->host_event_queue_overflow, 0))
+		for (ctx = self->context_list_head; ctx; ctx = ctx->context_list_next)
+			X86ContextHostEventUnwatch(ctx);
+}
+
+
+/* Host event loop thread. It blocks in 'epoll_wait' until a watched host file
+ * becomes ready or the timer expires, posts the associated contexts, and
+ * schedules a call to 'X86EmuProcessEvents'. */
+static void *X86EmuHostEventLoop(void *arg)
+{
+	X86Emu *self = asX86Emu(arg);
+	struct epoll_event events[X86_EMU_HOST_EVENT_BATCH];
+	unsigned long long expirations;
+	int count;
+	int i;
+
+	while (1)
+	{
+		/* Wait for events */
+		count = epoll_wait(self->host_event_epoll_fd, events,
+				X86_EMU_HOST_EVENT_BATCH, -1);
+		if (count < 0 && errno == EINTR)
+			continue;
+		if (count < 0)
+			fatal("%s: unexpected error in host 'epoll_wait'", __FUNCTION__);
+
+		/* Process them */
+		for (i = 0; i < count; i++)
+		{
+			/* Emulator is being destroyed */
+			if (events[i].data.u64 == X86_EMU_HOST_EVENT_STOP)
+				return NULL;
+
+			/* Timer expired. It might have been armed again in the
+			 * meantime, in which case there is nothing to read. */
+			if (events[i].data.u64 == X86_EMU_HOST_EVENT_TIMER)
+			{
+				if (read(self->host_event_timer_fd, &expirations,
+						sizeof expirations) < 0 && errno != EAGAIN)
+					fatal("%s: unexpected error reading host timer",
+						__FUNCTION__);
+				continue;
+			}
+
+			/* Watched file ready */
+			X86EmuHostEventPost(self, events[i].data.u64);
+		}
+
+		/* Schedule call to 'X86EmuProcessEvents' */
+		X86EmuProcessEventsSchedule(self);
+	}
+	return NULL;
+}
+
+
+/* Launch the host event loop thread, if it is not running yet. */
+void X86EmuHostEventStart(X86Emu *self)
+{
+	struct epoll_event event;
+
+	/* Already running */
+	if (self->host_event_thread_active)
+		return;
+
+	/* Create epoll instance, timer, and stop notification */
+	self->host_event_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	self->host_event_timer_fd = timerfd_create(CLOCK_MONOTONIC,
+			TFD_NONBLOCK | TFD_CLOEXEC);
+	self->host_event_stop_fd = eventfd(0, EFD_CLOEXEC);
+	if (self->host_event_epoll_fd < 0 || self->host_event_timer_fd < 0 ||
+			self->host_event_stop_fd < 0)
+		fatal("%s: cannot create host event loop (%s)",
+			__FUNCTION__, strerror(errno));
+
+	/* Watch them */
+	memset(&event, 0, sizeof event);
+	event.events = EPOLLIN;
+	event.data.u64 = X86_EMU_HOST_EVENT_TIMER;
+	if (epoll_ctl(self->host_event_epoll_fd, EPOLL_CTL_ADD,
+			self->host_event_timer_fd, &event))
+		fatal("%s: cannot watch host timer", __FUNCTION__);
+	event.data.u64 = X86_EMU_HOST_EVENT_STOP;
+	if (epoll_ctl(self->host_event_epoll_fd, EPOLL_CTL_ADD,
+			self->host_event_stop_fd, &event))
+		fatal("%s: cannot watch host event", __FUNCTION__);
+
+	/* Launch thread */
+	self->host_event_thread_active = 1;
+	if (pthread_create(&self->host_event_thread, NULL, X86EmuHostEventLoop, self))
+		fatal("%s: could not create host event loop thread", __FUNCTION__);
+}
+
+
+static void X86EmuHostEventStop(X86Emu *self)
+{
+	unsigned long long value = 1;
+
+	/* Not running */
+	if (!self->host_event_thread_active)
+		return;
+
+	/* Notify thread and wait for it */
+	if (write(self->host_event_stop_fd, &value, sizeof value) != sizeof value)
+		fatal("%s: cannot stop host event loop", __FUNCTION__);
+	pthread_join(self->host_event_thread, NULL);
+	self->host_event_thread_active = 0;
+	self->host_event_timer_wakeup = 0;
+
+	/* Free host resources */
+	close(self->host_event_epoll_fd);
+	close(self->host_event_timer_fd);
+	close(self->host_event_stop_fd);
+}
+
+
+/* Arm the host event loop timer to expire at time 'wakeup', given in the units
+ * of 'esim_real_time'. A value of 0 disarms the timer. */
+static void X86EmuHostEventSetTimer(X86Emu *self, long long wakeup, long long now)
+{
+	struct itimerspec its;
+	long long delay;
+
+	/* Nothing changed */
+	if (wakeup == self->host_event_timer_wakeup)
+		return;
+
+	/* Launch host event loop if needed */
+	if (!wakeup && !self->host_event_thread_active)
+		return;
+	X86EmuHostEventStart(self);
+
+	/* Arm relative timer, never with a 0 delay, which would disarm it */
+	memset(&its, 0, sizeof its);
+	if (wakeup)
+	{
+		delay = MAX(wakeup - now, 1);
+		its.it_value.tv_sec = delay / 1000000;
+		its.it_value.tv_nsec = (delay % 1000000) * 1000;
+	}
+	if (timerfd_settime(self->host_event_timer_fd, 0, &its, NULL))
+		fatal("%s: cannot arm host timer", __FUNCTION__);
+	self->host_event_timer_wakeup = wakeup;
+}
+
+
+/* Take contexts of the current parallel round until there are none left, and
+ * run their quantum of instructions. */
+static void X86EmuParallelWork(X86Emu *self)
+{
+	X86Context *ctx;
+	long long count;
+	int index;
+
+	while ((index = __sync_fetch_and_add(&self->parallel_context_next, 1)) <
+			self->parallel_context_count)
+	{
+		ctx = self->parallel_context_array[index];
+		count = X86ContextExecuteParallel(ctx, self->parallel_quantum);
+		__sync_fetch_and_add(&self->parallel_inst, count);
+	}
+}
+
+
+/* Worker thread for parallel execution. It waits for a new round to start,
+ * takes part in it, and notifies the main thread when it is done. */
+static void *X86EmuParallelThread(void *arg)
+{
+	X86Emu *self = asX86Emu(arg);
+	long long round = 0;
+
+	pthread_mutex_lock(&self->parallel_mutex);
+	while (1)
+	{
+		/* Wait for next round */
+		while (!self->parallel_stop && self->parallel_round == round)
+			pthread_cond_wait(&self->parallel_start_cond, &self->parallel_mutex);
+		if (self->parallel_stop)
+			break;
+		round = self->parallel_round;
+
+		/* Work */
+		pthread_mutex_unlock(&self->parallel_mutex);
+		X86EmuParallelWork(self);
+		pthread_mutex_lock(&self->parallel_mutex);
+
+		/* Last worker done */
+		if (!--self->parallel_pending)
+			pthread_cond_signal(&self->parallel_done_cond);
+	}
+	pthread_mutex_unlock(&self->parallel_mutex);
+	return NULL;
+}
+
+
+/* Launch the worker threads for parallel execution, if they are not running
+ * yet. */
+static void X86EmuParallelStart(X86Emu *self)
+{
+	int i;
+
+	/* Already running */
+	if (self->parallel_threads)
+		return;
+
+	/* From now on, memory images are accessed by several host threads */
+	mem_thread_safe_mode++;
+
+	/* Launch threads. The main thread works too. */
+	self->parallel_stop = 0;
+	self->parallel_round = 0;
+	self->parallel_thread_count = x86_emu_host_threads - 1;
+	self->parallel_threads = xcalloc(self->parallel_thread_count, sizeof(pthread_t));
+	for (i = 0; i < self->parallel_thread_count; i++)
+		if (pthread_create(&self->parallel_threads[i], NULL,
+				X86EmuParallelThread, self))
+			fatal("%s: could not create host thread", __FUNCTION__);
+}
+
+
+static void X86EmuParallelStop(X86Emu *self)
+{
+	int i;
+
+	/* Not running */
+	if (!self->parallel_threads)
+		return;
+
+	/* Notify threads and wait for them */
+	pthread_mutex_lock(&self->parallel_mutex);
+	self->parallel_stop = 1;
+	pthread_cond_broadcast(&self->parallel_start_cond);
+	pthread_mutex_unlock(&self->parallel_mutex);
+	for (i = 0; i < self->parallel_thread_count; i++)
+		pthread_join(self->parallel_threads[i], NULL);
+
+	/* Free */
+	free(self->parallel_threads);
+	self->parallel_threads = NULL;
+	mem_thread_safe_mode--;
+}
+
+
+/* Stop all host threads launched by the emulator, so that the simulator
+ * process can be forked: the child process only keeps the calling thread.
+ * Host files watched for suspended contexts are released, so that their wakeup
+ * conditions are checked again in the next call to 'X86EmuProcessEvents'. The
+ * threads are launched again when needed. */
+void X86EmuStopHostThreads(X86Emu *self)
+{
+	X86Context *ctx;
+
+	for (ctx = self->context_list_head; ctx; ctx = ctx->context_list_next)
+		X86ContextHostEventUnwatch(ctx);
+	X86EmuHostEventStop(self);
+	X86EmuParallelStop(self);
+	X86EmuProcessEventsSchedule(self);
+}
+
+
+/* Return whether the running contexts can be emulated in parallel. Features
+ * relying on the serial order of instructions, or on shared state that is not
+ * thread-safe, keep the serial emulation loop. This is the case of tracing of
+ * instructions or function calls, unsafe memory mode, where guest writes can
+ * create memory pages, and cache sweeps. */
+static int X86EmuParallelEnabled(X86Emu *self)
+{
+	return x86_emu_host_threads > 1 && self->running_list_count > 1 &&
+		mem_safe_mode && !cache_sweep_active &&
+		!debug_status(x86_context_isa_debug_category) &&
+		!debug_status(x86_context_call_debug_category);
+}
+
+
+/* Run one parallel round, where every running context executes a quantum of
+ * instructions, up to the first system call. System calls are then executed
+ * serially by the main thread, in the order of the running list. */
+static void X86EmuRunParallel(X86Emu *self)
+{
+	X86Context *ctx;
+
+	long long instructions;
+	long long limit;
+
+	int found;
+
+	/* Launch threads */
+	X86EmuParallelStart(self);
+
+	/* Contexts in round */
+	if (self->parallel_context_size < self->running_list_count)
+	{
+		self->parallel_context_size = self->running_list_count * 2;
+		self->parallel_context_array = xrealloc(self->parallel_context_array,
+				self->parallel_context_size * sizeof(X86Context *));
+	}
+	self->parallel_context_count = 0;
+	for (ctx = self->running_list_head; ctx; ctx = ctx->running_list_next)
+		self->parallel_context_array[self->parallel_context_count++] = ctx;
+
+	/* Quantum. It is shortened so that the maximum number of instructions and
+	 * the end of the fast-forward execution are not exceeded by more than
+	 * one instruction per context. */
+	instructions = asEmu(self)->instructions;
+	limit = x86_emu_max_inst;
+	if (x86_cpu_fast_forward_count > instructions &&
+			(!limit || x86_cpu_fast_forward_count < limit))
+		limit = x86_cpu_fast_forward_count;
+	self->parallel_quantum = x86_emu_host_quantum;
+	if (limit)
+		self->parallel_quantum = MIN(self->parallel_quantum,
+				MAX(1, (limit - instructions) / self->parallel_context_count));
+
+	/* Start round */
+	self->parallel_context_next = 0;
+	self->parallel_inst = 0;
+	pthread_mutex_lock(&self->parallel_mutex);
+	self->parallel_round++;
+	self->parallel_pending = self->parallel_thread_count;
+	pthread_cond_broadcast(&self->parallel_start_cond);
+	pthread_mutex_unlock(&self->parallel_mutex);
+
+	/* Work and wait for workers */
+	X86EmuParallelWork(self);
+	pthread_mutex_lock(&self->parallel_mutex);
+	while (self->parallel_pending)
+		pthread_cond_wait(&self->parallel_done_cond, &self->parallel_mutex);
+	pthread_mutex_unlock(&self->parallel_mutex);
+	asEmu(self)->instructions += self->parallel_inst;
+
+	/* System calls. Each one can change the running list, so it is scanned
+	 * again from the beginning after every call. */
+	do
+	{
+		found = 0;
+		for (ctx = self->running_list_head; ctx && !esim_finish;
+				ctx = ctx->running_list_next)
+		{
+			if (!ctx->parallel_serialize)
+				continue;
+			ctx->parallel_serialize = 0;
+			X86ContextExecute(ctx);
+			found = 1;
+			break;
+		}
+	} while (found);
+}
+
+
 void X86EmuCreate(X86Emu *self, X86Asm *as)
 {
 	/* Parent */
@@ -73,7 +495,6 @@ void X86EmuCreate(X86Emu *self, X86Asm *as)
 	/* Initialize */
 	self->as = as;
 	self->current_pid = 100;
-	pthread_mutex_init(&self->process_events_mutex, NULL);
 
 	/* Endian check */
 	union
@@ -93,6 +514,12 @@ void X86EmuCreate(X86Emu *self, X86Asm *as)
 	/* Drivers */
 	self->opencl_driver = new(OpenclDriver, self);
 
+	/* Parallel execution */
+	pthread_mutex_init(&self->parallel_mutex, NULL);
+	pthread_mutex_init(&self->parallel_atomic_mutex, NULL);
+	pthread_cond_init(&self->parallel_start_cond, NULL);
+	pthread_cond_init(&self->parallel_done_cond, NULL);
+
 	/* Micro-instructions - FIXME - should be part of class */
 	x86_uinst_init();
 
@@ -129,6 +556,18 @@ void X86EmuDestroy(X86Emu *self)
 	/* Free contexts */
 	while (self->context_list_head)
 		delete(self->context_list_head);
+
+	/* Host event loop */
+	X86EmuHostEventStop(self);
+
+	/* Parallel execution */
+	X86EmuParallelStop(self);
+	if (self->parallel_context_array)
+		free(self->parallel_context_array);
+	pthread_mutex_destroy(&self->parallel_mutex);
+	pthread_mutex_destroy(&self->parallel_atomic_mutex);
+	pthread_cond_destroy(&self->parallel_start_cond);
+	pthread_cond_destroy(&self->parallel_done_cond);
 	
 #ifdef HAVE_OPENGL
 
@@ -188,30 +627,29 @@ void X86EmuDumpSummary(Emu *self, FILE *f)
 /* Schedule a call to 'X86EmuProcessEvents' */
 void X86EmuProcessEventsSchedule(X86Emu *self)
 {
-	pthread_mutex_lock(&self->process_events_mutex);
-	self->process_events_force = 1;
-	pthread_mutex_unlock(&self->process_events_mutex);
+	__sync_fetch_and_or(&self->process_events_force, 1);
 }
 
 
-/* Check for events detected in spawned host threads, like waking up contexts or
+/* Check for events detected by the host event loop, like waking up contexts or
  * sending signals.
  * The list is only processed if flag 'self->process_events_force' is set. */
 void X86EmuProcessEvents(X86Emu *self)
 {
 	X86Context *ctx, *next;
 	long long now = esim_real_time();
+	long long wakeup = 0;
 	
-	/* Check if events need actually be checked. */
-	pthread_mutex_lock(&self->process_events_mutex);
-	if (!self->process_events_force)
-	{
-		pthread_mutex_unlock(&self->process_events_mutex);
+	/* Check if events need actually be checked. By default, no subsequent
+	 * call to 'X86EmuProcessEvents' is assumed. */
+	if (!__sync_fetch_and_and(&self->process_events_force, 0))
 		return;
-	}
-	
-	/* By default, no subsequent call to 'X86EmuProcessEvents' is assumed */
-	self->process_events_force = 0;
+
+	/* Release host files that became ready, so that their contexts are
+	 * checked below. If the timer went off, it needs to be armed again. */
+	X86EmuHostEventDrain(self);
+	if (self->host_event_timer_wakeup && self->host_event_timer_wakeup <= now)
+		self->host_event_timer_wakeup = 0;
 
 	/*
 	 * LOOP 1
@@ -231,10 +669,6 @@ void X86EmuProcessEvents(X86Emu *self)
 			unsigned int sec, usec;
 			unsigned long long diff;
 
-			/* If 'X86EmuHostThreadSuspend' is still running for this context, do nothing. */
-			if (ctx->host_thread_suspend_active)
-				continue;
-
 			/* Timeout expired */
 			if (ctx->wakeup_time <= now)
 			{
@@ -263,10 +697,9 @@ void X86EmuProcessEvents(X86Emu *self)
 				continue;
 			}
 
-			/* No event available, launch 'X86EmuHostThreadSuspend' again */
-			ctx->host_thread_suspend_active = 1;
-			if (pthread_create(&ctx->host_thread_suspend, NULL, X86EmuHostThreadSuspend, ctx))
-				fatal("syscall 'poll': could not create child thread");
+			/* No event available, the host event loop timer wakes up the
+			 * context when the timeout expires. */
+			wakeup = X86EmuMinWakeup(wakeup, ctx->wakeup_time);
 			continue;
 		}
 
@@ -284,7 +717,7 @@ void X86EmuProcessEvents(X86Emu *self)
 			}
 
 			/* No event available. The context will never awake on its own, so no
-			 * 'X86EmuHostThreadSuspend' is necessary. */
+			 * host event is necessary. */
 			continue;
 		}
 
@@ -297,9 +730,14 @@ void X86EmuProcessEvents(X86Emu *self)
 			struct pollfd host_fds;
 			int err;
 
-			/* If 'X86EmuHostThreadSuspend' is still running for this context, do nothing. */
-			if (ctx->host_thread_suspend_active)
+			/* If the host event loop is still watching the file, only the
+			 * timeout can wake up the context. */
+			if (ctx->host_event_fd >= 0 && (!ctx->wakeup_time || ctx->wakeup_time > now))
+			{
+				wakeup = X86EmuMinWakeup(wakeup, ctx->wakeup_time);
 				continue;
+			}
+			X86ContextHostEventUnwatch(ctx);
 
 			/* Get file descriptor */
 			fd = x86_file_desc_table_entry_get(ctx->file_desc_table, ctx->wakeup_fd);
@@ -357,10 +795,9 @@ void X86EmuProcessEvents(X86Emu *self)
 				continue;
 			}
 
-			/* No event available, launch 'X86EmuHostThreadSuspend' again */
-			ctx->host_thread_suspend_active = 1;
-			if (pthread_create(&ctx->host_thread_suspend, NULL, X86EmuHostThreadSuspend, ctx))
-				fatal("syscall 'poll': could not create child thread");
+			/* No event available, watch file and timeout in the host event loop */
+			X86ContextHostEventWatch(ctx, fd->host_fd, host_fds.events);
+			wakeup = X86EmuMinWakeup(wakeup, ctx->wakeup_time);
 			continue;
 		}
 
@@ -371,11 +808,10 @@ void X86EmuProcessEvents(X86Emu *self)
 			struct x86_file_desc_t *fd;
 			int count, err;
 			uint32_t pbuf;
-			void *buf;
 			struct pollfd host_fds;
 
-			/* If 'X86EmuHostThreadSuspend' is still running for this context, do nothing. */
-			if (ctx->host_thread_suspend_active)
+			/* If the host event loop is still watching the file, do nothing. */
+			if (ctx->host_event_fd >= 0)
 				continue;
 
 			/* Context received a signal */
@@ -403,15 +839,11 @@ void X86EmuProcessEvents(X86Emu *self)
 			if (host_fds.revents) {
 				pbuf = ctx->regs->ecx;
 				count = ctx->regs->edx;
-				buf = xmalloc(count);
-				mem_read(ctx->mem, pbuf, count, buf);
-
-				count = write(fd->host_fd, buf, count);
+				count = x86_sys_write_mem(ctx->mem, fd->host_fd, pbuf, count, -1);
 				if (count < 0)
 					fatal("syscall 'write': unexpected error in host 'write'");
 
 				ctx->regs->eax = count;
-				free(buf);
 
 				x86_sys_debug("syscall write - continue (pid %d)\n", ctx->pid);
 				x86_sys_debug("  return=0x%x\n", ctx->regs->eax);
@@ -419,10 +851,8 @@ void X86EmuProcessEvents(X86Emu *self)
 				continue;
 			}
 
-			/* Data is not ready to be written - launch 'X86EmuHostThreadSuspend' again */
-			ctx->host_thread_suspend_active = 1;
-			if (pthread_create(&ctx->host_thread_suspend, NULL, X86EmuHostThreadSuspend, ctx))
-				fatal("syscall 'write': could not create child thread");
+			/* Data is not ready to be written - watch file in the host event loop */
+			X86ContextHostEventWatch(ctx, fd->host_fd, POLLOUT);
 			continue;
 		}
 
@@ -432,11 +862,10 @@ void X86EmuProcessEvents(X86Emu *self)
 			struct x86_file_desc_t *fd;
 			uint32_t pbuf;
 			int count, err;
-			void *buf;
 			struct pollfd host_fds;
 
-			/* If 'X86EmuHostThreadSuspend' is still running for this context, do nothing. */
-			if (ctx->host_thread_suspend_active)
+			/* If the host event loop is still watching the file, do nothing. */
+			if (ctx->host_event_fd >= 0)
 				continue;
 
 			/* Context received a signal */
@@ -465,15 +894,11 @@ void X86EmuProcessEvents(X86Emu *self)
 			{
 				pbuf = ctx->regs->ecx;
 				count = ctx->regs->edx;
-				buf = xmalloc(count);
-				
-				count = read(fd->host_fd, buf, count);
+				count = x86_sys_read_mem(ctx->mem, fd->host_fd, pbuf, count, -1);
 				if (count < 0)
 					fatal("syscall 'read': unexpected error in host 'read'");
 
 				ctx->regs->eax = count;
-				mem_write(ctx->mem, pbuf, count, buf);
-				free(buf);
 
 				x86_sys_debug("syscall 'read' - continue (pid %d)\n", ctx->pid);
 				x86_sys_debug("  return=0x%x\n", ctx->regs->eax);
@@ -481,10 +906,8 @@ void X86EmuProcessEvents(X86Emu *self)
 				continue;
 			}
 
-			/* Data is not ready. Launch 'X86EmuHostThreadSuspend' again */
-			ctx->host_thread_suspend_active = 1;
-			if (pthread_create(&ctx->host_thread_suspend, NULL, X86EmuHostThreadSuspend, ctx))
-				fatal("syscall 'read': could not create child thread");
+			/* Data is not ready - watch file in the host event loop */
+			X86ContextHostEventWatch(ctx, fd->host_fd, POLLIN);
 			continue;
 		}
 
@@ -512,7 +935,7 @@ void X86EmuProcessEvents(X86Emu *self)
 			}
 
 			/* No event available. Since this context won't wake up on its own, no
-			 * 'X86EmuHostThreadSuspend' is needed. */
+			 * host event is needed. */
 			continue;
 		}
 
@@ -553,10 +976,6 @@ void X86EmuProcessEvents(X86Emu *self)
 		int sig[3] = { 14, 26, 27 };  /* SIGALRM, SIGVTALRM, SIGPROF */
 		int i;
 
-		/* If there is already a 'ke_host_thread_timer' running, do nothing. */
-		if (ctx->host_thread_timer_active)
-			continue;
-
 		/* Check for any expired 'itimer': itimer_value < now
 		 * In this case, send corresponding signal to process.
 		 * Then calculate next 'itimer' occurrence: itimer_value = now + itimer_interval */
@@ -567,11 +986,11 @@ void X86EmuProcessEvents(X86Emu *self)
 				continue;
 
 			/* Timer expired - send a signal.
-			 * The target process might be suspended, so the host thread is canceled, and a new
-			 * call to 'X86EmuProcessEvents' is scheduled. Since 'ke_process_events_mutex' is
-			 * already locked, the thread-unsafe version of 'x86_ctx_host_thread_suspend_cancel' is used. */
-			X86ContextHostThreadSuspendCancelUnsafe(ctx);
-			self->process_events_force = 1;
+			 * The target process might be suspended waiting for a host file, so
+			 * the file is unwatched, and a new call to 'X86EmuProcessEvents' is
+			 * scheduled. */
+			X86ContextHostEventUnwatch(ctx);
+			X86EmuProcessEventsSchedule(self);
 			x86_sigset_add(&ctx->signal_mask_table->pending, sig[i]);
 
 			/* Calculate next occurrence */
@@ -580,23 +999,11 @@ void X86EmuProcessEvents(X86Emu *self)
 				ctx->itimer_value[i] = now + ctx->itimer_interval[i];
 		}
 
-		/* Calculate the time when next wakeup occurs. */
-		ctx->host_thread_timer_wakeup = 0;
+		/* Account for the next timer expiration in the host event loop */
 		for (i = 0; i < 3; i++)
 		{
-			if (!ctx->itimer_value[i])
-				continue;
-			assert(ctx->itimer_value[i] >= now);
-			if (!ctx->host_thread_timer_wakeup || ctx->itimer_value[i] < ctx->host_thread_timer_wakeup)
-				ctx->host_thread_timer_wakeup = ctx->itimer_value[i];
-		}
-
-		/* If a new timer was set, launch ke_host_thread_timer' again */
-		if (ctx->host_thread_timer_wakeup)
-		{
-			ctx->host_thread_timer_active = 1;
-			if (pthread_create(&ctx->host_thread_timer, NULL, X86ContextHostThreadTimer, ctx))
-				fatal("%s: could not create child thread", __FUNCTION__);
+			assert(!ctx->itimer_value[i] || ctx->itimer_value[i] >= now);
+			wakeup = X86EmuMinWakeup(wakeup, ctx->itimer_value[i]);
 		}
 	}
 
@@ -610,9 +1017,8 @@ void X86EmuProcessEvents(X86Emu *self)
 		X86ContextCheckSignalHandler(ctx);
 	}
 
-	
-	/* Unlock */
-	pthread_mutex_unlock(&self->process_events_mutex);
+	/* Arm host event loop timer for the earliest wakeup */
+	X86EmuHostEventSetTimer(self, wakeup, now);
 }
 
 
@@ -633,9 +1039,13 @@ int X86EmuRun(Emu *self)
 	if (esim_finish)
 		return TRUE;
 
-	/* Run an instruction from every running process */
-	for (ctx = emu->running_list_head; ctx; ctx = ctx->running_list_next)
-		X86ContextExecute(ctx);
+	/* Run an instruction from every running process, or a quantum of
+	 * instructions in parallel host threads */
+	if (X86EmuParallelEnabled(emu))
+		X86EmuRunParallel(emu);
+	else
+		for (ctx = emu->running_list_head; ctx; ctx = ctx->running_list_next)
+			X86ContextExecute(ctx);
 
 	/* Free finished contexts */
 	while (emu->finished_list_head)
@@ -29,6 +29,10 @@
 /* Forward declarations */
 struct config_t;
 
+/* Maximum number of context wakeups posted by the host event loop
+ * and not yet processed. Must be a power of 2. */
+#define X86_EMU_HOST_EVENT_QUEUE_SIZE  256
+
 
 
 /*
@@ -45,9 +49,54 @@ CLASS_BEGIN(X86Emu, Emu)
 
 	/* Schedule next call to 'X86EmuProcessEvents()'.
 	 * The call will only be effective if 'process_events_force' is set.
-	 * This flag should be accessed thread-safely locking 'process_events_mutex'. */
-	pthread_mutex_t process_events_mutex;
-	int process_events_force;
+	 * The flag is set by the host event loop thread, so it should only be
+	 * accessed with atomic operations. */
+	volatile int process_events_force;
+
+	/* Host event loop. A single host thread waits with 'epoll' on the host
+	 * files that suspended contexts are blocked on, and on a 'timerfd' armed
+	 * with the earliest wakeup time of any context (nanosleep, poll timeout,
+	 * interval timers). Contexts whose files become ready are posted by pid
+	 * into a lock-free single-producer/single-consumer ring, which is drained
+	 * by 'X86EmuProcessEvents()'. The thread is launched the first time it is
+	 * needed. */
+	pthread_t host_event_thread;
+	int host_event_thread_active;
+	int host_event_epoll_fd;
+	int host_event_timer_fd;
+	int host_event_stop_fd;  /* 'eventfd' used to stop the thread */
+	long long host_event_timer_wakeup;  /* Time the timer is armed for (0=disarmed) */
+	int host_event_queue[X86_EMU_HOST_EVENT_QUEUE_SIZE];
+	volatile unsigned int host_event_queue_head;  /* Written by consumer */
+	volatile unsigned int host_event_queue_tail;  /* Written by producer */
+	volatile int host_event_queue_overflow;
+
+	/* Host-parallel execution of contexts in functional simulation (option
+	 * '--x86-host-threads'). In each call to 'X86EmuRun', every running
+	 * context executes a quantum of instructions, distributed among the main
+	 * thread and 'parallel_thread_count' worker threads, which take contexts
+	 * from 'parallel_context_array' in order. Contexts that stopped at a
+	 * system call are then resumed serially by the main thread, followed by
+	 * the processing of events. The workers are launched the first time they
+	 * are needed. */
+	pthread_t *parallel_threads;
+	int parallel_thread_count;
+	int parallel_stop;  /* Workers should finish */
+	pthread_mutex_t parallel_mutex;
+	pthread_cond_t parallel_start_cond;  /* Round started */
+	pthread_cond_t parallel_done_cond;  /* All workers done with round */
+	long long parallel_round;  /* Round counter, protected by mutex */
+	int parallel_pending;  /* Workers not done with round, protected by mutex */
+	X86Context **parallel_context_array;
+	int parallel_context_count;
+	int parallel_context_size;  /* Allocated entries */
+	volatile int parallel_context_next;  /* Next context, accessed atomically */
+	long long parallel_quantum;  /* Instructions per context in round */
+	volatile long long parallel_inst;  /* Executed instructions, accessed atomically */
+
+	/* Mutex serializing atomic instructions whose memory operand crosses a
+	 * page boundary */
+	pthread_mutex_t parallel_atomic_mutex;
 
 	/* Counter of times that a context has been suspended in a
 	 * futex. Used for FIFO wakeups. */
@@ -107,6 +156,9 @@ void X86EmuDumpSummary(Emu *self, FILE *f);
 void X86EmuProcessEvents(X86Emu *self);
 void X86EmuProcessEventsSchedule(X86Emu *self);
 
+void X86EmuHostEventStart(X86Emu *self);
+void X86EmuStopHostThreads(X86Emu *self);
+
 X86Context *X86EmuGetContext(X86Emu *self, int pid);
 
 void X86EmuLoadContextsFromConfig(X86Emu *self, struct config_t *config, char *section);
@@ -125,6 +177,8 @@ extern long long x86_emu_max_inst;
 extern char x86_emu_last_inst_bytes[20];
 extern int x86_emu_last_inst_size;
 extern int x86_emu_process_prefetch_hints;
+extern int x86_emu_host_threads;
+extern long long x86_emu_host_quantum;
 
 #endif
 
@@ -57,9 +57,10 @@ static X86ContextInstFunc x86_context_inst_func[X86InstOpcodeCount] =
 int x86_context_call_debug_category;
 int x86_context_isa_debug_category;
 
-/* Variables used to preserve host state before running assembly */
-long x86_context_host_flags;
-unsigned char x86_context_host_fpenv[28];
+/* Variables used to preserve host state before running assembly, one copy
+ * per host thread */
+__thread long x86_context_host_flags;
+__thread unsigned char x86_context_host_fpenv[28];
 
 
 void X86ContextDoubleToExtended(double f, unsigned char *e)
@@ -108,8 +109,51 @@ float X86ContextExtendedToFloat(unsigned char *e)
  *            Macros are defined after these two functions.
  */
 
+/* First access to the memory operand of an instruction emulated atomically.
+ * The current value of the operand is captured from its host buffer. An
+ * operand crossing a page boundary has no single host buffer, so the
+ * instruction is serialized with the rest of atomic instructions instead. */
+static void X86ContextAtomicStart(X86Context *self, int size)
+{
+	X86Emu *emu = self->emu;
+
+	/* Host buffer */
+	self->atomic_size = size;
+	self->atomic_host = NULL;
+	if (size == 1 || size == 2 || size == 4 || size == 8)
+		self->atomic_host = mem_get_buffer(self->mem, self->atomic_addr,
+				size, mem_access_read | mem_access_write);
+
+	/* Serialize */
+	if (!self->atomic_host)
+	{
+		pthread_mutex_lock(&emu->parallel_atomic_mutex);
+		self->atomic_locked = 1;
+		self->atomic_active = 0;
+		return;
+	}
+
+	/* Capture value */
+	self->atomic_old = 0;
+	memcpy(&self->atomic_old, self->atomic_host, size);
+	self->atomic_value = self->atomic_old;
+}
+
+
 void X86ContextMemRead(X86Context *self, unsigned int addr, int size, void *buf)
 {
+	/* Memory operand of atomic instruction */
+	if (self->atomic_active && addr == self->atomic_addr)
+	{
+		if (!self->atomic_size)
+			X86ContextAtomicStart(self, size);
+		if (self->atomic_active && size == self->atomic_size)
+		{
+			memcpy(buf, &self->atomic_value, size);
+			return;
+		}
+	}
+
 	/* Speculative mode read */
 	if (self->state & X86ContextSpecMode)
 	{
@@ -124,6 +168,19 @@ void X86ContextMemRead(X86Context *self, unsigned int addr, int size, void *buf)
 
 void X86ContextMemWrite(X86Context *self, unsigned int addr, int size, void *buf)
 {
+	/* Memory operand of atomic instruction */
+	if (self->atomic_active && addr == self->atomic_addr)
+	{
+		if (!self->atomic_size)
+			X86ContextAtomicStart(self, size);
+		if (self->atomic_active && size == self->atomic_size)
+		{
+			memcpy(&self->atomic_value, buf, size);
+			self->atomic_dirty = 1;
+			return;
+		}
+	}
+
 	/* Speculative mode write */
 	if (self->state & X86ContextSpecMode)
 	{
@@ -799,6 +856,100 @@ void X86ContextStoreXMMM128(X86Context *self, unsigned char *value)
 }
 
 
+/* Return whether the current instruction must be emulated atomically when
+ * running in parallel with other contexts. These are instructions with a
+ * 'lock' prefix and a memory operand, as well as 'xchg' with a memory operand,
+ * which is implicitly locked. */
+static int X86ContextAtomicInst(X86Context *self)
+{
+	X86Inst *inst = &self->inst;
+
+	/* No memory operand */
+	if (!inst->modrm_size || inst->modrm_mod == 3)
+		return 0;
+
+	/* Locked instruction */
+	return inst->lock ||
+		inst->opcode == x86_inst_xchg_rm8_r8 ||
+		inst->opcode == x86_inst_xchg_rm16_r16 ||
+		inst->opcode == x86_inst_xchg_rm32_r32;
+}
+
+
+/* Commit the value of the memory operand of an atomic instruction with a host
+ * compare-and-swap. Return non-zero on success, or 0 if another thread changed
+ * the operand since it was captured. */
+static int X86ContextAtomicCommit(X86Context *self)
+{
+	switch (self->atomic_size)
+	{
+
+	case 1:
+		return __sync_bool_compare_and_swap((unsigned char *) self->atomic_host,
+				(unsigned char) self->atomic_old,
+				(unsigned char) self->atomic_value);
+
+	case 2:
+		return __sync_bool_compare_and_swap((unsigned short *) self->atomic_host,
+				(unsigned short) self->atomic_old,
+				(unsigned short) self->atomic_value);
+
+	case 4:
+		return __sync_bool_compare_and_swap((unsigned int *) self->atomic_host,
+				(unsigned int) self->atomic_old,
+				(unsigned int) self->atomic_value);
+
+	default:
+		return __sync_bool_compare_and_swap((unsigned long long *) self->atomic_host,
+				self->atomic_old, self->atomic_value);
+	}
+}
+
+
+/* Emulate an instruction atomically. Its memory operand is read and written
+ * through a private copy, committed at the end with a host compare-and-swap.
+ * This is atomic with respect to any other access to the operand, including
+ * regular stores from other contexts. If the commit fails, the registers are
+ * restored and the instruction is emulated again. */
+static void X86ContextExecuteAtomic(X86Context *self, X86ContextInstFunc func)
+{
+	X86Emu *emu = self->emu;
+	struct x86_regs_t regs;
+	int done;
+
+	/* Operand address and initial state */
+	self->atomic_addr = X86ContextEffectiveAddress(self);
+	x86_regs_copy(&regs, self->regs);
+
+	do
+	{
+		/* Emulate */
+		self->atomic_active = 1;
+		self->atomic_size = 0;
+		self->atomic_dirty = 0;
+		self->atomic_locked = 0;
+		func(self);
+		self->atomic_active = 0;
+
+		/* Commit */
+		if (self->atomic_locked)
+		{
+			pthread_mutex_unlock(&emu->parallel_atomic_mutex);
+			done = 1;
+		}
+		else
+		{
+			done = !self->atomic_dirty || X86ContextAtomicCommit(self);
+		}
+
+		/* Retry */
+		if (!done)
+			x86_regs_copy(self->regs, &regs);
+
+	} while (!done);
+}
+
+
 void X86ContextExecuteInst(X86Context *self)
 {
 	X86Emu *emu = self->emu;
@@ -828,7 +979,9 @@ void X86ContextExecuteInst(X86Context *self)
 
 	/* Call instruction emulation function */
 	regs->eip = regs->eip + self->inst.size;
-	if (self->inst.opcode)
+	if (self->parallel && X86ContextAtomicInst(self))
+		X86ContextExecuteAtomic(self, x86_context_inst_func[self->inst.opcode]);
+	else if (self->inst.opcode)
 		x86_context_inst_func[self->inst.opcode](self);
 	
 	/* Debug */
@@ -17,6 +17,10 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <string.h>
+
+#include <mem-system/cache-sweep.h>
+#include <mem-system/memory.h>
 
 #include "context.h"
 #include "isa.h"
@@ -61,11 +65,256 @@ static void x86_isa_rep_init(X86Context *ctx)
 }
 
 
-#define OP_REP_IMPL(X, SIZE) \
+/*
+ * Bulk execution of string operations
+ *
+ * When no timing model consumes the micro-instructions generated for each
+ * iteration of a string operation (functional simulation and fast-forward),
+ * repeated string operations are executed in chunks of up to one memory page
+ * instead of one element per emulated instruction. 'rep movs' and 'rep stos'
+ * complete all their iterations at once. The 'repz' and 'repnz' versions of
+ * 'cmps' and 'scas' skip all iterations preceding the one that ends the loop,
+ * which is then executed by the regular code to produce the exact flags.
+ */
+
+static int x86_isa_rep_bulk_active(X86Context *ctx)
+{
+	/* Only with more than one iteration left. In speculative mode, memory
+	 * accesses are not performed, and the cache sweep needs to observe
+	 * each access separately. */
+	return !x86_uinst_active && ctx->regs->ecx > 1 &&
+		!X86ContextGetState(ctx, X86ContextSpecMode) &&
+		!cache_sweep_active;
+}
+
+
+/* Number of elements of size 'size' to process in the next chunk. For a move,
+ * the source and destination can overlap such that an element written by one
+ * iteration is read by a later one. The chunk is then limited so that none of
+ * its reads observes one of its own writes, preserving element-by-element
+ * semantics. */
+static unsigned int x86_isa_rep_bulk_count(X86Context *ctx, int size, int move)
+{
+	struct x86_regs_t *regs = ctx->regs;
+	unsigned int count;
+	unsigned int dist;
+
+	count = MEM_PAGE_SIZE / size;
+	if (count > regs->ecx)
+		count = regs->ecx;
+
+	if (move)
+	{
+		dist = X86ContextGetFlag(ctx, X86InstFlagDF) ?
+			regs->esi - regs->edi : regs->edi - regs->esi;
+		if (dist && dist < count * size)
+			count = dist / size ? dist / size : 1;
+	}
+
+	return count;
+}
+
+
+/* Lowest address of a chunk of 'count' elements of size 'size' starting at
+ * 'addr', taking into account the direction given by flag DF. */
+static unsigned int x86_isa_rep_bulk_addr(X86Context *ctx, unsigned int addr,
+	unsigned int count, int size)
+{
+	return X86ContextGetFlag(ctx, X86InstFlagDF) ?
+		addr - (count - 1) * size : addr;
+}
+
+
+/* Value of the element at iteration 'index' of a chunk of 'count' elements
+ * read into 'buf' */
+static unsigned int x86_isa_rep_bulk_elem(X86Context *ctx, unsigned char *buf,
+	unsigned int index, unsigned int count, int size)
+{
+	unsigned int value = 0;
+
+	if (X86ContextGetFlag(ctx, X86InstFlagDF))
+		index = count - 1 - index;
+	memcpy(&value, buf + index * size, size);
+	return value;
+}
+
+
+/* Advance registers past 'count' elements */
+static void x86_isa_rep_bulk_advance(X86Context *ctx, unsigned int count, int size,
+	int esi, int edi)
+{
+	struct x86_regs_t *regs = ctx->regs;
+	int delta;
+
+	delta = count * size;
+	if (X86ContextGetFlag(ctx, X86InstFlagDF))
+		delta = -delta;
+
+	if (esi)
+		regs->esi += delta;
+	if (edi)
+		regs->edi += delta;
+	regs->ecx -= count;
+}
+
+
+/* String operations without bulk execution */
+static void x86_isa_rep_no_bulk(X86Context *ctx, int size)
+{
+}
+
+
+static void x86_isa_rep_movs_bulk(X86Context *ctx, int size)
+{
+	struct x86_regs_t *regs = ctx->regs;
+	unsigned char buf[MEM_PAGE_SIZE];
+	unsigned int count;
+
+	if (!x86_isa_rep_bulk_active(ctx))
+		return;
+
+	while (regs->ecx)
+	{
+		count = x86_isa_rep_bulk_count(ctx, size, 1);
+		X86ContextMemRead(ctx, x86_isa_rep_bulk_addr(ctx, regs->esi,
+			count, size), count * size, buf);
+		X86ContextMemWrite(ctx, x86_isa_rep_bulk_addr(ctx, regs->edi,
+			count, size), count * size, buf);
+		x86_isa_rep_bulk_advance(ctx, count, size, 1, 1);
+	}
+}
+
+
+static void x86_isa_rep_stos_bulk(X86Context *ctx, int size)
+{
+	struct x86_regs_t *regs = ctx->regs;
+	unsigned char buf[MEM_PAGE_SIZE];
+	unsigned int count;
+	unsigned int i;
+
+	if (!x86_isa_rep_bulk_active(ctx))
+		return;
+
+	/* Pattern */
+	if (size == 1)
+		memset(buf, regs->eax, sizeof buf);
+	else
+		for (i = 0; i < sizeof buf; i += size)
+			memcpy(buf + i, &regs->eax, size);
+
+	/* Store */
+	while (regs->ecx)
+	{
+		count = x86_isa_rep_bulk_count(ctx, size, 0);
+		X86ContextMemWrite(ctx, x86_isa_rep_bulk_addr(ctx, regs->edi,
+			count, size), count * size, buf);
+		x86_isa_rep_bulk_advance(ctx, count, size, 0, 1);
+	}
+}
+
+
+/* Skip iterations of 'repz scas' ('zf' = 1) or 'repnz scas' ('zf' = 0) that
+ * do not end the loop. The last iteration is never skipped. */
+static void x86_isa_rep_scas_bulk(X86Context *ctx, int size, int zf)
+{
+	struct x86_regs_t *regs = ctx->regs;
+	unsigned char buf[MEM_PAGE_SIZE];
+	unsigned char *ptr;
+
+	unsigned int value;
+	unsigned int count;
+	unsigned int index;
+
+	if (!x86_isa_rep_bulk_active(ctx))
+		return;
+
+	value = size == 1 ? regs->eax & 0xff : regs->eax;
+	while (regs->ecx > 1)
+	{
+		/* Read chunk, excluding last iteration */
+		count = x86_isa_rep_bulk_count(ctx, size, 0);
+		if (count == regs->ecx)
+			count--;
+		X86ContextMemRead(ctx, x86_isa_rep_bulk_addr(ctx, regs->edi,
+			count, size), count * size, buf);
+
+		/* Find iteration ending the loop. Searching forward for a
+		 * byte, as in 'repnz scasb', reduces to 'memchr'. */
+		if (size == 1 && !zf && !X86ContextGetFlag(ctx, X86InstFlagDF))
+		{
+			ptr = memchr(buf, value, count);
+			index = ptr ? ptr - buf : count;
+		}
+		else
+		{
+			for (index = 0; index < count; index++)
+				if ((x86_isa_rep_bulk_elem(ctx, buf, index, count,
+						size) == value) != zf)
+					break;
+		}
+
+		/* Skip iterations before it */
+		x86_isa_rep_bulk_advance(ctx, index, size, 0, 1);
+		if (index < count)
+			break;
+	}
+}
+
+
+/* Skip iterations of 'repz cmps' ('zf' = 1) or 'repnz cmps' ('zf' = 0) that
+ * do not end the loop. The last iteration is never skipped. */
+static void x86_isa_rep_cmps_bulk(X86Context *ctx, int size, int zf)
+{
+	struct x86_regs_t *regs = ctx->regs;
+	unsigned char src[MEM_PAGE_SIZE];
+	unsigned char dst[MEM_PAGE_SIZE];
+
+	unsigned int count;
+	unsigned int index;
+
+	if (!x86_isa_rep_bulk_active(ctx))
+		return;
+
+	while (regs->ecx > 1)
+	{
+		/* Read chunks, excluding last iteration */
+		count = x86_isa_rep_bulk_count(ctx, size, 0);
+		if (count == regs->ecx)
+			count--;
+		X86ContextMemRead(ctx, x86_isa_rep_bulk_addr(ctx, regs->esi,
+			count, size), count * size, src);
+		X86ContextMemRead(ctx, x86_isa_rep_bulk_addr(ctx, regs->edi,
+			count, size), count * size, dst);
+
+		/* Find iteration ending the loop. A 'repz cmps' over two
+		 * equal chunks, the common case, is skipped with 'memcmp'. */
+		if (zf && !memcmp(src, dst, count * size))
+		{
+			index = count;
+		}
+		else
+		{
+			for (index = 0; index < count; index++)
+				if ((x86_isa_rep_bulk_elem(ctx, src, index, count, size) ==
+						x86_isa_rep_bulk_elem(ctx, dst, index, count,
+						size)) != zf)
+					break;
+		}
+
+		/* Skip iterations before it */
+		x86_isa_rep_bulk_advance(ctx, index, size, 1, 1);
+		if (index < count)
+			break;
+	}
+}
+
+
+#define OP_REP_IMPL(X, SIZE, BULK) \
 	void x86_isa_rep_##X##_impl(X86Context *ctx) \
 	{ \
 		struct x86_regs_t *regs = ctx->regs; \
 		x86_isa_rep_init(ctx); \
+		BULK(ctx, (SIZE)); \
 		\
 		if (regs->ecx) \
 		{ \
@@ -82,11 +331,12 @@ static void x86_isa_rep_init(X86Context *ctx)
 	}
 
 
-#define OP_REPZ_IMPL(X, SIZE) \
+#define OP_REPZ_IMPL(X, SIZE, BULK) \
 	void x86_isa_repz_##X##_impl(X86Context *ctx) \
 	{ \
 		struct x86_regs_t *regs = ctx->regs; \
 		x86_isa_rep_init(ctx); \
+		BULK(ctx, (SIZE), 1); \
 		\
 		if (regs->ecx) \
 		{ \
@@ -104,11 +354,12 @@ static void x86_isa_rep_init(X86Context *ctx)
 	}
 
 
-#define OP_REPNZ_IMPL(X, SIZE) \
+#define OP_REPNZ_IMPL(X, SIZE, BULK) \
 	void x86_isa_repnz_##X##_impl(X86Context *ctx) \
 	{ \
 		struct x86_regs_t *regs = ctx->regs; \
 		x86_isa_rep_init(ctx); \
+		BULK(ctx, (SIZE), 0); \
 		\
 		if (regs->ecx) \
 		{ \
@@ -703,31 +954,31 @@ void x86_isa_stosd_impl(X86Context *ctx)
  * Repetition prefixes
  */
 
-OP_REP_IMPL(insb, 1)
-OP_REP_IMPL(insd, 4)
+OP_REP_IMPL(insb, 1, x86_isa_rep_no_bulk)
+OP_REP_IMPL(insd, 4, x86_isa_rep_no_bulk)
 
-OP_REP_IMPL(movsb, 1)
-OP_REP_IMPL(movsw, 2)
-OP_REP_IMPL(movsd, 4)
+OP_REP_IMPL(movsb, 1, x86_isa_rep_movs_bulk)
+OP_REP_IMPL(movsw, 2, x86_isa_rep_movs_bulk)
+OP_REP_IMPL(movsd, 4, x86_isa_rep_movs_bulk)
 
-OP_REP_IMPL(outsb, 1)
-OP_REP_IMPL(outsd, 4)
+OP_REP_IMPL(outsb, 1, x86_isa_rep_no_bulk)
+OP_REP_IMPL(outsd, 4, x86_isa_rep_no_bulk)
 
-OP_REP_IMPL(lodsb, 1)
-OP_REP_IMPL(lodsd, 4)
+OP_REP_IMPL(lodsb, 1, x86_isa_rep_no_bulk)
+OP_REP_IMPL(lodsd, 4, x86_isa_rep_no_bulk)
 
-OP_REP_IMPL(stosb, 1)
-OP_REP_IMPL(stosd, 4)
+OP_REP_IMPL(stosb, 1, x86_isa_rep_stos_bulk)
+OP_REP_IMPL(stosd, 4, x86_isa_rep_stos_bulk)
 
-OP_REPZ_IMPL(cmpsb, 1)
-OP_REPZ_IMPL(cmpsd, 4)
+OP_REPZ_IMPL(cmpsb, 1, x86_isa_rep_cmps_bulk)
+OP_REPZ_IMPL(cmpsd, 4, x86_isa_rep_cmps_bulk)
 
-OP_REPZ_IMPL(scasb, 1)
-OP_REPZ_IMPL(scasd, 4)
+OP_REPZ_IMPL(scasb, 1, x86_isa_rep_scas_bulk)
+OP_REPZ_IMPL(scasd, 4, x86_isa_rep_scas_bulk)
 
-OP_REPNZ_IMPL(cmpsb, 1)
-OP_REPNZ_IMPL(cmpsd, 4)
+OP_REPNZ_IMPL(cmpsb, 1, x86_isa_rep_cmps_bulk)
+OP_REPNZ_IMPL(cmpsd, 4, x86_isa_rep_cmps_bulk)
 
-OP_REPNZ_IMPL(scasb, 1)
-OP_REPNZ_IMPL(scasd, 4)
+OP_REPNZ_IMPL(scasb, 1, x86_isa_rep_scas_bulk)
+OP_REPNZ_IMPL(scasd, 4, x86_isa_rep_scas_bulk)
 
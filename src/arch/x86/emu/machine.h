@@ -21,7 +21,9 @@
 #define ARCH_X86_EMU_MACHINE_H
 
 
-extern long x86_context_host_flags;
+/* Host state preserved around assembly code. These variables are private to
+ * each host thread, since contexts can be emulated in parallel. */
+extern __thread long x86_context_host_flags;
 
 #define __X86_ISA_ASM_START__ asm volatile ( \
 	"pushf\n\t" \
@@ -34,7 +36,7 @@ extern long x86_context_host_flags;
 	: "=m" (x86_context_host_flags));
 
 
-extern unsigned char x86_context_host_fpenv[28];
+extern __thread unsigned char x86_context_host_fpenv[28];
 
 #define __X86_ISA_FP_ASM_START__ asm volatile ( \
 	"pushf\n\t" \
@@ -31,6 +31,7 @@
 #include <sys/statfs.h>
 #include <sys/time.h>
 #include <sys/times.h>
+#include <sys/uio.h>
 
 #include <arch/common/runtime.h>
 #include <arch/x86/timing/cpu.h>
@@ -289,6 +290,159 @@ void X86ContextSyscall(X86Context *self)
 
 
 
+/*
+ * Guest memory I/O
+ */
+
+/* Maximum number of host I/O vector elements used to access guest memory
+ * pages directly. Transfers needing more go through a host buffer. */
+#define X86_SYS_IOV_MAX  1024
+
+
+/* Dump the first bytes of the data referenced by a host I/O vector, as
+ * 'x86_sys_debug_buffer' does for a contiguous buffer */
+static void x86_sys_debug_iovec(char *name, struct iovec *iov, int iov_count, int size)
+{
+	unsigned char buf[41];
+	int chunksize;
+	int len;
+	int i;
+
+	/* Debug not active */
+	if (!x86_sys_debug_category)
+		return;
+
+	/* Gather enough bytes to let 'debug_buffer' truncate the dump */
+	size = MIN(size, sizeof buf);
+	len = 0;
+	for (i = 0; i < iov_count && len < size; i++)
+	{
+		chunksize = MIN(iov[i].iov_len, size - len);
+		memcpy(buf + len, iov[i].iov_base, chunksize);
+		len += chunksize;
+	}
+	x86_sys_debug_buffer(name, buf, len);
+}
+
+
+/* Build in 'iov' the host I/O vector for the guest I/O vector of 'vlen'
+ * elements at address 'iovec_ptr', with one element per page span of each
+ * guest buffer. The return value is the number of elements, or -1 if guest
+ * memory cannot be accessed directly. */
+static int x86_sys_get_guest_iovec(struct mem_t *mem, unsigned int iovec_ptr,
+	unsigned int vlen, struct iovec *iov, enum mem_access_t access)
+{
+	unsigned int iov_base;
+	unsigned int iov_len;
+
+	int iov_count;
+	int count;
+	int v;
+
+	iov_count = 0;
+	for (v = 0; v < vlen; v++)
+	{
+		/* Read io vector element */
+		mem_read(mem, iovec_ptr, 4, &iov_base);
+		mem_read(mem, iovec_ptr + 4, 4, &iov_len);
+		iovec_ptr += 8;
+
+		/* Page spans */
+		count = mem_get_iovec(mem, iov_base, iov_len, iov + iov_count,
+			X86_SYS_IOV_MAX - iov_count, access);
+		if (count < 0)
+			return -1;
+		iov_count += count;
+	}
+	return iov_count;
+}
+
+
+int x86_sys_read_mem(struct mem_t *mem, int host_fd, unsigned int addr,
+	unsigned int count, long long offset)
+{
+	struct iovec iov[X86_SYS_IOV_MAX];
+	int iov_count;
+	int err;
+
+	void *buf;
+
+	/* Read directly into guest pages */
+	iov_count = mem_get_iovec(mem, addr, count, iov, X86_SYS_IOV_MAX,
+		mem_access_write);
+	if (iov_count >= 0)
+	{
+		err = offset < 0 ? readv(host_fd, iov, iov_count) :
+			preadv(host_fd, iov, iov_count, offset);
+		if (err == -1)
+			return -errno;
+		if (err > 0)
+			x86_sys_debug_iovec("  buf", iov, iov_count, err);
+		return err;
+	}
+
+	/* Read into host buffer */
+	buf = xcalloc(1, count);
+	err = offset < 0 ? read(host_fd, buf, count) :
+		pread(host_fd, buf, count, offset);
+	if (err == -1)
+	{
+		free(buf);
+		return -errno;
+	}
+
+	/* Write in guest memory */
+	if (err > 0)
+	{
+		mem_write(mem, addr, err, buf);
+		x86_sys_debug_buffer("  buf", buf, err);
+	}
+
+	/* Return number of read bytes */
+	free(buf);
+	return err;
+}
+
+
+int x86_sys_write_mem(struct mem_t *mem, int host_fd, unsigned int addr,
+	unsigned int count, long long offset)
+{
+	struct iovec iov[X86_SYS_IOV_MAX];
+	int iov_count;
+	int err;
+
+	void *buf;
+
+	/* Write directly from guest pages */
+	iov_count = mem_get_iovec(mem, addr, count, iov, X86_SYS_IOV_MAX,
+		mem_access_read);
+	if (iov_count >= 0)
+	{
+		x86_sys_debug_iovec("  buf", iov, iov_count, count);
+		err = offset < 0 ? writev(host_fd, iov, iov_count) :
+			pwritev(host_fd, iov, iov_count, offset);
+		return err == -1 ? -errno : err;
+	}
+
+	/* Read buffer from memory */
+	buf = xcalloc(1, count);
+	mem_read(mem, addr, count, buf);
+	x86_sys_debug_buffer("  buf", buf, count);
+
+	/* Host write */
+	err = offset < 0 ? write(host_fd, buf, count) :
+		pwrite(host_fd, buf, count, offset);
+	if (err == -1)
+		err = -errno;
+
+	/* Return written bytes */
+	free(buf);
+	return err;
+}
+
+
+
+
 /*
  * System call 'exit' (code 1)
  */
@@ -366,8 +520,6 @@ static int x86_sys_read_impl(X86Context *ctx)
 	int host_fd;
 	int err;
 
-	void *buf;
-
 	struct x86_file_desc_t *fd;
 	struct pollfd fds;
 
@@ -386,7 +538,6 @@ static int x86_sys_read_impl(X86Context *ctx)
 	x86_sys_debug("  host_fd=%d\n", host_fd);
 
 	/* Poll the file descriptor to check if read is blocking */
-	buf = xcalloc(1, count);
 	fds.fd = host_fd;
 	fds.events = POLLIN;
 	err = poll(&fds, 1, 0);
@@ -395,26 +546,7 @@ static int x86_sys_read_impl(X86Context *ctx)
 
 	/* Non-blocking read */
 	if (fds.revents || (fd->flags & O_NONBLOCK))
-	{
-		/* Host system call */
-		err = read(host_fd, buf, count);
-		if (err == -1)
-		{
-			free(buf);
-			return -errno;
-		}
-
-		/* Write in guest memory */
-		if (err > 0)
-		{
-			mem_write(mem, buf_ptr, err, buf);
-			x86_sys_debug_buffer("  buf", buf, err);
-		}
-
-		/* Return number of read bytes */
-		free(buf);
-		return err;
-	}
+		return x86_sys_read_mem(mem, host_fd, buf_ptr, count, -1);
 
 	/* Blocking read - suspend thread */
 	x86_sys_debug("  blocking read - process suspended\n");
@@ -423,9 +555,8 @@ static int x86_sys_read_impl(X86Context *ctx)
 	X86ContextSetState(ctx, X86ContextSuspended | X86ContextRead);
 	X86EmuProcessEventsSchedule(emu);
 
-	/* Free allocated buffer. Return value doesn't matter,
-	 * it will be overwritten when context wakes up from blocking call. */
-	free(buf);
+	/* Return value doesn't matter, it will be overwritten when context
+	 * wakes up from blocking call. */
 	return 0;
 }
 
@@ -448,10 +579,8 @@ static int x86_sys_write_impl(X86Context *ctx)
 
 	int guest_fd;
 	int host_fd;
-	int err;
 
 	struct x86_file_desc_t *desc;
-	void *buf;
 
 	struct pollfd fds;
 
@@ -469,11 +598,6 @@ static int x86_sys_write_impl(X86Context *ctx)
 	host_fd = desc->host_fd;
 	x86_sys_debug("  host_fd=%d\n", host_fd);
 
-	/* Read buffer from memory */
-	buf = xcalloc(1, count);
-	mem_read(mem, buf_ptr, count, buf);
-	x86_sys_debug_buffer("  buf", buf, count);
-
 	/* Poll the file descriptor to check if write is blocking */
 	fds.fd = host_fd;
 	fds.events = POLLOUT;
@@ -481,16 +605,7 @@ static int x86_sys_write_impl(X86Context *ctx)
 
 	/* Non-blocking write */
 	if (fds.revents)
-	{
-		/* Host write */
-		err = write(host_fd, buf, count);
-		if (err == -1)
-			err = -errno;
-
-		/* Return written bytes */
-		free(buf);
-		return err;
-	}
+		return x86_sys_write_mem(mem, host_fd, buf_ptr, count, -1);
 
 	/* Blocking write - suspend thread */
 	x86_sys_debug("  blocking write - process suspended\n");
@@ -500,7 +615,6 @@ static int x86_sys_write_impl(X86Context *ctx)
 
 	/* Return value doesn't matter here. It will be overwritten when the
 	 * context wakes up after blocking call. */
-	free(buf);
 	return 0;
 }
 
@@ -1200,7 +1314,7 @@ static int x86_sys_kill_impl(X86Context *ctx)
 
 	/* Send signal */
 	x86_sigset_add(&temp_ctx->signal_mask_table->pending, sig);
-	X86ContextHostThreadSuspendCancel(temp_ctx);
+	X86ContextHostEventUnwatch(temp_ctx);
 	X86EmuProcessEventsSchedule(emu);
 	X86EmuProcessEvents(emu);
 
@@ -2572,9 +2686,8 @@ static int x86_sys_setitimer_impl(X86Context *ctx)
 	ctx->itimer_interval[which] = itimerval.it_interval.tv_sec * 1000000
 		+ itimerval.it_interval.tv_usec;
 
-	/* New timer inserted, so interrupt current 'ke_host_thread_timer'
-	 * waiting for the next timer expiration. */
-	X86ContextHostThreadTimerCancel(ctx);
+	/* New timer inserted, so the host event loop timer is armed again
+	 * for the next expiration when events are processed. */
 	X86EmuProcessEventsSchedule(emu);
 
 	/* Return */
@@ -3321,6 +3434,93 @@ static int x86_sys_msync_impl(X86Context *ctx)
 
 
 
+/*
+ * System call 'readv' (code 145)
+ */
+
+static int x86_sys_readv_impl(X86Context *ctx)
+{
+	struct x86_regs_t *regs = ctx->regs;
+	struct mem_t *mem = ctx->mem;
+
+	int v;
+	int len;
+	int guest_fd;
+	int host_fd;
+	int total_len;
+	int iov_count;
+
+	struct x86_file_desc_t *desc;
+	struct iovec iov[X86_SYS_IOV_MAX];
+
+	unsigned int iovec_ptr;
+	unsigned int vlen;
+	unsigned int iov_base;
+	unsigned int iov_len;
+
+	void *buf;
+
+	/* Arguments */
+	guest_fd = regs->ebx;
+	iovec_ptr = regs->ecx;
+	vlen = regs->edx;
+	x86_sys_debug("  guest_fd=%d, iovec_ptr = 0x%x, vlen=0x%x\n",
+		guest_fd, iovec_ptr, vlen);
+
+	/* Check file descriptor */
+	desc = x86_file_desc_table_entry_get(ctx->file_desc_table, guest_fd);
+	if (!desc)
+		return -EBADF;
+	host_fd = desc->host_fd;
+	x86_sys_debug("  host_fd=%d\n", host_fd);
+
+	/* No pipes allowed */
+	if (desc->kind == file_desc_pipe)
+		fatal("%s: not supported for pipes.\n%s",
+			__FUNCTION__, err_x86_sys_note);
+
+	/* Read directly into guest pages */
+	iov_count = x86_sys_get_guest_iovec(mem, iovec_ptr, vlen, iov,
+		mem_access_write);
+	if (iov_count >= 0)
+	{
+		len = readv(host_fd, iov, iov_count);
+		return len == -1 ? -errno : len;
+	}
+
+	/* Proceed */
+	total_len = 0;
+	for (v = 0; v < vlen; v++)
+	{
+		/* Read io vector element */
+		mem_read(mem, iovec_ptr, 4, &iov_base);
+		mem_read(mem, iovec_ptr + 4, 4, &iov_len);
+		iovec_ptr += 8;
+
+		/* Read buffer from file and write it to memory */
+		buf = xmalloc(iov_len);
+		len = read(host_fd, buf, iov_len);
+		if (len == -1)
+		{
+			free(buf);
+			return total_len ? total_len : -errno;
+		}
+		mem_write(mem, iov_base, len, buf);
+		free(buf);
+
+		/* Accumulate read bytes, stopping at a short read */
+		total_len += len;
+		if (len < iov_len)
+			break;
+	}
+
+	/* Return total number of bytes read */
+	return total_len;
+}
+
+
+
+
 /*
  * System call 'writev' (code 146)
  */
@@ -3335,8 +3535,10 @@ static int x86_sys_writev_impl(X86Context *ctx)
 	int guest_fd;
 	int host_fd;
 	int total_len;
+	int iov_count;
 
 	struct x86_file_desc_t *desc;
+	struct iovec iov[X86_SYS_IOV_MAX];
 
 	unsigned int iovec_ptr;
 	unsigned int vlen;
@@ -3364,6 +3566,15 @@ static int x86_sys_writev_impl(X86Context *ctx)
 		fatal("%s: not supported for pipes.\n%s",
 			__FUNCTION__, err_x86_sys_note);
 
+	/* Write directly from guest pages */
+	iov_count = x86_sys_get_guest_iovec(mem, iovec_ptr, vlen, iov,
+		mem_access_read);
+	if (iov_count >= 0)
+	{
+		len = writev(host_fd, iov, iov_count);
+		return len == -1 ? -errno : len;
+	}
+
 	/* Proceed */
 	total_len = 0;
 	for (v = 0; v < vlen; v++)
@@ -4176,6 +4387,98 @@ static int x86_sys_rt_sigsuspend_impl(X86Context *ctx)
 
 
 
+/*
+ * System call 'pread64' (code 180)
+ */
+
+static int x86_sys_pread64_impl(X86Context *ctx)
+{
+	struct x86_regs_t *regs = ctx->regs;
+	struct mem_t *mem = ctx->mem;
+
+	unsigned int buf_ptr;
+	unsigned int count;
+	unsigned int offset_lo;
+	unsigned int offset_hi;
+
+	long long offset;
+
+	int guest_fd;
+	int host_fd;
+
+	/* Arguments */
+	guest_fd = regs->ebx;
+	buf_ptr = regs->ecx;
+	count = regs->edx;
+	offset_lo = regs->esi;
+	offset_hi = regs->edi;
+	offset = ((long long) offset_hi << 32) | offset_lo;
+	x86_sys_debug("  guest_fd=%d, buf_ptr=0x%x, count=0x%x, offset=0x%llx\n",
+		guest_fd, buf_ptr, count, offset);
+
+	/* Get host file descriptor */
+	host_fd = x86_file_desc_table_get_host_fd(ctx->file_desc_table, guest_fd);
+	if (host_fd < 0)
+		return -EBADF;
+	x86_sys_debug("  host_fd=%d\n", host_fd);
+
+	/* Negative offsets are invalid in the host call too */
+	if (offset < 0)
+		return -EINVAL;
+
+	/* Host call */
+	return x86_sys_read_mem(mem, host_fd, buf_ptr, count, offset);
+}
+
+
+
+
+/*
+ * System call 'pwrite64' (code 181)
+ */
+
+static int x86_sys_pwrite64_impl(X86Context *ctx)
+{
+	struct x86_regs_t *regs = ctx->regs;
+	struct mem_t *mem = ctx->mem;
+
+	unsigned int buf_ptr;
+	unsigned int count;
+	unsigned int offset_lo;
+	unsigned int offset_hi;
+
+	long long offset;
+
+	int guest_fd;
+	int host_fd;
+
+	/* Arguments */
+	guest_fd = regs->ebx;
+	buf_ptr = regs->ecx;
+	count = regs->edx;
+	offset_lo = regs->esi;
+	offset_hi = regs->edi;
+	offset = ((long long) offset_hi << 32) | offset_lo;
+	x86_sys_debug("  guest_fd=%d, buf_ptr=0x%x, count=0x%x, offset=0x%llx\n",
+		guest_fd, buf_ptr, count, offset);
+
+	/* Get host file descriptor */
+	host_fd = x86_file_desc_table_get_host_fd(ctx->file_desc_table, guest_fd);
+	if (host_fd < 0)
+		return -EBADF;
+	x86_sys_debug("  host_fd=%d\n", host_fd);
+
+	/* Negative offsets are invalid in the host call too */
+	if (offset < 0)
+		return -EINVAL;
+
+	/* Host call */
+	return x86_sys_write_mem(mem, host_fd, buf_ptr, count, offset);
+}
+
+
+
+
 /*
  * System call 'getcwd' (code 183)
  */
@@ -5569,7 +5872,7 @@ static int x86_sys_tgkill_impl(X86Context *ctx)
 
 	/* Send signal */
 	x86_sigset_add(&temp_ctx->signal_mask_table->pending, sig);
-	X86ContextHostThreadSuspendCancel(temp_ctx);
+	X86ContextHostEventUnwatch(temp_ctx);
 	X86EmuProcessEventsSchedule(emu);
 	X86EmuProcessEvents(emu);
 	return 0;
@@ -5804,7 +6107,6 @@ SYS_NOT_IMPL(ni_syscall_137)
 SYS_NOT_IMPL(setfsuid16)
 SYS_NOT_IMPL(setfsgid16)
 SYS_NOT_IMPL(flock)
-SYS_NOT_IMPL(readv)
 SYS_NOT_IMPL(getsid)
 SYS_NOT_IMPL(fdatasync)
 SYS_NOT_IMPL(mlock)
@@ -5826,8 +6128,6 @@ SYS_NOT_IMPL(rt_sigreturn)
 SYS_NOT_IMPL(rt_sigpending)
 SYS_NOT_IMPL(rt_sigtimedwait)
 SYS_NOT_IMPL(rt_sigqueueinfo)
-SYS_NOT_IMPL(pread64)
-SYS_NOT_IMPL(pwrite64)
 SYS_NOT_IMPL(chown16)
 SYS_NOT_IMPL(capget)
 SYS_NOT_IMPL(capset)
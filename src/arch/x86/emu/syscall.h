@@ -46,6 +46,17 @@ extern int x86_sys_debug_category;
 
 void x86_sys_dump_stats(FILE *f);
 
+/* Read 'count' bytes from host file descriptor 'host_fd' into guest memory
+ * at 'addr', or write them from guest memory into the file. Data moves
+ * directly between the file and guest pages when possible. The file offset
+ * is given in 'offset', or the current offset is used if it is negative. The
+ * return value is the number of bytes transferred, or -errno on error. */
+struct mem_t;
+int x86_sys_read_mem(struct mem_t *mem, int host_fd, unsigned int addr,
+	unsigned int count, long long offset);
+int x86_sys_write_mem(struct mem_t *mem, int host_fd, unsigned int addr,
+	unsigned int count, long long offset);
+
 
 
 #endif
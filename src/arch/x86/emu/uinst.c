@@ -610,6 +610,12 @@ void __x86_uinst_new(X86Context *ctx,
 
 void x86_uinst_clear(void)
 {
+	/* Nothing to clear. Checked first to avoid writing shared state when
+	 * micro-instructions are not generated, such as when contexts are
+	 * emulated in parallel host threads. */
+	if (!x86_uinst_effaddr_emitted && !list_count(x86_uinst_list))
+		return;
+
 	/* Clear list */
 	while (list_count(x86_uinst_list))
 		x86_uinst_free(list_remove_at(x86_uinst_list, 0));
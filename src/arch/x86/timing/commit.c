@@ -134,12 +134,16 @@ void X86ThreadCommit(X86Thread *self, int quant)
 		self->num_committed_uinst_array[uop->uinst->opcode]++;
 		core->num_committed_uinst_array[uop->uinst->opcode]++;
 		cpu->num_committed_uinst_array[uop->uinst->opcode]++;
+		self->num_committed_uinst++;
 		cpu->num_committed_uinst++;
 		ctx->inst_count++;
 		if (uop->trace_cache)
 			self->trace_cache->num_committed_uinst++;
 		if (!uop->mop_index)
+		{
+			self->num_committed_inst++;
 			cpu->num_committed_inst++;
+		}
 		if (uop->flags & X86_UINST_CTRL)
 		{
 			self->num_branch_uinst++;
@@ -20,7 +20,10 @@
 
 #include <arch/x86/emu/context.h>
 #include <arch/x86/emu/emu.h>
+#include <arch/x86/emu/uinst.h>
 #include <lib/esim/esim.h>
+#include <lib/esim/interval.h>
+#include <lib/esim/profile.h>
 #include <lib/esim/trace.h>
 #include <lib/mhandle/mhandle.h>
 #include <lib/util/config.h>
@@ -466,6 +469,27 @@ void X86CpuCreate(X86Cpu *self, X86Emu *emu)
 		}
 	}
 
+	/* Interval statistics */
+	for (i = 0; i < x86_cpu_num_cores && esim_interval_active; i++)
+	{
+		for (j = 0; j < x86_cpu_num_threads; j++)
+		{
+			thread = self->cores[i]->threads[j];
+			esim_interval_register_counter(&thread->num_fetched_uinst,
+					"x86.%s.FetchedUinsts", thread->name);
+			esim_interval_register_counter(&thread->num_committed_inst,
+					"x86.%s.CommittedInsts", thread->name);
+			esim_interval_register_counter(&thread->num_committed_uinst,
+					"x86.%s.CommittedUinsts", thread->name);
+			esim_interval_register_counter(&thread->num_squashed_uinst,
+					"x86.%s.SquashedUinsts", thread->name);
+			esim_interval_register_counter(&thread->num_branch_uinst,
+					"x86.%s.Branches", thread->name);
+			esim_interval_register_counter(&thread->num_mispred_branch_uinst,
+					"x86.%s.Mispred", thread->name);
+		}
+	}
+
 	/* Virtual functions */
 	asObject(self)->Dump = X86CpuDump;
 	asTiming(self)->DumpSummary = X86CpuDumpSummary;
@@ -1008,16 +1032,24 @@ int X86CpuRun(Timing *self)
 
 void X86CpuRunStages(X86Cpu *self)
 {
+	/* Host-throughput profiling probes */
+	static struct esim_profile_probe_t *commit_probe;
+	static struct esim_profile_probe_t *writeback_probe;
+	static struct esim_profile_probe_t *issue_probe;
+	static struct esim_profile_probe_t *dispatch_probe;
+	static struct esim_profile_probe_t *decode_probe;
+	static struct esim_profile_probe_t *fetch_probe;
+
 	/* Context scheduler */
 	X86CpuSchedule(self);
 
 	/* Stages */
-	X86CpuCommit(self);
-	X86CpuWriteback(self);
-	X86CpuIssue(self);
-	X86CpuDispatch(self);
-	X86CpuDecode(self);
-	X86CpuFetch(self);
+	ESIM_PROFILE_CALL(commit_probe, X86CpuCommit(self), "X86CpuCommit");
+	ESIM_PROFILE_CALL(writeback_probe, X86CpuWriteback(self), "X86CpuWriteback");
+	ESIM_PROFILE_CALL(issue_probe, X86CpuIssue(self), "X86CpuIssue");
+	ESIM_PROFILE_CALL(dispatch_probe, X86CpuDispatch(self), "X86CpuDispatch");
+	ESIM_PROFILE_CALL(decode_probe, X86CpuDecode(self), "X86CpuDecode");
+	ESIM_PROFILE_CALL(fetch_probe, X86CpuFetch(self), "X86CpuFetch");
 
 	/* Update stats for structures occupancy */
 	if (x86_cpu_occupancy_stats)
@@ -1029,17 +1061,25 @@ void X86CpuRunStages(X86Cpu *self)
 void X86CpuFastForward(X86Cpu *self)
 {
 	X86Emu *emu = self->emu;
+	int active;
 
 	/* Fast-forward simulation. Run 'x86_cpu_fast_forward' iterations of the x86
-	 * emulation loop until any simulation end reason is detected. */
-	while (asEmu(emu)->instructions < x86_cpu_fast_forward_count && !esim_finish)
-		X86EmuRun(asEmu(emu));
+	 * emulation loop until any simulation end reason is detected. No
+	 * micro-instructions are consumed meanwhile, so their generation is
+	 * disabled, which also enables bulk execution of string operations. */
+	x86_uinst_active = 0;
+	active = 1;
+	while (active && asEmu(emu)->instructions < x86_cpu_fast_forward_count &&
+			!esim_finish)
+		active = X86EmuRun(asEmu(emu));
+	x86_uinst_active = 1;
 
 	/* Record number of instructions in fast-forward execution. */
 	self->num_fast_forward_inst = asEmu(emu)->instructions;
 
-	/* Output warning if simulation finished during fast-forward execution. */
-	if (esim_finish)
+	/* Output warning if simulation finished during fast-forward execution,
+	 * including when all contexts finished. */
+	if (esim_finish || !active)
 		warning("x86 fast-forwarding finished simulation.\n%s",
 				x86_cpu_err_fast_forward);
 }
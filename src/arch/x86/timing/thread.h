@@ -95,6 +95,8 @@ CLASS_BEGIN(X86Thread, Object)
 
 	/* Statistics */
 	long long num_fetched_uinst;
+	long long num_committed_uinst;
+	long long num_committed_inst;
 	long long num_dispatched_uinst_array[x86_uinst_opcode_count];
 	long long num_issued_uinst_array[x86_uinst_opcode_count];
 	long long num_committed_uinst_array[x86_uinst_opcode_count];
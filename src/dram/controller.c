@@ -301,6 +301,7 @@ int dram_controller_get_request(struct dram_controller_t *controller, struct dra
 	i = (physical_channel_id) * (controller->dram_num_ranks) * (controller->dram_num_banks_per_device) + (rank_id) * (controller->dram_num_banks_per_device) + (bank_id);
 	info = list_get(controller->dram_bank_info_list, i);
 	list_add(info->request_queue, request);
+	controller->num_requests++;
 
 	return 1;
 }
@@ -603,6 +604,7 @@ void dram_controller_schedule_command(struct dram_controller_t *controller)
 
 					/* Schedule command receive */
 					esim_schedule_event(EV_DRAM_COMMAND_RECEIVE, command, 0);
+					controller->num_commands++;
 
 					/* Update last scheduled time matrix */
 					info->dram_bank_info_last_scheduled_time_matrix[command->type] = cycle;
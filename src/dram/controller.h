@@ -140,6 +140,10 @@ struct dram_controller_t
 	struct list_t *dram_list;
 	struct list_t *dram_bank_info_list;
 	struct list_t *dram_command_scheduler_list;
+
+	/* Statistics */
+	long long num_requests;
+	long long num_commands;
 };
 
 
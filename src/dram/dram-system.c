@@ -19,6 +19,7 @@
 
 
 #include <lib/esim/esim.h>
+#include <lib/esim/interval.h>
 #include <lib/mhandle/mhandle.h>
 #include <lib/util/debug.h>
 #include <lib/util/file.h>
@@ -292,6 +293,15 @@ struct dram_system_t *dram_system_config_with_file(struct config_t *config, char
 		/* Add controller to system */
 		list_add(system->dram_controller_list, controller);
 
+		/* Interval statistics */
+		if (esim_interval_active)
+		{
+			esim_interval_register_counter(&controller->num_requests,
+					"dram.%s.ch%d.Requests", system->name, controller->id);
+			esim_interval_register_counter(&controller->num_commands,
+					"dram.%s.ch%d.Commands", system->name, controller->id);
+		}
+
 		/* Create and add DRAM*/
 		for (j = 0; j < num_physical_channels; j++)
 		{
@@ -538,6 +548,7 @@ void dram_system_sim (char *debug_file_name)
 		esim_process_events(TRUE);
 	}
 
+	esim_interval_flush();
 	dram_system_done();
 	esim_done();
 	debug_done();
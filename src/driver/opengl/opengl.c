@@ -300,8 +300,6 @@ static int opengl_abi_si_mem_read_impl(X86Context *ctx)
 	unsigned int device_ptr;
 	unsigned int size;
 
-	void *buf;
-
 	/* Arguments */
 	host_ptr = regs->ecx;
 	device_ptr = regs->edx;
@@ -315,10 +313,7 @@ static int opengl_abi_si_mem_read_impl(X86Context *ctx)
 				__FUNCTION__);
 
 	/* Read memory from device to host */
-	buf = xmalloc(size);
-	mem_read(si_emu->video_mem, device_ptr, size, buf);
-	mem_write(mem, host_ptr, size, buf);
-	free(buf);
+	mem_transfer(mem, host_ptr, si_emu->video_mem, device_ptr, size);
 
 	/* Return */
 	return 0;
@@ -358,8 +353,6 @@ static int opengl_abi_si_mem_write_impl(X86Context *ctx)
 	unsigned int host_ptr;
 	unsigned int size;
 
-	void *buf;
-
 	/* Arguments */
 	device_ptr = regs->ecx;
 	host_ptr = regs->edx;
@@ -373,10 +366,7 @@ static int opengl_abi_si_mem_write_impl(X86Context *ctx)
 				__FUNCTION__);
 
 	/* Write memory from host to device */
-	buf = xmalloc(size);
-	mem_read(mem, host_ptr, size, buf);
-	mem_write(si_emu->video_mem, device_ptr, size, buf);
-	free(buf);
+	mem_transfer(si_emu->video_mem, device_ptr, mem, host_ptr, size);
 
 	/* Return */
 	return 0;
@@ -416,8 +406,6 @@ static int opengl_abi_si_mem_copy_impl(X86Context *ctx)
 	unsigned int src_ptr;
 	unsigned int size;
 
-	void *buf;
-
 	/* Arguments */
 	dest_ptr = regs->ecx;
 	src_ptr = regs->edx;
@@ -432,10 +420,7 @@ static int opengl_abi_si_mem_copy_impl(X86Context *ctx)
 				__FUNCTION__);
 
 	/* Write memory from host to device */
-	buf = xmalloc(size);
-	mem_read(si_emu->video_mem, src_ptr, size, buf);
-	mem_write(si_emu->video_mem, dest_ptr, size, buf);
-	free(buf);
+	mem_transfer(si_emu->video_mem, dest_ptr, si_emu->video_mem, src_ptr, size);
 
 	/* Return */
 	return 0;
@@ -29,6 +29,8 @@
 #include <lib/util/timer.h>
 
 #include "esim.h"
+#include "interval.h"
+#include "profile.h"
 
 
 /* Number of in-flight events before a warning is shown (10k events) */
@@ -120,6 +122,9 @@ int esim_frequency;
 /* Number of main loop iterations with no forwarded time */
 long long esim_no_forward_cycles;
 
+/* Number of events processed */
+long long esim_processed_events;
+
 
 
 /* List of registered events. Each element is of type 'struct
@@ -259,6 +264,10 @@ struct esim_event_info_t
 	char *name;
 	esim_event_handler_t handler;
 	struct esim_domain_t *domain;
+
+	/* Host-throughput profiling probe, created on the first execution of
+	 * the event when profiling is active. */
+	struct esim_profile_probe_t *probe;
 };
 
 
@@ -287,6 +296,16 @@ void esim_event_info_free(struct esim_event_info_t *event_info)
 }
 
 
+/* Run the handler of an event */
+static void esim_event_info_run(struct esim_event_info_t *event_info,
+	int event, void *data)
+{
+	assert(event_info && event_info->handler);
+	ESIM_PROFILE_CALL(event_info->probe, event_info->handler(event, data),
+			"event %s", event_info->name);
+}
+
+
 
 
 /*
@@ -349,9 +368,9 @@ static int esim_drain_heap(void)
 		count++;
 		esim_time = when;
 		event_info = list_get(esim_event_info_list, event->id);
-		assert(event_info && event_info->handler);
-		event_info->handler(event->id, event->data);
+		esim_event_info_run(event_info, event->id, event->data);
 		esim_event_free(event);
+		esim_processed_events++;
 
 		/* Interrupt heap draining after exceeding a given number of
 		 * events. This can happen if the event handlers of processed
@@ -390,6 +409,13 @@ void esim_init()
 	esim_domain_list = list_create();
 	list_add(esim_domain_list, NULL);
 
+	/* Host-throughput profiler */
+	if (esim_profile_active)
+		esim_profile_init();
+
+	/* Interval statistics */
+	esim_interval_init();
+
 	/* Initialize global timer */
 	esim_timer = m2s_timer_create(NULL);
 	m2s_timer_start(esim_timer);
@@ -425,6 +451,12 @@ void esim_done()
 
 	/* Free global timer */
 	m2s_timer_free(esim_timer);
+
+	/* Free profiling probes */
+	esim_profile_done();
+
+	/* Close interval report */
+	esim_interval_done();
 }
 
 
@@ -611,8 +643,7 @@ void esim_execute_event(int id, void *data)
 	
 	/* Execute event handler */
 	event_info = list_get(esim_event_info_list, id);
-	assert(event_info && event_info->handler);
-	event_info->handler(id, data);
+	esim_event_info_run(event_info, id, data);
 }
 
 
@@ -647,13 +678,17 @@ void esim_process_events(int forward)
 		/* Process it */
 		heap_extract(esim_event_heap, NULL);
 		event_info = list_get(esim_event_info_list, event->id);
-		assert(event_info && event_info->handler);
-		event_info->handler(event->id, event->data);
+		esim_event_info_run(event_info, event->id, event->data);
 		esim_event_free(event);
+		esim_processed_events++;
 	}
 	
 	/* Next simulation cycle */
 	esim_time += esim_cycle_time;
+
+	/* Interval statistics */
+	if (esim_time >= esim_interval_sample_time)
+		esim_interval_sample();
 }
 
 
@@ -681,9 +716,9 @@ void esim_process_all_events(void)
 
 		/* Process it */
 		event_info = list_get(esim_event_info_list, event->id);
-		assert(event_info && event_info->handler);
-		event_info->handler(event->id, event->data);
+		esim_event_info_run(event_info, event->id, event->data);
 		esim_event_free(event);
+		esim_processed_events++;
 	}
 	
 	/* Drain heap again with new events */
@@ -710,9 +745,9 @@ void esim_empty(void)
 		
 		/* Process it */
 		event_info = list_get(esim_event_info_list, event->id);
-		assert(event_info && event_info->handler);
-		event_info->handler(event->id, event->data);
+		esim_event_info_run(event_info, event->id, event->data);
 		esim_event_free(event);
+		esim_processed_events++;
 	}
 	
 	/* Unlock event scheduling */
@@ -730,3 +765,9 @@ long long esim_real_time(void)
 {
 	return m2s_timer_get_value(esim_timer);
 }
+
+
+void esim_real_time_reset(void)
+{
+	m2s_timer_reset(esim_timer);
+}
@@ -85,6 +85,9 @@ extern long long esim_cycle_time;
  * all architectures performing only a functional simulation. */
 extern long long esim_no_forward_cycles;
 
+/* Number of events processed since the beginning of the simulation */
+extern long long esim_processed_events;
+
 /* Empty event. When this event is scheduled, it will be ignored */
 extern int ESIM_EV_NONE;
 
@@ -177,6 +180,9 @@ void esim_empty(void);
  * simulation. */
 long long esim_real_time(void);
 
+/* Restart the count of micro-seconds returned by 'esim_real_time' */
+void esim_real_time_reset(void);
+
 
 #endif
 
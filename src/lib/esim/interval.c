@@ -0,0 +1,222 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <limits.h>
+#include <stdarg.h>
+
+#include <lib/mhandle/mhandle.h>
+#include <lib/util/debug.h>
+#include <lib/util/file.h>
+#include <lib/util/list.h>
+#include <lib/util/string.h>
+
+#include "esim.h"
+#include "interval.h"
+
+
+char *esim_interval_report_file_name = "";
+long long esim_interval_report_cycles = 10000;
+
+int esim_interval_active;
+long long esim_interval_sample_time = LLONG_MAX;
+
+enum esim_interval_kind_t
+{
+	esim_interval_kind_counter = 0,
+	esim_interval_kind_gauge
+};
+
+struct esim_interval_stat_t
+{
+	char *name;
+	enum esim_interval_kind_t kind;
+
+	/* Pointer to a 'long long' counter or an 'int' gauge */
+	void *ptr;
+
+	/* Counter value in the last sample */
+	long long last_value;
+};
+
+/* List of registered statistics, elements of type
+ * 'struct esim_interval_stat_t' */
+static struct list_t *esim_interval_stat_list;
+
+static FILE *esim_interval_report_file;
+
+/* Cycle of the last sample, or -1 if the header of the report has not been
+ * dumped yet. */
+static long long esim_interval_last_cycle = -1;
+
+
+static void esim_interval_register(void *ptr, enum esim_interval_kind_t kind,
+		char *fmt, va_list va)
+{
+	struct esim_interval_stat_t *stat;
+	char name[MAX_STRING_SIZE];
+
+	/* Columns cannot be added once the header was dumped */
+	if (esim_interval_last_cycle >= 0)
+		panic("%s: statistics must be registered before simulation starts",
+				__FUNCTION__);
+
+	/* Initialize */
+	vsnprintf(name, sizeof name, fmt, va);
+	stat = xcalloc(1, sizeof(struct esim_interval_stat_t));
+	stat->name = xstrdup(name);
+	stat->kind = kind;
+	stat->ptr = ptr;
+
+	/* Add to list */
+	list_add(esim_interval_stat_list, stat);
+}
+
+
+void esim_interval_register_counter(long long *counter, char *fmt, ...)
+{
+	va_list va;
+
+	va_start(va, fmt);
+	esim_interval_register(counter, esim_interval_kind_counter, fmt, va);
+	va_end(va);
+}
+
+
+void esim_interval_register_gauge(int *gauge, char *fmt, ...)
+{
+	va_list va;
+
+	va_start(va, fmt);
+	esim_interval_register(gauge, esim_interval_kind_gauge, fmt, va);
+	va_end(va);
+}
+
+
+void esim_interval_init(void)
+{
+	/* Interval report not requested, or already initialized */
+	if (!*esim_interval_report_file_name || esim_interval_active)
+		return;
+
+	/* Open file */
+	esim_interval_report_file = file_open_for_write(esim_interval_report_file_name);
+	if (!esim_interval_report_file)
+		fatal("%s: cannot open interval report file",
+				esim_interval_report_file_name);
+	if (esim_interval_report_cycles < 1)
+		fatal("%s: invalid number of cycles per interval",
+				esim_interval_report_file_name);
+
+	/* Active. The first sample is taken in the first cycle, dumping the
+	 * header of the report. */
+	esim_interval_active = 1;
+	esim_interval_stat_list = list_create();
+	esim_interval_sample_time = 0;
+}
+
+
+void esim_interval_done(void)
+{
+	struct esim_interval_stat_t *stat;
+	int index;
+
+	/* Not active */
+	if (!esim_interval_active)
+		return;
+
+	/* Free statistics */
+	LIST_FOR_EACH(esim_interval_stat_list, index)
+	{
+		stat = list_get(esim_interval_stat_list, index);
+		free(stat->name);
+		free(stat);
+	}
+	list_free(esim_interval_stat_list);
+
+	/* Close file */
+	file_close(esim_interval_report_file);
+	esim_interval_active = 0;
+	esim_interval_sample_time = LLONG_MAX;
+	esim_interval_last_cycle = -1;
+}
+
+
+void esim_interval_sample(void)
+{
+	struct esim_interval_stat_t *stat;
+	FILE *f = esim_interval_report_file;
+
+	long long cycle;
+	long long value;
+	int index;
+
+	/* Next sample */
+	if (!esim_interval_active || !esim_cycle_time)
+		return;
+	cycle = esim_cycle();
+	esim_interval_sample_time = esim_time + esim_interval_report_cycles *
+			esim_cycle_time;
+
+	/* First sample dumps the header and records initial values */
+	if (esim_interval_last_cycle < 0)
+	{
+		fprintf(f, "Cycle");
+		LIST_FOR_EACH(esim_interval_stat_list, index)
+		{
+			stat = list_get(esim_interval_stat_list, index);
+			if (stat->kind == esim_interval_kind_counter)
+				stat->last_value = * (long long *) stat->ptr;
+			fprintf(f, ",%s", stat->name);
+		}
+		fprintf(f, "\n");
+		esim_interval_last_cycle = cycle;
+		return;
+	}
+
+	/* Nothing happened since last sample */
+	if (cycle == esim_interval_last_cycle)
+		return;
+
+	/* One line */
+	fprintf(f, "%lld", cycle);
+	LIST_FOR_EACH(esim_interval_stat_list, index)
+	{
+		stat = list_get(esim_interval_stat_list, index);
+		if (stat->kind == esim_interval_kind_counter)
+		{
+			value = * (long long *) stat->ptr;
+			fprintf(f, ",%lld", value - stat->last_value);
+			stat->last_value = value;
+		}
+		else
+		{
+			fprintf(f, ",%d", * (int *) stat->ptr);
+		}
+	}
+	fprintf(f, "\n");
+	esim_interval_last_cycle = cycle;
+}
+
+
+void esim_interval_flush(void)
+{
+	/* Last sample, and no more samples after it */
+	esim_interval_sample();
+	esim_interval_sample_time = LLONG_MAX;
+}
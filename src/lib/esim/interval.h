@@ -0,0 +1,69 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef LIB_ESIM_INTERVAL_H
+#define LIB_ESIM_INTERVAL_H
+
+
+/*
+ * Interval statistics
+ *
+ * Components of the simulator register their statistics counters once, when
+ * they are created. Every 'esim_interval_report_cycles' cycles of the fastest
+ * frequency domain, the values of all counters are sampled into one line of
+ * a CSV file, giving time-series data for long simulations. Between samples,
+ * the only cost is one comparison per simulation cycle.
+ */
+
+/* Set with command-line options '--interval-report' and
+ * '--interval-report-cycles' */
+extern char *esim_interval_report_file_name;
+extern long long esim_interval_report_cycles;
+
+/* Set in 'esim_init' when an interval report was requested. Components only
+ * register their counters if this flag is set. */
+extern int esim_interval_active;
+
+/* Global simulation time of the next sample, checked in every call to
+ * 'esim_process_events' */
+extern long long esim_interval_sample_time;
+
+/* Register an event counter, of type 'long long' and only incremented. Each
+ * sample reports its increment over the last interval. The column name is
+ * given by the printf-like arguments. */
+void esim_interval_register_counter(long long *counter, char *fmt, ...)
+	__attribute__ ((format (printf, 2, 3)));
+
+/* Register an occupancy value of type 'int', such as the number of entries in
+ * a queue. Each sample reports its value at the time of the sample. */
+void esim_interval_register_gauge(int *gauge, char *fmt, ...)
+	__attribute__ ((format (printf, 2, 3)));
+
+void esim_interval_init(void);
+void esim_interval_done(void);
+
+/* Dump one line with the current values of all counters */
+void esim_interval_sample(void);
+
+/* Dump the last, incomplete interval. This function must be called at the end
+ * of the simulation, before the registered counters are freed. */
+void esim_interval_flush(void);
+
+
+#endif
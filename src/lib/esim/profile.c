@@ -0,0 +1,165 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <stdarg.h>
+
+#include <lib/mhandle/mhandle.h>
+#include <lib/util/list.h>
+#include <lib/util/string.h>
+
+#include "profile.h"
+
+
+int esim_profile_active;
+
+/* List of probes, elements of type 'struct esim_profile_probe_t' */
+static struct list_t *esim_profile_probe_list;
+
+/* Host time and cycle counter when profiling started, used to convert cycles
+ * into seconds. */
+static long long esim_profile_start_time;
+static unsigned long long esim_profile_start_cycles;
+
+
+static long long esim_profile_now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (long long) tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+
+static int esim_profile_probe_compare(const void *ptr1, const void *ptr2)
+{
+	const struct esim_profile_probe_t *probe1 = ptr1;
+	const struct esim_profile_probe_t *probe2 = ptr2;
+
+	if (probe1->cycles != probe2->cycles)
+		return probe1->cycles > probe2->cycles ? -1 : 1;
+	return 0;
+}
+
+
+struct esim_profile_probe_t *esim_profile_probe_create(char *fmt, ...)
+{
+	struct esim_profile_probe_t *probe;
+	char name[MAX_STRING_SIZE];
+	va_list va;
+
+	/* Name */
+	va_start(va, fmt);
+	vsnprintf(name, sizeof name, fmt, va);
+	va_end(va);
+
+	/* Initialize */
+	probe = xcalloc(1, sizeof(struct esim_profile_probe_t));
+	probe->name = xstrdup(name);
+
+	/* Add to list */
+	if (!esim_profile_probe_list)
+		esim_profile_probe_list = list_create();
+	list_add(esim_profile_probe_list, probe);
+
+	/* Return */
+	return probe;
+}
+
+
+void esim_profile_init(void)
+{
+	esim_profile_start_time = esim_profile_now();
+	esim_profile_start_cycles = esim_profile_cycles();
+}
+
+
+void esim_profile_done(void)
+{
+	struct esim_profile_probe_t *probe;
+	int index;
+
+	/* Nothing was profiled */
+	if (!esim_profile_probe_list)
+		return;
+
+	/* Free probes */
+	LIST_FOR_EACH(esim_profile_probe_list, index)
+	{
+		probe = list_get(esim_profile_probe_list, index);
+		free(probe->name);
+		free(probe);
+	}
+	list_free(esim_profile_probe_list);
+	esim_profile_probe_list = NULL;
+}
+
+
+void esim_profile_dump(FILE *f)
+{
+	struct esim_profile_probe_t *probe;
+	struct list_t *probe_list;
+
+	double total_time;
+	double sec_per_cycle;
+	double time;
+
+	int index;
+
+	/* Profiling disabled */
+	if (!esim_profile_active || !esim_profile_probe_list)
+		return;
+
+	/* Calibrate the cycle counter against the host wall-clock time
+	 * elapsed since the profiler started. */
+	total_time = (double) (esim_profile_now() - esim_profile_start_time) / 1.0e6;
+	sec_per_cycle = total_time / (double) (esim_profile_cycles() -
+			esim_profile_start_cycles + 1);
+
+	/* Probes sorted by time */
+	probe_list = list_create();
+	LIST_FOR_EACH(esim_profile_probe_list, index)
+	{
+		probe = list_get(esim_profile_probe_list, index);
+		if (probe->count)
+			list_add(probe_list, probe);
+	}
+	list_sort(probe_list, esim_profile_probe_compare);
+
+	/* Header */
+	fprintf(f, "[ HostProfile ]\n");
+	fprintf(f, "RealTime = %.2f [s]\n", total_time);
+	fprintf(f, "; %-38s %12s %10s %7s %12s %10s\n", "Probe", "Calls",
+			"Time[s]", "Time[%]", "Calls/s", "ns/Call");
+
+	/* Probes */
+	LIST_FOR_EACH(probe_list, index)
+	{
+		probe = list_get(probe_list, index);
+		time = probe->cycles * sec_per_cycle;
+		fprintf(f, "; %-38s %12lld %10.3f %7.2f %12.0f %10.1f\n",
+				probe->name, probe->count, time,
+				total_time > 0 ? time * 100.0 / total_time : 0.0,
+				time > 0 ? probe->count / time : 0.0,
+				time * 1.0e9 / probe->count);
+	}
+	fprintf(f, "\n");
+
+	/* Free */
+	list_free(probe_list);
+}
@@ -0,0 +1,103 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef LIB_ESIM_PROFILE_H
+#define LIB_ESIM_PROFILE_H
+
+#include <stdio.h>
+#include <sys/time.h>
+
+
+/*
+ * Host-throughput profiler
+ *
+ * Measures how much host time the simulator spends in each event handler,
+ * architecture iteration, and timing pipeline stage. Each measured piece of
+ * code is a probe, counting its invocations and the host cycles spent in
+ * them. Times are inclusive: an event executed from another event handler,
+ * or a stage run from an architecture iteration, counts in both probes.
+ */
+
+/* Set with command-line option '--host-profile' */
+extern int esim_profile_active;
+
+struct esim_profile_probe_t
+{
+	char *name;
+	long long count;
+	unsigned long long cycles;
+};
+
+/* Create a probe named after the format string 'fmt'. Probes are freed in
+ * 'esim_profile_done'. */
+struct esim_profile_probe_t *esim_profile_probe_create(char *fmt, ...)
+	__attribute__ ((format (printf, 1, 2)));
+
+void esim_profile_init(void);
+void esim_profile_done(void);
+
+/* Dump a table with all probes sorted by host time */
+void esim_profile_dump(FILE *f);
+
+
+/* Host cycle counter */
+static inline unsigned long long esim_profile_cycles(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+	unsigned int low;
+	unsigned int high;
+
+	__asm__ __volatile__ ("rdtsc" : "=a" (low), "=d" (high));
+	return ((unsigned long long) high << 32) | low;
+#else
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (unsigned long long) tv.tv_sec * 1000000000ull +
+		(unsigned long long) tv.tv_usec * 1000ull;
+#endif
+}
+
+
+/* Run statement 'call', accounting for it in probe 'probe', which should be an
+ * lvalue initialized to NULL. The probe is created the first time it is used,
+ * with the name given by the remaining printf-like arguments. When profiling
+ * is disabled, the only overhead is the check of 'esim_profile_active'. */
+#define ESIM_PROFILE_CALL(probe, call, ...) \
+	do { \
+		if (esim_profile_active) \
+		{ \
+			unsigned long long __esim_profile_start; \
+			\
+			if (!(probe)) \
+				(probe) = esim_profile_probe_create(__VA_ARGS__); \
+			__esim_profile_start = esim_profile_cycles(); \
+			call; \
+			(probe)->cycles += esim_profile_cycles() - \
+					__esim_profile_start; \
+			(probe)->count++; \
+		} \
+		else \
+		{ \
+			call; \
+		} \
+	} while (0)
+
+
+#endif
@@ -17,6 +17,7 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -55,6 +56,10 @@ static struct mhandle_item_t *mhandle_hash_table;  /* Linear hash table */
 static int mhandle_hash_table_size;  /* Allocated size for hash table */
 static int mhandle_hash_table_count;  /* Number of elements */
 
+/* Lock protecting the hash table. Memory can be allocated and freed by host
+ * threads simulating in parallel, so every public function takes it. */
+static pthread_mutex_t mhandle_lock = PTHREAD_MUTEX_INITIALIZER;
+
 /* Forward declarations */
 static void mhandle_hash_table_insert(void *ptr, unsigned long size, char *at, int corrupt_info);
 
@@ -270,6 +275,7 @@ void mhandle_free(void *ptr, char *at)
 	/* initialization */
 	if (!ptr)
 		return;
+	pthread_mutex_lock(&mhandle_lock);
 	mhandle_init();
 
 	/* Read item */
@@ -298,6 +304,7 @@ void mhandle_free(void *ptr, char *at)
 	
 	/* Remove pointer from data base */
 	mhandle_hash_table_remove(ptr, at);
+	pthread_mutex_unlock(&mhandle_lock);
 }
 
 
@@ -307,6 +314,7 @@ void *mhandle_malloc(unsigned long size, char *at)
 	void *eff_ptr;
 	unsigned long eff_size;
 	
+	pthread_mutex_lock(&mhandle_lock);
 	mhandle_init();
 
 	/* Allocate */
@@ -321,6 +329,7 @@ void *mhandle_malloc(unsigned long size, char *at)
 
 	/* Record pointer and return */
 	mhandle_hash_table_insert(ptr, size, at, 1);
+	pthread_mutex_unlock(&mhandle_lock);
 	return ptr;
 }
 
@@ -333,6 +342,7 @@ void *mhandle_calloc(unsigned long nmemb, unsigned long size, char *at)
 	unsigned long total;
 	unsigned long eff_total;
 	
+	pthread_mutex_lock(&mhandle_lock);
 	mhandle_init();
 
 	/* Effective size */
@@ -350,6 +360,7 @@ void *mhandle_calloc(unsigned long nmemb, unsigned long size, char *at)
 
 	/* Record pointer and return */
 	mhandle_hash_table_insert(ptr, total, at, 1);
+	pthread_mutex_unlock(&mhandle_lock);
 	return ptr;
 }
 
@@ -372,6 +383,7 @@ void *mhandle_realloc(void *ptr, unsigned long size, char *at)
 	}
 	
 	/* Reallocate */
+	pthread_mutex_lock(&mhandle_lock);
 	mhandle_init();
 
 	/* Search pointer */
@@ -411,6 +423,7 @@ void *mhandle_realloc(void *ptr, unsigned long size, char *at)
 	
 	/* Record pointer and return */
 	mhandle_hash_table_insert(ptr, size, at, 1);
+	pthread_mutex_unlock(&mhandle_lock);
 	return ptr;
 }
 
@@ -423,6 +436,7 @@ char *mhandle_strdup(const char *s, char *at)
 	unsigned long size = strlen(s) + 1;
 	unsigned long eff_size;
 
+	pthread_mutex_lock(&mhandle_lock);
 	mhandle_init();
 
 	/* Allocate */
@@ -439,6 +453,7 @@ char *mhandle_strdup(const char *s, char *at)
 
 	/* Record pointer and return */
 	mhandle_hash_table_insert(ptr, size, at, 1);
+	pthread_mutex_unlock(&mhandle_lock);
 	return ptr;
 }
 
@@ -496,6 +511,7 @@ void __mhandle_done()
 	int i;
 	
 	/* Visit whole hash table to look for not freed pointers */
+	pthread_mutex_lock(&mhandle_lock);
 	for (i = 0; i < mhandle_hash_table_size; i++)
 		if (mhandle_hash_table[i].active && !mhandle_hash_table[i].removed)
 			fprintf(stderr, "\nwarning: %s: pointer not freed", mhandle_hash_table[i].at);
@@ -512,6 +528,7 @@ void __mhandle_done()
 	mhandle_mem_used = 0;
 	mhandle_hash_table_count = 0;
 	mhandle_hash_table_size = 0;
+	pthread_mutex_unlock(&mhandle_lock);
 }
 
 
@@ -524,6 +541,7 @@ void __mhandle_check(char *at)
 	unsigned long eff_size;
 	
 	/* Check for corruption in all allocated blocks */
+	pthread_mutex_lock(&mhandle_lock);
 	for (i = 0; i < mhandle_hash_table_size; i++)
 	{
 		if (mhandle_hash_table[i].active && !mhandle_hash_table[i].removed
@@ -535,6 +553,7 @@ void __mhandle_check(char *at)
 			count++;
 		}
 	}
+	pthread_mutex_unlock(&mhandle_lock);
 	fprintf(stderr, "libmhandle: %d pointers checked for corruption\n", count);
 
 }
@@ -542,12 +561,19 @@ void __mhandle_check(char *at)
 
 unsigned long __mhandle_used_memory()
 {
-	return mhandle_mem_used;
+	unsigned long mem_used;
+
+	pthread_mutex_lock(&mhandle_lock);
+	mem_used = mhandle_mem_used;
+	pthread_mutex_unlock(&mhandle_lock);
+	return mem_used;
 }
 
 
 void __mhandle_register_ptr(void *ptr, unsigned long size, char *at)
 {
+	pthread_mutex_lock(&mhandle_lock);
 	mhandle_hash_table_insert(ptr, size, at, 0);
+	pthread_mutex_unlock(&mhandle_lock);
 }
 
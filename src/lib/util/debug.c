@@ -115,6 +115,13 @@ int debug_new_category(char *file_name)
 }
 
 
+int debug_category_count(void)
+{
+	/* Discard invalid category at index 0 */
+	return list_count(debug_category_list) - 1;
+}
+
+
 void __debug_on(int category)
 {
 	struct debug_category_t *c;
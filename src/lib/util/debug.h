@@ -33,6 +33,9 @@ void debug_done(void);
  * 'debug_assign_file' is performed. */
 int debug_new_category(char *filename);
 
+/* Return the number of categories created with a file name */
+int debug_category_count(void);
+
 /* Switch the status of a debugging category. By default, the
  * debugging messages are on, while there is an opened file to be dumped into. */
 #define debug_on(category) ((category) ? __debug_on((category)) : (void) 0)
@@ -19,12 +19,16 @@
 
 
 #include <assert.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #include <lib/mhandle/mhandle.h>
 
 #include "debug.h"
 #include "elf-format.h"
+#include "hash-table.h"
 #include "list.h"
 
 
@@ -322,12 +326,22 @@ struct elf_symbol_t *elf_symbol_get_by_name(struct elf_file_t *elf_file, char *n
 	struct elf_symbol_t *symbol;
 	int i;
 
-	for (i = 0; i < list_count(elf_file->symbol_table); i++) {
-		symbol = list_get(elf_file->symbol_table, i);
-		if (!strcmp(symbol->name, name))
-			return symbol;
+	/* Create index by name. Insertions of repeated names fail, keeping the
+	 * first symbol in the table. */
+	if (!elf_file->symbol_name_table)
+	{
+		elf_file->symbol_name_table = hash_table_create(
+			list_count(elf_file->symbol_table), 1);
+		LIST_FOR_EACH(elf_file->symbol_table, i)
+		{
+			symbol = list_get(elf_file->symbol_table, i);
+			hash_table_insert(elf_file->symbol_name_table,
+				symbol->name, symbol);
+		}
 	}
-	return NULL;
+
+	/* Look up symbol */
+	return hash_table_get(elf_file->symbol_name_table, name);
 }
 
 
@@ -596,30 +610,33 @@ struct elf_file_t *elf_file_create_from_path(char *path)
 {
 	struct elf_file_t *elf_file;
 	struct stat st;
-	FILE *f;
 
 	void *buffer;
 	int size;
-	int count;
+	int fd;
 
 	/* Get file size */
 	if (stat(path, &st))
 		fatal("'%s': path not found", path);
 	size = st.st_size;
+	if (!size)
+		fatal("%s: not a valid ELF file", path);
 
 	/* Open file */
-	f = fopen(path, "rt");
-	if (!f)
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
 		fatal("'%s': cannot open file", path);
 
-	/* Read file contents */
-	buffer = xmalloc(size);
-	count = fread(buffer, 1, size, f);
-	if (count != size)
-		fatal("'%s': error reading file contents", path);
+	/* Map file contents. The mapping is private, so the file is not
+	 * modified if the buffer is written. */
+	buffer = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	if (buffer == MAP_FAILED)
+		fatal("'%s': error mapping file contents", path);
+	close(fd);
 
 	/* Create ELF file */
 	elf_file = elf_file_create_from_allocated_buffer(buffer, size, path);
+	elf_file->buffer_mapped = 1;
 	return elf_file;
 }
 
@@ -630,6 +647,8 @@ void elf_file_free(struct elf_file_t *elf_file)
 	while (list_count(elf_file->symbol_table))
 		free(list_remove_at(elf_file->symbol_table, 0));
 	list_free(elf_file->symbol_table);
+	if (elf_file->symbol_name_table)
+		hash_table_free(elf_file->symbol_name_table);
 
 	/* Free section list */
 	while (list_count(elf_file->section_list))
@@ -642,7 +661,10 @@ void elf_file_free(struct elf_file_t *elf_file)
 	list_free(elf_file->program_header_list);
 
 	/* Free rest */
-	free(elf_file->buffer.ptr);
+	if (elf_file->buffer_mapped)
+		munmap(elf_file->buffer.ptr, elf_file->buffer.size);
+	else
+		free(elf_file->buffer.ptr);
 	free(elf_file->path);
 	free(elf_file);
 }
@@ -24,6 +24,8 @@
 #include <stdio.h>
 
 
+struct hash_table_t;
+
 /* ELF buffer */
 struct elf_buffer_t
 {
@@ -76,8 +78,10 @@ struct elf_file_t
 	/* File name, or NULL if loaded from buffer */
 	char *path;
 
-	/* ELF buffer */
+	/* ELF buffer. Files loaded from a path are mapped in memory, and only
+	 * the pages that are accessed are read from disk. */
 	struct elf_buffer_t buffer;
+	int buffer_mapped;
 
 	/* ELF header - pointer to a position within 'buffer' */
 	Elf32_Ehdr *header;
@@ -89,8 +93,13 @@ struct elf_file_t
 	/* ELF program headers */
 	struct list_t *program_header_list;  /* Elements of type 'struct elf_program_header_t' */
 
-	/* Symbol table */
+	/* Symbol table, sorted by address */
 	struct list_t *symbol_table;  /* Elements of type 'struct elf_symbol_t' */
+
+	/* Index of the symbol table by name, created in the first call to
+	 * 'elf_symbol_get_by_name'. Each name maps to the first symbol with
+	 * that name in 'symbol_table'. */
+	struct hash_table_t *symbol_name_table;
 };
 
 
@@ -44,6 +44,12 @@ struct repos_t
 };
 
 
+/* Identifier of the next repository. Identifiers are not taken from
+ * 'random()', so that creating a repository does not alter the random
+ * sequence observed by the simulation. */
+static int repos_next_id = 1;
+
+
 struct repos_t *repos_create(int object_size, char *name)
 {
 	struct repos_t *repos;
@@ -54,7 +60,7 @@ struct repos_t *repos_create(int object_size, char *name)
 
 	/* Initialize */
 	repos = xcalloc(1, sizeof(struct repos_t));
-	repos->id = random();
+	repos->id = repos_next_id++;
 	repos->name = name;
 	repos->object_size = object_size;
 
@@ -0,0 +1,948 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <arch/southern-islands/asm/asm.h>
+#include <arch/x86/asm/asm.h>
+#include <arch/x86/asm/inst.h>
+#include <lib/esim/esim.h>
+#include <lib/mhandle/mhandle.h>
+#include <lib/util/config.h>
+#include <lib/util/debug.h>
+#include <lib/util/heap.h>
+#include <lib/util/string.h>
+#include <mem-system/cache.h>
+#include <mem-system/memory.h>
+#include <network/network.h>
+#include <network/routing-table.h>
+
+
+/*
+ * Simulator performance benchmark suite
+ *
+ * Microbenchmarks time the core engines of the simulator in isolation, and
+ * end-to-end runs time the 'm2s' binary on the programs and configuration
+ * files in the 'samples' directory. Results are written into an INI file,
+ * which can later be used as a baseline to flag performance regressions.
+ * This program is built and run with 'make bench'.
+ */
+
+static char *m2s_bench_help =
+		"Syntax:\n"
+		"\n"
+		"        m2s-bench [<options>] [<benchmark_prefix> ...]\n"
+		"\n"
+		"Run the simulator performance benchmarks. If one or more prefixes are\n"
+		"given, only benchmarks whose name starts with any of them are run (e.g.,\n"
+		"'micro' or 'run.x86'). Options:\n"
+		"\n"
+		"  --compare <file>\n"
+		"      Compare results against a baseline file produced by a previous\n"
+		"      execution with option '--output'. Metrics that worsen by more\n"
+		"      than the threshold are reported as regressions, and the program\n"
+		"      exits with an error code.\n"
+		"\n"
+		"  --list\n"
+		"      List the available benchmarks and exit.\n"
+		"\n"
+		"  --m2s <path>\n"
+		"      Path to the 'm2s' binary used in end-to-end runs. If not given,\n"
+		"      end-to-end runs are skipped.\n"
+		"\n"
+		"  --output <file>\n"
+		"      Dump results into <file> in INI format.\n"
+		"\n"
+		"  --repeat <num>\n"
+		"      Number of times each microbenchmark is repeated. The fastest\n"
+		"      repetition is reported. Default is 3.\n"
+		"\n"
+		"  --samples <dir>\n"
+		"      Path to the 'samples' directory of the source tree, used in\n"
+		"      end-to-end runs.\n"
+		"\n"
+		"  --scale <num>\n"
+		"      Multiply the number of operations run by each microbenchmark by\n"
+		"      <num>. Default is 1.\n"
+		"\n"
+		"  --si-program <file>\n"
+		"      OpenCL host program run on the Southern Islands end-to-end\n"
+		"      benchmarks. The repository does not ship one, so these\n"
+		"      benchmarks are skipped if this option is not given.\n"
+		"\n"
+		"  --threshold <percent>\n"
+		"      Minimum change in a metric reported as a regression when using\n"
+		"      option '--compare'. Default is 10.\n"
+		"\n";
+
+static char *m2s_bench_err_note =
+		"Please type 'm2s-bench --help' for a list of valid options.\n";
+
+static char *m2s_bench_m2s_path = "";
+static char *m2s_bench_samples_path = "";
+static char *m2s_bench_si_program = "";
+static char *m2s_bench_output_file_name = "";
+static char *m2s_bench_compare_file_name = "";
+static double m2s_bench_threshold = 10.0;
+static int m2s_bench_scale = 1;
+static int m2s_bench_repeat = 3;
+static int m2s_bench_list;
+
+/* Benchmark name prefixes given in the command line */
+static char **m2s_bench_filter;
+static int m2s_bench_filter_count;
+
+/* Results */
+static struct config_t *m2s_bench_results;
+
+/* Sink for values computed by microbenchmarks, preventing the compiler from
+ * optimizing their work away. */
+static volatile long long m2s_bench_sink;
+
+/* Deterministic pseudo-random number generator, so that all executions
+ * perform the same work. */
+static unsigned int m2s_bench_seed;
+
+
+static unsigned int m2s_bench_random(void)
+{
+	m2s_bench_seed ^= m2s_bench_seed << 13;
+	m2s_bench_seed ^= m2s_bench_seed >> 17;
+	m2s_bench_seed ^= m2s_bench_seed << 5;
+	return m2s_bench_seed;
+}
+
+
+static double m2s_bench_now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1.0e6;
+}
+
+
+static int m2s_bench_selected(char *name)
+{
+	int i;
+
+	if (!m2s_bench_filter_count)
+		return 1;
+	for (i = 0; i < m2s_bench_filter_count; i++)
+		if (str_prefix(name, m2s_bench_filter[i]))
+			return 1;
+	return 0;
+}
+
+
+
+
+/*
+ * Microbenchmarks
+ */
+
+/* Each microbenchmark runs 'ops' operations on one engine of the simulator.
+ * Only the code between 'start' and 'end' is timed, leaving set-up and
+ * clean-up out. */
+typedef void (*m2s_bench_micro_func_t)(long long ops, double *start,
+		double *end);
+
+struct m2s_bench_micro_t
+{
+	char *name;
+	char *desc;
+	m2s_bench_micro_func_t func;
+	long long ops;
+};
+
+
+static void m2s_bench_micro_heap(long long ops, double *start, double *end)
+{
+	struct heap_t *heap;
+	void *data;
+	long long i;
+
+	heap = heap_create(1024);
+	*start = m2s_bench_now();
+
+	/* Keep 1024 elements in the heap, replacing the minimum by a later
+	 * one, as the event-driven simulation engine does. */
+	for (i = 0; i < 1024; i++)
+		heap_insert(heap, m2s_bench_random() % 64, NULL);
+	for (i = 0; i < ops; i++)
+		heap_insert(heap, heap_extract(heap, &data) +
+				m2s_bench_random() % 64, NULL);
+
+	*end = m2s_bench_now();
+	heap_free(heap);
+}
+
+
+static int m2s_bench_esim_event;
+static long long m2s_bench_esim_left;
+
+static void m2s_bench_esim_handler(int event, void *data)
+{
+	if (m2s_bench_esim_left-- > 0)
+		esim_schedule_event(event, data, 1 + m2s_bench_random() % 8);
+}
+
+static void m2s_bench_micro_esim(long long ops, double *start, double *end)
+{
+	int i;
+
+	*start = m2s_bench_now();
+
+	/* Keep 256 events in flight, each rescheduling itself */
+	m2s_bench_esim_left = ops;
+	for (i = 0; i < 256; i++)
+		esim_schedule_event(m2s_bench_esim_event, NULL, 1);
+	while (esim_event_count())
+		esim_process_events(1);
+
+	*end = m2s_bench_now();
+}
+
+
+static void m2s_bench_micro_mem_access(long long ops, double *start,
+		double *end)
+{
+	struct mem_t *mem;
+	unsigned int size;
+	unsigned int addr;
+	unsigned int value;
+	long long i;
+
+	/* 16MB of memory */
+	size = 1 << 24;
+	mem = mem_create();
+	mem_map(mem, 0, size, mem_access_read | mem_access_write);
+	mem_zero(mem, 0, size);
+	*start = m2s_bench_now();
+
+	/* Random reads and writes of 4 bytes */
+	for (i = 0; i < ops; i++)
+	{
+		addr = m2s_bench_random() % size & ~3;
+		if (i & 1)
+		{
+			mem_read(mem, addr, 4, &value);
+			m2s_bench_sink += value;
+		}
+		else
+		{
+			value = i;
+			mem_write(mem, addr, 4, &value);
+		}
+	}
+
+	*end = m2s_bench_now();
+	mem_free(mem);
+}
+
+
+static void m2s_bench_micro_cache_find_block(long long ops, double *start,
+		double *end)
+{
+	struct cache_t *cache;
+	unsigned int addr;
+	unsigned int span;
+	long long i;
+
+	int set;
+	int way;
+	int tag;
+	int state;
+
+	/* Cache of 1024 sets, 64-byte blocks, and 16 ways (1MB), full of
+	 * valid blocks. */
+	cache = cache_create("bench", 1024, 64, 16, cache_policy_lru,
+			cache_writepolicy_writeback);
+	span = 1024 * 64 * 16;
+	for (addr = 0; addr < span; addr += 64)
+	{
+		cache_decode_address(cache, addr, &set, &tag, NULL);
+		way = cache_replace_block(cache, set);
+		cache_set_block(cache, set, way, tag, cache_block_exclusive);
+		cache_access_block(cache, set, way);
+	}
+	*start = m2s_bench_now();
+
+	/* Lookups over twice the cache size, i.e., half of them hit */
+	for (i = 0; i < ops; i++)
+	{
+		addr = m2s_bench_random() % (span * 2);
+		m2s_bench_sink += cache_find_block(cache, addr, &set, &way,
+				&state);
+	}
+
+	*end = m2s_bench_now();
+	cache_free(cache);
+}
+
+
+/* Sequence of common IA-32 instructions */
+static unsigned char m2s_bench_x86_code[] =
+{
+	0x55,					/* push %ebp */
+	0x89, 0xe5,				/* mov %esp,%ebp */
+	0x83, 0xec, 0x18,			/* sub $0x18,%esp */
+	0x8b, 0x45, 0x08,			/* mov 0x8(%ebp),%eax */
+	0x01, 0xd0,				/* add %edx,%eax */
+	0x8d, 0x04, 0x85, 0x00, 0x00, 0x00, 0x00,	/* lea 0x0(,%eax,4),%eax */
+	0x39, 0xc8,				/* cmp %ecx,%eax */
+	0x7c, 0xf0,				/* jl <rel> */
+	0x0f, 0xaf, 0xc1,			/* imul %ecx,%eax */
+	0x66, 0x89, 0x08,			/* mov %cx,(%eax) */
+	0xdd, 0x45, 0xf8,			/* fldl -0x8(%ebp) */
+	0xf3, 0xa4,				/* rep movsb */
+	0xe8, 0x00, 0x00, 0x00, 0x00,		/* call <rel> */
+	0xc9,					/* leave */
+	0xc3,					/* ret */
+	0x90, 0x90, 0x90, 0x90, 0x90, 0x90,	/* padding */
+	0x90, 0x90, 0x90, 0x90, 0x90, 0x90,
+	0x90, 0x90, 0x90, 0x90
+};
+
+static void m2s_bench_micro_x86_inst_decode(long long ops, double *start,
+		double *end)
+{
+	X86Asm *as;
+	X86Inst inst;
+
+	unsigned int eip;
+	long long i;
+
+	as = new(X86Asm);
+	X86InstCreate(&inst, as);
+	*start = m2s_bench_now();
+
+	/* Decode the code sequence repeatedly. The padding at the end allows
+	 * the decoder to read up to 20 bytes past the last instruction. */
+	eip = 0;
+	for (i = 0; i < ops; i++)
+	{
+		X86InstDecode(&inst, 0x8048000 + eip, m2s_bench_x86_code + eip);
+		eip += inst.size;
+		if (eip >= sizeof m2s_bench_x86_code - 20)
+			eip = 0;
+	}
+
+	*end = m2s_bench_now();
+	X86InstDestroy(&inst);
+	delete(as);
+}
+
+
+/* Sequence of common Southern Islands instructions */
+static unsigned int m2s_bench_si_code[] =
+{
+	0xc2000504,	/* s_buffer_load_dword s0, s[4:7], 0x04 */
+	0xbf8c007f,	/* s_waitcnt lgkmcnt(0) */
+	0xbe820300,	/* s_mov_b32 s2, s0 */
+	0x7e000202,	/* v_mov_b32 v0, s2 */
+	0x4a020500,	/* v_add_i32 v1, vcc, v0, v2 */
+	0x81020302,	/* s_add_i32 s2, s2, s3 */
+	0xbf810000	/* s_endpgm */
+};
+
+static void m2s_bench_micro_si_inst_decode(long long ops, double *start,
+		double *end)
+{
+	struct si_inst_t inst;
+	unsigned int offset;
+	long long i;
+
+	si_disasm_init();
+	*start = m2s_bench_now();
+
+	offset = 0;
+	for (i = 0; i < ops; i++)
+	{
+		offset += si_inst_decode(m2s_bench_si_code + offset / 4,
+				&inst, offset);
+		if (offset >= sizeof m2s_bench_si_code)
+			offset = 0;
+	}
+
+	*end = m2s_bench_now();
+	si_disasm_done();
+}
+
+
+static void m2s_bench_micro_net_routing_lookup(long long ops, double *start,
+		double *end)
+{
+	struct net_routing_table_entry_t *entry;
+	struct net_node_t *end_nodes[64];
+	struct net_node_t *switches[64];
+	struct net_t *net;
+
+	char name[MAX_STRING_SIZE];
+	long long i;
+	int x;
+	int y;
+
+	/* 8x8 mesh of switches, each connected to one end node */
+	net = net_create("bench");
+	for (i = 0; i < 64; i++)
+	{
+		snprintf(name, sizeof name, "n%lld", i);
+		end_nodes[i] = net_add_end_node(net, 64, 64, name, NULL);
+		snprintf(name, sizeof name, "s%lld", i);
+		switches[i] = net_add_switch(net, 64, 64, 8, name);
+		net_add_bidirectional_link(net, end_nodes[i], switches[i],
+				8, 64, 64, 1);
+	}
+	for (y = 0; y < 8; y++)
+	{
+		for (x = 0; x < 8; x++)
+		{
+			if (x < 7)
+				net_add_bidirectional_link(net, switches[y * 8 + x],
+						switches[y * 8 + x + 1], 8, 64, 64, 1);
+			if (y < 7)
+				net_add_bidirectional_link(net, switches[y * 8 + x],
+						switches[y * 8 + x + 8], 8, 64, 64, 1);
+		}
+	}
+	net_routing_table_initiate(net->routing_table);
+	net_routing_table_floyd_warshall(net->routing_table);
+	*start = m2s_bench_now();
+
+	/* Lookups between random pairs of end nodes */
+	for (i = 0; i < ops; i++)
+	{
+		entry = net_routing_table_lookup(net->routing_table,
+				end_nodes[m2s_bench_random() % 64],
+				end_nodes[m2s_bench_random() % 64]);
+		m2s_bench_sink += entry->cost;
+	}
+
+	*end = m2s_bench_now();
+	net_free(net);
+}
+
+
+static struct m2s_bench_micro_t m2s_bench_micro_list[] =
+{
+	{ "micro.heap", "Insertion and extraction in 'heap_t'",
+		m2s_bench_micro_heap, 4000000 },
+	{ "micro.esim", "Event scheduling and processing in 'esim'",
+		m2s_bench_micro_esim, 4000000 },
+	{ "micro.mem_access", "Functional memory reads and writes",
+		m2s_bench_micro_mem_access, 8000000 },
+	{ "micro.cache_find_block", "Tag lookups in a 16-way cache",
+		m2s_bench_micro_cache_find_block, 16000000 },
+	{ "micro.x86_inst_decode", "x86 instruction decoding",
+		m2s_bench_micro_x86_inst_decode, 8000000 },
+	{ "micro.si_inst_decode", "Southern Islands instruction decoding",
+		m2s_bench_micro_si_inst_decode, 16000000 },
+	{ "micro.net_routing_lookup", "Routing table lookups in an 8x8 mesh",
+		m2s_bench_micro_net_routing_lookup, 16000000 },
+	{ 0 }
+};
+
+
+static void m2s_bench_micro_run(struct m2s_bench_micro_t *micro)
+{
+	long long ops;
+	double best;
+	double start;
+	double end;
+	int i;
+
+	/* Run 'repeat' times, keeping the fastest execution */
+	ops = micro->ops * m2s_bench_scale;
+	best = 0;
+	for (i = 0; i < m2s_bench_repeat; i++)
+	{
+		m2s_bench_seed = 1;
+		micro->func(ops, &start, &end);
+		if (!i || end - start < best)
+			best = end - start;
+	}
+
+	/* Results */
+	config_write_llint(m2s_bench_results, micro->name, "Ops", ops);
+	config_write_double(m2s_bench_results, micro->name, "Time", best);
+	config_write_double(m2s_bench_results, micro->name, "NsPerOp",
+			best * 1.0e9 / ops);
+	fprintf(stderr, "%-40s %12.2f ns/op\n", micro->name, best * 1.0e9 / ops);
+}
+
+
+
+
+/*
+ * End-to-end runs
+ */
+
+/* Arguments passed to 'm2s'. Arguments starting with '@' are paths relative
+ * to the 'samples' directory, and '%' is replaced by the Southern Islands
+ * host program. */
+#define M2S_BENCH_MAX_ARGS  16
+
+struct m2s_bench_run_t
+{
+	char *name;
+	char *args[M2S_BENCH_MAX_ARGS];
+};
+
+static struct m2s_bench_run_t m2s_bench_run_list[] =
+{
+	{ "run.x86.test-sort.functional",
+		{ "@x86/test-sort" } },
+	{ "run.x86.test-sort.detailed",
+		{ "--x86-sim", "detailed", "@x86/test-sort" } },
+	{ "run.memory.example-1",
+		{ "--x86-sim", "detailed",
+		"--x86-config", "@memory/example-1/x86-config",
+		"--mem-config", "@memory/example-1/mem-config",
+		"@x86/test-sort" } },
+	{ "run.memory.example-3",
+		{ "--x86-sim", "detailed",
+		"--x86-config", "@memory/example-3/x86-config",
+		"--mem-config", "@memory/example-3/mem-config",
+		"--net-config", "@memory/example-3/net-config",
+		"@x86/test-sort" } },
+	{ "run.network.example-1",
+		{ "--net-sim", "si-net-l1-l2",
+		"--net-config", "@network/example-1/net-si",
+		"--net-max-cycles", "100000", "--net-injection-rate", "0.05" } },
+	{ "run.network.example-3",
+		{ "--net-sim", "mynet",
+		"--net-config", "@network/example-3/net-bus",
+		"--net-max-cycles", "100000", "--net-injection-rate", "0.05" } },
+	{ "run.network.example-4",
+		{ "--net-sim", "net0",
+		"--net-config", "@network/example-4/net-mesh",
+		"--net-max-cycles", "100000", "--net-injection-rate", "0.05" } },
+	{ "run.si.7970.functional",
+		{ "%" } },
+	{ "run.si.7970.detailed",
+		{ "--si-sim", "detailed",
+		"--si-config", "@southern-islands/7970/si-config",
+		"--mem-config", "@southern-islands/7970/mem-config",
+		"%" } },
+	{ 0 }
+};
+
+
+/* Read the statistics summary dumped by 'm2s' into 'file_name'. The number
+ * of instructions is summed over all architecture sections, and the number
+ * of cycles is taken from section '[ General ]', or from the network section
+ * in stand-alone network simulations. */
+static void m2s_bench_run_read_summary(char *file_name,
+		long long *instructions_ptr, long long *cycles_ptr)
+{
+	char line[MAX_LONG_STRING_SIZE];
+	char section[MAX_STRING_SIZE];
+	char var[MAX_STRING_SIZE];
+	long long value;
+	FILE *f;
+
+	*instructions_ptr = 0;
+	*cycles_ptr = 0;
+	section[0] = '\0';
+	f = fopen(file_name, "r");
+	if (!f)
+		return;
+
+	while (fgets(line, sizeof line, f))
+	{
+		if (sscanf(line, "[ %s ]", section) == 1)
+			continue;
+		if (sscanf(line, "%s = %lld", var, &value) != 2)
+			continue;
+
+		if (!strcmp(var, "Instructions") && strcmp(section, "General"))
+			*instructions_ptr += value;
+		else if (!strcmp(var, "Cycles") && (!strcmp(section, "General") ||
+				str_prefix(section, "Network.")))
+			*cycles_ptr = value;
+	}
+
+	fclose(f);
+}
+
+
+static void m2s_bench_run_run(struct m2s_bench_run_t *run)
+{
+	char *argv[M2S_BENCH_MAX_ARGS + 2];
+	char summary_file_name[MAX_PATH_SIZE];
+	char path[MAX_PATH_SIZE];
+	char *arg;
+
+	struct rusage rusage;
+	long long instructions;
+	long long cycles;
+	double start;
+	double time;
+
+	int status;
+	pid_t pid;
+	int fd;
+	int i;
+
+	/* Build command line */
+	argv[0] = m2s_bench_m2s_path;
+	for (i = 0; (arg = run->args[i]); i++)
+	{
+		if (*arg == '%')
+		{
+			if (!*m2s_bench_si_program)
+			{
+				fprintf(stderr, "%-40s %12s\n", run->name, "skipped");
+				return;
+			}
+			arg = m2s_bench_si_program;
+		}
+		else if (*arg == '@')
+		{
+			snprintf(path, sizeof path, "%s/%s",
+					m2s_bench_samples_path, arg + 1);
+			arg = xstrdup(path);
+		}
+		argv[i + 1] = arg;
+	}
+	argv[i + 1] = NULL;
+
+	/* Summary is dumped by 'm2s' to its standard error output */
+	snprintf(summary_file_name, sizeof summary_file_name,
+			"/tmp/m2s-bench-XXXXXX");
+	fd = mkstemp(summary_file_name);
+	if (fd < 0)
+		fatal("%s: cannot create temporary file", __FUNCTION__);
+
+	/* Run */
+	start = m2s_bench_now();
+	pid = fork();
+	if (pid < 0)
+		fatal("%s: cannot fork", __FUNCTION__);
+	if (!pid)
+	{
+		dup2(fd, 2);
+		close(fd);
+		fd = open("/dev/null", O_WRONLY);
+		if (fd >= 0)
+			dup2(fd, 1);
+		execv(argv[0], argv);
+		_exit(127);
+	}
+	close(fd);
+	if (wait4(pid, &status, 0, &rusage) < 0)
+		fatal("%s: cannot wait for child process", __FUNCTION__);
+	time = m2s_bench_now() - start;
+
+	/* Free paths */
+	for (i = 0; (arg = run->args[i]); i++)
+		if (*arg == '@')
+			free(argv[i + 1]);
+
+	/* Failed */
+	if (!WIFEXITED(status) || WEXITSTATUS(status))
+		fatal("%s: 'm2s' failed, see output in %s",
+				run->name, summary_file_name);
+
+	/* Results */
+	m2s_bench_run_read_summary(summary_file_name, &instructions, &cycles);
+	unlink(summary_file_name);
+	config_write_double(m2s_bench_results, run->name, "RealTime", time);
+	config_write_llint(m2s_bench_results, run->name, "Instructions",
+			instructions);
+	config_write_double(m2s_bench_results, run->name, "KIPS",
+			instructions / time / 1000.0);
+	config_write_llint(m2s_bench_results, run->name, "Cycles", cycles);
+	config_write_double(m2s_bench_results, run->name, "CyclesPerSecond",
+			cycles / time);
+	config_write_llint(m2s_bench_results, run->name, "PeakRSS",
+			rusage.ru_maxrss);
+	fprintf(stderr, "%-40s %12.2f s %10.0f KIPS %12.0f cycles/s %8ld KB\n",
+			run->name, time, instructions / time / 1000.0,
+			cycles / time, rusage.ru_maxrss);
+}
+
+
+
+
+/*
+ * Comparison
+ */
+
+/* Metrics compared against the baseline. Field 'higher_is_better' gives the
+ * direction in which a metric improves. */
+struct m2s_bench_metric_t
+{
+	char *name;
+	int higher_is_better;
+};
+
+static struct m2s_bench_metric_t m2s_bench_metric_list[] =
+{
+	{ "NsPerOp", 0 },
+	{ "KIPS", 1 },
+	{ "CyclesPerSecond", 1 },
+	{ "PeakRSS", 0 },
+	{ 0 }
+};
+
+
+/* Return the number of regressions */
+static int m2s_bench_compare(void)
+{
+	struct config_t *baseline;
+	struct m2s_bench_metric_t *metric;
+
+	char *section;
+	double old_value;
+	double new_value;
+	double change;
+
+	int regression;
+	int num_regressions;
+
+	/* Load baseline */
+	baseline = config_create(m2s_bench_compare_file_name);
+	config_load(baseline);
+
+	/* Header */
+	fprintf(stderr, "\nComparison with baseline '%s' (threshold %.1f%%)\n\n",
+			m2s_bench_compare_file_name, m2s_bench_threshold);
+	fprintf(stderr, "%-40s %-16s %14s %14s %9s\n", "Benchmark", "Metric",
+			"Baseline", "Current", "Change");
+
+	/* Metrics present in both files */
+	num_regressions = 0;
+	for (section = config_section_first(m2s_bench_results); section;
+			section = config_section_next(m2s_bench_results))
+	{
+		for (metric = m2s_bench_metric_list; metric->name; metric++)
+		{
+			old_value = config_read_double(baseline, section,
+					metric->name, 0);
+			new_value = config_read_double(m2s_bench_results, section,
+					metric->name, 0);
+			if (old_value <= 0 || new_value <= 0)
+				continue;
+
+			/* Change in percent, and whether it is a regression */
+			change = (new_value - old_value) * 100.0 / old_value;
+			regression = metric->higher_is_better ?
+					-change > m2s_bench_threshold :
+					change > m2s_bench_threshold;
+			fprintf(stderr, "%-40s %-16s %14.2f %14.2f %+8.1f%%%s\n",
+					section, metric->name, old_value, new_value,
+					change, regression ? "  REGRESSION" : "");
+			if (regression)
+				num_regressions++;
+		}
+	}
+
+	/* Summary */
+	fprintf(stderr, "\n%d regression(s) found\n", num_regressions);
+	config_free(baseline);
+	return num_regressions;
+}
+
+
+
+
+/*
+ * Main program
+ */
+
+static void m2s_bench_need_argument(int argc, char **argv, int argi)
+{
+	if (argi == argc - 1)
+		fatal("option %s requires one argument.\n%s",
+				argv[argi], m2s_bench_err_note);
+}
+
+
+static void m2s_bench_read_command_line(int argc, char **argv)
+{
+	int argi;
+
+	m2s_bench_filter = xcalloc(argc, sizeof(char *));
+	for (argi = 1; argi < argc; argi++)
+	{
+		/* Baseline */
+		if (!strcmp(argv[argi], "--compare"))
+		{
+			m2s_bench_need_argument(argc, argv, argi);
+			m2s_bench_compare_file_name = argv[++argi];
+			continue;
+		}
+
+		/* Help */
+		if (!strcmp(argv[argi], "--help") || !strcmp(argv[argi], "-h"))
+		{
+			fprintf(stderr, "%s", m2s_bench_help);
+			exit(0);
+		}
+
+		/* List benchmarks */
+		if (!strcmp(argv[argi], "--list"))
+		{
+			m2s_bench_list = 1;
+			continue;
+		}
+
+		/* Simulator binary */
+		if (!strcmp(argv[argi], "--m2s"))
+		{
+			m2s_bench_need_argument(argc, argv, argi);
+			m2s_bench_m2s_path = argv[++argi];
+			continue;
+		}
+
+		/* Output file */
+		if (!strcmp(argv[argi], "--output"))
+		{
+			m2s_bench_need_argument(argc, argv, argi);
+			m2s_bench_output_file_name = argv[++argi];
+			continue;
+		}
+
+		/* Repetitions */
+		if (!strcmp(argv[argi], "--repeat"))
+		{
+			m2s_bench_need_argument(argc, argv, argi);
+			m2s_bench_repeat = atoi(argv[++argi]);
+			if (m2s_bench_repeat < 1)
+				fatal("option --repeat: invalid value");
+			continue;
+		}
+
+		/* Samples directory */
+		if (!strcmp(argv[argi], "--samples"))
+		{
+			m2s_bench_need_argument(argc, argv, argi);
+			m2s_bench_samples_path = argv[++argi];
+			continue;
+		}
+
+		/* Scale */
+		if (!strcmp(argv[argi], "--scale"))
+		{
+			m2s_bench_need_argument(argc, argv, argi);
+			m2s_bench_scale = atoi(argv[++argi]);
+			if (m2s_bench_scale < 1)
+				fatal("option --scale: invalid value");
+			continue;
+		}
+
+		/* Southern Islands program */
+		if (!strcmp(argv[argi], "--si-program"))
+		{
+			m2s_bench_need_argument(argc, argv, argi);
+			m2s_bench_si_program = argv[++argi];
+			continue;
+		}
+
+		/* Regression threshold */
+		if (!strcmp(argv[argi], "--threshold"))
+		{
+			m2s_bench_need_argument(argc, argv, argi);
+			m2s_bench_threshold = atof(argv[++argi]);
+			continue;
+		}
+
+		/* Invalid option */
+		if (argv[argi][0] == '-')
+			fatal("'%s' is not a valid option.\n%s",
+					argv[argi], m2s_bench_err_note);
+
+		/* Benchmark prefix */
+		m2s_bench_filter[m2s_bench_filter_count++] = argv[argi];
+	}
+}
+
+
+int main(int argc, char **argv)
+{
+	struct m2s_bench_micro_t *micro;
+	struct m2s_bench_run_t *run;
+
+	int num_regressions;
+
+	/* Classes */
+	num_regressions = 0;
+	CLASS_REGISTER(Asm);
+	CLASS_REGISTER(X86Asm);
+
+	/* Read command line */
+	m2s_bench_read_command_line(argc, argv);
+
+	/* List benchmarks */
+	if (m2s_bench_list)
+	{
+		for (micro = m2s_bench_micro_list; micro->name; micro++)
+			printf("%-40s %s\n", micro->name, micro->desc);
+		for (run = m2s_bench_run_list; run->name; run++)
+			printf("%s\n", run->name);
+		goto end;
+	}
+
+	/* Initialize */
+	esim_init();
+	m2s_bench_esim_event = esim_register_event_with_name(m2s_bench_esim_handler,
+			esim_new_domain(1000), "bench");
+	m2s_bench_results = config_create(m2s_bench_output_file_name);
+
+	/* Microbenchmarks */
+	for (micro = m2s_bench_micro_list; micro->name; micro++)
+		if (m2s_bench_selected(micro->name))
+			m2s_bench_micro_run(micro);
+
+	/* End-to-end runs */
+	for (run = m2s_bench_run_list; run->name; run++)
+	{
+		if (!m2s_bench_selected(run->name))
+			continue;
+		if (!*m2s_bench_m2s_path || !*m2s_bench_samples_path)
+		{
+			fprintf(stderr, "%-40s %12s\n", run->name, "skipped");
+			continue;
+		}
+		m2s_bench_run_run(run);
+	}
+
+	/* Dump results */
+	if (*m2s_bench_output_file_name)
+		config_save(m2s_bench_results);
+
+	/* Compare with baseline */
+	if (*m2s_bench_compare_file_name)
+		num_regressions = m2s_bench_compare();
+
+	/* Finalize */
+	config_free(m2s_bench_results);
+	esim_done();
+
+end:
+	free(m2s_bench_filter);
+	mhandle_done();
+	return num_regressions ? 1 : 0;
+}
@@ -17,7 +17,10 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <errno.h>
 #include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include <arch/arm/emu/context.h>
 #include <arch/arm/emu/isa.h>
@@ -60,17 +63,24 @@
 #include <driver/opencl-old/evergreen/opencl.h>
 #include <driver/opengl/opengl.h>
 #include <lib/esim/esim.h>
+#include <lib/esim/interval.h>
+#include <lib/esim/profile.h>
 #include <lib/esim/trace.h>
 #include <lib/mhandle/mhandle.h>
+#include <lib/util/config.h>
 #include <lib/util/debug.h>
 #include <lib/util/file.h>
+#include <lib/util/list.h>
 #include <lib/util/misc.h>
 #include <lib/util/string.h>
+#include <mem-system/access-trace.h>
+#include <mem-system/cache-sweep.h>
 #include <mem-system/config.h>
 #include <mem-system/mem-system.h>
 #include <mem-system/mmu.h>
 #include <network/config.h>
 #include <network/net-system.h>
+#include <network/traffic.h>
 #include <dram/dram-system.h>
 #include <sys/time.h>
 #include <visual/common/visual.h>
@@ -143,6 +153,9 @@ static long long m2s_max_time;  /* Max. simulation time in seconds (0 = no limit
 static long long m2s_loop_iter;  /* Number of iterations in main simulation loop */
 static char m2s_sim_id[10];  /* Pseudo-unique simulation ID (5 alpha-numeric digits) */
 
+static char *m2s_fork_server_file_name = "";  /* Job list in fork-server mode */
+static int m2s_fork_server_jobs = 1;  /* Max. number of concurrent jobs */
+
 static volatile int m2s_signal_received;  /* Signal received by handler (0 = none */
 
 static X86Asm *x86_asm;
@@ -181,6 +194,52 @@ static char *m2s_help =
 		"      an executable file is open (CPU program of GPU kernel binary), detailed\n"
 		"      information about its symbols, sections, strings, etc. is dumped here.\n"
 		"\n"
+		"  --fork-server <file>\n"
+		"      Fork-server mode. The simulator is initialized once, reading all\n"
+		"      configuration files and loading programs, and then a child process is\n"
+		"      forked for every job listed in <file>. This INI file contains one section\n"
+		"      '[ Job <name> ]' per job, with the following optional variables, which\n"
+		"      default to the values given in the command line:\n"
+		"        FastForward = <inst>    x86 fast-forward length (detailed simulation)\n"
+		"        MaxInst = <inst>        Same as option '--x86-max-inst'\n"
+		"        MaxCycles = <cycles>    Same as option '--x86-max-cycles'\n"
+		"        MaxTime = <time>        Same as option '--max-time'\n"
+		"        X86DecodeWidth, X86DispatchWidth, X86IssueWidth, X86CommitWidth\n"
+		"                                Override x86 pipeline widths\n"
+		"        Output = <file>         Statistics summary (default '<name>.out')\n"
+		"        X86Report = <file>      Same as option '--x86-report'\n"
+		"        MemReport = <file>      Same as option '--mem-report'\n"
+		"        SIReport = <file>       Same as option '--si-report'\n"
+		"      Report files are only dumped if given in the job section. Jobs run in\n"
+		"      increasing order of fast-forward length. The server fast-forwards to\n"
+		"      the length of each job before forking it, so the common part of the\n"
+		"      fast-forward execution is only emulated once. Options producing trace\n"
+		"      or debug output, or reading or writing memory access traces, sweep,\n"
+		"      network, or DRAM reports, cannot be used in this mode.\n"
+		"\n"
+		"  --fork-server-jobs <num>\n"
+		"      Maximum number of jobs run concurrently in fork-server mode. Default\n"
+		"      is 1.\n"
+		"\n"
+		"  --host-profile\n"
+		"      Measure the host time spent in each event handler, architecture\n"
+		"      iteration, and timing pipeline stage of the simulator. At the end of the\n"
+		"      simulation, a table with the number of invocations, time, events per\n"
+		"      second, and nanoseconds per event is dumped after the statistics\n"
+		"      summary, sorted by time. Times are inclusive of nested calls.\n"
+		"\n"
+		"  --interval-report <file>\n"
+		"      Sample the statistics of x86 threads, Southern Islands compute units,\n"
+		"      memory modules, network links, and DRAM channels periodically, and dump\n"
+		"      them into <file> in CSV format. Each line contains the current cycle,\n"
+		"      followed by the increment of each counter over the last interval, or\n"
+		"      the current value for occupancies, such as in-flight accesses in a\n"
+		"      memory module (column 'MSHR').\n"
+		"\n"
+		"  --interval-report-cycles <num>\n"
+		"      Number of cycles between samples of the interval report, measured in\n"
+		"      the fastest frequency domain. Default is 10000.\n"
+		"\n"
 		"  --max-time <time>\n"
 		"      Maximum simulation time in seconds. The simulator will stop once this time\n"
 		"      is exceeded. A value of 0 (default) means no time limit.\n"
@@ -252,6 +311,21 @@ static char *m2s_help =
 		"      Display a help message describing the format of the x86 CPU context\n"
 		"      configuration file.\n"
 		"\n"
+		"  --x86-host-quantum <inst>\n"
+		"      Number of instructions that each context executes in a round of\n"
+		"      host-parallel execution (option '--x86-host-threads'). Longer quanta\n"
+		"      reduce synchronization among host threads, while shorter quanta\n"
+		"      interleave guest threads more finely. Default is 10000.\n"
+		"\n"
+		"  --x86-host-threads <num>\n"
+		"      Number of host threads used to emulate guest contexts in parallel during\n"
+		"      x86 functional simulation and fast-forwarding. Contexts run in rounds\n"
+		"      of '--x86-host-quantum' instructions, or until they reach a system call,\n"
+		"      which is executed serially afterwards. Locked instructions are emulated\n"
+		"      atomically. The interleaving of guest threads, and thus the result of\n"
+		"      racy guest programs, is not deterministic in this mode. Use 1 (default)\n"
+		"      for serial emulation.\n"
+		"\n"
 		"  --x86-last-inst <bytes>\n"
 		"      Stop simulation when the specified instruction is fetched. Can be used to\n"
 		"      trigger a checkpoint with option '--x86-save-checkpoint'. The instruction\n"
@@ -396,6 +470,14 @@ static char *m2s_help =
 		"      Display a help message describing the format of the Southern Islands GPU\n"
 		"      configuration file, passed with option '--si-config <file>'.\n"
 		"\n"
+		"  --si-host-threads <num>\n"
+		"      Number of host threads used to simulate compute units in parallel during\n"
+		"      Southern Islands detailed simulation. Compute units advance one cycle at a\n"
+		"      time, and their memory accesses are issued afterwards in the same order as\n"
+		"      in serial simulation, so timing results do not change. The serial loop is\n"
+		"      kept while tracing, debugging the ISA, or dumping spatial or profiling\n"
+		"      reports. Use 1 (default) for serial simulation.\n"
+		"\n"
 		"  --si-max-cycles <cycles>\n"
 		"      Maximum number of cycles for the GPU detailed simulation. Use 0 (default)\n"
 		"      for no limit.\n"
@@ -496,6 +578,25 @@ static char *m2s_help =
 		"Memory System Options\n"
 		"================================================================================\n"
 		"\n"
+		"  --mem-access-replay <file>\n"
+		"      Drive the memory hierarchy with the accesses recorded in a trace\n"
+		"      generated with option '--mem-access-trace', instead of running CPU or GPU\n"
+		"      programs. Modules are matched by name in the memory configuration file.\n"
+		"      The configuration must enable the detailed simulation of the\n"
+		"      architectures whose entries it defines, for example with\n"
+		"      '--x86-sim detailed'.\n"
+		"\n"
+		"  --mem-access-replay-limit <num>\n"
+		"      Maximum number of in-flight accesses for each module accessed in a\n"
+		"      replayed trace. Accesses over the limit are delayed until a previous\n"
+		"      one completes. A value of 0 (default) issues every access at its\n"
+		"      recorded cycle.\n"
+		"\n"
+		"  --mem-access-trace <file>\n"
+		"      Record every access issued by the CPU/GPU timing models into the memory\n"
+		"      hierarchy in a compact binary file, which can be replayed with option\n"
+		"      '--mem-access-replay'.\n"
+		"\n"
 		"  --mem-config <file>\n"
 		"      Configuration file for memory hierarchy. Run 'm2s --mem-help' for a\n"
 		"      description of the file format.\n"
@@ -513,6 +614,20 @@ static char *m2s_help =
 		"      evictions, etc. This option must be used together with detailed simulation\n"
 		"      of any CPU/GPU architecture.\n"
 		"\n"
+		"  --mem-sweep <file>\n"
+		"      Evaluate a family of LRU cache configurations in a single pass over the\n"
+		"      data accesses of the guest programs, with either functional or detailed\n"
+		"      simulation. Run 'm2s --mem-sweep-help' for a description of the file\n"
+		"      format.\n"
+		"\n"
+		"  --mem-sweep-help\n"
+		"      Print help message describing the format of the cache sweep\n"
+		"      configuration file, passed with option '--mem-sweep <file>'.\n"
+		"\n"
+		"  --mem-sweep-report <file>\n"
+		"      File for a report on the hits and misses of each configuration\n"
+		"      evaluated with option '--mem-sweep'.\n"
+		"\n"
 		"\n"
 		"================================================================================\n"
 		"Network Options\n"
@@ -531,6 +646,15 @@ static char *m2s_help =
 		"      Print help message describing the network configuration file, passed to\n"
 		"      the simulator with option '--net-config <file>'.\n"
 		"\n"
+		"  --net-hotspot-fraction <fraction>\n"
+		"      For network simulation with traffic pattern 'hotspot', fraction of the\n"
+		"      messages sent to the hot spot node (default 0.2). The rest are sent to\n"
+		"      random destinations.\n"
+		"\n"
+		"  --net-hotspot-node <node>\n"
+		"      For network simulation with traffic pattern 'hotspot', end node receiving\n"
+		"      the additional traffic. Default is the first end node of the network.\n"
+		"\n"
 		"  --net-injection-rate <rate>\n"
 		"      For network simulation, packet injection rate for nodes (e.g. 0.01 means\n"
 		"      one packet every 100 cycles on average. Nodes will inject packets into\n"
@@ -561,6 +685,37 @@ static char *m2s_help =
 		"      Runs a network simulation using synthetic traffic, where <network> is the\n"
 		"      name of a network specified in the network configuration file (option\n"
 		"      '--net-config').\n"
+		"\n"
+		"  --net-sweep <file>\n"
+		"      For network simulation, run the traffic pattern at several injection\n"
+		"      rates evenly distributed up to the rate given in '--net-injection-rate',\n"
+		"      and dump the offered load, accepted load, and average latency of each\n"
+		"      one into <file> in CSV format. Each rate is simulated for the number of\n"
+		"      cycles given in '--net-max-cycles', after which the network is drained.\n"
+		"\n"
+		"  --net-sweep-points <num>\n"
+		"      Number of injection rates simulated with option '--net-sweep' (default\n"
+		"      10).\n"
+		"\n"
+		"  --net-traffic-pattern <pattern>\n"
+		"      Traffic pattern for network simulation. End nodes are numbered in the\n"
+		"      order they appear in the network configuration file. Possible values are:\n"
+		"        uniform - Random destinations (default).\n"
+		"        transpose - End nodes form a square; node at row R and column C\n"
+		"            sends to node at row C and column R.\n"
+		"        bitcomp - Node i sends to node N-1-i, for N end nodes.\n"
+		"        hotspot - Uniform traffic, plus a fraction of the messages sent\n"
+		"            to one node (see '--net-hotspot-node').\n"
+		"        neighbor - Node i sends to node i+1.\n"
+		"        trace - Messages read from a file (see '--net-traffic-trace').\n"
+		"        command - Messages given in the 'Commands' section of the network\n"
+		"            configuration file.\n"
+		"\n"
+		"  --net-traffic-trace <file>\n"
+		"      Text file with the messages injected with traffic pattern 'trace'. Each\n"
+		"      line contains the injection cycle, the source and destination end nodes,\n"
+		"      and optionally the message size (default given by '--net-msg-size').\n"
+		"      Lines must be sorted by cycle. Lines starting with '#' are ignored.\n"
 		"\n";
 
 
@@ -629,6 +784,53 @@ static void m2s_read_command_line(int *argc_ptr, char **argv)
 			continue;
 		}
 
+		/* Fork-server mode */
+		if (!strcmp(argv[argi], "--fork-server"))
+		{
+			m2s_need_argument(argc, argv, argi);
+			m2s_fork_server_file_name = argv[++argi];
+			continue;
+		}
+
+		/* Concurrent jobs in fork-server mode */
+		if (!strcmp(argv[argi], "--fork-server-jobs"))
+		{
+			m2s_need_argument(argc, argv, argi);
+			m2s_fork_server_jobs = str_to_int(argv[argi + 1], &err);
+			if (err || m2s_fork_server_jobs < 1)
+				fatal("option %s, value '%s': invalid number of jobs",
+						argv[argi], argv[argi + 1]);
+			argi++;
+			continue;
+		}
+
+		/* Host-throughput profiler */
+		if (!strcmp(argv[argi], "--host-profile"))
+		{
+			esim_profile_active = 1;
+			continue;
+		}
+
+		/* Interval statistics */
+		if (!strcmp(argv[argi], "--interval-report"))
+		{
+			m2s_need_argument(argc, argv, argi);
+			esim_interval_report_file_name = argv[++argi];
+			continue;
+		}
+
+		/* Cycles per interval */
+		if (!strcmp(argv[argi], "--interval-report-cycles"))
+		{
+			m2s_need_argument(argc, argv, argi);
+			esim_interval_report_cycles = str_to_llint(argv[argi + 1], &err);
+			if (err || esim_interval_report_cycles < 1)
+				fatal("option %s, value '%s': invalid number of cycles",
+						argv[argi], argv[argi + 1]);
+			argi++;
+			continue;
+		}
+
 		/* Simulation time limit */
 		if (!strcmp(argv[argi], "--max-time"))
 		{
@@ -781,6 +983,30 @@ static void m2s_read_command_line(int *argc_ptr, char **argv)
 			continue;
 		}
 
+		/* Instructions per context in parallel round */
+		if (!strcmp(argv[argi], "--x86-host-quantum"))
+		{
+			m2s_need_argument(argc, argv, argi);
+			x86_emu_host_quantum = str_to_llint(argv[argi + 1], &err);
+			if (err || x86_emu_host_quantum < 1)
+				fatal("option %s, value '%s': invalid number of instructions",
+						argv[argi], argv[argi + 1]);
+			argi++;
+			continue;
+		}
+
+		/* Host threads for parallel emulation */
+		if (!strcmp(argv[argi], "--x86-host-threads"))
+		{
+			m2s_need_argument(argc, argv, argi);
+			x86_emu_host_threads = str_to_int(argv[argi + 1], &err);
+			if (err || x86_emu_host_threads < 1)
+				fatal("option %s, value '%s': invalid number of threads",
+						argv[argi], argv[argi + 1]);
+			argi++;
+			continue;
+		}
+
 		/* Last x86 instruction */
 		if (!strcmp(argv[argi], "--x86-last-inst"))
 		{
@@ -1011,6 +1237,18 @@ static void m2s_read_command_line(int *argc_ptr, char **argv)
 			continue;
 		}
 
+		/* Host threads for parallel simulation of compute units */
+		if (!strcmp(argv[argi], "--si-host-threads"))
+		{
+			m2s_need_argument(argc, argv, argi);
+			si_gpu_host_threads = str_to_int(argv[argi + 1], &err);
+			if (err || si_gpu_host_threads < 1)
+				fatal("option %s, value '%s': invalid number of threads",
+						argv[argi], argv[argi + 1]);
+			argi++;
+			continue;
+		}
+
 		/* Southern Islands GPU occupancy calculation plots */
 		if (!strcmp(argv[argi], "--si-calc"))
 		{
@@ -1316,6 +1554,34 @@ static void m2s_read_command_line(int *argc_ptr, char **argv)
 		 * Memory System Options
 		 */
 
+		/* Trace-driven memory hierarchy simulation */
+		if (!strcmp(argv[argi], "--mem-access-replay"))
+		{
+			m2s_need_argument(argc, argv, argi);
+			access_trace_replay_file_name = argv[++argi];
+			continue;
+		}
+
+		/* In-flight accesses per module in trace-driven simulation */
+		if (!strcmp(argv[argi], "--mem-access-replay-limit"))
+		{
+			m2s_need_argument(argc, argv, argi);
+			access_trace_replay_limit = str_to_int(argv[argi + 1], &err);
+			if (err)
+				fatal("option %s, value '%s': %s", argv[argi],
+						argv[argi + 1], str_error(err));
+			argi++;
+			continue;
+		}
+
+		/* Memory access trace */
+		if (!strcmp(argv[argi], "--mem-access-trace"))
+		{
+			m2s_need_argument(argc, argv, argi);
+			access_trace_capture_file_name = argv[++argi];
+			continue;
+		}
+
 		/* Memory hierarchy configuration file */
 		if (!strcmp(argv[argi], "--mem-config"))
 		{
@@ -1356,6 +1622,29 @@ static void m2s_read_command_line(int *argc_ptr, char **argv)
 			continue;
 		}
 
+		/* Cache sweep configuration file */
+		if (!strcmp(argv[argi], "--mem-sweep"))
+		{
+			m2s_need_argument(argc, argv, argi);
+			cache_sweep_config_file_name = argv[++argi];
+			continue;
+		}
+
+		/* Help for cache sweep configuration file */
+		if (!strcmp(argv[argi], "--mem-sweep-help"))
+		{
+			fprintf(stderr, "%s", cache_sweep_config_help);
+			continue;
+		}
+
+		/* Cache sweep report */
+		if (!strcmp(argv[argi], "--mem-sweep-report"))
+		{
+			m2s_need_argument(argc, argv, argi);
+			cache_sweep_report_file_name = argv[++argi];
+			continue;
+		}
+
 
 		/*
 		 * Network Options
@@ -1411,6 +1700,56 @@ static void m2s_read_command_line(int *argc_ptr, char **argv)
 			continue;
 		}
 
+		/* Traffic trace */
+		if (!strcmp(argv[argi], "--net-traffic-trace"))
+		{
+			m2s_need_argument(argc, argv, argi);
+			net_sim_last_option = argv[argi];
+			net_traffic_trace_file_name = argv[++argi];
+			continue;
+		}
+
+		/* Hot spot for traffic pattern */
+		if (!strcmp(argv[argi], "--net-hotspot-node"))
+		{
+			m2s_need_argument(argc, argv, argi);
+			net_sim_last_option = argv[argi];
+			net_traffic_hotspot_name = argv[++argi];
+			continue;
+		}
+
+		/* Fraction of traffic sent to hot spot */
+		if (!strcmp(argv[argi], "--net-hotspot-fraction"))
+		{
+			m2s_need_argument(argc, argv, argi);
+			net_sim_last_option = argv[argi];
+			argi++;
+			net_traffic_hotspot_fraction = atof(argv[argi]);
+			continue;
+		}
+
+		/* Sweep of injection rates */
+		if (!strcmp(argv[argi], "--net-sweep"))
+		{
+			m2s_need_argument(argc, argv, argi);
+			net_sim_last_option = argv[argi];
+			net_sweep_file_name = argv[++argi];
+			continue;
+		}
+
+		/* Number of injection rates in sweep */
+		if (!strcmp(argv[argi], "--net-sweep-points"))
+		{
+			m2s_need_argument(argc, argv, argi);
+			net_sim_last_option = argv[argi];
+			net_sweep_points = str_to_int(argv[argi + 1], &err);
+			if (err)
+				fatal("option %s, value '%s': %s", argv[argi],
+						argv[argi + 1], str_error(err));
+			argi++;
+			continue;
+		}
+
 		/* Network Snapshot */
 		if (!strcmp(argv[argi], "--net-snapshot"))
 		{
@@ -1903,6 +2242,11 @@ static void m2s_loop(void)
 		 * architectures running an active timing simulation. */
 		arch_run(&num_emu_active, &num_timing_active);
 
+		/* A replayed memory access trace keeps the event-driven simulation
+		 * going until all its accesses completed. */
+		if (access_trace_replay_pending())
+			num_timing_active++;
+
 		/* Event-driven simulation. Only process events and advance to next global
 		 * simulation cycle if any architecture performed a useful timing simulation.
 		 * The argument 'num_timing_active' is interpreted as a flag TRUE/FALSE. */
@@ -1933,6 +2277,309 @@ static void m2s_loop(void)
 }
 
 
+/*
+ * Fork-server mode
+ */
+
+struct m2s_job_t
+{
+	char *name;
+	pid_t pid;
+
+	/* Files */
+	char *output;
+	char *x86_report;
+	char *mem_report;
+	char *si_report;
+
+	/* Limits */
+	long long fast_forward;
+	long long max_inst;
+	long long max_cycles;
+	long long max_time;
+
+	/* x86 pipeline widths */
+	int x86_decode_width;
+	int x86_dispatch_width;
+	int x86_issue_width;
+	int x86_commit_width;
+};
+
+
+static struct m2s_job_t *m2s_job_create(struct config_t *config, char *section)
+{
+	struct m2s_job_t *job;
+	char name[MAX_STRING_SIZE];
+	char output[MAX_PATH_SIZE];
+
+	/* Name */
+	str_token(name, sizeof name, section, 1, " ");
+	if (!*name)
+		fatal("%s: section '[ %s ]': job name expected",
+				m2s_fork_server_file_name, section);
+	snprintf(output, sizeof output, "%s.out", name);
+
+	/* Initialize */
+	job = xcalloc(1, sizeof(struct m2s_job_t));
+	job->name = xstrdup(name);
+	job->output = xstrdup(config_read_string(config, section, "Output", output));
+	job->x86_report = xstrdup(config_read_string(config, section, "X86Report", ""));
+	job->mem_report = xstrdup(config_read_string(config, section, "MemReport", ""));
+	job->si_report = xstrdup(config_read_string(config, section, "SIReport", ""));
+	job->fast_forward = config_read_llint(config, section, "FastForward",
+			x86_cpu_fast_forward_count);
+	job->max_inst = config_read_llint(config, section, "MaxInst", x86_emu_max_inst);
+	job->max_cycles = config_read_llint(config, section, "MaxCycles", x86_emu_max_cycles);
+	job->max_time = config_read_llint(config, section, "MaxTime", m2s_max_time);
+	job->x86_decode_width = config_read_int(config, section, "X86DecodeWidth",
+			x86_cpu_decode_width);
+	job->x86_dispatch_width = config_read_int(config, section, "X86DispatchWidth",
+			x86_cpu_dispatch_width);
+	job->x86_issue_width = config_read_int(config, section, "X86IssueWidth",
+			x86_cpu_issue_width);
+	job->x86_commit_width = config_read_int(config, section, "X86CommitWidth",
+			x86_cpu_commit_width);
+
+	/* Check */
+	if (job->fast_forward < 0 || job->max_inst < 0 || job->max_cycles < 0 ||
+			job->max_time < 0)
+		fatal("%s: job '%s': invalid negative limit",
+				m2s_fork_server_file_name, name);
+	if (job->fast_forward && !x86_cpu)
+		fatal("%s: job '%s': fast-forward requires x86 detailed simulation",
+				m2s_fork_server_file_name, name);
+	if (x86_cpu && (job->x86_decode_width < 1 || job->x86_dispatch_width < 1 ||
+			job->x86_issue_width < 1 || job->x86_commit_width < 1))
+		fatal("%s: job '%s': invalid x86 pipeline width",
+				m2s_fork_server_file_name, name);
+
+	/* Return */
+	return job;
+}
+
+
+static void m2s_job_free(struct m2s_job_t *job)
+{
+	free(job->name);
+	free(job->output);
+	free(job->x86_report);
+	free(job->mem_report);
+	free(job->si_report);
+	free(job);
+}
+
+
+static int m2s_job_compare(const void *ptr1, const void *ptr2)
+{
+	const struct m2s_job_t *job1 = ptr1;
+	const struct m2s_job_t *job2 = ptr2;
+
+	if (job1->fast_forward != job2->fast_forward)
+		return job1->fast_forward < job2->fast_forward ? -1 : 1;
+	return 0;
+}
+
+
+/* Apply the configuration of a job in its child process. Only parameters that
+ * do not affect the state built during initialization can be changed. */
+static void m2s_job_apply(struct m2s_job_t *job)
+{
+	/* Statistics summary */
+	if (!freopen(job->output, "w", stderr))
+		exit(1);
+
+	/* Execution time is measured from the fork, so that the time spent
+	 * by the server does not count for the job's speed or time limit. */
+	esim_real_time_reset();
+	arch_reset_timers();
+
+	/* Limits */
+	x86_emu_max_inst = job->max_inst;
+	x86_emu_max_cycles = job->max_cycles;
+	m2s_max_time = job->max_time;
+
+	/* Reports */
+	x86_cpu_report_file_name = job->x86_report;
+	mem_report_file_name = job->mem_report;
+	si_gpu_report_file_name = job->si_report;
+
+	/* x86 pipeline */
+	if (x86_cpu)
+	{
+		x86_cpu_fast_forward_count = job->fast_forward;
+		x86_cpu_decode_width = job->x86_decode_width;
+		x86_cpu_dispatch_width = job->x86_dispatch_width;
+		x86_cpu_issue_width = job->x86_issue_width;
+		x86_cpu_commit_width = job->x86_commit_width;
+	}
+}
+
+
+/* Wait for one job to finish. Return 0 if it failed. */
+static int m2s_job_wait(struct list_t *job_list)
+{
+	struct m2s_job_t *job;
+	pid_t pid;
+	int status;
+	int index;
+
+	/* Wait for any child */
+	do
+		pid = wait(&status);
+	while (pid < 0 && errno == EINTR);
+	if (pid < 0)
+		fatal("%s: error waiting for jobs", __FUNCTION__);
+
+	/* Find job */
+	job = NULL;
+	LIST_FOR_EACH(job_list, index)
+	{
+		job = list_get(job_list, index);
+		if (job->pid == pid)
+			break;
+		job = NULL;
+	}
+	if (!job)
+		return 1;
+
+	/* Report */
+	if (WIFEXITED(status) && !WEXITSTATUS(status))
+	{
+		fprintf(stderr, "Fork server: job '%s' finished\n", job->name);
+		return 1;
+	}
+	if (WIFSIGNALED(status))
+		fprintf(stderr, "Fork server: job '%s' killed by signal %d\n",
+				job->name, WTERMSIG(status));
+	else
+		fprintf(stderr, "Fork server: job '%s' failed with exit code %d\n",
+				job->name, WEXITSTATUS(status));
+	return 0;
+}
+
+
+/* Run the jobs in the file given in option '--fork-server'. All configuration
+ * files have been read and programs loaded at this point. The function only
+ * returns in the child process forked for each job, after applying its
+ * configuration, so that it continues with the simulation. The server process
+ * exits once all jobs finished. */
+static void m2s_fork_server(void)
+{
+	struct config_t *config;
+	struct list_t *job_list;
+	struct m2s_job_t *job;
+	char *section;
+
+	int running;
+	int failed;
+	int index;
+	pid_t pid;
+
+	/* Incompatible options. Files opened before forking would be shared by
+	 * all jobs, and output files would be overwritten by each of them. */
+	if (esim_interval_active)
+		fatal("options '--fork-server' and '--interval-report' are incompatible");
+	if (*trace_file_name)
+		fatal("options '--fork-server' and '--trace' are incompatible");
+	if (debug_category_count())
+		fatal("option '--fork-server' is incompatible with debug options");
+	if (*access_trace_capture_file_name)
+		fatal("options '--fork-server' and '--mem-access-trace' are incompatible");
+	if (*access_trace_replay_file_name)
+		fatal("options '--fork-server' and '--mem-access-replay' are incompatible");
+	if (*cache_sweep_report_file_name)
+		fatal("options '--fork-server' and '--mem-sweep-report' are incompatible");
+	if (*net_report_file_name)
+		fatal("options '--fork-server' and '--net-report' are incompatible");
+	if (*dram_report_file_name)
+		fatal("options '--fork-server' and '--dram-report' are incompatible");
+
+	/* Read jobs */
+	if (!file_can_open_for_read(m2s_fork_server_file_name))
+		fatal("%s: cannot open job list", m2s_fork_server_file_name);
+	config = config_create(m2s_fork_server_file_name);
+	config_load(config);
+	job_list = list_create();
+	CONFIG_SECTION_FOR_EACH(config, section)
+	{
+		if (strncasecmp(section, "Job ", 4))
+			fatal("%s: invalid section '[ %s ]'",
+					m2s_fork_server_file_name, section);
+		list_add(job_list, m2s_job_create(config, section));
+	}
+	config_check(config);
+	config_free(config);
+	if (!list_count(job_list))
+		fatal("%s: no jobs found", m2s_fork_server_file_name);
+
+	/* Jobs with the shortest fast-forward execution first */
+	list_sort(job_list, m2s_job_compare);
+
+	/* Run jobs */
+	running = 0;
+	failed = 0;
+	LIST_FOR_EACH(job_list, index)
+	{
+		job = list_get(job_list, index);
+
+		/* Fast-forward up to the job's starting point. Running jobs were
+		 * forked earlier, so they are not affected. */
+		if (x86_cpu && job->fast_forward > asEmu(x86_emu)->instructions)
+		{
+			x86_cpu_fast_forward_count = job->fast_forward;
+			X86CpuFastForward(x86_cpu);
+		}
+
+		/* Wait for a free slot */
+		while (running >= m2s_fork_server_jobs)
+		{
+			failed += !m2s_job_wait(job_list);
+			running--;
+		}
+
+		/* Fork. Host threads do not survive in the child, so they are
+		 * stopped first, and buffered output is flushed so that it is
+		 * not duplicated. */
+		X86EmuStopHostThreads(x86_emu);
+		if (si_gpu)
+			SIGpuStopHostThreads(si_gpu);
+		fflush(stdout);
+		fflush(stderr);
+		pid = fork();
+		if (pid < 0)
+			fatal("%s: cannot fork job '%s'", __FUNCTION__, job->name);
+
+		/* Child continues with the simulation */
+		if (!pid)
+		{
+			m2s_job_apply(job);
+			return;
+		}
+
+		/* Server */
+		job->pid = pid;
+		running++;
+		fprintf(stderr, "Fork server: job '%s' started (pid %d, fast-forward %lld)\n",
+				job->name, (int) pid, job->fast_forward);
+	}
+
+	/* Wait for remaining jobs */
+	while (running)
+	{
+		failed += !m2s_job_wait(job_list);
+		running--;
+	}
+	fprintf(stderr, "Fork server: %d jobs finished, %d failed\n",
+			list_count(job_list), failed);
+
+	/* Free jobs and exit */
+	LIST_FOR_EACH(job_list, index)
+		m2s_job_free(list_get(job_list, index));
+	list_free(job_list);
+	exit(failed ? 1 : 0);
+}
+
+
 int main(int argc, char **argv)
 {
 	/* Global initialization and welcome message */
@@ -2125,6 +2772,8 @@ int main(int argc, char **argv)
 	net_init();
 	mem_system_init();
 	mmu_init();
+	cache_sweep_init();
+	access_trace_init();
 
 	/* Load architectural state checkpoint */
 	if (x86_load_checkpoint_file_name[0])
@@ -2133,6 +2782,10 @@ int main(int argc, char **argv)
 	/* Load programs */
 	m2s_load_programs(argc, argv);
 
+	/* Fork-server mode. Only returns in the child process of each job. */
+	if (*m2s_fork_server_file_name)
+		m2s_fork_server();
+
 	/* Multi2Sim Central Simulation Loop */
 	m2s_loop();
 
@@ -2146,8 +2799,12 @@ int main(int argc, char **argv)
 	if (esim_finish != esim_finish_stall)
 		esim_process_all_events();
 
+	/* Last interval of the interval report */
+	esim_interval_flush();
+
 	/* Dump statistics summary */
 	m2s_dump_summary(stderr);
+	esim_profile_dump(stderr);
 
 	/* x86 */
 	if (x86_cpu)
@@ -2162,6 +2819,8 @@ int main(int argc, char **argv)
 	runtime_done();
 
 	/* Finalization of network and memory system */
+	access_trace_done();
+	cache_sweep_done();
 	mmu_done();
 	mem_system_done();
 	net_done();
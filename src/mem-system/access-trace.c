@@ -0,0 +1,473 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <string.h>
+
+#include <lib/esim/esim.h>
+#include <lib/mhandle/mhandle.h>
+#include <lib/util/debug.h>
+#include <lib/util/linked-list.h>
+#include <lib/util/list.h>
+#include <lib/util/misc.h>
+
+#include "access-trace.h"
+#include "mem-system.h"
+#include "module.h"
+
+
+/*
+ * Trace file format
+ *
+ * The file starts with the 8-byte magic string below, followed by the number
+ * of modules of the memory configuration where the trace was captured, and
+ * their names. Each name is a 32-bit length followed by its characters. All
+ * integers are little-endian.
+ *
+ * Then comes one record per access, in issue order:
+ *   - One byte with the access kind (enum mod_access_kind_t). Bit 7 is set
+ *     if the client passed the PC of the accessing instruction.
+ *   - Index of the accessed module, as a variable-length integer.
+ *   - Cycles elapsed since the previous record in the memory frequency
+ *     domain, as a variable-length integer.
+ *   - 32-bit address.
+ *   - 32-bit PC, only if bit 7 of the first byte is set.
+ *
+ * Variable-length integers use 7 bits per byte, least significant group
+ * first, with bit 7 set in all bytes but the last.
+ */
+
+#define ACCESS_TRACE_MAGIC  "m2smtr01"
+#define ACCESS_TRACE_HAS_EIP  0x80
+
+
+/*
+ * Global Variables
+ */
+
+char *access_trace_capture_file_name = "";
+char *access_trace_replay_file_name = "";
+int access_trace_replay_limit;
+
+int access_trace_capture_active;
+
+int EV_ACCESS_TRACE_REPLAY;
+
+
+/* Access read from a trace, waiting to be issued */
+struct access_trace_record_t
+{
+	long long cycle;
+	enum mod_access_kind_t access_kind;
+	unsigned int addr;
+	int has_eip;
+	unsigned int eip;
+};
+
+/* Every module accessed in a trace acts as one client during replay. The
+ * limit on in-flight accesses given by 'access_trace_replay_limit' applies
+ * to each of them separately. */
+struct access_trace_client_t
+{
+	struct mod_t *mod;
+
+	/* Records ready to issue, in trace order */
+	struct linked_list_t *record_list;
+
+	/* Accesses issued, and accesses completed. The memory system returns
+	 * the client into 'event_queue' every time one of its accesses
+	 * finishes, the same way it notifies the x86 pipeline. */
+	long long issued;
+	long long completed;
+	struct linked_list_t *event_queue;
+};
+
+
+static FILE *access_trace_capture_file;
+static long long access_trace_capture_cycle;
+
+static FILE *access_trace_replay_file;
+static struct access_trace_client_t *access_trace_client;
+static int access_trace_num_clients;
+static long long access_trace_replay_cycle;
+static long long access_trace_replay_in_flight;
+
+/* Next record in the replay file, not yet assigned to a client */
+static struct access_trace_record_t access_trace_next_record;
+static int access_trace_next_client;
+static int access_trace_next_valid;
+
+
+
+
+/*
+ * Private Functions
+ */
+
+static void access_trace_write_u32(FILE *f, unsigned int value)
+{
+	putc(value & 0xff, f);
+	putc((value >> 8) & 0xff, f);
+	putc((value >> 16) & 0xff, f);
+	putc((value >> 24) & 0xff, f);
+}
+
+
+static void access_trace_write_varint(FILE *f, unsigned long long value)
+{
+	while (value >= 0x80)
+	{
+		putc((value & 0x7f) | 0x80, f);
+		value >>= 7;
+	}
+	putc(value, f);
+}
+
+
+/* Read a 32-bit integer. Return 0 on end of file. */
+static int access_trace_read_u32(FILE *f, unsigned int *value_ptr)
+{
+	unsigned char buf[4];
+
+	if (fread(buf, 1, 4, f) != 4)
+		return 0;
+	*value_ptr = buf[0] | buf[1] << 8 | buf[2] << 16 | (unsigned int) buf[3] << 24;
+	return 1;
+}
+
+
+/* Read a variable-length integer. Return 0 on end of file. */
+static int access_trace_read_varint(FILE *f, unsigned long long *value_ptr)
+{
+	unsigned long long value;
+	int shift;
+	int c;
+
+	value = 0;
+	for (shift = 0; shift < 64; shift += 7)
+	{
+		c = getc(f);
+		if (c == EOF)
+			return 0;
+		value |= (unsigned long long) (c & 0x7f) << shift;
+		if (!(c & 0x80))
+		{
+			*value_ptr = value;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+
+/* Read the next record of the replay file into 'access_trace_next_record' */
+static void access_trace_read_record(void)
+{
+	struct access_trace_record_t *record;
+
+	unsigned long long client = 0;
+	unsigned long long delta = 0;
+
+	int c;
+
+	/* End of trace */
+	record = &access_trace_next_record;
+	access_trace_next_valid = 0;
+	c = getc(access_trace_replay_file);
+	if (c == EOF)
+		return;
+
+	/* Fields */
+	record->access_kind = c & ~ACCESS_TRACE_HAS_EIP;
+	record->has_eip = (c & ACCESS_TRACE_HAS_EIP) != 0;
+	if (!access_trace_read_varint(access_trace_replay_file, &client) ||
+			!access_trace_read_varint(access_trace_replay_file, &delta) ||
+			!access_trace_read_u32(access_trace_replay_file, &record->addr) ||
+			(record->has_eip && !access_trace_read_u32(
+			access_trace_replay_file, &record->eip)))
+		fatal("%s: unexpected end of trace", access_trace_replay_file_name);
+	if (client >= access_trace_num_clients)
+		fatal("%s: invalid module index in trace", access_trace_replay_file_name);
+	if (record->access_kind < mod_access_load ||
+			record->access_kind > mod_access_prefetch)
+		fatal("%s: invalid access kind in trace", access_trace_replay_file_name);
+
+	/* Cycles are relative to the previous record */
+	access_trace_replay_cycle += delta;
+	record->cycle = access_trace_replay_cycle;
+	access_trace_next_client = client;
+	access_trace_next_valid = 1;
+}
+
+
+static void access_trace_capture_init(void)
+{
+	struct mod_t *mod;
+	int i;
+
+	/* Open file */
+	access_trace_capture_file = fopen(access_trace_capture_file_name, "wb");
+	if (!access_trace_capture_file)
+		fatal("%s: cannot open memory access trace for writing",
+			access_trace_capture_file_name);
+
+	/* Header with module names */
+	fwrite(ACCESS_TRACE_MAGIC, 1, 8, access_trace_capture_file);
+	access_trace_write_u32(access_trace_capture_file,
+		list_count(mem_system->mod_list));
+	LIST_FOR_EACH(mem_system->mod_list, i)
+	{
+		mod = list_get(mem_system->mod_list, i);
+		access_trace_write_u32(access_trace_capture_file, strlen(mod->name));
+		fwrite(mod->name, 1, strlen(mod->name), access_trace_capture_file);
+	}
+
+	/* Start */
+	access_trace_capture_active = 1;
+}
+
+
+static void access_trace_replay_init(void)
+{
+	struct access_trace_client_t *client;
+
+	char magic[8];
+	char *name;
+
+	unsigned int num_clients;
+	unsigned int length;
+
+	int i;
+
+	/* Open file */
+	access_trace_replay_file = fopen(access_trace_replay_file_name, "rb");
+	if (!access_trace_replay_file)
+		fatal("%s: cannot open memory access trace",
+			access_trace_replay_file_name);
+	if (fread(magic, 1, 8, access_trace_replay_file) != 8 ||
+			memcmp(magic, ACCESS_TRACE_MAGIC, 8))
+		fatal("%s: not a memory access trace", access_trace_replay_file_name);
+
+	/* Modules are matched by name in the current memory configuration */
+	if (!access_trace_read_u32(access_trace_replay_file, &num_clients))
+		fatal("%s: unexpected end of trace", access_trace_replay_file_name);
+	access_trace_num_clients = num_clients;
+	access_trace_client = xcalloc(num_clients,
+		sizeof(struct access_trace_client_t));
+	for (i = 0; i < num_clients; i++)
+	{
+		if (!access_trace_read_u32(access_trace_replay_file, &length) ||
+				length >= MAX_STRING_SIZE)
+			fatal("%s: invalid module name in trace",
+				access_trace_replay_file_name);
+		name = xcalloc(1, length + 1);
+		if (fread(name, 1, length, access_trace_replay_file) != length)
+			fatal("%s: unexpected end of trace",
+				access_trace_replay_file_name);
+
+		/* Modules that receive no accesses do not need to exist */
+		client = &access_trace_client[i];
+		client->mod = mem_system_get_mod(name);
+		client->record_list = linked_list_create();
+		client->event_queue = linked_list_create();
+		free(name);
+	}
+
+	/* Schedule first access */
+	EV_ACCESS_TRACE_REPLAY = esim_register_event_with_name(
+		access_trace_replay_handler, mem_domain_index,
+		"access_trace_replay");
+	access_trace_read_record();
+	if (access_trace_next_valid)
+		esim_schedule_event(EV_ACCESS_TRACE_REPLAY, NULL, 0);
+}
+
+
+
+
+/*
+ * Public Functions
+ */
+
+void access_trace_init(void)
+{
+	/* Check options */
+	if (access_trace_replay_limit < 0)
+		fatal("option '--mem-access-replay-limit': value must be 0 or greater");
+	if (access_trace_replay_limit && !*access_trace_replay_file_name)
+		fatal("option '--mem-access-replay-limit' requires '--mem-access-replay'");
+	if ((*access_trace_capture_file_name || *access_trace_replay_file_name) &&
+			!list_count(mem_system->mod_list))
+		fatal("memory access trace given, but no memory hierarchy is simulated.\n"
+			"\tOptions '--mem-access-trace' and '--mem-access-replay' need a\n"
+			"\tdetailed simulation with a memory configuration.\n");
+
+	/* Start capture and/or replay */
+	if (*access_trace_capture_file_name)
+		access_trace_capture_init();
+	if (*access_trace_replay_file_name)
+		access_trace_replay_init();
+}
+
+
+void access_trace_done(void)
+{
+	struct access_trace_client_t *client;
+	int i;
+
+	/* Close capture file */
+	if (access_trace_capture_file)
+	{
+		fclose(access_trace_capture_file);
+		access_trace_capture_file = NULL;
+		access_trace_capture_active = 0;
+	}
+
+	/* Close replay file */
+	if (access_trace_replay_file)
+	{
+		for (i = 0; i < access_trace_num_clients; i++)
+		{
+			client = &access_trace_client[i];
+			linked_list_head(client->record_list);
+			while (linked_list_count(client->record_list))
+			{
+				free(linked_list_get(client->record_list));
+				linked_list_remove(client->record_list);
+			}
+			linked_list_free(client->record_list);
+			linked_list_free(client->event_queue);
+		}
+		free(access_trace_client);
+		fclose(access_trace_replay_file);
+		access_trace_replay_file = NULL;
+	}
+}
+
+
+/* Record an access issued to the memory hierarchy */
+void access_trace_capture(struct mod_t *mod, enum mod_access_kind_t access_kind,
+	unsigned int addr, struct mod_client_info_t *client_info)
+{
+	FILE *f = access_trace_capture_file;
+	long long cycle;
+
+	cycle = esim_domain_cycle(mem_domain_index);
+	putc(access_kind | (client_info ? ACCESS_TRACE_HAS_EIP : 0), f);
+	access_trace_write_varint(f, list_index_of(mem_system->mod_list, mod));
+	access_trace_write_varint(f, cycle - access_trace_capture_cycle);
+	access_trace_write_u32(f, addr);
+	if (client_info)
+		access_trace_write_u32(f, client_info->prefetcher_eip);
+	access_trace_capture_cycle = cycle;
+}
+
+
+/* Return true while the replayed trace has accesses left to issue or to
+ * complete, so that the main simulation loop keeps advancing time. */
+int access_trace_replay_pending(void)
+{
+	return access_trace_replay_file && (access_trace_next_valid ||
+		access_trace_replay_in_flight);
+}
+
+
+/* Event handler for EV_ACCESS_TRACE_REPLAY. Issue all accesses recorded up
+ * to the current cycle, as long as their client is below the limit of
+ * in-flight accesses. */
+void access_trace_replay_handler(int event, void *data)
+{
+	struct access_trace_client_t *client;
+	struct access_trace_record_t *record;
+	struct mod_client_info_t *client_info;
+
+	long long cycle;
+	long long in_flight;
+
+	int blocked;
+	int i;
+
+	/* Move records up to the current cycle into their client's list */
+	cycle = esim_domain_cycle(mem_domain_index);
+	while (access_trace_next_valid && access_trace_next_record.cycle <= cycle)
+	{
+		client = &access_trace_client[access_trace_next_client];
+		record = xmalloc(sizeof(struct access_trace_record_t));
+		*record = access_trace_next_record;
+		linked_list_add(client->record_list, record);
+		access_trace_read_record();
+	}
+
+	/* Issue */
+	blocked = 0;
+	in_flight = 0;
+	for (i = 0; i < access_trace_num_clients; i++)
+	{
+		client = &access_trace_client[i];
+		client->completed += linked_list_count(client->event_queue);
+		linked_list_clear(client->event_queue);
+
+		linked_list_head(client->record_list);
+		while (linked_list_count(client->record_list))
+		{
+			record = linked_list_get(client->record_list);
+
+			/* Closed-loop issue. Prefetches are not counted, since
+			 * they may be dropped without completing. */
+			if (access_trace_replay_limit && record->access_kind != mod_access_prefetch
+					&& client->issued - client->completed >= access_trace_replay_limit)
+			{
+				blocked = 1;
+				break;
+			}
+
+			/* Access */
+			if (!client->mod)
+				fatal("%s: module accessed in trace not present in memory configuration",
+					access_trace_replay_file_name);
+			client_info = NULL;
+			if (record->has_eip)
+			{
+				client_info = mod_client_info_create(client->mod);
+				client_info->prefetcher_eip = record->eip;
+			}
+			if (record->access_kind == mod_access_prefetch)
+			{
+				mod_access(client->mod, record->access_kind, record->addr,
+					NULL, NULL, NULL, client_info);
+			}
+			else
+			{
+				mod_access(client->mod, record->access_kind, record->addr,
+					NULL, client->event_queue, client, client_info);
+				client->issued++;
+			}
+			free(record);
+			linked_list_remove(client->record_list);
+		}
+		in_flight += client->issued - client->completed;
+	}
+	access_trace_replay_in_flight = in_flight;
+
+	/* Next replay event. Blocked clients retry every cycle. */
+	if (blocked || in_flight)
+		esim_schedule_event(EV_ACCESS_TRACE_REPLAY, NULL, 1);
+	else if (access_trace_next_valid)
+		esim_schedule_event(EV_ACCESS_TRACE_REPLAY, NULL,
+			access_trace_next_record.cycle - cycle);
+}
@@ -0,0 +1,49 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef MEM_SYSTEM_ACCESS_TRACE_H
+#define MEM_SYSTEM_ACCESS_TRACE_H
+
+#include "module.h"
+
+
+/* Command-line options */
+extern char *access_trace_capture_file_name;
+extern char *access_trace_replay_file_name;
+extern int access_trace_replay_limit;
+
+/* True while accesses are being recorded. Checked by 'mod_access' before
+ * calling 'access_trace_capture'. */
+extern int access_trace_capture_active;
+
+/* Event for trace-driven simulation */
+extern int EV_ACCESS_TRACE_REPLAY;
+
+void access_trace_init(void);
+void access_trace_done(void);
+
+void access_trace_capture(struct mod_t *mod, enum mod_access_kind_t access_kind,
+	unsigned int addr, struct mod_client_info_t *client_info);
+
+int access_trace_replay_pending(void);
+void access_trace_replay_handler(int event, void *data);
+
+
+#endif
+
@@ -0,0 +1,545 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <stdarg.h>
+#include <string.h>
+
+#include <lib/mhandle/mhandle.h>
+#include <lib/util/config.h>
+#include <lib/util/debug.h>
+#include <lib/util/file.h>
+#include <lib/util/list.h>
+#include <lib/util/misc.h>
+#include <lib/util/string.h>
+
+#include "cache-sweep.h"
+#include "memory.h"
+
+
+/*
+ * Global Variables
+ */
+
+char *cache_sweep_config_file_name = "";
+char *cache_sweep_report_file_name = "";
+
+int cache_sweep_active;
+
+char *cache_sweep_config_help =
+	"Option '--mem-sweep <file>' evaluates many LRU cache configurations in a\n"
+	"single simulation. Every data read and write to the memory of the guest\n"
+	"programs is driven through all configurations, independently of the\n"
+	"simulation kind (functional or detailed) and of the memory hierarchy given\n"
+	"with option '--mem-config', if any. This includes the memory of each CPU\n"
+	"process and the global memory of each GPU, and the accesses done on behalf of\n"
+	"the guest programs by system calls and GPU drivers. Scratchpad memories, such\n"
+	"as the GPU local memory, are not included. Statistics are dumped into the file\n"
+	"given with option '--mem-sweep-report <file>'.\n"
+	"\n"
+	"For each pair of block size and number of sets, the simulator keeps one LRU\n"
+	"stack per set, and records the stack distance of each access (Mattson's\n"
+	"algorithm). The hits of every associativity are then obtained from the same\n"
+	"pass. Accesses spanning several blocks count as one access per block. Caches\n"
+	"are write-allocate. Each memory space has caches of its own, reported in\n"
+	"separate sections.\n"
+	"\n"
+	"The configuration file is a plain-text file in the IniFile format, with any\n"
+	"number of sections of the following form:\n"
+	"\n"
+	"Section [Sweep <name>] defines a family of cache configurations.\n"
+	"\n"
+	"  BlockSize = <sizes>  (Required)\n"
+	"      List of block sizes in bytes, separated by spaces.\n"
+	"  Sets = <counts>  (Required)\n"
+	"      List of numbers of sets, separated by spaces.\n"
+	"  Assoc = <counts>  (Required)\n"
+	"      List of associativities, separated by spaces.\n"
+	"\n"
+	"All values must be powers of 2. One configuration is reported for each\n"
+	"combination of block size, number of sets, and associativity.\n"
+	"\n";
+
+
+/* Set of configurations with the same block size and number of sets,
+ * covering all associativities up to 'max_assoc'. */
+struct cache_sweep_group_t
+{
+	char *name;
+
+	int block_size;
+	int log_block_size;
+	int num_sets;
+
+	/* Associativities to report, in increasing order */
+	int num_assoc;
+	int *assoc;
+	int max_assoc;
+
+	/* LRU stack of each set, as an array of 'num_sets * max_assoc' block
+	 * numbers with the most recently used block first. */
+	unsigned int *stack;
+	int *stack_size;
+
+	/* Number of accesses with each stack distance. Entry 'max_assoc'
+	 * counts accesses that missed in all configurations. */
+	long long *read_dist;
+	long long *write_dist;
+};
+
+
+/* Memory space included in the sweep */
+struct cache_sweep_space_t
+{
+	char *name;
+
+	/* List of groups of type 'struct cache_sweep_group_t', created on the
+	 * first access to the space. */
+	struct list_t *group_list;
+};
+
+
+/* Configurations read from the sweep configuration file, used as templates
+ * for the groups of each memory space. */
+static struct list_t *cache_sweep_group_list;
+
+/* Registered memory spaces, elements of type 'struct cache_sweep_space_t' */
+static struct list_t *cache_sweep_space_list;
+
+
+
+
+/*
+ * Private Functions
+ */
+
+static char *cache_sweep_err_format =
+	"\tA section [Sweep <name>] in the cache sweep configuration file contains an\n"
+	"\tinvalid value. Please run 'm2s --mem-sweep-help' for a description of the\n"
+	"\tformat.\n";
+
+
+/* Parse a list of powers of two, in increasing order */
+static int *cache_sweep_read_list(struct config_t *config, char *section,
+	char *var, int *count_ptr)
+{
+	struct list_t *token_list;
+	char *token;
+	int *values;
+	int err;
+	int i;
+
+	config_var_enforce(config, section, var);
+	token_list = str_token_list_create(config_read_string(config,
+		section, var, ""), " ");
+	if (!list_count(token_list))
+		fatal("%s: %s: empty list for '%s'.\n%s", cache_sweep_config_file_name,
+			section, var, cache_sweep_err_format);
+
+	values = xcalloc(list_count(token_list), sizeof(int));
+	for (i = 0; i < list_count(token_list); i++)
+	{
+		token = list_get(token_list, i);
+		values[i] = str_to_int(token, &err);
+		if (err || values[i] < 1 || (values[i] & (values[i] - 1)))
+			fatal("%s: %s: invalid value '%s' for '%s'.\n%s",
+				cache_sweep_config_file_name, section, token,
+				var, cache_sweep_err_format);
+		if (i && values[i] <= values[i - 1])
+			fatal("%s: %s: values for '%s' must be given in increasing order.\n%s",
+				cache_sweep_config_file_name, section, var,
+				cache_sweep_err_format);
+	}
+
+	*count_ptr = list_count(token_list);
+	str_token_list_free(token_list);
+	return values;
+}
+
+
+static struct cache_sweep_group_t *cache_sweep_group_create(char *name,
+	int block_size, int num_sets, int *assoc, int num_assoc)
+{
+	struct cache_sweep_group_t *group;
+
+	/* Initialize */
+	group = xcalloc(1, sizeof(struct cache_sweep_group_t));
+	group->name = xstrdup(name);
+	group->block_size = block_size;
+	group->log_block_size = log_base2(block_size);
+	group->num_sets = num_sets;
+	group->num_assoc = num_assoc;
+	group->assoc = xcalloc(num_assoc, sizeof(int));
+	memcpy(group->assoc, assoc, num_assoc * sizeof(int));
+	group->max_assoc = assoc[num_assoc - 1];
+
+	/* LRU stacks and histograms */
+	group->stack = xcalloc((long long) num_sets * group->max_assoc,
+		sizeof(unsigned int));
+	group->stack_size = xcalloc(num_sets, sizeof(int));
+	group->read_dist = xcalloc(group->max_assoc + 1, sizeof(long long));
+	group->write_dist = xcalloc(group->max_assoc + 1, sizeof(long long));
+
+	/* Return */
+	return group;
+}
+
+
+static struct cache_sweep_space_t *cache_sweep_space_create(char *name)
+{
+	struct cache_sweep_space_t *space;
+
+	space = xcalloc(1, sizeof(struct cache_sweep_space_t));
+	space->name = xstrdup(name);
+	return space;
+}
+
+
+static void cache_sweep_group_free(struct cache_sweep_group_t *group)
+{
+	free(group->name);
+	free(group->assoc);
+	free(group->stack);
+	free(group->stack_size);
+	free(group->read_dist);
+	free(group->write_dist);
+	free(group);
+}
+
+
+static void cache_sweep_space_free(struct cache_sweep_space_t *space)
+{
+	int i;
+
+	if (space->group_list)
+	{
+		LIST_FOR_EACH(space->group_list, i)
+			cache_sweep_group_free(list_get(space->group_list, i));
+		list_free(space->group_list);
+	}
+	free(space->name);
+	free(space);
+}
+
+
+/* Access one block and record its stack distance */
+static void cache_sweep_group_access(struct cache_sweep_group_t *group,
+	unsigned int block, int write)
+{
+	unsigned int *stack;
+	int *stack_size;
+	int dist;
+
+	stack = &group->stack[(long long) (block & (group->num_sets - 1)) *
+		group->max_assoc];
+	stack_size = &group->stack_size[block & (group->num_sets - 1)];
+
+	/* Find block in the set's LRU stack */
+	for (dist = 0; dist < *stack_size; dist++)
+		if (stack[dist] == block)
+			break;
+
+	/* Record distance. A block not found misses in all associativities. */
+	if (dist == *stack_size)
+	{
+		dist = group->max_assoc;
+		if (*stack_size < group->max_assoc)
+			(*stack_size)++;
+	}
+	if (write)
+		group->write_dist[dist]++;
+	else
+		group->read_dist[dist]++;
+
+	/* Move block to the top of the stack */
+	if (dist == group->max_assoc)
+		dist = *stack_size - 1;
+	memmove(&stack[1], &stack[0], dist * sizeof(unsigned int));
+	stack[0] = block;
+}
+
+
+static void cache_sweep_group_dump(struct cache_sweep_group_t *group,
+	char *space_name, FILE *f)
+{
+	long long read_hits;
+	long long write_hits;
+	long long reads;
+	long long writes;
+	long long accesses;
+
+	int assoc;
+	int dist;
+	int i;
+
+	/* Total accesses */
+	reads = 0;
+	writes = 0;
+	for (dist = 0; dist <= group->max_assoc; dist++)
+	{
+		reads += group->read_dist[dist];
+		writes += group->write_dist[dist];
+	}
+	accesses = reads + writes;
+
+	/* One section per associativity. An access hits in an 'assoc'-way
+	 * cache if its stack distance is less than 'assoc'. */
+	read_hits = 0;
+	write_hits = 0;
+	dist = 0;
+	for (i = 0; i < group->num_assoc; i++)
+	{
+		assoc = group->assoc[i];
+		for (; dist < assoc; dist++)
+		{
+			read_hits += group->read_dist[dist];
+			write_hits += group->write_dist[dist];
+		}
+
+		fprintf(f, "[ %s %s-b%d-s%d-a%d ]\n", space_name, group->name,
+			group->block_size, group->num_sets, assoc);
+		fprintf(f, "\n");
+		fprintf(f, "Sets = %d\n", group->num_sets);
+		fprintf(f, "Assoc = %d\n", assoc);
+		fprintf(f, "Policy = LRU\n");
+		fprintf(f, "BlockSize = %d\n", group->block_size);
+		fprintf(f, "Size = %lld\n", (long long) group->num_sets * assoc *
+			group->block_size);
+		fprintf(f, "\n");
+		fprintf(f, "Accesses = %lld\n", accesses);
+		fprintf(f, "Hits = %lld\n", read_hits + write_hits);
+		fprintf(f, "Misses = %lld\n", accesses - read_hits - write_hits);
+		fprintf(f, "HitRatio = %.4g\n", accesses ?
+			(double) (read_hits + write_hits) / accesses : 0.0);
+		fprintf(f, "\n");
+		fprintf(f, "Reads = %lld\n", reads);
+		fprintf(f, "ReadHits = %lld\n", read_hits);
+		fprintf(f, "ReadMisses = %lld\n", reads - read_hits);
+		fprintf(f, "\n");
+		fprintf(f, "Writes = %lld\n", writes);
+		fprintf(f, "WriteHits = %lld\n", write_hits);
+		fprintf(f, "WriteMisses = %lld\n", writes - write_hits);
+		fprintf(f, "\n\n");
+	}
+}
+
+
+
+
+/*
+ * Public Functions
+ */
+
+void cache_sweep_init(void)
+{
+	struct config_t *config;
+	struct cache_sweep_group_t *group;
+
+	char *section;
+
+	int *block_size;
+	int *num_sets;
+	int *assoc;
+
+	int num_block_size;
+	int num_num_sets;
+	int num_assoc;
+
+	int i;
+	int j;
+
+	/* Nothing if no sweep was requested */
+	if (!*cache_sweep_config_file_name)
+	{
+		if (*cache_sweep_report_file_name)
+			fatal("option '--mem-sweep-report' requires '--mem-sweep'");
+		return;
+	}
+
+	/* Open configuration file */
+	if (!file_can_open_for_read(cache_sweep_config_file_name))
+		fatal("%s: cannot open cache sweep configuration file",
+			cache_sweep_config_file_name);
+	if (*cache_sweep_report_file_name && !file_can_open_for_write(
+			cache_sweep_report_file_name))
+		fatal("%s: cannot open cache sweep report file",
+			cache_sweep_report_file_name);
+	config = config_create(cache_sweep_config_file_name);
+	config_load(config);
+
+	/* Create one group per block size and number of sets */
+	cache_sweep_group_list = list_create();
+	for (section = config_section_first(config); section;
+			section = config_section_next(config))
+	{
+		if (strncasecmp(section, "Sweep ", 6))
+			fatal("%s: invalid section [%s].\n%s",
+				cache_sweep_config_file_name, section,
+				cache_sweep_err_format);
+
+		block_size = cache_sweep_read_list(config, section,
+			"BlockSize", &num_block_size);
+		num_sets = cache_sweep_read_list(config, section,
+			"Sets", &num_num_sets);
+		assoc = cache_sweep_read_list(config, section,
+			"Assoc", &num_assoc);
+		config_section_check(config, section);
+
+		for (i = 0; i < num_block_size; i++)
+		{
+			for (j = 0; j < num_num_sets; j++)
+			{
+				group = cache_sweep_group_create(section + 6,
+					block_size[i], num_sets[j], assoc, num_assoc);
+				list_add(cache_sweep_group_list, group);
+			}
+		}
+
+		free(block_size);
+		free(num_sets);
+		free(assoc);
+	}
+	config_check(config);
+	config_free(config);
+
+	/* Start. Memory spaces may have been registered already. */
+	if (!cache_sweep_space_list)
+		cache_sweep_space_list = list_create();
+	cache_sweep_active = list_count(cache_sweep_group_list) > 0;
+}
+
+
+void cache_sweep_done(void)
+{
+	struct cache_sweep_space_t *space;
+	struct cache_sweep_group_t *group;
+	FILE *f;
+	int i;
+	int j;
+
+	/* Nothing if no sweep was requested */
+	if (!cache_sweep_group_list)
+		return;
+	cache_sweep_active = 0;
+
+	/* Dump report */
+	f = file_open_for_write(cache_sweep_report_file_name);
+	if (f)
+	{
+		fprintf(f, "; Report for cache sweep over LRU configurations\n");
+		fprintf(f, ";    Accesses - Total number of block accesses\n");
+		fprintf(f, ";    Hits, Misses - Accesses resulting in hits/misses\n");
+		fprintf(f, ";    HitRatio - Hits divided by accesses\n");
+		fprintf(f, ";    Reads, Writes - Total read/write accesses\n");
+		fprintf(f, "\n\n");
+		LIST_FOR_EACH(cache_sweep_space_list, i)
+		{
+			space = list_get(cache_sweep_space_list, i);
+			if (!space->group_list)
+				continue;
+			LIST_FOR_EACH(space->group_list, j)
+				cache_sweep_group_dump(list_get(space->group_list, j),
+					space->name, f);
+		}
+		file_close(f);
+	}
+
+	/* Free */
+	LIST_FOR_EACH(cache_sweep_space_list, i)
+		cache_sweep_space_free(list_get(cache_sweep_space_list, i));
+	list_free(cache_sweep_space_list);
+	cache_sweep_space_list = NULL;
+	while (list_count(cache_sweep_group_list))
+	{
+		group = list_pop(cache_sweep_group_list);
+		cache_sweep_group_free(group);
+	}
+	list_free(cache_sweep_group_list);
+	cache_sweep_group_list = NULL;
+}
+
+
+void cache_sweep_register_mem(struct mem_t *mem, char *fmt, ...)
+{
+	struct cache_sweep_space_t *space;
+	char name[MAX_STRING_SIZE];
+	va_list va;
+
+	/* Nothing if no sweep was requested. Memory spaces can be created before
+	 * the sweep is initialized, so the option is checked instead. */
+	if (!*cache_sweep_config_file_name)
+		return;
+
+	/* Create space */
+	va_start(va, fmt);
+	vsnprintf(name, sizeof name, fmt, va);
+	va_end(va);
+	space = cache_sweep_space_create(name);
+	mem->cache_sweep_space = space;
+
+	/* Add to list */
+	if (!cache_sweep_space_list)
+		cache_sweep_space_list = list_create();
+	list_add(cache_sweep_space_list, space);
+}
+
+
+/* Drive an access of 'size' bytes at 'addr' in memory space 'mem' through
+ * all configurations */
+void cache_sweep_access(struct mem_t *mem, unsigned int addr, int size, int write)
+{
+	struct cache_sweep_space_t *space = mem->cache_sweep_space;
+	struct cache_sweep_group_t *group;
+
+	unsigned int block;
+	unsigned int last_block;
+
+	int i;
+
+	/* Space not included */
+	if (!space || size <= 0)
+		return;
+
+	/* First access to the space */
+	if (!space->group_list)
+	{
+		space->group_list = list_create();
+		LIST_FOR_EACH(cache_sweep_group_list, i)
+		{
+			group = list_get(cache_sweep_group_list, i);
+			list_add(space->group_list, cache_sweep_group_create(group->name,
+				group->block_size, group->num_sets, group->assoc,
+				group->num_assoc));
+		}
+	}
+
+	/* Access. The loop stops on the last block instead of comparing
+	 * against 'addr + size', which wraps around at the top of the
+	 * 32-bit address space. */
+	LIST_FOR_EACH(space->group_list, i)
+	{
+		group = list_get(space->group_list, i);
+		last_block = (addr + size - 1) >> group->log_block_size;
+		for (block = addr >> group->log_block_size; ; block++)
+		{
+			cache_sweep_group_access(group, block, write);
+			if (block == last_block)
+				break;
+		}
+	}
+}
@@ -0,0 +1,51 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef MEM_SYSTEM_CACHE_SWEEP_H
+#define MEM_SYSTEM_CACHE_SWEEP_H
+
+
+/* Command-line options */
+extern char *cache_sweep_config_file_name;
+extern char *cache_sweep_report_file_name;
+extern char *cache_sweep_config_help;
+
+/* True if a sweep is in progress. Checked by the memory access functions
+ * before calling 'cache_sweep_access'. */
+extern int cache_sweep_active;
+
+struct mem_t;
+
+void cache_sweep_init(void);
+void cache_sweep_done(void);
+
+/* Include the accesses to memory space 'mem' in the sweep, with caches of
+ * their own. The space is identified in the report by the name given with the
+ * printf-like arguments. Nothing is done if no sweep was requested. */
+void cache_sweep_register_mem(struct mem_t *mem, char *fmt, ...)
+	__attribute__ ((format (printf, 2, 3)));
+
+/* Drive an access to a memory space through all configurations. Called by
+ * the memory access functions for spaces registered with
+ * 'cache_sweep_register_mem'. */
+void cache_sweep_access(struct mem_t *mem, unsigned int addr, int size, int write);
+
+
+#endif
+
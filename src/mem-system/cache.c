@@ -17,6 +17,11 @@
  */
 
 #include <assert.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include <lib/esim/trace.h>
 #include <lib/mhandle/mhandle.h>
@@ -68,60 +73,92 @@ struct str_map_t cache_block_state_map =
  * Private Functions
  */
 
-enum cache_waylist_enum
+/* Return the first index at or after 'way' where 'array1' or, if given,
+ * 'array2' contains 'value'. If there is none, return 'assoc'. Since
+ * the associativity is a power of two, it is either smaller than the
+ * vector width or a multiple of it. */
+static int cache_array_find(int *array1, int *array2, int way,
+	int assoc, int value)
 {
-	cache_waylist_head,
-	cache_waylist_tail
-};
-
-static void cache_update_waylist(struct cache_set_t *set,
-	struct cache_block_t *blk, enum cache_waylist_enum where)
-{
-	if (!blk->way_prev && !blk->way_next)
-	{
-		assert(set->way_head == blk && set->way_tail == blk);
-		return;
-		
-	}
-	else if (!blk->way_prev)
-	{
-		assert(set->way_head == blk && set->way_tail != blk);
-		if (where == cache_waylist_head)
-			return;
-		set->way_head = blk->way_next;
-		blk->way_next->way_prev = NULL;
-		
-	}
-	else if (!blk->way_next)
+#if defined(__AVX2__)
+	__m256i key8;
+	int mask;
+
+	key8 = _mm256_set1_epi32(value);
+	for (; way < assoc && (way & 7); way++)
+		if (array1[way] == value || (array2 && array2[way] == value))
+			return way;
+	for (; way + 8 <= assoc; way += 8)
 	{
-		assert(set->way_head != blk && set->way_tail == blk);
-		if (where == cache_waylist_tail)
-			return;
-		set->way_tail = blk->way_prev;
-		blk->way_prev->way_next = NULL;
-		
+		__m256i cmp;
+
+		cmp = _mm256_cmpeq_epi32(_mm256_loadu_si256((__m256i *) &array1[way]), key8);
+		if (array2)
+			cmp = _mm256_or_si256(cmp, _mm256_cmpeq_epi32(
+				_mm256_loadu_si256((__m256i *) &array2[way]), key8));
+		mask = _mm256_movemask_ps(_mm256_castsi256_ps(cmp));
+		if (mask)
+			return way + __builtin_ctz(mask);
 	}
-	else
+#elif defined(__SSE2__)
+	__m128i key4;
+	int mask;
+
+	key4 = _mm_set1_epi32(value);
+	for (; way < assoc && (way & 3); way++)
+		if (array1[way] == value || (array2 && array2[way] == value))
+			return way;
+	for (; way + 4 <= assoc; way += 4)
 	{
-		assert(set->way_head != blk && set->way_tail != blk);
-		blk->way_prev->way_next = blk->way_next;
-		blk->way_next->way_prev = blk->way_prev;
+		__m128i cmp;
+
+		cmp = _mm_cmpeq_epi32(_mm_loadu_si128((__m128i *) &array1[way]), key4);
+		if (array2)
+			cmp = _mm_or_si128(cmp, _mm_cmpeq_epi32(
+				_mm_loadu_si128((__m128i *) &array2[way]), key4));
+		mask = _mm_movemask_ps(_mm_castsi128_ps(cmp));
+		if (mask)
+			return way + __builtin_ctz(mask);
 	}
+#endif
 
-	if (where == cache_waylist_head)
-	{
-		blk->way_next = set->way_head;
-		blk->way_prev = NULL;
-		set->way_head->way_prev = blk;
-		set->way_head = blk;
-	}
-	else
+	/* Remaining ways */
+	for (; way < assoc; way++)
+		if (array1[way] == value || (array2 && array2[way] == value))
+			return way;
+	return assoc;
+}
+
+
+/* Make 'way' the most recently used block of a set. All blocks that were
+ * more recent than it age by one position. */
+static void cache_move_to_head(struct cache_t *cache, int set, int way)
+{
+	int *age = cache->sets[set].age;
+	int way_age = age[way];
+	int i = 0;
+
+	/* Already at head */
+	if (!way_age)
+		return;
+
+#if defined(__SSE2__)
 	{
-		blk->way_prev = set->way_tail;
-		blk->way_next = NULL;
-		set->way_tail->way_next = blk;
-		set->way_tail = blk;
+		__m128i key = _mm_set1_epi32(way_age);
+		__m128i val;
+
+		for (; i + 4 <= cache->assoc; i += 4)
+		{
+			val = _mm_loadu_si128((__m128i *) &age[i]);
+			val = _mm_sub_epi32(val, _mm_cmplt_epi32(val, key));
+			_mm_storeu_si128((__m128i *) &age[i], val);
+		}
 	}
+#endif
+	for (; i < cache->assoc; i++)
+		if (age[i] < way_age)
+			age[i]++;
+	age[way] = 0;
 }
 
 
@@ -138,8 +175,8 @@ struct cache_t *cache_create(char *name, unsigned int num_sets,
 	enum cache_policy_t policy, enum cache_writepolicy_t writepolicy)
 {
 	struct cache_t *cache;
-	struct cache_block_t *block;
 	unsigned int set, way;
+	unsigned int index;
 
 	/* Initialize */
 	cache = xcalloc(1, sizeof(struct cache_t));
@@ -156,22 +193,27 @@ struct cache_t *cache_create(char *name, unsigned int num_sets,
 	assert(!(assoc & (assoc - 1)));
 	cache->log_block_size = log_base2(block_size);
 	cache->block_mask = block_size - 1;
+
+	/* Block storage */
+	cache->tag_array = xcalloc(num_sets * assoc, sizeof(int));
+	cache->transient_tag_array = xcalloc(num_sets * assoc, sizeof(int));
+	cache->state_array = xcalloc(num_sets * assoc, sizeof(unsigned char));
+	cache->prefetched_array = xcalloc(num_sets * assoc, sizeof(unsigned char));
+	cache->age_array = xcalloc(num_sets * assoc, sizeof(int));
 	
-	/* Initialize array of sets */
+	/* Initialize array of sets. Way 0 starts as the most recently used
+	 * block, and way 'assoc - 1' as the first one to be replaced. */
 	cache->sets = xcalloc(num_sets, sizeof(struct cache_set_t));
 	for (set = 0; set < num_sets; set++)
 	{
-		/* Initialize array of blocks */
-		cache->sets[set].blocks = xcalloc(assoc, sizeof(struct cache_block_t));
-		cache->sets[set].way_head = &cache->sets[set].blocks[0];
-		cache->sets[set].way_tail = &cache->sets[set].blocks[assoc - 1];
+		index = set * assoc;
+		cache->sets[set].tag = &cache->tag_array[index];
+		cache->sets[set].transient_tag = &cache->transient_tag_array[index];
+		cache->sets[set].state = &cache->state_array[index];
+		cache->sets[set].prefetched = &cache->prefetched_array[index];
+		cache->sets[set].age = &cache->age_array[index];
 		for (way = 0; way < assoc; way++)
-		{
-			block = &cache->sets[set].blocks[way];
-			block->way = way;
-			block->way_prev = way ? &cache->sets[set].blocks[way - 1] : NULL;
-			block->way_next = way < assoc - 1 ? &cache->sets[set].blocks[way + 1] : NULL;
-		}
+			cache->sets[set].age[way] = way;
 	}
 	
 	/* Return it */
@@ -181,11 +223,12 @@ struct cache_t *cache_create(char *name, unsigned int num_sets,
 
 void cache_free(struct cache_t *cache)
 {
-	unsigned int set;
-
-	for (set = 0; set < cache->num_sets; set++)
-		free(cache->sets[set].blocks);
 	free(cache->sets);
+	free(cache->tag_array);
+	free(cache->transient_tag_array);
+	free(cache->state_array);
+	free(cache->prefetched_array);
+	free(cache->age_array);
 	free(cache->name);
 	if (cache->prefetcher)
 		prefetcher_free(cache->prefetcher);
@@ -216,9 +259,9 @@ int cache_find_block(struct cache_t *cache, unsigned int addr, int *set_ptr, int
 	set = (addr >> cache->log_block_size) % cache->num_sets;
 	PTR_ASSIGN(set_ptr, set);
 	PTR_ASSIGN(state_ptr, 0);  /* Invalid */
-	for (way = 0; way < cache->assoc; way++)
-		if (cache->sets[set].blocks[way].tag == tag && cache->sets[set].blocks[way].state)
-			break;
+	way = cache_array_find(cache->sets[set].tag, NULL, 0, cache->assoc, tag);
+	while (way < cache->assoc && !cache->sets[set].state[way])
+		way = cache_array_find(cache->sets[set].tag, NULL, way + 1, cache->assoc, tag);
 	
 	/* Block not found */
 	if (way == cache->assoc)
@@ -226,13 +269,13 @@ int cache_find_block(struct cache_t *cache, unsigned int addr, int *set_ptr, int
 	
 	/* Block found */
 	PTR_ASSIGN(way_ptr, way);
-	PTR_ASSIGN(state_ptr, cache->sets[set].blocks[way].state);
+	PTR_ASSIGN(state_ptr, cache->sets[set].state[way]);
 	return 1;
 }
 
 
 /* Set the tag and state of a block.
- * If replacement policy is FIFO, update linked list in case a new
+ * If replacement policy is FIFO, update the block order in case a new
  * block is brought to cache, i.e., a new tag is set. */
 void cache_set_block(struct cache_t *cache, int set, int way, int tag, int state)
 {
@@ -244,12 +287,10 @@ void cache_set_block(struct cache_t *cache, int set, int way, int tag, int state
 			str_map_value(&cache_block_state_map, state));
 
 	if (cache->policy == cache_policy_fifo
-		&& cache->sets[set].blocks[way].tag != tag)
-		cache_update_waylist(&cache->sets[set],
-			&cache->sets[set].blocks[way],
-			cache_waylist_head);
-	cache->sets[set].blocks[way].tag = tag;
-	cache->sets[set].blocks[way].state = state;
+		&& cache->sets[set].tag[way] != tag)
+		cache_move_to_head(cache, set, way);
+	cache->sets[set].tag[way] = tag;
+	cache->sets[set].state[way] = state;
 }
 
 
@@ -257,13 +298,12 @@ void cache_get_block(struct cache_t *cache, int set, int way, int *tag_ptr, int
 {
 	assert(set >= 0 && set < cache->num_sets);
 	assert(way >= 0 && way < cache->assoc);
-	PTR_ASSIGN(tag_ptr, cache->sets[set].blocks[way].tag);
-	PTR_ASSIGN(state_ptr, cache->sets[set].blocks[way].state);
+	PTR_ASSIGN(tag_ptr, cache->sets[set].tag[way]);
+	PTR_ASSIGN(state_ptr, cache->sets[set].state[way]);
 }
 
 
-/* Update LRU counters, i.e., rearrange linked list in case
- * replacement policy is LRU. */
+/* Update LRU counters in case replacement policy is LRU. */
 void cache_access_block(struct cache_t *cache, int set, int way)
 {
 	int move_to_head;
@@ -275,11 +315,9 @@ void cache_access_block(struct cache_t *cache, int set, int way)
 	 * It will also be moved if it is its first access for FIFO policy, i.e., if the
 	 * state of the block was invalid. */
 	move_to_head = cache->policy == cache_policy_lru ||
-		(cache->policy == cache_policy_fifo && !cache->sets[set].blocks[way].state);
-	if (move_to_head && cache->sets[set].blocks[way].way_prev)
-		cache_update_waylist(&cache->sets[set],
-			&cache->sets[set].blocks[way],
-			cache_waylist_head);
+		(cache->policy == cache_policy_fifo && !cache->sets[set].state[way]);
+	if (move_to_head)
+		cache_move_to_head(cache, set, way);
 }
 
 
@@ -287,25 +325,16 @@ void cache_access_block(struct cache_t *cache, int set, int way)
  * depending on the replacement policy */
 int cache_replace_block(struct cache_t *cache, int set)
 {
-	//struct cache_block_t *block;
-
-	/* Try to find an invalid block. Do this in the LRU order, to avoid picking the
-	 * MRU while its state has not changed to valid yet. */
 	assert(set >= 0 && set < cache->num_sets);
-	/*
-	for (block = cache->sets[set].way_tail; block; block = block->way_prev)
-		if (!block->state)
-			return block->way;
-	*/
-
-	/* LRU and FIFO replacement: return block at the
-	 * tail of the linked list */
+
+	/* LRU and FIFO replacement: return the oldest block */
 	if (cache->policy == cache_policy_lru ||
 		cache->policy == cache_policy_fifo)
 	{
-		int way = cache->sets[set].way_tail->way;
-		cache_update_waylist(&cache->sets[set], cache->sets[set].way_tail, 
-			cache_waylist_head);
+		int way = cache_array_find(cache->sets[set].age, NULL, 0,
+			cache->assoc, cache->assoc - 1);
+		assert(way < cache->assoc);
+		cache_move_to_head(cache, set, way);
 
 		return way;
 	}
@@ -318,10 +347,17 @@ int cache_replace_block(struct cache_t *cache, int set)
 
 void cache_set_transient_tag(struct cache_t *cache, int set, int way, int tag)
 {
-	struct cache_block_t *block;
-
 	/* Set transient tag */
-	block = &cache->sets[set].blocks[way];
-	block->transient_tag = tag;
+	cache->sets[set].transient_tag[way] = tag;
 }
 
+
+/* Return the first way at or after 'way' in 'set' whose tag or transient
+ * tag is equal to 'tag', or the cache associativity if there is none.
+ * The state of the block is not checked. */
+int cache_find_tag(struct cache_t *cache, int set, int way, int tag)
+{
+	assert(set >= 0 && set < cache->num_sets);
+	return cache_array_find(cache->sets[set].tag,
+		cache->sets[set].transient_tag, way, cache->assoc, tag);
+}
@@ -50,24 +50,20 @@ enum cache_block_state_t
 	cache_block_shared
 };
 
-struct cache_block_t
-{
-	struct cache_block_t *way_next;
-	struct cache_block_t *way_prev;
-
-	int tag;
-	int transient_tag;
-	int way;
-	int prefetched;
-
-	enum cache_block_state_t state;
-};
-
+/* Blocks of a set are stored as one array per field, so that a tag lookup
+ * or a replacement decision scans contiguous memory and can compare
+ * several ways with one vector instruction. */
 struct cache_set_t
 {
-	struct cache_block_t *way_head;
-	struct cache_block_t *way_tail;
-	struct cache_block_t *blocks;
+	int *tag;
+	int *transient_tag;
+	unsigned char *state;  /* Values of type 'enum cache_block_state_t' */
+	unsigned char *prefetched;
+
+	/* Position of each way in the LRU/FIFO order, where 0 is the most
+	 * recently used (or inserted) block and 'assoc - 1' is the block
+	 * to replace next. */
+	int *age;
 };
 
 struct cache_t
@@ -84,6 +80,13 @@ struct cache_t
 	unsigned int block_mask;
 	int log_block_size;
 
+	/* Storage for the per-set arrays, 'num_sets * assoc' entries each */
+	int *tag_array;
+	int *transient_tag_array;
+	unsigned char *state_array;
+	unsigned char *prefetched_array;
+	int *age_array;
+
 	struct prefetcher_t *prefetcher;
 };
 
@@ -103,6 +106,7 @@ void cache_get_block(struct cache_t *cache, int set, int way, int *tag_ptr, int
 void cache_access_block(struct cache_t *cache, int set, int way);
 int cache_replace_block(struct cache_t *cache, int set);
 void cache_set_transient_tag(struct cache_t *cache, int set, int way, int tag);
+int cache_find_tag(struct cache_t *cache, int set, int way, int tag);
 
 
 #endif
@@ -658,10 +658,10 @@ void mem_system_end_command_handler(int event, void *data)
 		/* Construct list of actual sharers */
 		sharers_check_list = linked_list_create();
 		assert(mod->high_net);
-		for (node_index = 0; node_index < mod->high_net->node_count; node_index++)
+		for (node_index = dir_entry_next_sharer(mod->dir, set, way, sub_block, 0);
+				node_index >= 0; node_index = dir_entry_next_sharer(mod->dir,
+				set, way, sub_block, node_index + 1))
 		{
-			if (!dir_entry_is_sharer(mod->dir, set, way, sub_block, node_index))
-				continue;
 			node = list_get(mod->high_net->node_list, node_index);
 			sharer = node->user_data;
 			linked_list_add(sharers_check_list, sharer);
@@ -18,6 +18,7 @@
  */
 
 #include <assert.h>
+#include <string.h>
 
 #include <lib/esim/esim.h>
 #include <lib/esim/trace.h>
@@ -30,50 +31,73 @@
 #include "mod-stack.h"
 
 
-#define DIR_ENTRY_SHARERS_SIZE ((dir->num_nodes + 7) / 8)
-#define DIR_ENTRY_SIZE (sizeof(struct dir_entry_t) + DIR_ENTRY_SHARERS_SIZE)
-#define DIR_ENTRY(X, Y, Z) ((struct dir_entry_t *) (((void *) &dir->data) + DIR_ENTRY_SIZE * \
-	((X) * dir->ysize * dir->zsize + (Y) * dir->zsize + (Z))))
+#define DIR_ENTRY(X, Y, Z) (&dir->dir_entry[((X) * dir->ysize + (Y)) * dir->zsize + (Z)])
+#define DIR_ENTRY_ACTIVE(dir_entry)  ((dir_entry)->num_sharers || DIR_ENTRY_VALID_OWNER(dir_entry))
 
+/* Entry keeps its sharers in a heap-allocated bit vector */
+#define DIR_ENTRY_USES_VECTOR(dir_entry)  (dir->num_nodes > DIR_ENTRY_WORD_NODES && \
+	(dir_entry)->num_sharers > DIR_ENTRY_NUM_POINTERS)
 
-struct dir_t *dir_create(char *name, int xsize, int ysize, int zsize, int num_nodes)
+
+/* Update the count of active entries in block (x, y) after 'dir_entry' of
+ * that block changed. 'was_active' tells whether it was active before. */
+static void dir_entry_update_active(struct dir_t *dir, int x, int y,
+	struct dir_entry_t *dir_entry, int was_active)
 {
-	struct dir_t *dir;
-	struct dir_entry_t *dir_entry;
+	int *num_active_entries;
+
+	num_active_entries = &dir->num_active_entries[x * dir->ysize + y];
+	if (DIR_ENTRY_ACTIVE(dir_entry) && !was_active)
+		(*num_active_entries)++;
+	else if (!DIR_ENTRY_ACTIVE(dir_entry) && was_active)
+		(*num_active_entries)--;
+	assert(IN_RANGE(*num_active_entries, 0, dir->zsize));
+}
 
-	int dir_size;
-	int dir_entry_size;
 
-	int x;
-	int y;
-	int z;
-	
-	/* Calculate sizes */
-	assert(num_nodes > 0);
-	dir_entry_size = sizeof(struct dir_entry_t) + (num_nodes + 7) / 8;
-	dir_size = sizeof(struct dir_t) + dir_entry_size * xsize * ysize * zsize;
+/* Return the first bit set at or after position 'node' in a bit vector of
+ * 'num_words' words, or -1 if there is none. */
+static int dir_bit_vector_next(unsigned long long *vector, int num_words, int node)
+{
+	unsigned long long word;
+	int index;
+
+	index = node / 64;
+	if (index >= num_words)
+		return -1;
+	word = vector[index] & (~0ULL << (node % 64));
+	while (!word)
+	{
+		if (++index == num_words)
+			return -1;
+		word = vector[index];
+	}
+	return index * 64 + __builtin_ctzll(word);
+}
+
+
+struct dir_t *dir_create(char *name, int xsize, int ysize, int zsize, int num_nodes)
+{
+	struct dir_t *dir;
+	int i;
 
 	/* Initialize */
-	dir = xcalloc(1, dir_size);
+	assert(num_nodes > 0);
+	assert(num_nodes <= 0x10000);
+	dir = xcalloc(1, sizeof(struct dir_t));
 	dir->name = xstrdup(name);
 	dir->dir_lock = xcalloc(xsize * ysize, sizeof(struct dir_lock_t));
+	dir->num_active_entries = xcalloc(xsize * ysize, sizeof(int));
+	dir->dir_entry = xcalloc(xsize * ysize * zsize, sizeof(struct dir_entry_t));
 	dir->num_nodes = num_nodes;
+	dir->num_words = (num_nodes + 63) / 64;
 	dir->xsize = xsize;
 	dir->ysize = ysize;
 	dir->zsize = zsize;
 
 	/* Reset all owners */
-	for (x = 0; x < xsize; x++)
-	{
-		for (y = 0; y < ysize; y++)
-		{
-			for (z = 0; z < zsize; z++)
-			{
-				dir_entry = dir_entry_get(dir, x, y, z);
-				dir_entry->owner = DIR_ENTRY_OWNER_NONE;
-			}
-		}
-	}
+	for (i = 0; i < xsize * ysize * zsize; i++)
+		dir->dir_entry[i].owner = DIR_ENTRY_OWNER_NONE;
 
 	/* Return */
 	return dir;
@@ -82,8 +106,21 @@ struct dir_t *dir_create(char *name, int xsize, int ysize, int zsize, int num_no
 
 void dir_free(struct dir_t *dir)
 {
+	struct dir_entry_t *dir_entry;
+	int i;
+
+	/* Free sharer bit vectors */
+	for (i = 0; i < dir->xsize * dir->ysize * dir->zsize; i++)
+	{
+		dir_entry = &dir->dir_entry[i];
+		if (DIR_ENTRY_USES_VECTOR(dir_entry))
+			free(dir_entry->sharer.vector);
+	}
+
 	free(dir->name);
 	free(dir->dir_lock);
+	free(dir->num_active_entries);
+	free(dir->dir_entry);
 	free(dir);
 }
 
@@ -104,9 +141,9 @@ void dir_entry_dump_sharers(struct dir_t *dir, int x, int y, int z)
 
 	dir_entry = dir_entry_get(dir, x, y, z);
 	mem_debug("  %d sharers: { ", dir_entry->num_sharers);
-	for (i = 0; i < dir->num_nodes; i++)
-		if (dir_entry_is_sharer(dir, x, y, z, i))
-			mem_debug("%d ", i);
+	for (i = dir_entry_next_sharer(dir, x, y, z, 0); i >= 0;
+			i = dir_entry_next_sharer(dir, x, y, z, i + 1))
+		mem_debug("%d ", i);
 	mem_debug("}\n");
 }
 
@@ -114,11 +151,14 @@ void dir_entry_dump_sharers(struct dir_t *dir, int x, int y, int z)
 void dir_entry_set_owner(struct dir_t *dir, int x, int y, int z, int node)
 {
 	struct dir_entry_t *dir_entry;
+	int was_active;
 
 	/* Set owner */
 	assert(node == DIR_ENTRY_OWNER_NONE || IN_RANGE(node, 0, dir->num_nodes - 1));
 	dir_entry = dir_entry_get(dir, x, y, z);
+	was_active = DIR_ENTRY_ACTIVE(dir_entry);
 	dir_entry->owner = node;
+	dir_entry_update_active(dir, x, y, dir_entry, was_active);
 
 	/* Trace */
 	mem_trace("mem.set_owner dir=\"%s\" x=%d y=%d z=%d owner=%d\n",
@@ -129,17 +169,46 @@ void dir_entry_set_owner(struct dir_t *dir, int x, int y, int z, int node)
 void dir_entry_set_sharer(struct dir_t *dir, int x, int y, int z, int node)
 {
 	struct dir_entry_t *dir_entry;
+	unsigned long long *vector;
+	int was_active;
+	int i;
 
 	/* Nothing if sharer was already set */
 	assert(IN_RANGE(node, 0, dir->num_nodes - 1));
-	dir_entry = dir_entry_get(dir, x, y, z);
-	if (dir_entry->sharer[node / 8] & (1 << (node % 8)))
+	if (dir_entry_is_sharer(dir, x, y, z, node))
 		return;
 
 	/* Set sharer */
-	dir_entry->sharer[node / 8] |= 1 << (node % 8);
+	dir_entry = dir_entry_get(dir, x, y, z);
+	was_active = DIR_ENTRY_ACTIVE(dir_entry);
+	if (dir->num_nodes <= DIR_ENTRY_WORD_NODES)
+	{
+		dir_entry->sharer.word |= 1ULL << node;
+	}
+	else if (DIR_ENTRY_USES_VECTOR(dir_entry))
+	{
+		dir_entry->sharer.vector[node / 64] |= 1ULL << (node % 64);
+	}
+	else if (dir_entry->num_sharers < DIR_ENTRY_NUM_POINTERS)
+	{
+		/* Insert keeping node indices sorted */
+		for (i = dir_entry->num_sharers; i > 0 && dir_entry->sharer.pointer[i - 1] > node; i--)
+			dir_entry->sharer.pointer[i] = dir_entry->sharer.pointer[i - 1];
+		dir_entry->sharer.pointer[i] = node;
+	}
+	else
+	{
+		/* Out of pointers, switch to a bit vector */
+		vector = xcalloc(dir->num_words, sizeof(unsigned long long));
+		for (i = 0; i < dir_entry->num_sharers; i++)
+			vector[dir_entry->sharer.pointer[i] / 64] |=
+				1ULL << (dir_entry->sharer.pointer[i] % 64);
+		vector[node / 64] |= 1ULL << (node % 64);
+		dir_entry->sharer.vector = vector;
+	}
 	dir_entry->num_sharers++;
 	assert(dir_entry->num_sharers <= dir->num_nodes);
+	dir_entry_update_active(dir, x, y, dir_entry, was_active);
 
 	/* Debug */
 	mem_trace("mem.set_sharer dir=\"%s\" x=%d y=%d z=%d sharer=%d\n",
@@ -150,17 +219,49 @@ void dir_entry_set_sharer(struct dir_t *dir, int x, int y, int z, int node)
 void dir_entry_clear_sharer(struct dir_t *dir, int x, int y, int z, int node)
 {
 	struct dir_entry_t *dir_entry;
+	unsigned long long *vector;
+	int was_active;
+	int sharer;
+	int i;
 
 	/* Nothing if sharer is not set */
-	dir_entry = dir_entry_get(dir, x, y, z);
 	assert(IN_RANGE(node, 0, dir->num_nodes - 1));
-	if (!(dir_entry->sharer[node / 8] & (1 << (node % 8))))
+	if (!dir_entry_is_sharer(dir, x, y, z, node))
 		return;
 
 	/* Clear sharer */
-	dir_entry->sharer[node / 8] &= ~(1 << (node % 8));
+	dir_entry = dir_entry_get(dir, x, y, z);
+	was_active = DIR_ENTRY_ACTIVE(dir_entry);
 	assert(dir_entry->num_sharers > 0);
+	if (dir->num_nodes <= DIR_ENTRY_WORD_NODES)
+	{
+		dir_entry->sharer.word &= ~(1ULL << node);
+	}
+	else if (!DIR_ENTRY_USES_VECTOR(dir_entry))
+	{
+		for (i = 0; dir_entry->sharer.pointer[i] != node; i++)
+			assert(i < dir_entry->num_sharers);
+		for (; i < dir_entry->num_sharers - 1; i++)
+			dir_entry->sharer.pointer[i] = dir_entry->sharer.pointer[i + 1];
+	}
+	else if (dir_entry->num_sharers > DIR_ENTRY_NUM_POINTERS + 1)
+	{
+		dir_entry->sharer.vector[node / 64] &= ~(1ULL << (node % 64));
+	}
+	else
+	{
+		/* Few enough sharers left to go back to pointers */
+		vector = dir_entry->sharer.vector;
+		vector[node / 64] &= ~(1ULL << (node % 64));
+		i = 0;
+		for (sharer = dir_bit_vector_next(vector, dir->num_words, 0); sharer >= 0;
+				sharer = dir_bit_vector_next(vector, dir->num_words, sharer + 1))
+			dir_entry->sharer.pointer[i++] = sharer;
+		assert(i == DIR_ENTRY_NUM_POINTERS);
+		free(vector);
+	}
 	dir_entry->num_sharers--;
+	dir_entry_update_active(dir, x, y, dir_entry, was_active);
 
 	/* Debug */
 	mem_trace("mem.clear_sharer dir=\"%s\" x=%d y=%d z=%d sharer=%d\n",
@@ -171,13 +272,16 @@ void dir_entry_clear_sharer(struct dir_t *dir, int x, int y, int z, int node)
 void dir_entry_clear_all_sharers(struct dir_t *dir, int x, int y, int z)
 {
 	struct dir_entry_t *dir_entry;
-	int i;
+	int was_active;
 
 	/* Clear sharers */
 	dir_entry = dir_entry_get(dir, x, y, z);
+	was_active = DIR_ENTRY_ACTIVE(dir_entry);
+	if (DIR_ENTRY_USES_VECTOR(dir_entry))
+		free(dir_entry->sharer.vector);
+	memset(&dir_entry->sharer, 0, sizeof dir_entry->sharer);
 	dir_entry->num_sharers = 0;
-	for (i = 0; i < DIR_ENTRY_SHARERS_SIZE; i++)
-		dir_entry->sharer[i] = 0;
+	dir_entry_update_active(dir, x, y, dir_entry, was_active);
 
 	/* Debug */
 	mem_trace("mem.clear_all_sharers dir=\"%s\" x=%d y=%d z=%d\n",
@@ -188,24 +292,45 @@ void dir_entry_clear_all_sharers(struct dir_t *dir, int x, int y, int z)
 int dir_entry_is_sharer(struct dir_t *dir, int x, int y, int z, int node)
 {
 	struct dir_entry_t *dir_entry;
+	int i;
 
 	assert(IN_RANGE(node, 0, dir->num_nodes - 1));
 	dir_entry = dir_entry_get(dir, x, y, z);
-	return (dir_entry->sharer[node / 8] & (1 << (node % 8))) > 0;
+	if (dir->num_nodes <= DIR_ENTRY_WORD_NODES)
+		return (dir_entry->sharer.word >> node) & 1;
+	if (DIR_ENTRY_USES_VECTOR(dir_entry))
+		return (dir_entry->sharer.vector[node / 64] >> (node % 64)) & 1;
+	for (i = 0; i < dir_entry->num_sharers; i++)
+		if (dir_entry->sharer.pointer[i] == node)
+			return 1;
+	return 0;
 }
 
 
-int dir_entry_group_shared_or_owned(struct dir_t *dir, int x, int y)
+/* Return the lowest sharer with an index equal to or greater than 'node',
+ * or -1 if there is none. Sharers of an entry can be visited in
+ * increasing order by starting at 0 and passing the last one plus 1. */
+int dir_entry_next_sharer(struct dir_t *dir, int x, int y, int z, int node)
 {
 	struct dir_entry_t *dir_entry;
-	int z;
-	for (z = 0; z < dir->zsize; z++)
-	{
-		dir_entry = DIR_ENTRY(x, y, z);
-		if (dir_entry->num_sharers || DIR_ENTRY_VALID_OWNER(dir_entry))
-			return 1;
-	}
-	return 0;
+	int i;
+
+	dir_entry = dir_entry_get(dir, x, y, z);
+	if (dir->num_nodes <= DIR_ENTRY_WORD_NODES)
+		return dir_bit_vector_next(&dir_entry->sharer.word, 1, node);
+	if (DIR_ENTRY_USES_VECTOR(dir_entry))
+		return dir_bit_vector_next(dir_entry->sharer.vector, dir->num_words, node);
+	for (i = 0; i < dir_entry->num_sharers; i++)
+		if (dir_entry->sharer.pointer[i] >= node)
+			return dir_entry->sharer.pointer[i];
+	return -1;
+}
+
+
+int dir_entry_group_shared_or_owned(struct dir_t *dir, int x, int y)
+{
+	assert(x < dir->xsize && y < dir->ysize);
+	return dir->num_active_entries[x * dir->ysize + y] > 0;
 }
 
 
@@ -328,6 +453,17 @@ void dir_entry_unlock(struct dir_t *dir, int x, int y)
 		dir_lock->lock_queue = dir_lock->lock_queue->dir_lock_next;
 	}
 
+	/* Restart all aborted accesses. They hold no locks and start over
+	 * from the top-level cache, so none of them can be left behind
+	 * waiting for an unlock that never comes. */
+	while (dir_lock->retry_queue)
+	{
+		stack = dir_lock->retry_queue;
+		mem_debug("    A-%lld retried\n", stack->id);
+		esim_schedule_event(stack->dir_lock_event, stack, 1);
+		dir_lock->retry_queue = stack->dir_lock_next;
+	}
+
 	/* Trace */
 	mem_trace("mem.end_access_block cache=\"%s\" access=\"A-%lld\" set=%d way=%d\n",
 		dir->name, dir_lock->stack_id, x, y);
@@ -336,3 +472,26 @@ void dir_entry_unlock(struct dir_t *dir, int x, int y)
 	dir_lock->lock = 0;
 }
 
+
+/* Make a non-blocking access that aborted on a locked entry wait until
+ * the entry is unlocked. Waiters are restarted in arrival order. */
+void dir_lock_wait_retry(struct dir_lock_t *dir_lock, int event, struct mod_stack_t *stack)
+{
+	struct mod_stack_t *lock_queue_iter;
+
+	/* Entry must be locked */
+	assert(dir_lock->lock);
+
+	/* Enqueue at the tail */
+	stack->dir_lock_event = event;
+	stack->dir_lock_next = NULL;
+	if (!dir_lock->retry_queue)
+	{
+		dir_lock->retry_queue = stack;
+		return;
+	}
+	lock_queue_iter = dir_lock->retry_queue;
+	while (lock_queue_iter->dir_lock_next)
+		lock_queue_iter = lock_queue_iter->dir_lock_next;
+	lock_queue_iter->dir_lock_next = stack;
+}
@@ -26,16 +26,39 @@ struct dir_lock_t
 	int lock;
 	long long stack_id;
 	struct mod_stack_t *lock_queue;
+
+	/* Non-blocking accesses that aborted because of this lock. They
+	 * are restarted when the entry is unlocked. */
+	struct mod_stack_t *retry_queue;
 };
 
 #define DIR_ENTRY_OWNER_NONE  (-1)
 #define DIR_ENTRY_VALID_OWNER(dir_entry)  ((dir_entry)->owner >= 0)
 
+/* Directories with up to this many nodes keep the sharers of an entry in
+ * one bit-vector word. */
+#define DIR_ENTRY_WORD_NODES  64
+
+/* In larger directories, an entry keeps up to this many sharers as a
+ * sorted list of node indices, and only switches to a bit vector
+ * allocated on demand when more nodes share the block. */
+#define DIR_ENTRY_NUM_POINTERS  4
+
 struct dir_entry_t
 {
 	int owner;  /* Node owning the block (-1 = No owner)*/
-	int num_sharers;  /* Number of 1s in next field */
-	unsigned char sharer[0];  /* Bitmap of sharers (must be last field) */
+	int num_sharers;  /* Number of sharers in next field */
+
+	/* Sharers. 'word' is used if the directory has at most
+	 * DIR_ENTRY_WORD_NODES nodes. Otherwise, 'pointer' is used while
+	 * there are at most DIR_ENTRY_NUM_POINTERS sharers, and 'vector'
+	 * beyond that. */
+	union
+	{
+		unsigned long long word;
+		unsigned short pointer[DIR_ENTRY_NUM_POINTERS];
+		unsigned long long *vector;
+	} sharer;
 };
 
 struct dir_t
@@ -43,9 +66,12 @@ struct dir_t
 	char *name;
 
 	/* Number of possible sharers for a block. This determines
-	 * the size of the directory entry bitmap. */
+	 * the representation of the sharers in each entry. */
 	int num_nodes;
 
+	/* Number of 64-bit words in a bit vector of sharers */
+	int num_words;
+
 	/* Width, height and depth of the directory. For caches, it is
 	 * useful to have a 3-dim directory. XSize is the number of
 	 * sets, YSize is the number of ways of the cache, and ZSize
@@ -57,9 +83,12 @@ struct dir_t
 	 * block, i.e. a set of zsize directory entries */
 	struct dir_lock_t *dir_lock;
 
-	/* Last field. This is an array of xsize*ysize*zsize elements of type
-	 * dir_entry_t, which have likewise variable size. */
-	unsigned char data[0];
+	/* Array of xsize * ysize counters. Each one is the number of
+	 * entries of a block that have an owner or at least one sharer. */
+	int *num_active_entries;
+
+	/* Array of xsize * ysize * zsize entries */
+	struct dir_entry_t *dir_entry;
 };
 
 struct dir_t *dir_create(char *name, int xsize, int ysize, int zsize, int num_nodes);
@@ -72,6 +101,7 @@ void dir_entry_set_sharer(struct dir_t *dir, int x, int y, int z, int node);
 void dir_entry_clear_sharer(struct dir_t *dir, int x, int y, int z, int node);
 void dir_entry_clear_all_sharers(struct dir_t *dir, int x, int y, int z);
 int dir_entry_is_sharer(struct dir_t *dir, int x, int y, int z, int node);
+int dir_entry_next_sharer(struct dir_t *dir, int x, int y, int z, int node);
 int dir_entry_group_shared_or_owned(struct dir_t *dir, int x, int y);
 
 void dir_entry_dump_sharers(struct dir_t *dir, int x, int y, int z);
@@ -79,6 +109,7 @@ void dir_entry_dump_sharers(struct dir_t *dir, int x, int y, int z);
 struct dir_lock_t *dir_lock_get(struct dir_t *dir, int x, int y);
 int dir_entry_lock(struct dir_t *dir, int x, int y, int event, struct mod_stack_t *stack);
 void dir_entry_unlock(struct dir_t *dir, int x, int y);
+void dir_lock_wait_retry(struct dir_lock_t *dir_lock, int event, struct mod_stack_t *stack);
 
 
 #endif
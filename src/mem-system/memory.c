@@ -18,11 +18,14 @@
  */
 
 #include <assert.h>
+#include <pthread.h>
+#include <sys/uio.h>
 
 #include <lib/mhandle/mhandle.h>
 #include <lib/util/misc.h>
 #include <lib/util/debug.h>
 
+#include "cache-sweep.h"
 #include "memory.h"
 
 
@@ -33,6 +36,10 @@ unsigned long mem_max_mapped_space = 0;
 /* Safe mode */
 int mem_safe_mode = 1;
 
+/* Thread-safe mode */
+int mem_thread_safe_mode = 0;
+static pthread_mutex_t mem_page_create_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 
 /* Return mem page corresponding to an address. */
 struct mem_page_t *mem_page_get(struct mem_t *mem, unsigned int addr)
@@ -53,7 +60,7 @@ struct mem_page_t *mem_page_get(struct mem_t *mem, unsigned int addr)
 	}
 	
 	/* Place page into list head */
-	if (prev && page)
+	if (prev && page && !mem_thread_safe_mode)
 	{
 		prev->next = page->next;
 		page->next = mem->pages[index];
@@ -119,8 +126,10 @@ static struct mem_page_t *mem_page_create(struct mem_t *mem, unsigned int addr,
 	page->tag = tag;
 	page->perm = perm;
 	
-	/* Insert in pages hash table */
+	/* Insert in pages hash table. The page is initialized before it becomes
+	 * visible to other threads looking it up. */
 	page->next = mem->pages[index];
+	__sync_synchronize();
 	mem->pages[index] = page;
 	mem_mapped_space += MEM_PAGE_SIZE;
 	mem_max_mapped_space = MAX(mem_max_mapped_space, mem_mapped_space);
@@ -130,6 +139,23 @@ static struct mem_page_t *mem_page_create(struct mem_t *mem, unsigned int addr,
 }
 
 
+/* Create a page in thread-safe mode, unless another thread created it first.
+ * Threads looking up pages at the same time find it in the page table only
+ * once it is fully initialized. */
+static struct mem_page_t *mem_page_create_locked(struct mem_t *mem,
+	unsigned int addr, int perm)
+{
+	struct mem_page_t *page;
+
+	pthread_mutex_lock(&mem_page_create_mutex);
+	page = mem_page_get(mem, addr);
+	if (!page)
+		page = mem_page_create(mem, addr, perm);
+	pthread_mutex_unlock(&mem_page_create_mutex);
+	return page;
+}
+
+
 /* Free mem pages */
 static void mem_page_free(struct mem_t *mem, unsigned int addr)
 {
@@ -162,6 +188,19 @@ static void mem_page_free(struct mem_t *mem, unsigned int addr)
 }
 
 
+/* Allocate the data of a page, initialized to zero. Two threads accessing the
+ * page for the first time might race to allocate it, in which case only one
+ * allocation survives. */
+static void mem_page_alloc_data(struct mem_page_t *page)
+{
+	unsigned char *data;
+
+	data = xcalloc(1, MEM_PAGE_SIZE);
+	if (!__sync_bool_compare_and_swap(&page->data, NULL, data))
+		free(data);
+}
+
+
 /* Copy memory pages. All parameters must be multiple of the page size.
  * The pages in the source and destination interval must exist. */
 void mem_copy(struct mem_t *mem, unsigned int dest, unsigned int src, int size)
@@ -231,19 +270,90 @@ void *mem_get_buffer(struct mem_t *mem, unsigned int addr, int size,
 	
 	/* Allocate and initialize page data if it does not exist yet. */
 	if (!page->data)
-		page->data = xcalloc(1, MEM_PAGE_SIZE);
+		mem_page_alloc_data(page);
+
+	/* The caller reads and/or writes the buffer directly */
+	if (cache_sweep_active && mem->cache_sweep_space)
+	{
+		if (access & mem_access_read)
+			cache_sweep_access(mem, addr, size, 0);
+		if (access & mem_access_write)
+			cache_sweep_access(mem, addr, size, 1);
+	}
 	
 	/* Return pointer to page data */
 	return page->data + offset;
 }
 
 
+/* Fill 'iov' with pointers to the page buffers holding the 'size' bytes at
+ * address 'addr', one element per page, so that the host can move data
+ * between a file and simulated memory with a single 'readv' or 'writev'.
+ * Page buffers are allocated, and pages are marked as modified for write
+ * accesses. The function returns the number of elements used, or -1 if more
+ * than 'max_count' elements are needed or if a page does not exist or lacks
+ * permissions. In the latter case, the caller should fall back to
+ * 'mem_access', which handles those cases depending on safe mode. */
+int mem_get_iovec(struct mem_t *mem, unsigned int addr, int size,
+	struct iovec *iov, int max_count, enum mem_access_t access)
+{
+	struct mem_page_t *page;
+	unsigned int offset;
+	int chunksize;
+	int count;
+	int i;
+
+	/* Number of pages */
+	if (size < 0)
+		return -1;
+	count = ((addr & (MEM_PAGE_SIZE - 1)) + (unsigned int) size +
+		MEM_PAGE_SIZE - 1) >> MEM_PAGE_SHIFT;
+	if (count > max_count)
+		return -1;
+
+	/* Check all pages first, so that no page is modified on failure */
+	for (i = 0; i < count; i++)
+	{
+		page = mem_page_get(mem, (addr & MEM_PAGE_MASK) + i * MEM_PAGE_SIZE);
+		if (!page || (page->perm & access) != access)
+			return -1;
+	}
+
+	/* Record access */
+	mem->last_address = addr;
+	if (cache_sweep_active && mem->cache_sweep_space &&
+			(access == mem_access_read || access == mem_access_write))
+		cache_sweep_access(mem, addr, size, access == mem_access_write);
+
+	/* Page spans */
+	for (i = 0; i < count; i++)
+	{
+		page = mem_page_get(mem, addr);
+		offset = addr & (MEM_PAGE_SIZE - 1);
+		chunksize = MIN(size, MEM_PAGE_SIZE - offset);
+
+		/* Page buffer */
+		if (!page->data)
+			mem_page_alloc_data(page);
+		if (access == mem_access_write)
+			page->perm |= mem_access_modif;
+		iov[i].iov_base = page->data + offset;
+		iov[i].iov_len = chunksize;
+
+		size -= chunksize;
+		addr += chunksize;
+	}
+	return count;
+}
+
+
 /* Access memory without exceeding page boundaries. */
 static void mem_access_page_boundary(struct mem_t *mem, unsigned int addr,
 	int size, void *buf, enum mem_access_t access)
 {
 	struct mem_page_t *page;
 	unsigned int offset;
+	int perm;
 
 	/* Find memory page and compute offset. */
 	page = mem_page_get(mem, addr);
@@ -263,16 +373,18 @@ static void mem_access_page_boundary(struct mem_t *mem, unsigned int addr,
 		}
 		if (access == mem_access_write || access == mem_access_init)
 		{
-			page = mem_page_create(mem, addr, mem_access_read |
-				mem_access_write | mem_access_exec |
-				mem_access_init);
+			perm = mem_access_read | mem_access_write |
+				mem_access_exec | mem_access_init;
+			page = mem_thread_safe_mode ?
+				mem_page_create_locked(mem, addr, perm) :
+				mem_page_create(mem, addr, perm);
 		}
 	}
 	assert(page);
 
 	/* If it is a write access, set the 'modified' flag in the page
 	 * attributes (perm). This is not done for 'initialize' access. */
-	if (access == mem_access_write)
+	if (access == mem_access_write && !(page->perm & mem_access_modif))
 		page->perm |= mem_access_modif;
 
 	/* Check permissions in safe mode */
@@ -293,7 +405,7 @@ static void mem_access_page_boundary(struct mem_t *mem, unsigned int addr,
 	if (access == mem_access_write || access == mem_access_init)
 	{
 		if (!page->data)
-			page->data = xcalloc(1, MEM_PAGE_SIZE);
+			mem_page_alloc_data(page);
 		memcpy(page->data + offset, buf, size);
 		return;
 	}
@@ -312,6 +424,9 @@ void mem_access(struct mem_t *mem, unsigned int addr, int size, void *buf,
 	int chunksize;
 
 	mem->last_address = addr;
+	if (cache_sweep_active && mem->cache_sweep_space &&
+			(access == mem_access_read || access == mem_access_write))
+		cache_sweep_access(mem, addr, size, access == mem_access_write);
 	while (size)
 	{
 		offset = addr & (MEM_PAGE_SIZE - 1);
@@ -337,6 +452,66 @@ void mem_write(struct mem_t *mem, unsigned int addr, int size, void *buf)
 }
 
 
+/* Copy 'size' bytes from address 'src_addr' in 'src_mem' into address
+ * 'dst_addr' in 'dst_mem', possibly a different memory space. Data moves
+ * directly between page buffers, one chunk at a time without crossing a page
+ * boundary in either space, with the same permission checks and page
+ * allocation policy as 'mem_read' followed by 'mem_write'. */
+void mem_transfer(struct mem_t *dst_mem, unsigned int dst_addr,
+	struct mem_t *src_mem, unsigned int src_addr, int size)
+{
+	static unsigned char zero_page[MEM_PAGE_SIZE];
+
+	struct mem_page_t *src_page;
+	unsigned int src_offset;
+	unsigned int dst_offset;
+	void *buf;
+	int chunksize;
+
+	/* Overlapping regions in the same space need an intermediate copy */
+	if (dst_mem == src_mem && ((src_addr < dst_addr && src_addr + size > dst_addr) ||
+		(dst_addr < src_addr && dst_addr + size > src_addr)))
+	{
+		buf = xmalloc(size);
+		mem_read(src_mem, src_addr, size, buf);
+		mem_write(dst_mem, dst_addr, size, buf);
+		free(buf);
+		return;
+	}
+
+	src_mem->last_address = src_addr;
+	dst_mem->last_address = dst_addr;
+	if (cache_sweep_active && src_mem->cache_sweep_space)
+		cache_sweep_access(src_mem, src_addr, size, 0);
+	if (cache_sweep_active && dst_mem->cache_sweep_space)
+		cache_sweep_access(dst_mem, dst_addr, size, 1);
+	while (size)
+	{
+		src_offset = src_addr & (MEM_PAGE_SIZE - 1);
+		dst_offset = dst_addr & (MEM_PAGE_SIZE - 1);
+		chunksize = MIN(size, MEM_PAGE_SIZE - MAX(src_offset, dst_offset));
+
+		/* Source data. A nonexistent page or a page without data reads
+		 * as zeros, unless safe mode forbids it. */
+		src_page = mem_page_get(src_mem, src_addr);
+		if (!src_page && src_mem->safe)
+			fatal("illegal access at 0x%x: page not allocated", src_addr);
+		if (src_page && src_mem->safe && !(src_page->perm & mem_access_read))
+			fatal("mem_access: permission denied at 0x%x", src_addr);
+		buf = src_page && src_page->data ? src_page->data + src_offset :
+			zero_page;
+
+		/* Write into destination page */
+		mem_access_page_boundary(dst_mem, dst_addr, chunksize, buf,
+			mem_access_write);
+
+		size -= chunksize;
+		src_addr += chunksize;
+		dst_addr += chunksize;
+	}
+}
+
+
 /* Creation and destruction */
 struct mem_t *mem_create()
 {
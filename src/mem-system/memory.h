@@ -40,6 +40,13 @@ enum mem_access_t
 /* Safe mode */
 extern int mem_safe_mode;
 
+/* Thread-safe mode. Nonzero while memory images are accessed by several host
+ * threads at a time, and incremented by each component launching them. Page
+ * lookups stop reordering the page table, which can then be read concurrently.
+ * Pages created by writes in unsafe mode are inserted under a lock. Pages can
+ * only be freed while no other thread is accessing the memory image. */
+extern int mem_thread_safe_mode;
+
 /* A 4KB page of memory */
 struct mem_page_t
 {
@@ -65,6 +72,10 @@ struct mem_t
 
 	/* Last accessed address */
 	unsigned int last_address;
+
+	/* State of the cache sweep for this memory space, or NULL if its
+	 * accesses are not part of the sweep (see 'cache_sweep_register_mem') */
+	struct cache_sweep_space_t *cache_sweep_space;
 };
 
 extern unsigned long mem_mapped_space;
@@ -93,12 +104,18 @@ void mem_copy(struct mem_t *mem, unsigned int dest, unsigned int src, int size);
 void mem_access(struct mem_t *mem, unsigned int addr, int size, void *buf, enum mem_access_t access);
 void mem_read(struct mem_t *mem, unsigned int addr, int size, void *buf);
 void mem_write(struct mem_t *mem, unsigned int addr, int size, void *buf);
+void mem_transfer(struct mem_t *dst_mem, unsigned int dst_addr,
+	struct mem_t *src_mem, unsigned int src_addr, int size);
 
 void mem_zero(struct mem_t *mem, unsigned int addr, int size);
 int mem_read_string(struct mem_t *mem, unsigned int addr, int size, char *str);
 void mem_write_string(struct mem_t *mem, unsigned int addr, char *str);
 void *mem_get_buffer(struct mem_t *mem, unsigned int addr, int size, enum mem_access_t access);
 
+struct iovec;
+int mem_get_iovec(struct mem_t *mem, unsigned int addr, int size,
+	struct iovec *iov, int max_count, enum mem_access_t access);
+
 void mem_dump(struct mem_t *mem, char *filename, unsigned int start, unsigned int end);
 void mem_load(struct mem_t *mem, char *filename, unsigned int start);
 
@@ -25,6 +25,7 @@
 #include <lib/util/debug.h>
 
 #include "cache.h"
+#include "directory.h"
 #include "mem-system.h"
 #include "mod-stack.h"
 
@@ -166,12 +167,53 @@ void mod_stack_wakeup_stack(struct mod_stack_t *master_stack)
 		DOUBLE_LINKED_LIST_REMOVE(master_stack, waiting, stack);
 		esim_schedule_event(event, stack, 0);
 		mem_debug(" %lld", stack->id);
+
+		/* The master stack is about to be freed, while the coalesced
+		 * access stays in flight until its finish event. Accesses
+		 * coalescing with it from now on must wait in it instead. */
+		if (stack->master_stack == master_stack)
+			stack->master_stack = NULL;
 	}
 
 	/* Debug */
 	mem_debug("\n");
 }
 
+
+/* Record the directory lock that made a non-blocking access abort. The
+ * lock is stored in the top-level stack of the access, which is the one
+ * retrying it. */
+void mod_stack_set_retry_lock(struct mod_stack_t *stack, struct dir_lock_t *dir_lock)
+{
+	while (stack->ret_stack)
+		stack = stack->ret_stack;
+	stack->retry_dir_lock = dir_lock;
+}
+
+
+/* Retry an aborted access. Instead of polling after a random delay, the
+ * access sleeps until the directory entry it conflicted with is unlocked. */
+void mod_stack_retry(struct mod_stack_t *stack, int event)
+{
+	struct dir_lock_t *dir_lock;
+
+	dir_lock = stack->retry_dir_lock;
+	stack->retry_dir_lock = NULL;
+	stack->retry = 1;
+
+	/* Entry still locked */
+	if (dir_lock && dir_lock->lock)
+	{
+		mem_debug("    lock error, waiting for A-%lld\n", dir_lock->stack_id);
+		dir_lock_wait_retry(dir_lock, event, stack);
+		return;
+	}
+
+	/* Entry already released */
+	mem_debug("    lock error, retrying\n");
+	esim_schedule_event(event, stack, 1);
+}
+
 /* Set a reply value that has a precedence order.  This is required
  * when multiple subblocks all return replies.  An alternative would
  * be to store each reply and scan them all before deciding an action. */
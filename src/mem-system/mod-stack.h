@@ -149,6 +149,10 @@ struct mod_stack_t
 	int dir_lock_event;
 	struct mod_stack_t *dir_lock_next;
 
+	/* Directory lock that made the access abort. Only set in the
+	 * top-level stack of an access, and consumed on retry. */
+	struct dir_lock_t *retry_dir_lock;
+
 	/* Return stack */
 	struct mod_stack_t *ret_stack;
 	int ret_event;
@@ -170,6 +174,9 @@ void mod_stack_wait_in_stack(struct mod_stack_t *stack,
 	struct mod_stack_t *master_stack, int event);
 void mod_stack_wakeup_stack(struct mod_stack_t *master_stack);
 
+void mod_stack_set_retry_lock(struct mod_stack_t *stack, struct dir_lock_t *dir_lock);
+void mod_stack_retry(struct mod_stack_t *stack, int event);
+
 
 #endif
 
@@ -19,6 +19,7 @@
 #include <assert.h>
 
 #include <lib/esim/esim.h>
+#include <lib/esim/interval.h>
 #include <lib/mhandle/mhandle.h>
 #include <lib/util/debug.h>
 #include <lib/util/linked-list.h>
@@ -26,6 +27,7 @@
 #include <lib/util/string.h>
 #include <lib/util/repos.h>
 
+#include "access-trace.h"
 #include "cache.h"
 #include "directory.h"
 #include "local-mem-protocol.h"
@@ -79,6 +81,21 @@ struct mod_t *mod_create(char *name, enum mod_kind_t kind, int num_ports,
 	mod->log_block_size = log_base2(block_size);
 
 	mod->client_info_repos = repos_create(sizeof(struct mod_client_info_t), mod->name);
+
+	/* Interval statistics. The number of accesses in flight gives the
+	 * occupancy of the MSHR. */
+	if (esim_interval_active)
+	{
+		esim_interval_register_counter(&mod->reads, "mod.%s.Reads", name);
+		esim_interval_register_counter(&mod->read_hits, "mod.%s.ReadHits", name);
+		esim_interval_register_counter(&mod->read_misses, "mod.%s.ReadMisses", name);
+		esim_interval_register_counter(&mod->writes, "mod.%s.Writes", name);
+		esim_interval_register_counter(&mod->write_hits, "mod.%s.WriteHits", name);
+		esim_interval_register_counter(&mod->write_misses, "mod.%s.WriteMisses", name);
+		esim_interval_register_counter(&mod->evictions, "mod.%s.Evictions", name);
+		esim_interval_register_gauge(&mod->access_list_count, "mod.%s.MSHR", name);
+	}
+
 	return mod;
 }
 
@@ -123,6 +140,12 @@ long long mod_access(struct mod_t *mod, enum mod_access_kind_t access_kind,
 	struct mod_stack_t *stack;
 	int event;
 
+	/* Record access. Prefetches with no way to notify completion come from
+	 * the hardware prefetcher, which issues them again on replay. */
+	if (access_trace_capture_active && (access_kind != mod_access_prefetch ||
+			witness_ptr || event_queue))
+		access_trace_capture(mod, access_kind, addr, client_info);
+
 	/* Create module stack with new ID */
 	mod_stack_id++;
 	stack = mod_stack_create(mod_stack_id,
@@ -220,7 +243,6 @@ int mod_find_block(struct mod_t *mod, unsigned int addr, int *set_ptr,
 		int *way_ptr, int *tag_ptr, int *state_ptr)
 {
 	struct cache_t *cache = mod->cache;
-	struct cache_block_t *blk;
 	struct dir_lock_t *dir_lock;
 
 	int set;
@@ -244,12 +266,12 @@ int mod_find_block(struct mod_t *mod, unsigned int addr, int *set_ptr,
 		panic("%s: invalid range kind (%d)", __FUNCTION__, mod->range_kind);
 	}
 
-	for (way = 0; way < cache->assoc; way++)
+	for (way = cache_find_tag(cache, set, 0, tag); way < cache->assoc;
+			way = cache_find_tag(cache, set, way + 1, tag))
 	{
-		blk = &cache->sets[set].blocks[way];
-		if (blk->tag == tag && blk->state)
+		if (cache->sets[set].tag[way] == tag && cache->sets[set].state[way])
 			break;
-		if (blk->transient_tag == tag)
+		if (cache->sets[set].transient_tag[way] == tag)
 		{
 			dir_lock = dir_lock_get(mod->dir, set, way);
 			if (dir_lock->lock)
@@ -262,7 +284,7 @@ int mod_find_block(struct mod_t *mod, unsigned int addr, int *set_ptr,
 
 	/* Miss */
 	if (way == cache->assoc ||
-			cache->sets[set].blocks[way].state == cache_block_invalid)
+			cache->sets[set].state[way] == cache_block_invalid)
 	{
 		/*
 		PTR_ASSIGN(way_ptr, 0);
@@ -273,7 +295,7 @@ int mod_find_block(struct mod_t *mod, unsigned int addr, int *set_ptr,
 
 	/* Hit */
 	PTR_ASSIGN(way_ptr, way);
-	PTR_ASSIGN(state_ptr, cache->sets[set].blocks[way].state);
+	PTR_ASSIGN(state_ptr, cache->sets[set].state[way]);
 	return 1;
 }
 
@@ -284,7 +306,7 @@ void mod_block_set_prefetched(struct mod_t *mod, unsigned int addr, int val)
 	assert(mod->kind == mod_kind_cache && mod->cache != NULL);
 	if (mod->cache->prefetcher && mod_find_block(mod, addr, &set, &way, NULL, NULL))
 	{
-		mod->cache->sets[set].blocks[way].prefetched = val;
+		mod->cache->sets[set].prefetched[way] = val;
 	}
 }
 
@@ -295,7 +317,7 @@ int mod_block_get_prefetched(struct mod_t *mod, unsigned int addr)
 	assert(mod->kind == mod_kind_cache && mod->cache != NULL);
 	if (mod->cache->prefetcher && mod_find_block(mod, addr, &set, &way, NULL, NULL))
 	{
-		return mod->cache->sets[set].blocks[way].prefetched;
+		return mod->cache->sets[set].prefetched[way];
 	}
 
 	return 0;
@@ -563,15 +585,6 @@ struct mod_t *mod_get_low_mod(struct mod_t *mod, unsigned int addr)
 }
 
 
-int mod_get_retry_latency(struct mod_t *mod)
-{
-	/* DEV - To support a data latency of zero, we must ensure that at least
-	 * one of the following values is non-zero so that the modulo operation
-	 * will work.  Using two instead of one to avoid livelock situations. */
-	return random() % (mod->data_latency + 2);
-}
-
-
 /* Check if an access to a module can be coalesced with another access older
  * than 'older_than_stack'. If 'older_than_stack' is NULL, check if it can
  * be coalesced with any in-flight access.
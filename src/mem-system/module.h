@@ -290,8 +290,6 @@ struct mod_stack_t *mod_in_flight_write(struct mod_t *mod,
 int mod_serves_address(struct mod_t *mod, unsigned int addr);
 struct mod_t *mod_get_low_mod(struct mod_t *mod, unsigned int addr);
 
-int mod_get_retry_latency(struct mod_t *mod);
-
 struct mod_stack_t *mod_can_coalesce(struct mod_t *mod,
 	enum mod_access_kind_t access_kind, unsigned int addr,
 	struct mod_stack_t *older_than_stack);
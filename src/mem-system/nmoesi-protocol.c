@@ -216,8 +216,6 @@ void mod_handler_nmoesi_load(int event, void *data)
 
 	if (event == EV_MOD_NMOESI_LOAD_ACTION)
 	{
-		int retry_lat;
-
 		mem_debug("  %lld %lld 0x%x %s load action\n", esim_time, stack->id,
 				stack->addr, mod->name);
 		mem_trace("mem.access name=\"A-%lld\" state=\"%s:load_action\"\n",
@@ -226,10 +224,7 @@ void mod_handler_nmoesi_load(int event, void *data)
 		/* Error locking */
 		if (stack->err)
 		{
-			retry_lat = mod_get_retry_latency(mod);
-			mem_debug("    lock error, retrying in %d cycles\n", retry_lat);
-			stack->retry = 1;
-			esim_schedule_event(EV_MOD_NMOESI_LOAD_LOCK, stack, retry_lat);
+			mod_stack_retry(stack, EV_MOD_NMOESI_LOAD_LOCK);
 			return;
 		}
 
@@ -262,8 +257,6 @@ void mod_handler_nmoesi_load(int event, void *data)
 
 	if (event == EV_MOD_NMOESI_LOAD_MISS)
 	{
-		int retry_lat;
-
 		mem_debug("  %lld %lld 0x%x %s load miss\n", esim_time, stack->id,
 				stack->addr, mod->name);
 		mem_trace("mem.access name=\"A-%lld\" state=\"%s:load_miss\"\n",
@@ -272,11 +265,8 @@ void mod_handler_nmoesi_load(int event, void *data)
 		/* Error on read request. Unlock block and retry load. */
 		if (stack->err)
 		{
-			retry_lat = mod_get_retry_latency(mod);
 			dir_entry_unlock(mod->dir, stack->set, stack->way);
-			mem_debug("    lock error, retrying in %d cycles\n", retry_lat);
-			stack->retry = 1;
-			esim_schedule_event(EV_MOD_NMOESI_LOAD_LOCK, stack, retry_lat);
+			mod_stack_retry(stack, EV_MOD_NMOESI_LOAD_LOCK);
 			return;
 		}
 
@@ -423,8 +413,6 @@ void mod_handler_nmoesi_store(int event, void *data)
 
 	if (event == EV_MOD_NMOESI_STORE_ACTION)
 	{
-		int retry_lat;
-
 		mem_debug("  %lld %lld 0x%x %s store action\n", esim_time, stack->id,
 				stack->addr, mod->name);
 		mem_trace("mem.access name=\"A-%lld\" state=\"%s:store_action\"\n",
@@ -433,10 +421,7 @@ void mod_handler_nmoesi_store(int event, void *data)
 		/* Error locking */
 		if (stack->err)
 		{
-			retry_lat = mod_get_retry_latency(mod);
-			mem_debug("    lock error, retrying in %d cycles\n", retry_lat);
-			stack->retry = 1;
-			esim_schedule_event(EV_MOD_NMOESI_STORE_LOCK, stack, retry_lat);
+			mod_stack_retry(stack, EV_MOD_NMOESI_STORE_LOCK);
 			return;
 		}
 
@@ -470,8 +455,6 @@ void mod_handler_nmoesi_store(int event, void *data)
 
 	if (event == EV_MOD_NMOESI_STORE_UNLOCK)
 	{
-		int retry_lat;
-
 		mem_debug("  %lld %lld 0x%x %s store unlock\n", esim_time, stack->id,
 				stack->addr, mod->name);
 		mem_trace("mem.access name=\"A-%lld\" state=\"%s:store_unlock\"\n",
@@ -480,11 +463,8 @@ void mod_handler_nmoesi_store(int event, void *data)
 		/* Error in write request, unlock block and retry store. */
 		if (stack->err)
 		{
-			retry_lat = mod_get_retry_latency(mod);
 			dir_entry_unlock(mod->dir, stack->set, stack->way);
-			mem_debug("    lock error, retrying in %d cycles\n", retry_lat);
-			stack->retry = 1;
-			esim_schedule_event(EV_MOD_NMOESI_STORE_LOCK, stack, retry_lat);
+			mod_stack_retry(stack, EV_MOD_NMOESI_STORE_LOCK);
 			return;
 		}
 
@@ -621,8 +601,6 @@ void mod_handler_nmoesi_nc_store(int event, void *data)
 
 	if (event == EV_MOD_NMOESI_NC_STORE_WRITEBACK)
 	{
-		int retry_lat;
-
 		mem_debug("  %lld %lld 0x%x %s nc store writeback\n", esim_time,
 				stack->id, stack->addr, mod->name);
 		mem_trace("mem.access name=\"A-%lld\" state=\"%s:nc_store_writeback\"\n",
@@ -631,12 +609,7 @@ void mod_handler_nmoesi_nc_store(int event, void *data)
 		/* Error locking */
 		if (stack->err)
 		{
-			retry_lat = mod_get_retry_latency(mod);
-			mem_debug("    lock error, retrying in %d cycles\n", 
-					retry_lat);
-			stack->retry = 1;
-			esim_schedule_event(EV_MOD_NMOESI_NC_STORE_LOCK, stack,
-					retry_lat);
+			mod_stack_retry(stack, EV_MOD_NMOESI_NC_STORE_LOCK);
 			return;
 		}
 
@@ -660,8 +633,6 @@ void mod_handler_nmoesi_nc_store(int event, void *data)
 
 	if (event == EV_MOD_NMOESI_NC_STORE_ACTION)
 	{
-		int retry_lat;
-
 		mem_debug("  %lld %lld 0x%x %s nc store action\n", esim_time, stack->id,
 				stack->addr, mod->name);
 		mem_trace("mem.access name=\"A-%lld\" state=\"%s:nc_store_action\"\n",
@@ -670,10 +641,7 @@ void mod_handler_nmoesi_nc_store(int event, void *data)
 		/* Error locking */
 		if (stack->err)
 		{
-			retry_lat = mod_get_retry_latency(mod);
-			mem_debug("    lock error, retrying in %d cycles\n", retry_lat);
-			stack->retry = 1;
-			esim_schedule_event(EV_MOD_NMOESI_NC_STORE_LOCK, stack, retry_lat);
+			mod_stack_retry(stack, EV_MOD_NMOESI_NC_STORE_LOCK);
 			return;
 		}
 
@@ -722,8 +690,6 @@ void mod_handler_nmoesi_nc_store(int event, void *data)
 
 	if (event == EV_MOD_NMOESI_NC_STORE_MISS)
 	{
-		int retry_lat;
-
 		mem_debug("  %lld %lld 0x%x %s nc store miss\n", esim_time, stack->id,
 				stack->addr, mod->name);
 		mem_trace("mem.access name=\"A-%lld\" state=\"%s:nc_store_miss\"\n",
@@ -732,11 +698,8 @@ void mod_handler_nmoesi_nc_store(int event, void *data)
 		/* Error on read request. Unlock block and retry nc store. */
 		if (stack->err)
 		{
-			retry_lat = mod_get_retry_latency(mod);
 			dir_entry_unlock(mod->dir, stack->set, stack->way);
-			mem_debug("    lock error, retrying in %d cycles\n", retry_lat);
-			stack->retry = 1;
-			esim_schedule_event(EV_MOD_NMOESI_NC_STORE_LOCK, stack, retry_lat);
+			mod_stack_retry(stack, EV_MOD_NMOESI_NC_STORE_LOCK);
 			return;
 		}
 
@@ -1224,6 +1187,7 @@ void mod_handler_nmoesi_find_and_lock(int event, void *data)
 					stack->id, stack->tag, mod->name, stack->set,
 					stack->way, dir_lock->stack_id);
 			ret->err = 1;
+			mod_stack_set_retry_lock(stack, dir_lock);
 			mod_unlock_port(mod, port, stack);
 			ret->port_locked = 0;
 			mod_stack_return(stack);
@@ -3249,14 +3213,12 @@ void mod_handler_nmoesi_invalidate(int event, void *data)
 			dir_entry_tag = stack->tag + z * mod->sub_block_size;
 			assert(dir_entry_tag < stack->tag + mod->block_size);
 			dir_entry = dir_entry_get(dir, stack->set, stack->way, z);
-			for (i = 0; i < dir->num_nodes; i++)
+			for (i = dir_entry_next_sharer(dir, stack->set, stack->way, z, 0); i >= 0;
+					i = dir_entry_next_sharer(dir, stack->set, stack->way, z, i + 1))
 			{
 				struct net_node_t *node;
 
-				/* Skip non-sharers and 'except_mod' */
-				if (!dir_entry_is_sharer(dir, stack->set, stack->way, z, i))
-					continue;
-
+				/* Skip 'except_mod' */
 				node = list_get(mod->high_net->node_list, i);
 				sharer = node->user_data;
 				if (sharer == stack->except_mod)
@@ -304,8 +304,6 @@ void mod_handler_nmoesi_load_wt(int event, void *data)
 
 	if (event == EV_MOD_NMOESI_LOAD_ACTION_WT)
 	{
-		int retry_lat;
-
 		mem_debug("  %lld %lld 0x%x %s load action\n", esim_time, stack->id,
 				stack->addr, mod->name);
 		mem_trace("mem.access name=\"A-%lld\" state=\"%s:load_action\"\n",
@@ -314,10 +312,7 @@ void mod_handler_nmoesi_load_wt(int event, void *data)
 		/* Error locking */
 		if (stack->err)
 		{
-			retry_lat = mod_get_retry_latency(mod);
-			mem_debug("    lock error, retrying in %d cycles\n", retry_lat);
-			stack->retry = 1;
-			esim_schedule_event(EV_MOD_NMOESI_LOAD_LOCK_WT, stack, retry_lat);
+			mod_stack_retry(stack, EV_MOD_NMOESI_LOAD_LOCK_WT);
 			return;
 		}
 
@@ -350,8 +345,6 @@ void mod_handler_nmoesi_load_wt(int event, void *data)
 
 	if (event == EV_MOD_NMOESI_LOAD_MISS_WT)
 	{
-		int retry_lat;
-
 		mem_debug("  %lld %lld 0x%x %s load miss\n", esim_time, stack->id,
 				stack->addr, mod->name);
 		mem_trace("mem.access name=\"A-%lld\" state=\"%s:load_miss\"\n",
@@ -360,11 +353,8 @@ void mod_handler_nmoesi_load_wt(int event, void *data)
 		/* Error on read request. Unlock block and retry load. */
 		if (stack->err)
 		{
-			retry_lat = mod_get_retry_latency(mod);
 			dir_entry_unlock(mod->dir, stack->set, stack->way);
-			mem_debug("    lock error, retrying in %d cycles\n", retry_lat);
-			stack->retry = 1;
-			esim_schedule_event(EV_MOD_NMOESI_LOAD_LOCK_WT, stack, retry_lat);
+			mod_stack_retry(stack, EV_MOD_NMOESI_LOAD_LOCK_WT);
 			return;
 		}
 
@@ -512,8 +502,6 @@ void mod_handler_nmoesi_store_wt(int event, void *data)
 
 	if (event == EV_MOD_NMOESI_STORE_ACTION_WT)
 	{
-		int retry_lat;
-
 		mem_debug("  %lld %lld 0x%x %s store action\n", esim_time, stack->id,
 				stack->addr, mod->name);
 		mem_trace("mem.access name=\"A-%lld\" state=\"%s:store_action\"\n",
@@ -522,10 +510,7 @@ void mod_handler_nmoesi_store_wt(int event, void *data)
 		/* Error locking */
 		if (stack->err)
 		{
-			retry_lat = mod_get_retry_latency(mod);
-			mem_debug("    lock error, retrying in %d cycles\n", retry_lat);
-			stack->retry = 1;
-			esim_schedule_event(EV_MOD_NMOESI_STORE_LOCK_WT, stack, retry_lat);
+			mod_stack_retry(stack, EV_MOD_NMOESI_STORE_LOCK_WT);
 			return;
 		}
 
@@ -559,8 +544,6 @@ void mod_handler_nmoesi_store_wt(int event, void *data)
 
 	if (event == EV_MOD_NMOESI_STORE_UNLOCK_WT)
 	{
-		int retry_lat;
-
 		mem_debug("  %lld %lld 0x%x %s store unlock\n", esim_time, stack->id,
 				stack->addr, mod->name);
 		mem_trace("mem.access name=\"A-%lld\" state=\"%s:store_unlock\"\n",
@@ -569,11 +552,8 @@ void mod_handler_nmoesi_store_wt(int event, void *data)
 		/* Error in write request, unlock block and retry store. */
 		if (stack->err)
 		{
-			retry_lat = mod_get_retry_latency(mod);
 			dir_entry_unlock(mod->dir, stack->set, stack->way);
-			mem_debug("    lock error, retrying in %d cycles\n", retry_lat);
-			stack->retry = 1;
-			esim_schedule_event(EV_MOD_NMOESI_STORE_LOCK_WT, stack, retry_lat);
+			mod_stack_retry(stack, EV_MOD_NMOESI_STORE_LOCK_WT);
 			return;
 		}
 
@@ -700,8 +680,6 @@ void mod_handler_nmoesi_nc_store_wt(int event, void *data)
 	/*
 	if (event == EV_MOD_NMOESI_NC_STORE_WRITEBACK)
 	{
-		int retry_lat;
-
 		mem_debug("  %lld %lld 0x%x %s nc store writeback\n", esim_time, stack->id,
 			stack->addr, mod->name);
 		mem_trace("mem.access name=\"A-%lld\" state=\"%s:nc_store_writeback\"\n",
@@ -711,10 +689,7 @@ void mod_handler_nmoesi_nc_store_wt(int event, void *data)
 		if (stack->err)
 		{
 			mod->nc_write_retries++;
-			retry_lat = mod_get_retry_latency(mod);
-			mem_debug("    lock error, retrying in %d cycles\n", retry_lat);
-			stack->retry = 1;
-			esim_schedule_event(EV_MOD_NMOESI_NC_STORE_LOCK, stack, retry_lat);
+			mod_stack_retry(stack, EV_MOD_NMOESI_NC_STORE_LOCK);
 			return;
 		}
 
@@ -736,7 +711,6 @@ void mod_handler_nmoesi_nc_store_wt(int event, void *data)
 	 */
 	if (event == EV_MOD_NMOESI_NC_STORE_ACTION_WT)
 	{
-		int retry_lat;
 		stack->pending = 1;
 
 		mem_debug("  %lld %lld 0x%x %s nc store action\n", esim_time, stack->id,
@@ -747,10 +721,7 @@ void mod_handler_nmoesi_nc_store_wt(int event, void *data)
 		/* Error locking */
 		if (stack->err)
 		{
-			retry_lat = mod_get_retry_latency(mod);
-			mem_debug("    lock error, retrying in %d cycles\n", retry_lat);
-			stack->retry = 1;
-			esim_schedule_event(EV_MOD_NMOESI_NC_STORE_LOCK_WT, stack, retry_lat);
+			mod_stack_retry(stack, EV_MOD_NMOESI_NC_STORE_LOCK_WT);
 			return;
 		}
 
@@ -831,11 +802,8 @@ void mod_handler_nmoesi_nc_store_wt(int event, void *data)
 					stack->id, mod->name);
 			/*
 			mod->nc_write_retries++;
-			retry_lat = mod_get_retry_latency(mod);
 			dir_entry_unlock(mod->dir, stack->set, stack->way);
-			mem_debug("    lock error, retrying in %d cycles\n", retry_lat);
-			stack->retry = 1;
-			esim_schedule_event(EV_MOD_NMOESI_NC_STORE_LOCK, stack, retry_lat);
+			mod_stack_retry(stack, EV_MOD_NMOESI_NC_STORE_LOCK);
 			return; */
 		}
 
@@ -1060,6 +1028,7 @@ void mod_handler_nmoesi_find_and_lock_read_wt(int event, void *data)
 			mem_debug("    %lld 0x%x %s block locked at set=%d, way=%d by A-%lld - aborting\n",
 					stack->id, stack->tag, mod->name, stack->set, stack->way, dir_lock->stack_id);
 			ret->err = 1;
+			mod_stack_set_retry_lock(stack, dir_lock);
 			mod_unlock_port(mod, port, stack);
 			ret->port_locked = 0;
 			mod_stack_return(stack);
@@ -2788,6 +2757,7 @@ void mod_handler_nmoesi_find_and_lock_write_wt(int event, void *data)
 				mem_debug("    %lld 0x%x %s block locked at set=%d, way=%d by A-%lld - aborting\n",
 						stack->id, stack->tag, mod->name, stack->set, stack->way, dir_lock->stack_id);
 				ret->err = 1;
+				mod_stack_set_retry_lock(stack, dir_lock);
 				mod_unlock_port(mod, port, stack);
 				ret->port_locked = 0;
 				mod_stack_return(stack);
@@ -46,6 +46,7 @@ struct net_buffer_t *net_buffer_create(struct net_t *net,
 	buffer = xcalloc(1, sizeof(struct net_buffer_t));
 	buffer->msg_list = list_create();
 	buffer->wakeup_list = linked_list_create();
+	buffer->sched_wait_queue = net_wait_queue_create();
 	buffer->net = net;
 	buffer->node = node;
 	buffer->name = xstrdup(name);
@@ -64,6 +65,7 @@ void net_buffer_free(struct net_buffer_t *buffer)
 	LINKED_LIST_FOR_EACH(buffer->wakeup_list)
 		free(linked_list_get(buffer->wakeup_list));
 	linked_list_free(buffer->wakeup_list);
+	net_wait_queue_free(buffer->sched_wait_queue);
 
 	/* Free rest */
 	list_free(buffer->msg_list);
@@ -199,6 +201,7 @@ void net_buffer_wait(struct net_buffer_t *buffer, int event, void *stack)
 	/* Add it to wakeup list */
 	wakeup->event = event;
 	wakeup->stack = stack;
+	wakeup->cycle = esim_domain_cycle(net_domain_index);
 	linked_list_add(buffer->wakeup_list, wakeup);
 }
 
@@ -222,6 +225,107 @@ void net_buffer_wakeup(struct net_buffer_t *buffer)
 }
 
 
+/* Create a wait queue for packets losing the arbitration of a resource */
+struct net_wait_queue_t *net_wait_queue_create(void)
+{
+	struct net_wait_queue_t *queue;
+
+	/* Initialize */
+	queue = xcalloc(1, sizeof(struct net_wait_queue_t));
+	queue->wakeup_list = linked_list_create();
+
+	/* Return */
+	return queue;
+}
+
+
+void net_wait_queue_free(struct net_wait_queue_t *queue)
+{
+	LINKED_LIST_FOR_EACH(queue->wakeup_list)
+		free(linked_list_get(queue->wakeup_list));
+	linked_list_free(queue->wakeup_list);
+	free(queue);
+}
+
+
+/* Called by a packet that lost the arbitration of the resource in the current
+ * cycle. The first loser in the cycle retries in the next one, and the others
+ * are queued until 'net_wait_queue_wakeup' is called by the winner, or until
+ * the retry calls 'net_wait_queue_wakeup_stale'. */
+void net_wait_queue_wait(struct net_wait_queue_t *queue, int event, void *stack)
+{
+	struct net_buffer_wakeup_t *wakeup;
+	long long cycle;
+
+	/* No event */
+	if (event == ESIM_EV_NONE)
+		return;
+
+	/* First loser in this cycle retries in the next one */
+	cycle = esim_domain_cycle(net_domain_index);
+	if (queue->retry_cycle != cycle + 1)
+	{
+		queue->retry_cycle = cycle + 1;
+		esim_schedule_event(event, stack, 1);
+		return;
+	}
+
+	/* Sleep */
+	wakeup = xmalloc(sizeof(struct net_buffer_wakeup_t));
+	wakeup->event = event;
+	wakeup->stack = stack;
+	wakeup->cycle = cycle;
+	linked_list_add(queue->wakeup_list, wakeup);
+}
+
+
+/* Called by the winner of the arbitration when it occupies the resource.
+ * Waiting events are scheduled 'after' cycles later, when they should
+ * compete for the resource again. */
+void net_wait_queue_wakeup(struct net_wait_queue_t *queue, int after)
+{
+	struct net_buffer_wakeup_t *wakeup;
+
+	assert(after > 0);
+	while (linked_list_count(queue->wakeup_list))
+	{
+		/* Get event/stack */
+		linked_list_head(queue->wakeup_list);
+		wakeup = linked_list_get(queue->wakeup_list);
+		linked_list_remove(queue->wakeup_list);
+
+		/* Schedule event */
+		esim_schedule_event(wakeup->event, wakeup->stack, after);
+		free(wakeup);
+	}
+}
+
+
+/* Called before arbitrating for the resource. Events that have been waiting
+ * since a previous cycle in which the winner did not occupy the resource are
+ * scheduled in the current cycle, as if they had kept retrying. */
+void net_wait_queue_wakeup_stale(struct net_wait_queue_t *queue)
+{
+	struct net_buffer_wakeup_t *wakeup;
+	long long cycle;
+
+	cycle = esim_domain_cycle(net_domain_index);
+	while (linked_list_count(queue->wakeup_list))
+	{
+		/* Events are sorted by waiting cycle */
+		linked_list_head(queue->wakeup_list);
+		wakeup = linked_list_get(queue->wakeup_list);
+		if (wakeup->cycle >= cycle)
+			break;
+		linked_list_remove(queue->wakeup_list);
+
+		/* Schedule event */
+		esim_schedule_event(wakeup->event, wakeup->stack, 0);
+		free(wakeup);
+	}
+}
+
+
 /* Update occupancy statistic */
 void net_buffer_update_occupancy(struct net_buffer_t *buffer)
 {
@@ -25,12 +25,28 @@
 #include "message.h"
 
 
-/* Event to be scheduled when space released in buffer */
+/* Event to be scheduled when space released in buffer, or when a resource
+ * lost in arbitration is occupied by the winner */
 struct net_buffer_wakeup_t
 {
 	int event;
 	void *stack;
+	long long cycle;	/* Cycle when the event started waiting */
+};
+
+/* Wait queue for packets that lost the arbitration of a shared resource (the
+ * virtual channels of a link, the lanes of a bus, or a switch output buffer).
+ * The first loser in a cycle retries in the next cycle, while the rest sleep
+ * until the winner occupies the resource. If the winner did not occupy it,
+ * the sleeping losers are woken up by the first loser's retry. This keeps the
+ * same arbitration cycles as polling every cycle. */
+struct net_wait_queue_t
+{
+	/* Cycle when the first loser of the last contended cycle retries */
+	long long retry_cycle;
 
+	/* Elements of type 'struct net_buffer_wakeup_t' */
+	struct linked_list_t *wakeup_list;
 };
 
 enum net_buffer_kind_t
@@ -68,6 +84,7 @@ struct net_buffer_t
 	/* Scheduling for output buffers */
 	long long sched_when;	/* Last cycle when scheduler was called */
 	struct net_buffer_t *sched_buffer;	/* Input buffer to fetch from */
+	struct net_wait_queue_t *sched_wait_queue;	/* Packets that lost the switch */
 
 	/* List of events to schedule when new space becomes available in the 
 	 * buffer. Elements are of type 'struct net_buffer_wakeup_t' */
@@ -98,5 +115,12 @@ void net_buffer_wakeup(struct net_buffer_t *buffer);
 
 void net_buffer_update_occupancy(struct net_buffer_t *buffer);
 
+struct net_wait_queue_t *net_wait_queue_create(void);
+void net_wait_queue_free(struct net_wait_queue_t *queue);
+
+void net_wait_queue_wait(struct net_wait_queue_t *queue, int event, void *stack);
+void net_wait_queue_wakeup(struct net_wait_queue_t *queue, int after);
+void net_wait_queue_wakeup_stale(struct net_wait_queue_t *queue);
+
 
 #endif
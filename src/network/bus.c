@@ -23,6 +23,7 @@
 #include <lib/mhandle/mhandle.h>
 #include <lib/util/debug.h>
 #include <lib/util/list.h>
+#include <lib/util/misc.h>
 
 #include "buffer.h"
 #include "bus.h"
@@ -146,6 +147,25 @@ struct net_bus_t *net_bus_arbitration(struct net_node_t *bus_node,
 	return NULL;
 }
 
+/* Return the cycle until which all lanes of a bus or photonic node are busy,
+ * that is, the last cycle before any of them is released. */
+long long net_bus_lanes_busy(struct net_node_t *bus_node)
+{
+	struct net_bus_t *bus;
+	long long busy;
+	int i;
+
+	assert(list_count(bus_node->bus_lane_list));
+	bus = list_get(bus_node->bus_lane_list, 0);
+	busy = bus->busy;
+	for (i = 1; i < list_count(bus_node->bus_lane_list); i++)
+	{
+		bus = list_get(bus_node->bus_lane_list, i);
+		busy = MIN(busy, bus->busy);
+	}
+	return busy;
+}
+
 void net_bus_dump_report(struct net_bus_t *bus, FILE *f)
 {
 	long long cycle;
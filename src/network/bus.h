@@ -54,5 +54,6 @@ struct net_bus_t *net_bus_arbitration(struct net_node_t *bus_node,
 	struct net_buffer_t *buffer);
 struct net_bus_t *net_photo_link_arbitration(struct net_node_t *bus_node,
 	struct net_buffer_t *buffer);
+long long net_bus_lanes_busy(struct net_node_t *bus_node);
 void net_bus_dump_report(struct net_bus_t *bus, FILE *f);
 #endif
@@ -20,6 +20,7 @@
 #include <assert.h>
 
 #include <lib/esim/esim.h>
+#include <lib/esim/interval.h>
 #include <lib/mhandle/mhandle.h>
 #include <lib/util/debug.h>
 #include <lib/util/list.h>
@@ -51,7 +52,7 @@ struct net_link_t *net_link_create(struct net_t *net,
 	link->dst_node = dst_node;
 	link->bandwidth = bandwidth;
 	link->virtual_channel = virtual_channel;
-
+	link->vc_wait_queue = net_wait_queue_create();
 
 	for (int i = 0; i < virtual_channel; i++)
 	{
@@ -81,6 +82,17 @@ struct net_link_t *net_link_create(struct net_t *net,
 	if (bandwidth < 1)
 		panic("%s: invalid bandwidth", __FUNCTION__);
 
+	/* Interval statistics */
+	if (esim_interval_active)
+	{
+		esim_interval_register_counter(&link->transferred_msgs,
+				"net.%s.%s.Packets", net->name, link->name);
+		esim_interval_register_counter(&link->transferred_bytes,
+				"net.%s.%s.Bytes", net->name, link->name);
+		esim_interval_register_counter(&link->busy_cycles,
+				"net.%s.%s.BusyCycles", net->name, link->name);
+	}
+
 	/* Return */
 	return link;
 }
@@ -88,6 +100,7 @@ struct net_link_t *net_link_create(struct net_t *net,
 
 void net_link_free(struct net_link_t *link)
 {
+	net_wait_queue_free(link->vc_wait_queue);
 	free(link->name);
 	free(link);
 }
@@ -45,6 +45,7 @@ struct net_link_t
 	int virtual_channel;	/* Number of Virtual Channels on a Link*/
 	long long sched_when;	/* The last time a buffer was assigned to Link */
 	struct net_buffer_t *sched_buffer;	/* The output buffer to fetch from*/
+	struct net_wait_queue_t *vc_wait_queue;	/* Packets that lost the link */
 
 	/* Stats */
 	long long busy_cycles;
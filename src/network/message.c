@@ -25,6 +25,7 @@
 #include <lib/util/debug.h>
 #include <lib/util/list.h>
 #include <lib/util/misc.h>
+#include <lib/util/repos.h>
 
 #include "buffer.h"
 #include "bus.h"
@@ -51,7 +52,7 @@ struct net_msg_t *net_msg_create(struct net_t *net,
 	cycle = esim_domain_cycle(net_domain_index);
 
 	/* Initialize */
-	msg = xcalloc(1, sizeof(struct net_msg_t));
+	msg = repos_create_object(net->msg_repos);
 	msg->net = net;
 	msg->src_node = src_node;
 	msg->dst_node = dst_node;
@@ -75,7 +76,7 @@ void net_msg_free(struct net_msg_t *msg)
 		DOUBLE_LINKED_LIST_REMOVE(msg, packet, pkt);
 		net_packet_free(pkt);
 	}
-	free(msg);
+	repos_free_object(msg->net->msg_repos, msg);
 }
 
 
@@ -91,7 +92,7 @@ struct net_stack_t *net_stack_create(struct net_t *net,
 	struct net_stack_t *stack;
 
 	/* Initialize */
-	stack = xcalloc(1, sizeof(struct net_stack_t));
+	stack = repos_create_object(net->stack_repos);
 	stack->net = net;
 	stack->ret_event = retevent;
 	stack->ret_stack = retstack;
@@ -101,12 +102,18 @@ struct net_stack_t *net_stack_create(struct net_t *net,
 }
 
 
+void net_stack_free(struct net_stack_t *stack)
+{
+	repos_free_object(stack->net->stack_repos, stack);
+}
+
+
 void net_stack_return(struct net_stack_t *stack)
 {
 	int retevent = stack->ret_event;
 	struct net_stack_t *retstack = stack->ret_stack;
 
-	free(stack);
+	net_stack_free(stack);
 	esim_schedule_event(retevent, retstack, 0);
 }
 
@@ -268,6 +275,7 @@ void net_event_handler(int event, void *data)
 			{
 				struct net_buffer_t *temp_buffer;
 
+				net_wait_queue_wakeup_stale(link->vc_wait_queue);
 				temp_buffer = net_link_arbitrator_vc(link, node);
 				if (temp_buffer != buffer)
 				{
@@ -279,7 +287,7 @@ void net_event_handler(int event, void *data)
 							net->name,
 							pkt->msg->id,
 							pkt->session_id);
-					esim_schedule_event(event, stack, 1);
+					net_wait_queue_wait(link->vc_wait_queue, event, stack);
 
 					net_trace("net.packet "
 							"net=\"%s\" "
@@ -355,6 +363,9 @@ void net_event_handler(int event, void *data)
 			link->busy = cycle + lat - 1;
 			input_buffer->write_busy = cycle + lat - 1;
 
+			/* Packets that lost the link compete again when released */
+			net_wait_queue_wakeup(link->vc_wait_queue, lat);
+
 			/* Transfer message to next input buffer */
 			assert(pkt->busy < cycle);
 			net_buffer_extract(buffer, pkt);
@@ -384,6 +395,7 @@ void net_event_handler(int event, void *data)
 		{
 			struct net_bus_t *bus, *updated_bus;
 			struct net_node_t *bus_node;
+			long long lanes_busy;
 
 			assert(!buffer->link);
 			assert(buffer->bus);
@@ -413,6 +425,10 @@ void net_event_handler(int event, void *data)
 						"buffer for the route between %s and %s \n", net->name,
 						pkt->node->name,entry->next_node->name);
 
+			/* Wake up packets that lost the lanes in a previous cycle
+			 * to a winner that did not take them */
+			net_wait_queue_wakeup_stale(bus_node->bus_wait_queue);
+
 			/* 1. Check the destination buffer is busy or not */
 			if (input_buffer->write_busy >= cycle)
 			{
@@ -474,7 +490,15 @@ void net_event_handler(int event, void *data)
 			updated_bus = net_bus_arbitration(bus_node, buffer);
 			if (updated_bus == NULL)
 			{
-				esim_schedule_event(event, stack, 1);
+				/* If all lanes are busy, wait until the first one
+				 * is released. Otherwise, wait for the winner. */
+				lanes_busy = net_bus_lanes_busy(bus_node);
+				if (lanes_busy >= cycle)
+					esim_schedule_event(event, stack,
+						lanes_busy - cycle + 1);
+				else
+					net_wait_queue_wait(bus_node->bus_wait_queue,
+						event, stack);
 				net_debug("msg "
 						"a=\"stall\" "
 						"net=\"%s\" "
@@ -518,6 +542,9 @@ void net_event_handler(int event, void *data)
 			bus->busy = cycle + lat - 1;
 			input_buffer->write_busy = cycle + lat - 1 ;
 
+			/* Packets that lost the lanes compete again next cycle */
+			net_wait_queue_wakeup(bus_node->bus_wait_queue, 1);
+
 			/* Transfer message to next input buffer */
 			assert(pkt->busy < cycle);
 			net_buffer_extract(buffer, pkt);
@@ -547,6 +574,7 @@ void net_event_handler(int event, void *data)
 		{
 			struct net_bus_t *bus, *updated_bus;
 			struct net_node_t *bus_node;
+			long long lanes_busy;
 
 			assert(!buffer->link);
 			assert(buffer->bus);
@@ -576,6 +604,10 @@ void net_event_handler(int event, void *data)
 						"buffer for the route between %s and %s \n", net->name,
 						pkt->node->name,entry->next_node->name);
 
+			/* Wake up packets that lost the lanes in a previous cycle
+			 * to a winner that did not take them */
+			net_wait_queue_wakeup_stale(bus_node->bus_wait_queue);
+
 			/* 1. Check the destination buffer is busy or not */
 			if (input_buffer->write_busy > cycle)
 			{
@@ -638,7 +670,15 @@ void net_event_handler(int event, void *data)
 			updated_bus = net_photo_link_arbitration(bus_node, buffer);
 			if (updated_bus == NULL)
 			{
-				esim_schedule_event(event, stack, 1);
+				/* If all lanes are busy, wait until the first one
+				 * is released. Otherwise, wait for the winner. */
+				lanes_busy = net_bus_lanes_busy(bus_node);
+				if (lanes_busy >= cycle)
+					esim_schedule_event(event, stack,
+						lanes_busy - cycle + 1);
+				else
+					net_wait_queue_wait(bus_node->bus_wait_queue,
+						event, stack);
 				net_debug("msg "
 						"a=\"stall\" "
 						"net=\"%s\" "
@@ -681,6 +721,9 @@ void net_event_handler(int event, void *data)
 			bus->busy = cycle + lat - 1;
 			input_buffer->write_busy = cycle + lat - 1;
 
+			/* Packets that lost the lanes compete again next cycle */
+			net_wait_queue_wakeup(bus_node->bus_wait_queue, 1);
+
 			/* Transfer message to next input buffer */
 			assert(pkt->busy < cycle);
 			net_buffer_extract(buffer, pkt);
@@ -784,6 +827,10 @@ void net_event_handler(int event, void *data)
 			fatal("%s: no route from %s to %s.\n%s", net->name,
 					node->name, dst_node->name, net_err_no_route);
 
+		/* Wake up packets that lost the switch output in a previous
+		 * cycle to a winner that did not take it */
+		net_wait_queue_wakeup_stale(output_buffer->sched_wait_queue);
+
 		/* If destination output buffer is busy, wait */
 		if (output_buffer->write_busy >= cycle)
 		{
@@ -864,7 +911,8 @@ void net_event_handler(int event, void *data)
 					node->name,
 					buffer->name);
 
-			esim_schedule_event(event, stack, 1);
+			net_wait_queue_wait(output_buffer->sched_wait_queue,
+					event, stack);
 			return;
 		}
 
@@ -876,6 +924,9 @@ void net_event_handler(int event, void *data)
 		buffer->read_busy = cycle + lat - 1;
 		output_buffer->write_busy = cycle + lat - 1;
 
+		/* Packets that lost the switch output compete again when released */
+		net_wait_queue_wakeup(output_buffer->sched_wait_queue, lat);
+
 		/* Transfer message to next output buffer */
 		assert(pkt->busy < cycle);
 		net_buffer_extract(buffer, pkt);
@@ -920,7 +971,7 @@ void net_event_handler(int event, void *data)
 		}
 		else
 			/* Freeing packet stack, not the message */
-			free(stack);
+			net_stack_free(stack);
 	}
 
 	else
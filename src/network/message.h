@@ -65,9 +65,6 @@ struct net_msg_t
 	struct net_buffer_t *src_buffer;	/* Original source buffer */
 	struct net_buffer_t *dst_buffer;	/* Final destination buffer */
 
-	/* Liked list for bucket chain in net->msg_table */
-	struct net_msg_t *bucket_next;
-
 	/* For Packetizing */
 	struct net_packet_t *packet_list_head, *packet_list_tail;
 	int packet_list_count;
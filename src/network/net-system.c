@@ -17,9 +17,9 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
-#include <math.h>
-
 #include <lib/esim/esim.h>
+#include <lib/esim/interval.h>
+#include <lib/esim/profile.h>
 #include <lib/esim/trace.h>
 #include <lib/mhandle/mhandle.h>
 #include <lib/util/debug.h>
@@ -34,6 +34,7 @@
 #include "net-system.h"
 #include "network.h"
 #include "node.h"
+#include "traffic.h"
 #include "visual.h"
 
 /* 
@@ -119,68 +120,6 @@ int net_domain_index;
 
 
 
-/* 
- * Private Functions
- */
-
-static double exp_random(double lambda)
-{
-	double x = (double) random() / RAND_MAX;
-
-	return log(1 - x) / -lambda;
-}
-
-
-static void net_traffic_uniform(struct net_t *net, double *inject_time)
-{
-	while (1)
-	{
-		struct net_node_t *node;
-		struct net_node_t *dst_node;
-		long long cycle;
-		int i;
-
-		/* Get current cycle */
-		cycle = esim_domain_cycle(net_domain_index);
-		if (cycle >= net_max_cycles)
-			break;
-
-		/* Inject messages */
-		for (i = 0; i < net->node_count; i++)
-		{
-			/* Get end node */
-			node = list_get(net->node_list, i);
-			if (node->kind != net_node_end)
-				continue;
-
-			/* Turn for next injection? */
-			if (inject_time[i] > cycle)
-				continue;
-
-			/* Get a random destination node */
-			do
-			{
-				dst_node = list_get(net->node_list, random() %
-						list_count(net->node_list));
-			} while (dst_node->kind != net_node_end
-					|| dst_node == node);
-
-			/* Inject */
-			while (inject_time[i] < cycle)
-			{
-				inject_time[i] += exp_random(net_injection_rate);
-				if (net_can_send(net, node, dst_node, net_msg_size))
-					net_send(net, node, dst_node, net_msg_size);
-			}
-		}
-		/* Next cycle */
-		net_debug("___ cycle %lld ___\n", cycle);
-		esim_process_events(TRUE);
-	}
-
-}
-
-
 /*
  * Public Functions
  */
@@ -274,7 +213,6 @@ struct net_t *net_find_next(void)
 void net_sim(char *debug_file_name)
 {
 	struct net_t *net;
-	double *inject_time;	/* Next injection time (one per node) */
 
 	/* Initialize */
 	debug_init();
@@ -298,41 +236,11 @@ void net_sim(char *debug_file_name)
 		/* Network Trace Header */
 		net_config_trace(net);
 	}
-	inject_time = xcalloc(net->node_count, sizeof(double));
-
-	/* FIXME: error for no dest node in network */
-
-	/* Simulation loop */
-	esim_process_events(TRUE);
-	if (!strcmp(net_traffic_pattern, "") ||
-			(!strcmp(net_traffic_pattern, "uniform")))
-	{
-		net_traffic_uniform(net, inject_time);
-	}
-	else if (!strcmp(net_traffic_pattern, "command"))
-	{
-		while(1)
-		{
-			long long cycle;
-
-			cycle = esim_domain_cycle(net_domain_index);
-			if (cycle >= net_max_cycles)
-				break;
-
-			net_debug("___cycle %lld___ \n", cycle);
-			esim_process_events(TRUE);
-		}
-	}
-	else
-		fatal("Network %s: unknown traffic pattern (%s). \n", net->name
-				,net_traffic_pattern);
-
-
-	/* Drain events */
-	esim_process_all_events();
 
-	/* Free */
-	free(inject_time);
+	/* Simulate traffic */
+	net_traffic_run(net);
+	esim_interval_flush();
+	esim_profile_dump(stderr);
 
 	/* Finalize */
 	net_done();
@@ -28,6 +28,7 @@
 #include <lib/util/hash-table.h>
 #include <lib/util/list.h>
 #include <lib/util/misc.h>
+#include <lib/util/repos.h>
 #include <lib/util/string.h>
 
 #include "buffer.h"
@@ -42,52 +43,105 @@
 #include "packet.h"
 
 
+/* Return the slot of the in-flight messages table where a message with the
+ * given ID is stored, or the empty slot where it would be inserted. Message
+ * IDs are assigned sequentially, so the low bits of the ID are used directly
+ * as the hash value, and the table is probed linearly. */
+static int net_msg_table_find(struct net_t *net, long long id)
+{
+	struct net_msg_t *msg;
+	int mask;
+	int index;
+
+	mask = net->msg_table_size - 1;
+	index = id & mask;
+	while ((msg = net->msg_table[index]) && msg->id != id)
+		index = (index + 1) & mask;
+	return index;
+}
+
+
+/* Double the size of the in-flight messages table */
+static void net_msg_table_grow(struct net_t *net)
+{
+	struct net_msg_t **old_table;
+	struct net_msg_t *msg;
+
+	int old_size;
+	int i;
+
+	old_table = net->msg_table;
+	old_size = net->msg_table_size;
+	net->msg_table_size = old_size * 2;
+	net->msg_table = xcalloc(net->msg_table_size, sizeof(struct net_msg_t *));
+	for (i = 0; i < old_size; i++)
+	{
+		msg = old_table[i];
+		if (msg)
+			net->msg_table[net_msg_table_find(net, msg->id)] = msg;
+	}
+	free(old_table);
+}
+
+
 /* Insert a message into the in-flight messages hash table. */
 void net_msg_table_insert(struct net_t *net, struct net_msg_t *msg)
 {
 	int index;
 
-	index = msg->id % NET_MSG_TABLE_SIZE;
-	assert(!msg->bucket_next);
-	msg->bucket_next = net->msg_table[index];
+	/* Keep the table at most half full */
+	if ((net->msg_table_count + 1) * 2 > net->msg_table_size)
+		net_msg_table_grow(net);
+
+	index = net_msg_table_find(net, msg->id);
+	assert(!net->msg_table[index]);
 	net->msg_table[index] = msg;
+	net->msg_table_count++;
 }
 
 
 /* Return a message from the in-flight messages hash table */
 struct net_msg_t *net_msg_table_get(struct net_t *net, long long id)
 {
-	int index;
-	struct net_msg_t *msg;
-
-	index = id % NET_MSG_TABLE_SIZE;
-	msg = net->msg_table[index];
-	while (msg && msg->id != id)
-		msg = msg->bucket_next;
-	return msg;
+	return net->msg_table[net_msg_table_find(net, id)];
 }
 
 
 /* Extract a message from the in-flight messages hash table */
 struct net_msg_t *net_msg_table_extract(struct net_t *net, long long id)
 {
+	struct net_msg_t *msg;
+	struct net_msg_t *next_msg;
+
+	int mask;
 	int index;
-	struct net_msg_t *prev, *msg;
+	int next_index;
+	int home_index;
 
-	index = id % NET_MSG_TABLE_SIZE;
-	prev = NULL;
+	/* Find message */
+	mask = net->msg_table_size - 1;
+	index = net_msg_table_find(net, id);
 	msg = net->msg_table[index];
-	while (msg && msg->id != id)
-	{
-		prev = msg;
-		msg = msg->bucket_next;
-	}
 	if (!msg)
 		panic("%s: message %lld not in hash table", __FUNCTION__, id);
-	if (prev)
-		prev->bucket_next = msg->bucket_next;
-	else
-		net->msg_table[index] = msg->bucket_next;
+
+	/* Close the gap left in the probe sequence by moving back the
+	 * following messages that can take the freed slot. */
+	next_index = index;
+	while (1)
+	{
+		next_index = (next_index + 1) & mask;
+		next_msg = net->msg_table[next_index];
+		if (!next_msg)
+			break;
+		home_index = next_msg->id & mask;
+		if (((next_index - home_index) & mask) < ((next_index - index) & mask))
+			continue;
+		net->msg_table[index] = next_msg;
+		index = next_index;
+	}
+	net->msg_table[index] = NULL;
+	net->msg_table_count--;
 	return msg;
 }
 
@@ -109,6 +163,17 @@ struct net_t *net_create(char *name)
 	net->link_list = list_create();
 	net->routing_table = net_routing_table_create(net);
 
+	/* Table of in-flight messages */
+	net->msg_table_size = NET_MSG_TABLE_SIZE;
+	net->msg_table = xcalloc(net->msg_table_size, sizeof(struct net_msg_t *));
+
+	/* Repositories of messages, packets and stacks. These objects are
+	 * created and destroyed for every message sent, so they are recycled
+	 * instead of going through malloc() and free() every time. */
+	net->msg_repos = repos_create(sizeof(struct net_msg_t), "net_msg_repos");
+	net->packet_repos = repos_create(sizeof(struct net_packet_t), "net_packet_repos");
+	net->stack_repos = repos_create(sizeof(struct net_stack_t), "net_stack_repos");
+
 	/* Return */
 	return net;
 }
@@ -133,17 +198,15 @@ void net_free(struct net_t *net)
 	net_routing_table_free(net->routing_table);
 
 	/* Free messages in flight */
-	for (i = 0; i < NET_MSG_TABLE_SIZE; i++)
-	{
-		while (net->msg_table[i])
-		{
-			struct net_msg_t *next;
-
-			next = net->msg_table[i]->bucket_next;
+	for (i = 0; i < net->msg_table_size; i++)
+		if (net->msg_table[i])
 			net_msg_free(net->msg_table[i]);
-			net->msg_table[i] = next;
-		}
-	}
+	free(net->msg_table);
+
+	/* Repositories */
+	repos_free(net->msg_repos);
+	repos_free(net->packet_repos);
+	repos_free(net->stack_repos);
 
 	/* Network */
 	free(net->name);
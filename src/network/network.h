@@ -44,12 +44,14 @@ struct net_stack_t
 
 struct net_stack_t *net_stack_create(struct net_t *net,
 	int retevent, void *retstack);
+void net_stack_free(struct net_stack_t *stack);
 void net_stack_return(struct net_stack_t *stack);
 
 void net_event_handler(int event, void *data);
 
 
 
+/* Initial size of the in-flight messages table. Must be a power of 2. */
 #define NET_MSG_TABLE_SIZE 32
 
 /* Network */
@@ -78,8 +80,16 @@ struct net_t
 	/* Routing table */
 	struct net_routing_table_t *routing_table;
 
-	/* Hash table of in-flight messages. Each entry is a bucket list */
-	struct net_msg_t *msg_table[NET_MSG_TABLE_SIZE];
+	/* Hash table of in-flight messages, with open addressing. Its size
+	 * is a power of 2 and grows as needed to stay at most half full. */
+	struct net_msg_t **msg_table;
+	int msg_table_size;
+	int msg_table_count;
+
+	/* Repositories of recycled objects */
+	struct repos_t *msg_repos;
+	struct repos_t *packet_repos;
+	struct repos_t *stack_repos;
 
 	/* Stats */
 	long long transfers;	        /* Transfers */
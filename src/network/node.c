@@ -65,6 +65,10 @@ struct net_node_t *net_node_create(struct net_t *net,
 	node->output_buffer_list = list_create_with_size(4);
 	node->input_buffer_list = list_create_with_size(4);
 
+	/* Packets waiting for bus lanes */
+	if (kind == net_node_bus || kind == net_node_photonic)
+		node->bus_wait_queue = net_wait_queue_create();
+
 	return node;
 }
 
@@ -117,6 +121,9 @@ void net_node_free(struct net_node_t *node)
 			list_free(node->src_buffer_list);
 		if (node->dst_buffer_list)
 			list_free(node->dst_buffer_list);
+
+		/* Wait queue */
+		net_wait_queue_free(node->bus_wait_queue);
 	}
 
 	/* Free node */
@@ -59,6 +59,7 @@ struct net_node_t
 	struct list_t *dst_buffer_list;	/* elements are of type struct net_buffer_t */
 	int last_node_index;
 	int last_lane_index;
+	struct net_wait_queue_t *bus_wait_queue;	/* Packets that lost the lanes */
 
 	/* Stats */
 	long long bytes_received;
@@ -25,6 +25,7 @@
 #include <lib/util/debug.h>
 #include <lib/util/list.h>
 #include <lib/util/misc.h>
+#include <lib/util/repos.h>
 
 #include "net-system.h"
 #include "message.h"
@@ -38,7 +39,7 @@ struct net_packet_t *net_packet_create(struct net_t *net, struct net_msg_t *msg,
 {
 	struct net_packet_t *pkt;
 
-	pkt= xcalloc(1, sizeof(struct net_packet_t));
+	pkt = repos_create_object(net->packet_repos);
 	pkt->net = net;
 	pkt->msg = msg;
 	pkt->size = size;
@@ -50,7 +51,7 @@ struct net_packet_t *net_packet_create(struct net_t *net, struct net_msg_t *msg,
 
 void net_packet_free (struct net_packet_t *pkt)
 {
-	free(pkt);
+	repos_free_object(pkt->net->packet_repos, pkt);
 }
 
 /*
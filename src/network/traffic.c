@@ -0,0 +1,605 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <assert.h>
+#include <math.h>
+
+#include <lib/esim/esim.h>
+#include <lib/mhandle/mhandle.h>
+#include <lib/util/debug.h>
+#include <lib/util/file.h>
+#include <lib/util/linked-list.h>
+#include <lib/util/list.h>
+#include <lib/util/misc.h>
+#include <lib/util/string.h>
+
+#include "net-system.h"
+#include "network.h"
+#include "node.h"
+#include "traffic.h"
+
+
+/*
+ * Global Variables
+ */
+
+struct str_map_t net_traffic_pattern_map =
+{
+	7, {
+		{ "uniform", net_traffic_pattern_uniform },
+		{ "transpose", net_traffic_pattern_transpose },
+		{ "bitcomp", net_traffic_pattern_bitcomp },
+		{ "hotspot", net_traffic_pattern_hotspot },
+		{ "neighbor", net_traffic_pattern_neighbor },
+		{ "trace", net_traffic_pattern_trace },
+		{ "command", net_traffic_pattern_command }
+	}
+};
+
+char *net_traffic_trace_file_name = "";
+char *net_traffic_hotspot_name = "";
+double net_traffic_hotspot_fraction = 0.2;
+char *net_sweep_file_name = "";
+int net_sweep_points = 10;
+
+
+/* Message read from a traffic trace, waiting to be injected */
+struct net_traffic_trace_msg_t
+{
+	struct net_node_t *dst_node;
+	int size;
+};
+
+
+/* Pattern being simulated */
+static enum net_traffic_pattern_t net_traffic_pattern_kind;
+
+/* End nodes of the network, numbered in the order they appear in the network
+ * configuration. Synthetic patterns are defined on these indexes. */
+static struct net_node_t **net_traffic_end_node;
+static int net_traffic_end_node_count;
+
+/* Index of end node of each node in the network, or -1 if it is a switch or
+ * a bus, indexed by 'node->index'. */
+static int *net_traffic_end_node_index;
+
+/* Parameters of specific patterns */
+static int net_traffic_transpose_side;
+static int net_traffic_hotspot_index;
+
+/* Messages that sources tried to inject, and how many of them could not be
+ * injected because of a full output buffer. */
+static long long net_traffic_offered;
+static long long net_traffic_dropped;
+
+
+
+
+/*
+ * Private Functions
+ */
+
+static double exp_random(double lambda)
+{
+	double x = (double) random() / RAND_MAX;
+
+	return log(1 - x) / -lambda;
+}
+
+
+/* Return the destination of a new message sent by end node 'src_index', or
+ * NULL if the pattern does not make that node send messages. */
+static struct net_node_t *net_traffic_get_dst_node(int src_index)
+{
+	int count = net_traffic_end_node_count;
+	int side = net_traffic_transpose_side;
+	int dst_index;
+
+	switch (net_traffic_pattern_kind)
+	{
+
+	case net_traffic_pattern_hotspot:
+
+		/* A fraction of the messages go to the hot spot, the rest
+		 * are distributed uniformly. */
+		if (src_index != net_traffic_hotspot_index && (double) random()
+				/ RAND_MAX < net_traffic_hotspot_fraction)
+		{
+			dst_index = net_traffic_hotspot_index;
+			break;
+		}
+
+		/* Fall through */
+
+	case net_traffic_pattern_uniform:
+
+		/* Any end node but the source */
+		dst_index = random() % (count - 1);
+		if (dst_index >= src_index)
+			dst_index++;
+		break;
+
+	case net_traffic_pattern_transpose:
+
+		/* End nodes are laid out in a square, row by row. The node at
+		 * row R and column C sends to the node at row C and column R. */
+		dst_index = (src_index % side) * side + src_index / side;
+		break;
+
+	case net_traffic_pattern_bitcomp:
+
+		/* For a power-of-2 number of nodes, this is the node whose
+		 * index has all bits complemented. */
+		dst_index = count - 1 - src_index;
+		break;
+
+	case net_traffic_pattern_neighbor:
+
+		dst_index = (src_index + 1) % count;
+		break;
+
+	default:
+		panic("%s: invalid traffic pattern", __FUNCTION__);
+		return NULL;
+	}
+
+	/* Nodes mapped to themselves stay idle */
+	if (dst_index == src_index)
+		return NULL;
+	return net_traffic_end_node[dst_index];
+}
+
+
+/* Inject synthetic traffic for 'cycles' cycles, with every end node sending
+ * messages at random intervals with exponential distribution. */
+static void net_traffic_inject(struct net_t *net, double rate, long long cycles)
+{
+	struct net_node_t *node;
+	struct net_node_t *dst_node;
+
+	double *inject_time;	/* Next injection time (one per end node) */
+	long long start_cycle;
+	long long cycle;
+
+	int i;
+
+	/* Initialize */
+	start_cycle = esim_domain_cycle(net_domain_index);
+	inject_time = xcalloc(net_traffic_end_node_count, sizeof(double));
+	for (i = 0; i < net_traffic_end_node_count; i++)
+		inject_time[i] = start_cycle;
+
+	while (1)
+	{
+		/* Get current cycle */
+		cycle = esim_domain_cycle(net_domain_index);
+		if (cycle >= start_cycle + cycles)
+			break;
+
+		/* Inject messages */
+		for (i = 0; i < net_traffic_end_node_count; i++)
+		{
+			node = net_traffic_end_node[i];
+			while (inject_time[i] < cycle)
+			{
+				inject_time[i] += exp_random(rate);
+				dst_node = net_traffic_get_dst_node(i);
+				if (!dst_node)
+					continue;
+
+				/* Messages finding a full buffer are lost */
+				net_traffic_offered++;
+				if (net_can_send(net, node, dst_node, net_msg_size))
+					net_send(net, node, dst_node, net_msg_size);
+				else
+					net_traffic_dropped++;
+			}
+		}
+
+		/* Next cycle */
+		net_debug("___ cycle %lld ___\n", cycle);
+		esim_process_events(TRUE);
+	}
+
+	/* Free */
+	free(inject_time);
+}
+
+
+/* Read the next message from a traffic trace. Return 0 at the end of the
+ * file. */
+static int net_traffic_trace_read(struct net_t *net, FILE *f, int *line_num_ptr,
+	long long *cycle_ptr, int *src_index_ptr,
+	struct net_traffic_trace_msg_t *msg)
+{
+	char line[MAX_STRING_SIZE];
+	char src_name[MAX_STRING_SIZE];
+	char dst_name[MAX_STRING_SIZE];
+	char *name;
+	char *text;
+
+	struct net_node_t *src_node;
+	int count;
+
+	while (fgets(line, sizeof line, f))
+	{
+		/* Skip empty lines and comments */
+		(*line_num_ptr)++;
+		text = line + strspn(line, " \t\r\n");
+		if (!*text || *text == '#')
+			continue;
+
+		/* Fields */
+		count = sscanf(text, "%lld %s %s %d", cycle_ptr, src_name,
+			dst_name, &msg->size);
+		if (count < 3 || *cycle_ptr < 0 || (count == 4 && msg->size < 1))
+			fatal("%s: line %d: invalid format.\n"
+				"\tEach line must contain a cycle, a source node, a destination\n"
+				"\tnode and, optionally, a message size.\n",
+				net_traffic_trace_file_name, *line_num_ptr);
+		if (count == 3)
+			msg->size = net_msg_size;
+
+		/* Nodes */
+		src_node = net_get_node_by_name(net, src_name);
+		msg->dst_node = net_get_node_by_name(net, dst_name);
+		name = !src_node ? src_name : !msg->dst_node ? dst_name : NULL;
+		if (name)
+			fatal("%s: line %d: network '%s' has no node '%s'",
+				net_traffic_trace_file_name, *line_num_ptr,
+				net->name, name);
+		if (src_node->kind != net_node_end || msg->dst_node->kind != net_node_end)
+			fatal("%s: line %d: not end nodes.\n%s",
+				net_traffic_trace_file_name, *line_num_ptr,
+				net_err_end_nodes);
+		if (src_node == msg->dst_node)
+			fatal("%s: line %d: source and destination are the same node",
+				net_traffic_trace_file_name, *line_num_ptr);
+		*src_index_ptr = net_traffic_end_node_index[src_node->index];
+		return 1;
+	}
+
+	/* End of file */
+	return 0;
+}
+
+
+/* Inject the messages listed in a trace file, at the cycles specified there.
+ * Messages that find a full output buffer wait at the source, delaying later
+ * messages from that same source. */
+static void net_traffic_trace(struct net_t *net)
+{
+	struct net_traffic_trace_msg_t msg;
+	struct net_traffic_trace_msg_t *pending_msg;
+	struct linked_list_t **pending_list;
+	struct linked_list_t *list;
+	struct net_node_t *node;
+
+	FILE *f;
+
+	long long msg_cycle;
+	long long cycle;
+
+	int line_num;
+	int msg_valid;
+	int src_index;
+	int num_pending;
+	int i;
+
+	/* Open trace */
+	if (!*net_traffic_trace_file_name)
+		fatal("traffic pattern 'trace' requires option '--net-traffic-trace'");
+	f = file_open_for_read(net_traffic_trace_file_name);
+	if (!f)
+		fatal("%s: cannot open network traffic trace",
+			net_traffic_trace_file_name);
+
+	/* One list of pending messages per source */
+	pending_list = xcalloc(net_traffic_end_node_count,
+		sizeof(struct linked_list_t *));
+	for (i = 0; i < net_traffic_end_node_count; i++)
+		pending_list[i] = linked_list_create();
+
+	/* Simulation loop */
+	line_num = 0;
+	num_pending = 0;
+	msg_valid = net_traffic_trace_read(net, f, &line_num, &msg_cycle,
+		&src_index, &msg);
+	while (msg_valid || num_pending)
+	{
+		/* Get current cycle */
+		cycle = esim_domain_cycle(net_domain_index);
+		if (cycle >= net_max_cycles)
+			break;
+
+		/* Queue messages due at this cycle */
+		while (msg_valid && msg_cycle <= cycle)
+		{
+			pending_msg = xmalloc(sizeof(struct net_traffic_trace_msg_t));
+			*pending_msg = msg;
+			linked_list_add(pending_list[src_index], pending_msg);
+			num_pending++;
+			net_traffic_offered++;
+			msg_valid = net_traffic_trace_read(net, f, &line_num,
+				&msg_cycle, &src_index, &msg);
+		}
+
+		/* Inject queued messages in order */
+		for (i = 0; i < net_traffic_end_node_count; i++)
+		{
+			node = net_traffic_end_node[i];
+			list = pending_list[i];
+			linked_list_head(list);
+			while (linked_list_count(list))
+			{
+				pending_msg = linked_list_get(list);
+				if (!net_can_send(net, node, pending_msg->dst_node,
+						pending_msg->size))
+					break;
+				net_send(net, node, pending_msg->dst_node,
+					pending_msg->size);
+				free(pending_msg);
+				linked_list_remove(list);
+				num_pending--;
+			}
+		}
+
+		/* Next cycle */
+		net_debug("___ cycle %lld ___\n", cycle);
+		esim_process_events(TRUE);
+	}
+
+	/* Messages not injected before the maximum cycle */
+	for (i = 0; i < net_traffic_end_node_count; i++)
+	{
+		list = pending_list[i];
+		net_traffic_dropped += linked_list_count(list);
+		linked_list_head(list);
+		while (linked_list_count(list))
+		{
+			free(linked_list_get(list));
+			linked_list_remove(list);
+		}
+		linked_list_free(list);
+	}
+
+	/* Free */
+	free(pending_list);
+	fclose(f);
+}
+
+
+/* Let messages in flight reach their destinations. Return non-zero if the
+ * network did not become empty within 'net_max_cycles' cycles. */
+static int net_traffic_drain(void)
+{
+	long long cycle;
+
+	cycle = esim_domain_cycle(net_domain_index) + net_max_cycles;
+	while (esim_event_count())
+	{
+		if (esim_domain_cycle(net_domain_index) >= cycle)
+			return 1;
+		esim_process_events(TRUE);
+	}
+	return 0;
+}
+
+
+/* Simulate the network at 'net_sweep_points' injection rates, evenly
+ * distributed between 0 and 'net_injection_rate', and dump one line per rate
+ * into a CSV file. Each point injects traffic for 'net_max_cycles' cycles and
+ * then lets the network drain, so that the next point starts empty. */
+static void net_traffic_sweep(struct net_t *net)
+{
+	FILE *f;
+
+	double rate;
+	double offered_load;
+	double accepted_load;
+	double latency;
+	double real_time;
+
+	long long transfers;
+	long long lat_acc;
+	long long accepted;
+	long long messages;
+	long long events;
+	long long start_time;
+
+	int point;
+
+	/* Check options */
+	if (net_sweep_points < 1)
+		fatal("option '--net-sweep-points': value must be 1 or greater");
+	if (net_injection_rate <= 0)
+		fatal("option '--net-sweep' requires a positive injection rate");
+	f = file_open_for_write(net_sweep_file_name);
+	if (!f)
+		fatal("%s: cannot open network sweep file", net_sweep_file_name);
+
+	/* Header. Loads are given in messages per end node per cycle, and
+	 * latencies in cycles. */
+	fprintf(f, "InjectionRate,OfferedLoad,AcceptedLoad,AverageLatency,"
+		"Messages,Dropped,EventsPerSecond\n");
+
+	for (point = 1; point <= net_sweep_points; point++)
+	{
+		/* Initial state */
+		rate = net_injection_rate * point / net_sweep_points;
+		transfers = net->transfers;
+		lat_acc = net->lat_acc;
+		events = esim_processed_events;
+		start_time = esim_real_time();
+		net_traffic_offered = 0;
+		net_traffic_dropped = 0;
+
+		/* Throughput is measured over the injection period, while the
+		 * latency accounts for all messages sent in it. */
+		net_traffic_inject(net, rate, net_max_cycles);
+		accepted = net->transfers - transfers;
+		if (net_traffic_drain())
+			warning("%s: network not drained after %lld cycles at "
+				"injection rate %g", net->name, net_max_cycles, rate);
+		messages = net->transfers - transfers;
+
+		/* Dump */
+		offered_load = (double) net_traffic_offered /
+			net_traffic_end_node_count / net_max_cycles;
+		accepted_load = (double) accepted /
+			net_traffic_end_node_count / net_max_cycles;
+		latency = messages ? (double) (net->lat_acc - lat_acc) / messages : 0.0;
+		real_time = (double) (esim_real_time() - start_time) / 1.0e6;
+		fprintf(f, "%g,%.6f,%.6f,%.2f,%lld,%lld,%.0f\n", rate,
+			offered_load, accepted_load, latency, messages,
+			net_traffic_dropped, real_time > 0 ?
+			(esim_processed_events - events) / real_time : 0.0);
+		fflush(f);
+	}
+
+	/* Close */
+	file_close(f);
+}
+
+
+
+
+/*
+ * Public Functions
+ */
+
+void net_traffic_run(struct net_t *net)
+{
+	struct net_node_t *node;
+
+	long long start_cycle;
+	long long start_events;
+	long long start_time;
+	double real_time;
+
+	int i;
+
+	/* Pattern */
+	net_traffic_pattern_kind = *net_traffic_pattern ?
+		str_map_string_case(&net_traffic_pattern_map, net_traffic_pattern) :
+		net_traffic_pattern_uniform;
+	if (!net_traffic_pattern_kind)
+		fatal("Network %s: unknown traffic pattern (%s). \n", net->name,
+			net_traffic_pattern);
+	if (*net_sweep_file_name && (net_traffic_pattern_kind == net_traffic_pattern_trace ||
+			net_traffic_pattern_kind == net_traffic_pattern_command))
+		fatal("option '--net-sweep' requires a synthetic traffic pattern");
+
+	/* End nodes */
+	net_traffic_end_node = xcalloc(net->node_count, sizeof(struct net_node_t *));
+	net_traffic_end_node_index = xcalloc(net->node_count, sizeof(int));
+	net_traffic_end_node_count = 0;
+	for (i = 0; i < net->node_count; i++)
+	{
+		node = list_get(net->node_list, i);
+		assert(node->index == i);
+		net_traffic_end_node_index[i] = -1;
+		if (node->kind != net_node_end)
+			continue;
+		net_traffic_end_node_index[i] = net_traffic_end_node_count;
+		net_traffic_end_node[net_traffic_end_node_count++] = node;
+	}
+	if (net_traffic_end_node_count < 2)
+		fatal("Network %s: synthetic traffic needs at least 2 end nodes",
+			net->name);
+
+	/* Pattern parameters */
+	if (net_traffic_pattern_kind == net_traffic_pattern_transpose)
+	{
+		net_traffic_transpose_side = sqrt(net_traffic_end_node_count) + 0.5;
+		if (net_traffic_transpose_side * net_traffic_transpose_side !=
+				net_traffic_end_node_count)
+			fatal("Network %s: traffic pattern 'transpose' needs a square "
+				"number of end nodes (%d found)", net->name,
+				net_traffic_end_node_count);
+	}
+	if (net_traffic_pattern_kind == net_traffic_pattern_hotspot)
+	{
+		node = *net_traffic_hotspot_name ?
+			net_get_node_by_name(net, net_traffic_hotspot_name) :
+			net_traffic_end_node[0];
+		if (!node || node->kind != net_node_end)
+			fatal("Network %s: '%s' is not an end node", net->name,
+				net_traffic_hotspot_name);
+		if (net_traffic_hotspot_fraction < 0 || net_traffic_hotspot_fraction > 1)
+			fatal("option '--net-hotspot-fraction': value must be between 0 and 1");
+		net_traffic_hotspot_index = net_traffic_end_node_index[node->index];
+	}
+
+	/* Simulation loop */
+	start_cycle = esim_domain_cycle(net_domain_index);
+	start_events = esim_processed_events;
+	start_time = esim_real_time();
+	esim_process_events(TRUE);
+	if (*net_sweep_file_name)
+	{
+		net_traffic_sweep(net);
+	}
+	else if (net_traffic_pattern_kind == net_traffic_pattern_trace)
+	{
+		net_traffic_trace(net);
+	}
+	else if (net_traffic_pattern_kind == net_traffic_pattern_command)
+	{
+		while (1)
+		{
+			long long cycle;
+
+			cycle = esim_domain_cycle(net_domain_index);
+			if (cycle >= net_max_cycles)
+				break;
+
+			net_debug("___cycle %lld___ \n", cycle);
+			esim_process_events(TRUE);
+		}
+	}
+	else
+	{
+		net_traffic_inject(net, net_injection_rate, net_max_cycles);
+	}
+
+	/* Drain events */
+	esim_process_all_events();
+
+	/* Summary of the performance of the network model itself */
+	real_time = (double) (esim_real_time() - start_time) / 1.0e6;
+	fprintf(stderr, "\n");
+	fprintf(stderr, ";\n");
+	fprintf(stderr, "; Network Simulation Summary\n");
+	fprintf(stderr, ";\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "[ Network.%s ]\n", net->name);
+	fprintf(stderr, "TrafficPattern = %s\n", str_map_value(&net_traffic_pattern_map,
+		net_traffic_pattern_kind));
+	fprintf(stderr, "Cycles = %lld\n", esim_domain_cycle(net_domain_index) - start_cycle);
+	fprintf(stderr, "Events = %lld\n", esim_processed_events - start_events);
+	fprintf(stderr, "RealTime = %.2f [s]\n", real_time);
+	fprintf(stderr, "EventsPerSecond = %.0f\n", real_time > 0 ?
+		(esim_processed_events - start_events) / real_time : 0.0);
+	fprintf(stderr, "\n");
+
+	/* Free */
+	free(net_traffic_end_node);
+	free(net_traffic_end_node_index);
+}
@@ -0,0 +1,55 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef NETWORK_TRAFFIC_H
+#define NETWORK_TRAFFIC_H
+
+#include <lib/util/string.h>
+
+
+struct net_t;
+
+/* Traffic patterns for stand-alone network simulation */
+extern struct str_map_t net_traffic_pattern_map;
+enum net_traffic_pattern_t
+{
+	net_traffic_pattern_invalid = 0,
+	net_traffic_pattern_uniform,
+	net_traffic_pattern_transpose,
+	net_traffic_pattern_bitcomp,
+	net_traffic_pattern_hotspot,
+	net_traffic_pattern_neighbor,
+	net_traffic_pattern_trace,
+	net_traffic_pattern_command
+};
+
+/* Command-line options */
+extern char *net_traffic_trace_file_name;
+extern char *net_traffic_hotspot_name;
+extern double net_traffic_hotspot_fraction;
+extern char *net_sweep_file_name;
+extern int net_sweep_points;
+
+/* Run the stand-alone simulation of a network with the traffic pattern given
+ * in 'net_traffic_pattern', or a sweep over injection rates if
+ * 'net_sweep_file_name' is set. */
+void net_traffic_run(struct net_t *net);
+
+
+#endif
@@ -18,12 +18,16 @@
  */
 
 #include <gtk/gtk.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <lib/mhandle/mhandle.h>
 #include <lib/util/debug.h>
 #include <lib/util/file.h>
 #include <lib/util/hash-table.h>
 #include <lib/util/list.h>
+#include <lib/util/misc.h>
 #include <lib/util/string.h>
 
 #include "state.h"
@@ -38,6 +42,13 @@
 #define VI_STATE_CHECKPOINT_INTERVAL  1000
 #define VI_STATE_PROGRESS_INTERVAL  100000
 
+/* Trace lines replayed in each step of the checkpoint construction that runs
+ * while the GUI is idle. A step ends at the first checkpoint after them. */
+#define VI_STATE_INDEX_STEP_LINES  20000
+
+/* Version of the format of the index file */
+#define VI_STATE_INDEX_VERSION  1
+
 struct vi_state_checkpoint_t
 {
 	long long cycle;
@@ -157,6 +168,9 @@ void vi_state_category_free(struct vi_state_category_t *category)
 
 struct vi_state_t
 {
+	/* Trace file */
+	char *trace_file_name;
+
 	/* Uncompressed trace file */
 	char *unzipped_trace_file_name;
 	FILE *unzipped_trace_file;
@@ -165,6 +179,24 @@ struct vi_state_t
 	char *checkpoint_file_name;
 	FILE *checkpoint_file;
 
+	/* Set when the uncompressed trace and the checkpoints are stored next to
+	 * the trace file, in '<trace>.vi-trace' and '<trace>.vi-checkpoints'.
+	 * They are described in '<trace>.vi-index', and reused the next time the
+	 * trace is opened. Otherwise, they are temporary files. */
+	int persistent;
+	char *index_file_name;
+
+	/* Checkpoints are created while the GUI is idle, after the first one.
+	 * Set when all of them are created. */
+	int index_complete;
+	guint index_source_id;
+	long long num_indexed_trace_lines;
+
+	/* Function refreshing the panels after an idle step of the checkpoint
+	 * construction, which frees and recreates the objects they show. */
+	vi_state_refresh_func_t refresh_func;
+	void *refresh_func_arg;
+
 	/* Cycles */
 	long long cycle;
 	long long num_cycles;
@@ -233,53 +265,416 @@ static void vi_state_write_checkpoint(void)
 }
 
 
-void vi_state_init(char *trace_file_name)
+static long vi_state_file_size(char *file_name)
 {
-	struct vi_trace_t *trace_file;
-	struct vi_trace_line_t *trace_line;
+	struct stat st;
 
-	int num_trace_lines;
+	return stat(file_name, &st) ? -1 : st.st_size;
+}
 
-	char buf[MAX_STRING_SIZE];
 
-	/* Create */
-	vi_state = xcalloc(1, sizeof(struct vi_state_t));
-	
-	/* Create uncompressed trace file */
-	vi_state->unzipped_trace_file = file_create_temp(buf, sizeof buf);
-	vi_state->unzipped_trace_file_name = xstrdup(buf);
+/* Dump the index of the trace into '<trace>.vi-index'. The first lines
+ * describe the uncompressed trace, and the rest describe the checkpoints,
+ * once all of them are created. */
+static void vi_state_index_write(void)
+{
+	struct vi_state_category_t *category;
+	struct vi_state_checkpoint_t *checkpoint;
+	struct stat st;
+	FILE *f;
 
-	/* Create checkpoint file */
-	vi_state->checkpoint_file = file_create_temp(buf, sizeof buf);
-	vi_state->checkpoint_file_name = xstrdup(buf);
+	int i;
 
-	/* Initialize */
-	vi_state->checkpoint_list = list_create();
-	vi_state->category_list = list_create();
-	vi_state->command_table = hash_table_create(0, FALSE);
+	/* Open file */
+	if (stat(vi_state->trace_file_name, &st))
+		return;
+	f = fopen(vi_state->index_file_name, "w");
+	if (!f)
+	{
+		warning("%s: cannot create trace index", vi_state->index_file_name);
+		return;
+	}
 
-	/* Unpack trace */
-	num_trace_lines = 0;
-	trace_file = vi_trace_create(trace_file_name);
-	while ((trace_line = vi_trace_line_create_from_trace(trace_file)))
+	/* Uncompressed trace */
+	fflush(vi_state->unzipped_trace_file);
+	fprintf(f, "m2s-visual-index %d %lld %lld\n", VI_STATE_INDEX_VERSION,
+		(long long) st.st_size, (long long) st.st_mtime);
+	fprintf(f, "trace %ld %lld\n",
+		vi_state_file_size(vi_state->unzipped_trace_file_name),
+		vi_state->num_cycles);
+
+	/* Checkpoints */
+	if (vi_state->index_complete)
+	{
+		fflush(vi_state->checkpoint_file);
+		LIST_FOR_EACH(vi_state->category_list, i)
+		{
+			category = list_get(vi_state->category_list, i);
+			fprintf(f, "category %s\n", category->name);
+		}
+		fprintf(f, "checkpoints %d %ld\n",
+			list_count(vi_state->checkpoint_list),
+			vi_state_file_size(vi_state->checkpoint_file_name));
+		LIST_FOR_EACH(vi_state->checkpoint_list, i)
+		{
+			checkpoint = list_get(vi_state->checkpoint_list, i);
+			fprintf(f, "%lld %ld %ld\n", checkpoint->cycle,
+				checkpoint->unzipped_trace_file_offset,
+				checkpoint->checkpoint_file_offset);
+		}
+		fprintf(f, "end\n");
+	}
+
+	/* Close */
+	fclose(f);
+}
+
+
+/* Read '<trace>.vi-index', dumped when the trace was opened before. If
+ * 'checkpoints' is FALSE, check only that the uncompressed trace is up to
+ * date with the trace file. Otherwise, check that the checkpoints were created
+ * for the current categories, and load the list of checkpoints. The function
+ * returns TRUE if the index is valid. */
+static int vi_state_index_read(int checkpoints)
+{
+	struct vi_state_category_t *category;
+	struct vi_state_checkpoint_t *checkpoint;
+	struct stat st;
+	FILE *f;
+
+	char line[MAX_STRING_SIZE];
+	char expected[MAX_STRING_SIZE];
+
+	long long num_cycles;
+	long long cycle;
+	long int unzipped_trace_file_offset;
+	long int checkpoint_file_offset;
+	long size;
+
+	int valid;
+	int count;
+	int i;
+
+	/* Open file */
+	if (stat(vi_state->trace_file_name, &st))
+		return 0;
+	f = fopen(vi_state->index_file_name, "r");
+	if (!f)
+		return 0;
+
+	/* Uncompressed trace */
+	snprintf(expected, sizeof expected, "m2s-visual-index %d %lld %lld",
+		VI_STATE_INDEX_VERSION, (long long) st.st_size,
+		(long long) st.st_mtime);
+	valid = file_read_line(f, line, sizeof line) >= 0 &&
+		!strcmp(line, expected);
+	valid = valid && file_read_line(f, line, sizeof line) >= 0 &&
+		sscanf(line, "trace %ld %lld", &size, &num_cycles) == 2 &&
+		size == vi_state_file_size(vi_state->unzipped_trace_file_name);
+	if (valid && !checkpoints)
+		vi_state->num_cycles = num_cycles;
+
+	/* Categories */
+	LIST_FOR_EACH(vi_state->category_list, i)
+	{
+		if (!valid || !checkpoints)
+			break;
+		category = list_get(vi_state->category_list, i);
+		snprintf(expected, sizeof expected, "category %s", category->name);
+		valid = file_read_line(f, line, sizeof line) >= 0 &&
+			!strcmp(line, expected);
+	}
+
+	/* Checkpoints */
+	if (valid && checkpoints)
+	{
+		valid = file_read_line(f, line, sizeof line) >= 0 &&
+			sscanf(line, "checkpoints %d %ld", &count, &size) == 2 &&
+			size == vi_state_file_size(vi_state->checkpoint_file_name);
+		for (i = 0; valid && i < count; i++)
+		{
+			valid = file_read_line(f, line, sizeof line) >= 0 &&
+				sscanf(line, "%lld %ld %ld", &cycle,
+				&unzipped_trace_file_offset,
+				&checkpoint_file_offset) == 3;
+			if (!valid)
+				break;
+			checkpoint = vi_state_checkpoint_create(cycle,
+				unzipped_trace_file_offset,
+				checkpoint_file_offset);
+			list_add(vi_state->checkpoint_list, checkpoint);
+		}
+		valid = valid && file_read_line(f, line, sizeof line) >= 0 &&
+			!strcmp(line, "end");
+
+		/* Discard checkpoints of an invalid index */
+		while (!valid && list_count(vi_state->checkpoint_list))
+			vi_state_checkpoint_free(list_remove_at(
+				vi_state->checkpoint_list, 0));
+	}
+
+	/* Close */
+	fclose(f);
+	return valid;
+}
+
+
+/* Uncompression of the trace. The trace is read by the main thread in blocks
+ * of lines, which are parsed by a pool of host threads while the next blocks
+ * are read. The parsed lines are then dumped in order into the uncompressed
+ * trace. */
+
+#define VI_STATE_UNPACK_BLOCK_SIZE  4096  /* Trace lines per block */
+#define VI_STATE_UNPACK_MAX_THREADS  16
+
+struct vi_state_unpack_block_t
+{
+	struct vi_trace_t *trace;
+
+	/* Number of the first line in the trace */
+	int line_num;
+
+	/* Text of the lines, one after another */
+	int num_lines;
+	int line_offset[VI_STATE_UNPACK_BLOCK_SIZE];
+	char *text;
+	int text_size;
+	int text_max_size;
+
+	/* Parsed lines */
+	struct vi_trace_line_t *lines[VI_STATE_UNPACK_BLOCK_SIZE];
+};
+
+/* Pool of host threads parsing blocks. The threads live for the whole
+ * uncompression, and parse one batch of blocks in each round. */
+struct vi_state_unpack_pool_t
+{
+	int num_threads;
+	pthread_t *threads;
+
+	pthread_mutex_t mutex;
+	pthread_cond_t start_cond;  /* New round or stop */
+	pthread_cond_t done_cond;  /* All threads done with the round */
+
+	long long round;
+	int pending;  /* Threads still working in the round */
+	int stop;
+
+	/* Blocks of the current round, and next block to parse */
+	struct vi_state_unpack_block_t *batch;
+	int count;
+	int next;
+};
+
+
+/* Read one block of lines for each element of 'blocks'. The function returns
+ * the number of blocks that contain lines. */
+static int vi_state_unpack_read(struct vi_state_unpack_block_t *blocks,
+	int num_blocks, struct vi_trace_t *trace, int *line_num_ptr)
+{
+	struct vi_state_unpack_block_t *block;
+
+	char buf[4096];
+	int size;
+	int i;
+
+	for (i = 0; i < num_blocks; i++)
+	{
+		/* Initialize */
+		block = &blocks[i];
+		block->trace = trace;
+		block->line_num = *line_num_ptr;
+		block->num_lines = 0;
+		block->text_size = 0;
+
+		/* Read lines */
+		while (block->num_lines < VI_STATE_UNPACK_BLOCK_SIZE &&
+			vi_trace_read_line(trace, buf, sizeof buf))
+		{
+			size = strlen(buf) + 1;
+			if (block->text_size + size > block->text_max_size)
+			{
+				block->text_max_size = MAX(block->text_max_size * 2,
+					block->text_size + size);
+				block->text = xrealloc(block->text, block->text_max_size);
+			}
+			memcpy(block->text + block->text_size, buf, size);
+			block->line_offset[block->num_lines++] = block->text_size;
+			block->text_size += size;
+		}
+
+		/* End of trace */
+		*line_num_ptr += block->num_lines;
+		if (!block->num_lines)
+			break;
+	}
+
+	/* Return number of blocks read */
+	return i;
+}
+
+
+static void vi_state_unpack_parse(struct vi_state_unpack_block_t *block)
+{
+	int i;
+
+	for (i = 0; i < block->num_lines; i++)
+		block->lines[i] = vi_trace_line_create_from_string(block->trace,
+			block->text + block->line_offset[i], block->line_num + i);
+}
+
+
+/* Worker thread of the pool. It takes blocks of the current round until
+ * there are none left, and notifies the main thread when it is done. */
+static void *vi_state_unpack_thread(void *arg)
+{
+	struct vi_state_unpack_pool_t *pool = arg;
+	long long round = 0;
+	int index;
+
+	pthread_mutex_lock(&pool->mutex);
+	while (1)
+	{
+		/* Wait for next round */
+		while (!pool->stop && pool->round == round)
+			pthread_cond_wait(&pool->start_cond, &pool->mutex);
+		if (pool->stop)
+			break;
+		round = pool->round;
+
+		/* Work */
+		pthread_mutex_unlock(&pool->mutex);
+		while ((index = __sync_fetch_and_add(&pool->next, 1)) < pool->count)
+			vi_state_unpack_parse(&pool->batch[index]);
+		pthread_mutex_lock(&pool->mutex);
+
+		/* Last thread done */
+		if (!--pool->pending)
+			pthread_cond_signal(&pool->done_cond);
+	}
+	pthread_mutex_unlock(&pool->mutex);
+	return NULL;
+}
+
+
+static void vi_state_unpack_write(struct vi_state_unpack_block_t *block,
+	long long *num_trace_lines_ptr)
+{
+	struct vi_trace_line_t *trace_line;
+	int i;
+
+	for (i = 0; i < block->num_lines; i++)
 	{
 		/* Copy trace */
+		trace_line = block->lines[i];
 		vi_trace_line_dump(trace_line, vi_state->unzipped_trace_file);
 		if (!strcmp(vi_trace_line_get_command(trace_line), "c"))
 			vi_state->num_cycles = vi_trace_line_get_symbol_long_long(trace_line, "clk");
 		vi_trace_line_free(trace_line);
 
 		/* Show progress */
-		num_trace_lines++;
-		if (num_trace_lines % VI_STATE_PROGRESS_INTERVAL == 1)
+		(*num_trace_lines_ptr)++;
+		if (*num_trace_lines_ptr % VI_STATE_PROGRESS_INTERVAL == 1)
 		{
 			printf("Uncompressing trace (%.1fMB, %lld cycles)   \r",
 				ftell(vi_state->unzipped_trace_file) / 1.048e6, vi_state->num_cycles);
 			fflush(stdout);
 		}
 	}
+}
+
+
+static void vi_state_unpack(char *trace_file_name)
+{
+	struct vi_trace_t *trace_file;
+	struct vi_state_unpack_pool_t pool;
+	struct vi_state_unpack_block_t *blocks;
+	struct vi_state_unpack_block_t *batch;
+	struct vi_state_unpack_block_t *next_batch;
+
+	long long num_trace_lines;
+
+	int num_threads;
+	int line_num;
+	int count;
+	int next_count;
+	int i;
+
+	/* One block per host core in each batch. Two batches are used, one
+	 * being parsed while the other is read. */
+	num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	num_threads = MAX(1, MIN(num_threads, VI_STATE_UNPACK_MAX_THREADS));
+	blocks = xcalloc(num_threads * 2, sizeof(struct vi_state_unpack_block_t));
+	batch = blocks;
+	next_batch = blocks + num_threads;
+
+	/* Launch threads */
+	memset(&pool, 0, sizeof pool);
+	pool.num_threads = num_threads;
+	pool.threads = xcalloc(num_threads, sizeof(pthread_t));
+	pthread_mutex_init(&pool.mutex, NULL);
+	pthread_cond_init(&pool.start_cond, NULL);
+	pthread_cond_init(&pool.done_cond, NULL);
+	for (i = 0; i < num_threads; i++)
+		if (pthread_create(&pool.threads[i], NULL,
+				vi_state_unpack_thread, &pool))
+			fatal("%s: could not create host thread", __FUNCTION__);
+
+	/* Unpack trace */
+	line_num = 1;
+	num_trace_lines = 0;
+	trace_file = vi_trace_create(trace_file_name);
+	count = vi_state_unpack_read(batch, num_threads, trace_file, &line_num);
+	while (count)
+	{
+		/* Parse current batch */
+		pthread_mutex_lock(&pool.mutex);
+		pool.batch = batch;
+		pool.count = count;
+		pool.next = 0;
+		pool.round++;
+		pool.pending = pool.num_threads;
+		pthread_cond_broadcast(&pool.start_cond);
+		pthread_mutex_unlock(&pool.mutex);
+
+		/* Read next batch meanwhile */
+		next_count = vi_state_unpack_read(next_batch, num_threads,
+			trace_file, &line_num);
+
+		/* Wait for threads */
+		pthread_mutex_lock(&pool.mutex);
+		while (pool.pending)
+			pthread_cond_wait(&pool.done_cond, &pool.mutex);
+		pthread_mutex_unlock(&pool.mutex);
+
+		/* Dump current batch in order */
+		for (i = 0; i < count; i++)
+			vi_state_unpack_write(&batch[i], &num_trace_lines);
+
+		/* Next */
+		batch = batch == blocks ? blocks + num_threads : blocks;
+		next_batch = next_batch == blocks ? blocks + num_threads : blocks;
+		count = next_count;
+	}
 	vi_trace_free(trace_file);
 
+	/* Stop threads */
+	pthread_mutex_lock(&pool.mutex);
+	pool.stop = 1;
+	pthread_cond_broadcast(&pool.start_cond);
+	pthread_mutex_unlock(&pool.mutex);
+	for (i = 0; i < num_threads; i++)
+		pthread_join(pool.threads[i], NULL);
+	pthread_mutex_destroy(&pool.mutex);
+	pthread_cond_destroy(&pool.start_cond);
+	pthread_cond_destroy(&pool.done_cond);
+	free(pool.threads);
+
+	/* Free blocks */
+	for (i = 0; i < num_threads * 2; i++)
+		free(blocks[i].text);
+	free(blocks);
+
 	/* Final progress */
 	printf("Uncompressing trace (%.1fMB, %lld cycles)   \n",
 		ftell(vi_state->unzipped_trace_file) / 1.048e6, vi_state->num_cycles);
@@ -287,6 +682,61 @@ void vi_state_init(char *trace_file_name)
 }
 
 
+void vi_state_init(char *trace_file_name)
+{
+	char buf[MAX_STRING_SIZE];
+
+	/* Create */
+	vi_state = xcalloc(1, sizeof(struct vi_state_t));
+
+	/* Initialize */
+	vi_state->checkpoint_list = list_create();
+	vi_state->category_list = list_create();
+	vi_state->command_table = hash_table_create(0, FALSE);
+
+	/* File names */
+	vi_state->trace_file_name = xstrdup(trace_file_name);
+	snprintf(buf, sizeof buf, "%s.vi-index", trace_file_name);
+	vi_state->index_file_name = xstrdup(buf);
+	snprintf(buf, sizeof buf, "%s.vi-trace", trace_file_name);
+	vi_state->unzipped_trace_file_name = xstrdup(buf);
+	snprintf(buf, sizeof buf, "%s.vi-checkpoints", trace_file_name);
+	vi_state->checkpoint_file_name = xstrdup(buf);
+
+	/* Reuse uncompressed trace */
+	if (vi_state_index_read(0))
+	{
+		vi_state->unzipped_trace_file = fopen(vi_state->unzipped_trace_file_name, "rb");
+		if (vi_state->unzipped_trace_file)
+		{
+			vi_state->persistent = 1;
+			printf("Reusing uncompressed trace %s (%lld cycles)\n",
+				vi_state->unzipped_trace_file_name, vi_state->num_cycles);
+			fflush(stdout);
+			return;
+		}
+	}
+
+	/* Create uncompressed trace file next to the trace, or a temporary file
+	 * if this is not possible. */
+	unlink(vi_state->index_file_name);
+	vi_state->unzipped_trace_file = fopen(vi_state->unzipped_trace_file_name, "w+b");
+	vi_state->persistent = vi_state->unzipped_trace_file != NULL;
+	if (!vi_state->persistent)
+	{
+		free(vi_state->unzipped_trace_file_name);
+		vi_state->unzipped_trace_file = file_create_temp(buf, sizeof buf);
+		vi_state->unzipped_trace_file_name = xstrdup(buf);
+	}
+
+	/* Unpack trace */
+	vi_state->num_cycles = 0;
+	vi_state_unpack(trace_file_name);
+	if (vi_state->persistent)
+		vi_state_index_write();
+}
+
+
 void vi_state_done(void)
 {
 	struct vi_state_category_t *category;
@@ -297,13 +747,22 @@ void vi_state_done(void)
 
 	int i;
 
-	/* Close and delete uncompressed trace file */
+	/* Stop creating checkpoints */
+	if (vi_state->index_source_id)
+		g_source_remove(vi_state->index_source_id);
+
+	/* Close uncompressed trace file, and delete it if temporary */
 	fclose(vi_state->unzipped_trace_file);
-	unlink(vi_state->unzipped_trace_file_name);
+	if (!vi_state->persistent)
+		unlink(vi_state->unzipped_trace_file_name);
 
-	/* Close and detele checkpoint file */
-	fclose(vi_state->checkpoint_file);
-	unlink(vi_state->checkpoint_file_name);
+	/* Close checkpoint file, and delete it if temporary or incomplete */
+	if (vi_state->checkpoint_file)
+	{
+		fclose(vi_state->checkpoint_file);
+		if (!vi_state->persistent || !vi_state->index_complete)
+			unlink(vi_state->checkpoint_file_name);
+	}
 
 	/* Free checkpoints */
 	LIST_FOR_EACH(vi_state->checkpoint_list, i)
@@ -335,6 +794,8 @@ void vi_state_done(void)
 		vi_trace_line_free(vi_state->body_trace_line);
 
 	/* Free */
+	free(vi_state->trace_file_name);
+	free(vi_state->index_file_name);
 	free(vi_state->unzipped_trace_file_name);
 	free(vi_state->checkpoint_file_name);
 	free(vi_state);
@@ -353,40 +814,56 @@ long long vi_state_get_current_cycle(void)
 }
 
 
-void vi_state_create_checkpoints(void)
+/* Replay the trace from the last checkpoint, creating a new checkpoint every
+ * 'VI_STATE_CHECKPOINT_INTERVAL' cycles, until the first checkpoint after
+ * 'VI_STATE_INDEX_STEP_LINES' trace lines, or the end of the trace. The state
+ * of the panels is overwritten, and must be restored by the caller. */
+static void vi_state_index_step(void)
 {
+	struct vi_state_checkpoint_t *checkpoint;
+	struct vi_state_command_t *state_command;
 	struct vi_trace_line_t *trace_line;
 
 	long long last_checkpoint_cycle;
 	long unzipped_trace_file_size;
 
 	int num_trace_lines;
+	int num_checkpoints;
+	int count;
+
+	char *command;
 
 	/* Get unzipped trace file size */
-	fseek(vi_state->unzipped_trace_file, 0, SEEK_END);
-	unzipped_trace_file_size = ftell(vi_state->unzipped_trace_file);
+	unzipped_trace_file_size = vi_state_file_size(vi_state->unzipped_trace_file_name);
 
-	/* Initialize */
-	last_checkpoint_cycle = -VI_STATE_CHECKPOINT_INTERVAL;
-	fseek(vi_state->unzipped_trace_file, 0, SEEK_SET);
+	/* Resume from the last checkpoint, or from the beginning of the trace */
+	count = list_count(vi_state->checkpoint_list);
+	if (count)
+	{
+		vi_state_read_checkpoint(count - 1);
+		checkpoint = list_get(vi_state->checkpoint_list, count - 1);
+		last_checkpoint_cycle = checkpoint->cycle;
+	}
+	else
+	{
+		last_checkpoint_cycle = -VI_STATE_CHECKPOINT_INTERVAL;
+		fseek(vi_state->unzipped_trace_file, 0, SEEK_SET);
+		vi_state->cycle = 0;
+	}
 
 	/* Parse uncompressed trace file */
 	num_trace_lines = 0;
-	vi_state->cycle = 0;
 	while ((trace_line = vi_trace_line_create_from_file(vi_state->unzipped_trace_file)))
 	{
-		struct vi_state_checkpoint_t *checkpoint;
-		struct vi_state_command_t *state_command;
-
-		char *command;
-
 		/* Get command */
 		command = vi_trace_line_get_command(trace_line);
 
 		/* New cycle command */
+		num_checkpoints = 0;
 		if (!strcasecmp(command, "c"))
 		{
 			vi_state->cycle = atoll(vi_trace_line_get_symbol(trace_line, "clk"));
+			fseek(vi_state->checkpoint_file, 0, SEEK_END);
 			while (vi_state->cycle >= last_checkpoint_cycle + VI_STATE_CHECKPOINT_INTERVAL)
 			{
 				last_checkpoint_cycle += VI_STATE_CHECKPOINT_INTERVAL;
@@ -395,6 +872,7 @@ void vi_state_create_checkpoints(void)
 					ftell(vi_state->checkpoint_file));
 				list_add(vi_state->checkpoint_list, checkpoint);
 				vi_state_write_checkpoint();
+				num_checkpoints++;
 			}
 		}
 
@@ -408,8 +886,8 @@ void vi_state_create_checkpoints(void)
 		}
 
 		/* Progress */
-		num_trace_lines++;
-		if (num_trace_lines % VI_STATE_PROGRESS_INTERVAL == 1)
+		vi_state->num_indexed_trace_lines++;
+		if (vi_state->num_indexed_trace_lines % VI_STATE_PROGRESS_INTERVAL == 1)
 		{
 			printf("Creating checkpoints (%.1fMB, %.1f%%)   \r",
 				ftell(vi_state->checkpoint_file) / 1.048e6,
@@ -421,19 +899,127 @@ void vi_state_create_checkpoints(void)
 
 		/* Free trace line */
 		vi_trace_line_free(trace_line);
+
+		/* End of step. The next one resumes from the new checkpoint. */
+		num_trace_lines++;
+		if (num_checkpoints && num_trace_lines >= VI_STATE_INDEX_STEP_LINES)
+			return;
 	}
 
 	/* Progress */
+	fseek(vi_state->checkpoint_file, 0, SEEK_END);
 	printf("Creating checkpoints (%.1fMB, 100%%)   \n",
 		ftell(vi_state->checkpoint_file) / 1.048e6);
 	fflush(stdout);
 
+	/* All checkpoints created */
+	vi_state->index_complete = 1;
+	if (vi_state->persistent)
+		vi_state_index_write();
+}
+
+
+/* Go back to the cycle shown in the panels after a step of the checkpoint
+ * construction */
+static void vi_state_index_restore(long long cycle)
+{
+	vi_state->cycle = -1;
+	vi_state_go_to_cycle(cycle);
+}
+
+
+/* Make sure that checkpoint 'index' is created, or that all checkpoints are,
+ * creating them right away otherwise */
+static void vi_state_index_wait(int index)
+{
+	long long cycle;
+
+	/* Already created */
+	if (vi_state->index_complete || index < list_count(vi_state->checkpoint_list))
+		return;
+
+	/* Create checkpoints */
+	cycle = vi_state->cycle;
+	while (!vi_state->index_complete && index >= list_count(vi_state->checkpoint_list))
+		vi_state_index_step();
+	vi_state_index_restore(cycle);
+}
+
+
+static gboolean vi_state_index_idle(gpointer data)
+{
+	long long cycle;
+
+	/* One step, keeping the cycle shown in the panels. The panels still
+	 * point to the objects freed when the state is restored, so they are
+	 * refreshed as if the cycle had changed. */
+	cycle = vi_state->cycle;
+	vi_state_index_step();
+	vi_state_index_restore(cycle);
+	if (vi_state->refresh_func)
+		vi_state->refresh_func(vi_state->refresh_func_arg);
+
+	/* Continue while the GUI is idle, until all checkpoints are created */
+	if (!vi_state->index_complete)
+		return TRUE;
+	vi_state->index_source_id = 0;
+	return FALSE;
+}
+
+
+void vi_state_create_checkpoints(void)
+{
+	char buf[MAX_STRING_SIZE];
+
+	/* Reuse checkpoints */
+	if (vi_state->persistent)
+	{
+		vi_state->checkpoint_file = fopen(vi_state->checkpoint_file_name, "rb");
+		if (vi_state->checkpoint_file && vi_state_index_read(1))
+		{
+			vi_state->index_complete = 1;
+			printf("Reusing checkpoints %s\n", vi_state->checkpoint_file_name);
+			fflush(stdout);
+			vi_state_read_checkpoint(0);
+			return;
+		}
+		if (vi_state->checkpoint_file)
+			fclose(vi_state->checkpoint_file);
+	}
+
+	/* Create checkpoint file next to the trace, or a temporary file if this
+	 * is not possible. */
+	vi_state->checkpoint_file = vi_state->persistent ?
+		fopen(vi_state->checkpoint_file_name, "w+b") : NULL;
+	if (!vi_state->checkpoint_file)
+	{
+		vi_state->persistent = 0;
+		free(vi_state->checkpoint_file_name);
+		vi_state->checkpoint_file = file_create_temp(buf, sizeof buf);
+		vi_state->checkpoint_file_name = xstrdup(buf);
+	}
+
+	/* Create first checkpoint */
+	while (!vi_state->index_complete && !list_count(vi_state->checkpoint_list))
+		vi_state_index_step();
+
 	/* No checkpoint created - assume trace file empty */
 	if (!list_count(vi_state->checkpoint_list))
 		fatal("empty trace");
 
 	/* Load first checkpoint */
 	vi_state_read_checkpoint(0);
+
+	/* Create the rest of checkpoints while the GUI is idle */
+	if (!vi_state->index_complete)
+		vi_state->index_source_id = g_idle_add(vi_state_index_idle, NULL);
+}
+
+
+void vi_state_set_refresh_func(vi_state_refresh_func_t refresh_func, void *user_data)
+{
+	vi_state->refresh_func = refresh_func;
+	vi_state->refresh_func_arg = user_data;
 }
 
 
@@ -529,16 +1115,17 @@ struct vi_trace_line_t *vi_state_trace_line_first(long long cycle)
 	if (cycle > vi_state->num_cycles)
 		return NULL;
 
-	/* Store current position in trace file */
-	trace_file_offset = ftell(vi_state->unzipped_trace_file);
-
 	/* Get closest checkpoint */
 	checkpoint_index = cycle / VI_STATE_CHECKPOINT_INTERVAL;
 	checkpoint_cycle = (long long) checkpoint_index * VI_STATE_CHECKPOINT_INTERVAL;
+	vi_state_index_wait(checkpoint_index);
 	checkpoint = list_get(vi_state->checkpoint_list, checkpoint_index);
 	if (!checkpoint)
 		panic("%s: invalid checkpoint index", __FUNCTION__);
 
+	/* Store current position in trace file */
+	trace_file_offset = ftell(vi_state->unzipped_trace_file);
+
 	/* Set position in trace file */
 	fseek(vi_state->unzipped_trace_file, checkpoint->unzipped_trace_file_offset, SEEK_SET);
 	vi_state->body_trace_line_offset = checkpoint->unzipped_trace_file_offset;
@@ -603,6 +1190,7 @@ void vi_state_go_to_cycle(long long cycle)
 	/* Load a checkpoint */
 	checkpoint_index = cycle / VI_STATE_CHECKPOINT_INTERVAL;
 	checkpoint_cycle = (long long) checkpoint_index * VI_STATE_CHECKPOINT_INTERVAL;
+	vi_state_index_wait(checkpoint_index);
 	if (cycle < vi_state->cycle || checkpoint_cycle > vi_state->cycle)
 		vi_state_read_checkpoint(checkpoint_index);
 
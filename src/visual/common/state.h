@@ -26,6 +26,7 @@ struct vi_trace_line_t;
 typedef void (*vi_state_write_checkpoint_func_t)(void *user_data, FILE *f);
 typedef void (*vi_state_read_checkpoint_func_t)(void *user_data, FILE *f);
 typedef void (*vi_state_process_trace_line_func_t)(void *user_data, struct vi_trace_line_t *trace_line);
+typedef void (*vi_state_refresh_func_t)(void *user_data);
 
 #define VI_STATE_FOR_EACH_HEADER(trace_line) \
 	for ((trace_line) = vi_state_header_first(); \
@@ -38,6 +39,7 @@ long long vi_state_get_num_cycles(void);
 long long vi_state_get_current_cycle(void);
 
 void vi_state_create_checkpoints(void);
+void vi_state_set_refresh_func(vi_state_refresh_func_t refresh_func, void *user_data);
 
 void vi_state_new_category(char *name,
 	vi_state_read_checkpoint_func_t read_checkpoint_func,
@@ -26,6 +26,8 @@
 #include <lib/util/hash-table.h>
 #include <lib/util/string.h>
 
+#include "trace.h"
+
 
 
 
@@ -140,32 +142,19 @@ struct vi_trace_line_t *vi_trace_line_create_from_file(FILE *f)
 }
 
 
-struct vi_trace_line_t *vi_trace_line_create_from_trace(struct vi_trace_t *trace)
+/* Parse line 'line_num' of a plain-text trace, read into 'buf' with a call to
+ * 'vi_trace_read_line'. The contents of 'buf' are modified. Lines of the same
+ * trace can be parsed by several threads at a time. */
+struct vi_trace_line_t *vi_trace_line_create_from_string(struct vi_trace_t *trace,
+	char *buf, int line_num)
 {
 	struct vi_trace_line_t *line;
 
-	long int offset;
-
-	char buf[4096];
-	char *buf_ptr;
-
-	/* Read line from trace file */
-	offset = gztell(trace->f);
-	buf_ptr = gzgets(trace->f, buf, sizeof buf);
-
-	/* Empty line */
-	if (!buf_ptr)
-		return NULL;
-
-	/* Line too long */
-	if (strlen(buf) == sizeof(buf) - 1)
-		fatal("%s: buffer too small", __FUNCTION__);
+	char *buf_ptr = buf;
 
 	/* Initialize */
 	line = xcalloc(1, sizeof(struct vi_trace_line_t));
-	trace->line_num++;
-	line->offset = offset;
-	line->line_num = trace->line_num;
+	line->line_num = line_num;
 	line->symbol_table = hash_table_create(13, FALSE);
 
 	/* Read command */
@@ -177,7 +166,7 @@ struct vi_trace_line_t *vi_trace_line_create_from_trace(struct vi_trace_t *trace
 	if (*buf_ptr)
 		*buf_ptr++ = '\0';
 	if (!strlen(line->command))
-		fatal("%s: line %d: invalid command", trace->name, trace->line_num);
+		fatal("%s: line %d: invalid command", trace->name, line_num);
 	line->command = xstrdup(line->command);
 
 	/* Read symbols */
@@ -193,7 +182,7 @@ struct vi_trace_line_t *vi_trace_line_create_from_trace(struct vi_trace_t *trace
 		while (isidchar(*buf_ptr))
 			buf_ptr++;
 		if (*buf_ptr != '=')
-			fatal("%s: line %d: invalid format", trace->name, trace->line_num);
+			fatal("%s: line %d: invalid format", trace->name, line_num);
 		*buf_ptr++ = '\0';
 
 		/* Read symbol value */
@@ -203,7 +192,7 @@ struct vi_trace_line_t *vi_trace_line_create_from_trace(struct vi_trace_t *trace
 			while (*buf_ptr && *buf_ptr != '"')
 				buf_ptr++;
 			if (*buf_ptr != '"')
-				fatal("%s: line %d: invalid format", trace->name, trace->line_num);
+				fatal("%s: line %d: invalid format", trace->name, line_num);
 			*buf_ptr++ = '\0';
 		}
 		else
@@ -229,6 +218,26 @@ struct vi_trace_line_t *vi_trace_line_create_from_trace(struct vi_trace_t *trace
 }
 
 
+struct vi_trace_line_t *vi_trace_line_create_from_trace(struct vi_trace_t *trace)
+{
+	struct vi_trace_line_t *line;
+
+	long int offset;
+
+	char buf[4096];
+
+	/* Read line from trace file */
+	offset = gztell(trace->f);
+	if (!vi_trace_read_line(trace, buf, sizeof buf))
+		return NULL;
+
+	/* Parse it */
+	line = vi_trace_line_create_from_string(trace, buf, trace->line_num);
+	line->offset = offset;
+	return line;
+}
+
+
 void vi_trace_line_free(struct vi_trace_line_t *line)
 {
 	char *symbol_name;
@@ -383,3 +392,21 @@ void vi_trace_free(struct vi_trace_t *trace)
 	free(trace);
 }
 
+
+/* Read the next line of the trace into 'buf', a buffer of 'size' bytes. The
+ * function returns NULL at the end of the trace. */
+char *vi_trace_read_line(struct vi_trace_t *trace, char *buf, int size)
+{
+	/* End of trace */
+	if (!gzgets(trace->f, buf, size))
+		return NULL;
+
+	/* Line too long */
+	if (strlen(buf) == size - 1)
+		fatal("%s: buffer too small", __FUNCTION__);
+
+	/* Return */
+	trace->line_num++;
+	return buf;
+}
+
@@ -28,11 +28,15 @@ struct vi_trace_t;
 struct vi_trace_t *vi_trace_create(char *file_name);
 void vi_trace_free(struct vi_trace_t *trace);
 
+char *vi_trace_read_line(struct vi_trace_t *trace, char *buf, int size);
+
 
 struct vi_trace_line_t;
 
 struct vi_trace_line_t *vi_trace_line_create_from_file(FILE *f);
 struct vi_trace_line_t *vi_trace_line_create_from_trace(struct vi_trace_t *trace);
+struct vi_trace_line_t *vi_trace_line_create_from_string(struct vi_trace_t *trace,
+	char *buf, int line_num);
 void vi_trace_line_free(struct vi_trace_line_t *line);
 
 void vi_trace_line_dump(struct vi_trace_line_t *line, FILE *f);
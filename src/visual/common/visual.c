@@ -76,6 +76,12 @@ static void visual_cycle_bar_refresh(void *user_data, long long cycle)
 }
 
 
+static void visual_state_refresh(void *user_data)
+{
+	visual_cycle_bar_refresh(NULL, vi_cycle_bar_get_cycle());
+}
+
+
 void visual_run(char *file_name)
 {
 	char *m2s_images_path = "images";
@@ -157,6 +163,10 @@ void visual_run(char *file_name)
 	gtk_box_pack_start(GTK_BOX(vbox), vi_mem_panel_get_widget(vi_mem_panel),
 		TRUE, TRUE, 0);
 
+	/* Refresh panels when checkpoints created while idle replace the
+	 * objects they show */
+	vi_state_set_refresh_func(visual_state_refresh, NULL);
+
 	/* Show */
 	gtk_widget_show_all(window);
 